@@ -0,0 +1,417 @@
+/**
+ * @file unilog_jitter.c
+ * @brief How much logging perturbs the tail latency of a co-running workload
+ *
+ * Usage: unilog_jitter [-n REQUESTS] [-w KIB] [-s STEPS] [-l PER_REQUEST]
+ *                      [-r RATES] [-p PRODUCERS] [-i IDLE] [-c CPU] [-W CPU]
+ *                      [-b CAPACITY]
+ *
+ * A worker thread serves synthetic requests: each one follows STEPS
+ * pointers through a randomly linked working set of KIB kilobytes, so
+ * its latency depends on what stays in the caches. The worker logs
+ * PER_REQUEST entries per request, as application code would, while
+ * PRODUCERS background threads log at each of the aggregate RATES
+ * (entries per second), and a consumer thread with each of the IDLE
+ * strategies drains into /dev/null. This covers the ways logging gets
+ * in the way: the write path itself, cache lines of write_pos and the
+ * ring bouncing between cores, and the consumer's CPU time and cache
+ * footprint.
+ *
+ * Every scenario reports the workload's p50, p99, p999 and maximum
+ * request latency, and the change in p99 and p999 against a run without
+ * any logging. A second baseline run at the end shows the noise.
+ * Use -W and -c to pin worker and consumer as in production.
+ */
+
+#define _GNU_SOURCE  /* pthread_setaffinity_np */
+
+#include <unilog/unilog.h>
+#include <unilog/unilog_consumer.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Maximum number of rates and of background producers */
+#define MAX_RATES 16
+#define MAX_PRODUCERS 64
+
+/* Requests not measured while caches and branch predictors settle */
+#define WARMUP_DIVISOR 10
+
+/* Producers write in bursts once per tick */
+#define TICK_NS 1000000L
+
+/* Size of the consumer's output buffer */
+#define OUTPUT_SIZE 65536
+
+static const char *const idle_names[] = { "spin", "yield", "park", "wait" };
+
+typedef struct {
+    uint32_t requests;          /* Requests per scenario, after warmup */
+    uint32_t steps;             /* Pointers followed per request */
+    uint32_t per_request;       /* Entries the worker logs per request */
+    uint32_t *next;             /* Working set: index of the next line, per line */
+    uint32_t lines;             /* Number of cache lines in the working set */
+    int worker_cpu;             /* CPU to pin the worker to, -1 for none */
+    uint64_t *latencies;        /* Request latencies in ns */
+    uint64_t dropped;           /* Writes that found the log full */
+} workload_t;
+
+typedef struct {
+    unilog_t *log;              /* Log to write to */
+    uint32_t rate;              /* Entries per second */
+    _Atomic(bool) *running;     /* Cleared to stop */
+    uint64_t dropped;           /* Writes that found the log full */
+} producer_t;
+
+typedef struct {
+    int fd;                     /* Output, /dev/null */
+    char buffer[OUTPUT_SIZE];   /* Messages of the current batch */
+    size_t used;                /* Bytes in buffer */
+} output_t;
+
+typedef struct {
+    uint64_t p50, p99, p999, max;
+} result_t;
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n REQUESTS] [-w KIB] [-s STEPS] [-l PER_REQUEST] [-r RATES]\n"
+            "          [-p PRODUCERS] [-i IDLE] [-c CPU] [-W CPU] [-b CAPACITY]\n"
+            "  RATES: entries per second, comma-separated (default 0,10000,100000,1000000)\n"
+            "  IDLE:  consumer idle strategies, comma-separated: spin,yield,park,wait\n",
+            argv0);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void pin(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        fprintf(stderr, "cannot pin to CPU %d: %s\n", cpu, strerror(error));
+    }
+}
+
+/* Link the lines of the working set into one cycle in random order */
+static uint32_t *make_working_set(uint32_t lines) {
+    uint32_t stride = 64 / sizeof(uint32_t);
+    uint32_t *next = aligned_alloc(64, (size_t)lines * 64);
+    uint32_t *order = malloc((size_t)lines * sizeof(uint32_t));
+    if (!next || !order) {
+        free(next);
+        free(order);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < lines; i++) {
+        order[i] = i;
+    }
+    srand(1);
+    for (uint32_t i = lines - 1; i > 0; i--) {
+        uint32_t j = (uint32_t)rand() % (i + 1);
+        uint32_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    for (uint32_t i = 0; i < lines; i++) {
+        next[order[i] * stride] = order[(i + 1) % lines] * stride;
+    }
+    free(order);
+    return next;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Serve requests, logging per_request entries in each when log is set */
+static result_t run_workload(workload_t *work, unilog_t *log) {
+    uint32_t warmup = work->requests / WARMUP_DIVISOR;
+    uint32_t position = 0;
+    char message[64];
+
+    for (uint32_t r = 0; r < warmup + work->requests; r++) {
+        uint64_t start = now_ns();
+        for (uint32_t s = 0; s < work->steps; s++) {
+            position = work->next[position];
+        }
+        if (log) {
+            for (uint32_t e = 0; e < work->per_request; e++) {
+                int length = snprintf(message, sizeof(message), "request %u step %u at %u",
+                                      r, e, position);
+                if (unilog_write_raw(log, UNILOG_LEVEL_INFO, r, message, (size_t)length) ==
+                    UNILOG_ERR_FULL) {
+                    work->dropped++;
+                }
+            }
+        }
+        uint64_t end = now_ns();
+        if (r >= warmup) {
+            work->latencies[r - warmup] = end - start;
+        }
+    }
+
+    /* Keep the chase from being optimized away */
+    __asm__ __volatile__("" : : "r"(position));
+
+    qsort(work->latencies, work->requests, sizeof(uint64_t), compare_u64);
+    uint32_t n = work->requests;
+    result_t result = {
+        work->latencies[n / 2],
+        work->latencies[(uint64_t)n * 99 / 100],
+        work->latencies[(uint64_t)n * 999 / 1000],
+        work->latencies[n - 1],
+    };
+    return result;
+}
+
+static void *producer_main(void *arg) {
+    producer_t *producer = (producer_t *)arg;
+    char message[64];
+    uint32_t sequence = 0;
+    uint64_t credit = 0;        /* Fraction of an entry owed, times 1e9 */
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load_explicit(producer->running, memory_order_relaxed)) {
+        /* Carry the fraction of an entry to the next tick, so any rate is exact */
+        credit += (uint64_t)producer->rate * TICK_NS;
+        uint64_t count = credit / 1000000000u;
+        credit %= 1000000000u;
+        for (uint64_t i = 0; i < count; i++) {
+            int length = snprintf(message, sizeof(message), "background %u", sequence);
+            if (unilog_write_raw(producer->log, UNILOG_LEVEL_INFO, sequence, message,
+                                 (size_t)length) == UNILOG_ERR_FULL) {
+                producer->dropped++;
+            }
+            sequence++;
+        }
+        next.tv_nsec += TICK_NS;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+    }
+    return NULL;
+}
+
+static void output_entry(void *ctx, const unilog_entry_info_t *info, const char *message,
+                         size_t length) {
+    output_t *output = (output_t *)ctx;
+    (void)info;
+    if (output->used + length + 1 > sizeof(output->buffer)) {
+        return;
+    }
+    memcpy(output->buffer + output->used, message, length);
+    output->buffer[output->used + length] = '\n';
+    output->used += length + 1;
+}
+
+static void output_flush(void *ctx) {
+    output_t *output = (output_t *)ctx;
+    if (output->used > 0 && write(output->fd, output->buffer, output->used) < 0) {
+        perror("write");
+    }
+    output->used = 0;
+}
+
+static void print_result(const char *name, result_t result, const result_t *baseline,
+                         uint64_t dropped) {
+    printf("%-22s %9llu %9llu %9llu %10llu", name, (unsigned long long)result.p50,
+           (unsigned long long)result.p99, (unsigned long long)result.p999,
+           (unsigned long long)result.max);
+    if (baseline) {
+        printf(" %+9lld %+9lld %9llu", (long long)(result.p99 - baseline->p99),
+               (long long)(result.p999 - baseline->p999), (unsigned long long)dropped);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/* Parse a comma-separated list of numbers; returns the count or -1 */
+static int parse_rates(char *list, uint32_t *rates) {
+    int count = 0;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if (count == MAX_RATES) {
+            return -1;
+        }
+        rates[count++] = (uint32_t)strtoul(item, NULL, 0);
+    }
+    return count;
+}
+
+/* Parse a comma-separated list of idle strategy names into a bit mask */
+static int parse_idle(char *list) {
+    int mask = 0;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        int found = -1;
+        for (int i = 0; i < (int)(sizeof(idle_names) / sizeof(idle_names[0])); i++) {
+            if (strcmp(item, idle_names[i]) == 0) {
+                found = i;
+            }
+        }
+        if (found < 0) {
+            return -1;
+        }
+        mask |= 1 << found;
+    }
+    return mask;
+}
+
+int main(int argc, char **argv) {
+    workload_t work = { 200000, 256, 1, NULL, 0, -1, NULL, 0 };
+    uint32_t working_set_kib = 256;
+    uint32_t rates[MAX_RATES] = { 0, 10000, 100000, 1000000 };
+    int rate_count = 4;
+    uint32_t producer_count = 2;
+    int idle_mask = 1 << UNILOG_IDLE_PARK | 1 << UNILOG_IDLE_WAIT;
+    int consumer_cpu = -1;
+    uint32_t capacity = 1u << 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:w:s:l:r:p:i:c:W:b:")) != -1) {
+        switch (opt) {
+            case 'n':
+                work.requests = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                working_set_kib = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                work.steps = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                work.per_request = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                rate_count = parse_rates(optarg, rates);
+                break;
+            case 'p':
+                producer_count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                idle_mask = parse_idle(optarg);
+                break;
+            case 'c':
+                consumer_cpu = (int)strtol(optarg, NULL, 0);
+                break;
+            case 'W':
+                work.worker_cpu = (int)strtol(optarg, NULL, 0);
+                break;
+            case 'b':
+                capacity = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc || work.requests < WARMUP_DIVISOR || work.steps == 0 ||
+        working_set_kib == 0 || rate_count <= 0 || idle_mask <= 0 ||
+        producer_count > MAX_PRODUCERS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    work.lines = working_set_kib * 1024 / 64;
+    work.next = make_working_set(work.lines);
+    work.latencies = malloc((size_t)work.requests * sizeof(uint64_t));
+    uint8_t *ring = calloc(1, capacity);
+    static unilog_t log;
+    static output_t output;
+    output.fd = open("/dev/null", O_WRONLY);
+    if (!work.next || !work.latencies || !ring || output.fd < 0 ||
+        unilog_init_zeroed(&log, ring, capacity) != UNILOG_OK) {
+        fprintf(stderr, "cannot set up: working set, ring of %u bytes or /dev/null\n",
+                capacity);
+        return 1;
+    }
+    pin(work.worker_cpu);
+
+    printf("%u requests of %u steps over %u KiB, %u entries per request, "
+           "%u background producers\n\n",
+           work.requests, work.steps, working_set_kib, work.per_request, producer_count);
+    printf("%-22s %9s %9s %9s %10s %9s %9s %9s\n", "scenario (ns)", "p50", "p99", "p999", "max",
+           "d-p99", "d-p999", "dropped");
+
+    result_t baseline = run_workload(&work, NULL);
+    print_result("no logging", baseline, NULL, 0);
+
+    for (int idle = 0; idle < (int)(sizeof(idle_names) / sizeof(idle_names[0])); idle++) {
+        if (!(idle_mask & 1 << idle)) {
+            continue;
+        }
+        for (int r = 0; r < rate_count; r++) {
+            unilog_consumer_config_t config;
+            unilog_consumer_config_init(&config, output_entry, &output);
+            config.batch_end = output_flush;
+            config.idle = (unilog_idle_t)idle;
+            config.cpu = consumer_cpu;
+            static unilog_consumer_t consumer;
+            static char message_buffer[256];
+            if (unilog_consumer_start(&consumer, &log, &config, message_buffer,
+                                      sizeof(message_buffer)) != UNILOG_OK) {
+                fprintf(stderr, "cannot start consumer\n");
+                return 1;
+            }
+
+            static producer_t producers[MAX_PRODUCERS];
+            static pthread_t threads[MAX_PRODUCERS];
+            _Atomic(bool) running = true;
+            uint32_t started = rates[r] > 0 ? producer_count : 0;
+            for (uint32_t p = 0; p < started; p++) {
+                producers[p].log = &log;
+                producers[p].rate = rates[r] / started + (p < rates[r] % started);
+                producers[p].running = &running;
+                producers[p].dropped = 0;
+                if (pthread_create(&threads[p], NULL, producer_main, &producers[p]) != 0) {
+                    fprintf(stderr, "cannot start producer\n");
+                    return 1;
+                }
+            }
+
+            work.dropped = 0;
+            result_t result = run_workload(&work, &log);
+
+            atomic_store(&running, false);
+            uint64_t dropped = work.dropped;
+            for (uint32_t p = 0; p < started; p++) {
+                pthread_join(threads[p], NULL);
+                dropped += producers[p].dropped;
+            }
+            unilog_consumer_stop(&consumer);
+
+            char name[32];
+            snprintf(name, sizeof(name), "%s %u/s", idle_names[idle], rates[r]);
+            print_result(name, result, &baseline, dropped);
+        }
+    }
+
+    result_t again = run_workload(&work, NULL);
+    print_result("no logging (again)", again, &baseline, 0);
+
+    close(output.fd);
+    free(ring);
+    free(work.latencies);
+    free(work.next);
+    return 0;
+}
@@ -0,0 +1,215 @@
+# Footprint report for the unilog_size target (run with cmake -P).
+#
+# Inputs:
+#   OBJECTS  object files compiled with -fcallgraph-info=su, separated by |
+#   HEADERS  directory of the public headers
+#   NM       nm of the toolchain
+#   SIZE     size of the toolchain
+#   OUTPUT   file to write the report to
+#
+# Prints .text/.data/.bss per object, then for every public function
+# the code it pulls in (itself and the library functions it can call)
+# and its worst-case stack depth along the call graph. A "+" marks
+# depths that exclude callees outside the library (libc) or frames of
+# unbounded dynamic size.
+
+cmake_minimum_required(VERSION 3.10)
+
+string(REPLACE "|" ";" objects "${OBJECTS}")
+
+set(report "")
+macro(emit line)
+    string(APPEND report "${line}\n")
+endmacro()
+
+function(pad text width out)
+    string(LENGTH "${text}" length)
+    set(padded "${text}")
+    while(length LESS width)
+        string(APPEND padded " ")
+        math(EXPR length "${length} + 1")
+    endwhile()
+    set(${out} "${padded}" PARENT_SCOPE)
+endfunction()
+
+function(rpad text width out)
+    string(LENGTH "${text}" length)
+    set(padded "${text}")
+    while(length LESS width)
+        set(padded " ${padded}")
+        math(EXPR length "${length} + 1")
+    endwhile()
+    set(${out} "${padded}" PARENT_SCOPE)
+endfunction()
+
+# Sections per object
+pad("Object" 28 header)
+emit("${header}     .text     .data      .bss")
+set(total_text 0)
+set(total_data 0)
+set(total_bss 0)
+set(nodes "")
+foreach(object IN LISTS objects)
+    get_filename_component(object_name "${object}" NAME)
+    execute_process(COMMAND "${SIZE}" "${object}" OUTPUT_VARIABLE size_output
+                    RESULT_VARIABLE size_result)
+    if(NOT size_result EQUAL 0)
+        message(FATAL_ERROR "${SIZE} failed on ${object}")
+    endif()
+    string(REGEX MATCH "\n[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)" row "${size_output}")
+    set(text ${CMAKE_MATCH_1})
+    set(data ${CMAKE_MATCH_2})
+    set(bss ${CMAKE_MATCH_3})
+    math(EXPR total_text "${total_text} + ${text}")
+    math(EXPR total_data "${total_data} + ${data}")
+    math(EXPR total_bss "${total_bss} + ${bss}")
+    pad("${object_name}" 28 name_column)
+    rpad("${text}" 10 text_column)
+    rpad("${data}" 10 data_column)
+    rpad("${bss}" 10 bss_column)
+    emit("${name_column}${text_column}${data_column}${bss_column}")
+
+    # Call graph: nodes carry the frame size, statics are titled source:name
+    string(REGEX REPLACE "\\.[^.]*$" ".ci" graph "${object}")
+    if(NOT EXISTS "${graph}")
+        message(FATAL_ERROR "No call graph for ${object} (needs -fcallgraph-info=su)")
+    endif()
+    file(STRINGS "${graph}" lines)
+    set(source "")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^graph: { title: \"([^\"]*)\"")
+            set(source "${CMAKE_MATCH_1}")
+        elseif(line MATCHES "^node: { title: \"([^\"]*)\" label: \"([^\\\\\"]*)[^\"]*\\\\n([0-9]+) bytes \\(([a-z,]*)\\)")
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_1}" key)
+            list(APPEND nodes ${key})
+            set(NAME_${key} "${CMAKE_MATCH_2}")
+            set(FRAME_${key} ${CMAKE_MATCH_3})
+            set(CODE_${key} 0)
+            set(PLUS_${key} 0)
+            if(CMAKE_MATCH_4 STREQUAL "dynamic")
+                set(PLUS_${key} 1)
+            endif()
+        elseif(line MATCHES "^edge: { sourcename: \"([^\"]*)\" targetname: \"([^\"]*)\"")
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_1}" from)
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_2}" to)
+            list(APPEND CALLEES_${from} ${to})
+        endif()
+    endforeach()
+
+    # Code size of each function
+    execute_process(COMMAND "${NM}" -S -t d --defined-only "${object}"
+                    OUTPUT_VARIABLE nm_output RESULT_VARIABLE nm_result)
+    if(NOT nm_result EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${object}")
+    endif()
+    string(REPLACE "\n" ";" symbols "${nm_output}")
+    foreach(symbol IN LISTS symbols)
+        if(symbol MATCHES "^[0-9a-fA-F]+ ([0-9]+) ([TtWw]) (.+)$")
+            if(CMAKE_MATCH_2 STREQUAL "t")
+                string(MAKE_C_IDENTIFIER "${source}:${CMAKE_MATCH_3}" key)
+            else()
+                string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_3}" key)
+            endif()
+            set(CODE_${key} ${CMAKE_MATCH_1})
+        endif()
+    endforeach()
+endforeach()
+pad("Total" 28 name_column)
+rpad("${total_text}" 10 text_column)
+rpad("${total_data}" 10 data_column)
+rpad("${total_bss}" 10 bss_column)
+emit("${name_column}${text_column}${data_column}${bss_column}")
+emit("")
+
+# Worst-case depth: relax frame + deepest callee until nothing changes;
+# more rounds than functions means the graph has a cycle
+list(REMOVE_DUPLICATES nodes)
+list(LENGTH nodes node_count)
+foreach(key IN LISTS nodes)
+    set(WORST_${key} ${FRAME_${key}})
+endforeach()
+set(rounds 0)
+set(changed 1)
+while(changed AND rounds LESS_EQUAL node_count)
+    set(changed 0)
+    math(EXPR rounds "${rounds} + 1")
+    foreach(key IN LISTS nodes)
+        foreach(callee IN LISTS CALLEES_${key})
+            if(NOT DEFINED FRAME_${callee})
+                if(NOT PLUS_${key})
+                    set(PLUS_${key} 1)
+                    set(changed 1)
+                endif()
+                continue()
+            endif()
+            math(EXPR depth "${FRAME_${key}} + ${WORST_${callee}}")
+            if(depth GREATER WORST_${key})
+                set(WORST_${key} ${depth})
+                set(changed 1)
+            endif()
+            if(PLUS_${callee} AND NOT PLUS_${key})
+                set(PLUS_${key} 1)
+                set(changed 1)
+            endif()
+        endforeach()
+    endforeach()
+endwhile()
+if(changed)
+    emit("Note: recursive calls, stack depths are not bounded")
+endif()
+
+# Public functions, as declared in the headers
+file(GLOB headers "${HEADERS}/*.h")
+set(public "")
+foreach(header IN LISTS headers)
+    file(STRINGS "${header}" declarations REGEX "^[a-z].*[ *]unilog_[a-z0-9_]+\\(")
+    foreach(declaration IN LISTS declarations)
+        string(REGEX MATCH "unilog_[a-z0-9_]+\\(" name "${declaration}")
+        string(REPLACE "(" "" name "${name}")
+        list(APPEND public ${name})
+    endforeach()
+endforeach()
+list(REMOVE_DUPLICATES public)
+list(SORT public)
+
+pad("Public function" 36 header)
+emit("${header}      code     stack")
+foreach(name IN LISTS public)
+    string(MAKE_C_IDENTIFIER "${name}" key)
+    if(NOT DEFINED FRAME_${key})
+        continue()
+    endif()
+
+    # Code of everything reachable within the library
+    set(seen ${key})
+    set(queue ${key})
+    set(code 0)
+    while(queue)
+        list(POP_FRONT queue current)
+        math(EXPR code "${code} + ${CODE_${current}}")
+        foreach(callee IN LISTS CALLEES_${current})
+            if(DEFINED FRAME_${callee} AND NOT callee IN_LIST seen)
+                list(APPEND seen ${callee})
+                list(APPEND queue ${callee})
+            endif()
+        endforeach()
+    endwhile()
+
+    set(stack "${WORST_${key}}")
+    if(PLUS_${key})
+        string(APPEND stack "+")
+    else()
+        string(APPEND stack " ")
+    endif()
+    pad("${name}" 36 name_column)
+    rpad("${code}" 10 code_column)
+    rpad("${stack}" 10 stack_column)
+    emit("${name_column}${code_column}${stack_column}")
+endforeach()
+emit("")
+emit("+ excludes callees outside the library or dynamically sized frames")
+
+message("${report}")
+if(OUTPUT)
+    file(WRITE "${OUTPUT}" "${report}")
+endif()
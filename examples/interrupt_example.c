@@ -21,6 +21,16 @@ static uint32_t get_timestamp(void) {
     return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
+/* Display an entry, including producer thread and CPU if recorded */
+static void print_entry(const unilog_entry_info_t *info, const char *message) {
+#if UNILOG_THREAD_INFO
+    printf("[%u] %s (tid %u, cpu %d): %s\n", info->timestamp, unilog_level_name(info->level),
+           info->thread_id, (int)info->cpu_id, message);
+#else
+    printf("[%u] %s: %s\n", info->timestamp, unilog_level_name(info->level), message);
+#endif
+}
+
 /* Simulated interrupt/producer thread */
 static void *producer_thread(void *arg) {
     int thread_id = *(int *)arg;
@@ -64,8 +74,7 @@ int main(void) {
     printf("----------------------------------------\n");
     
     char read_buffer[256];
-    unilog_level_t level;
-    uint32_t timestamp;
+    unilog_entry_info_t info;
     int messages_read = 0;
     int empty_count = 0;
     const int max_empty_checks = 100;  /* Number of empty checks before stopping */
@@ -73,10 +82,10 @@ int main(void) {
     
     /* Keep reading until all threads are done and buffer is empty */
     while (empty_count < max_empty_checks) {
-        int read_len = unilog_read(&g_log, &level, &timestamp, read_buffer, sizeof(read_buffer));
+        int read_len = unilog_read_entry(&g_log, &info, read_buffer, sizeof(read_buffer));
         
         if (read_len > 0) {
-            printf("[%u] %s: %s\n", timestamp, unilog_level_name(level), read_buffer);
+            print_entry(&info, read_buffer);
             messages_read++;
             empty_count = 0;
         } else {
@@ -92,8 +101,8 @@ int main(void) {
     
     /* Read any remaining messages */
     int read_len;
-    while ((read_len = unilog_read(&g_log, &level, &timestamp, read_buffer, sizeof(read_buffer))) > 0) {
-        printf("[%u] %s: %s\n", timestamp, unilog_level_name(level), read_buffer);
+    while ((read_len = unilog_read_entry(&g_log, &info, read_buffer, sizeof(read_buffer))) > 0) {
+        print_entry(&info, read_buffer);
         messages_read++;
     }
     
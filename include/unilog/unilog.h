@@ -10,7 +10,13 @@
 #ifndef UNILOG_H
 #define UNILOG_H
 
+#if defined(__cplusplus) && __cplusplus <= 202002L
+/* No <stdatomic.h> in C++ before C++23; std::atomic has the same layout */
+#include <atomic>
+#define _Atomic(T) std::atomic<T>
+#else
 #include <stdatomic.h>
+#endif
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -19,6 +25,103 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Record producer thread and CPU in every entry header
+ *
+ * Must be defined identically for the library and all code including
+ * this header, as it changes the entry layout. The CMake option
+ * UNILOG_ENABLE_THREAD_INFO takes care of this.
+ */
+#ifndef UNILOG_THREAD_INFO
+#define UNILOG_THREAD_INFO 0
+#endif
+
+/**
+ * @brief Store a CRC32C of header and message in every entry header
+ *
+ * Lets unilog_recover and the decoders detect torn or corrupted entries
+ * and resynchronize behind them. Changes the entry layout, see
+ * UNILOG_THREAD_INFO. The CMake option UNILOG_ENABLE_CRC sets it.
+ */
+#ifndef UNILOG_ENTRY_CRC
+#define UNILOG_ENTRY_CRC 0
+#endif
+
+/**
+ * @brief Support per-thread settings (level overrides, helping)
+ *
+ * Needs thread-local storage. Only affects the library build: with it
+ * set to 0, unilog_set_thread_level and unilog_set_thread_helping have
+ * no effect.
+ */
+#ifndef UNILOG_THREAD_LEVEL
+#define UNILOG_THREAD_LEVEL 1
+#endif
+
+/**
+ * @brief Feature switches for small targets
+ *
+ * Each defaults to 1. Setting one to 0 removes the feature's code from
+ * the library, so it costs neither flash nor stack; its functions stay
+ * declared and fail or do nothing, as described for each. They only
+ * affect the library build. The CMake options UNILOG_ENABLE_FORMAT,
+ * UNILOG_ENABLE_COMPRESSION, UNILOG_ENABLE_HELPING,
+ * UNILOG_ENABLE_RESIZE and UNILOG_ENABLE_THREAD_LEVEL set them.
+ *
+ * - UNILOG_FORMAT: unilog_format, which pulls in vsnprintf and a
+ *   stack buffer of UNILOG_FORMAT_BUFFER_SIZE bytes. Without it,
+ *   unilog_format returns UNILOG_ERR_INVALID.
+ * - UNILOG_COMPRESSION: compression in the write path and
+ *   decompression in unilog_read_entry. Without it,
+ *   unilog_set_compression has no effect and compressed entries read
+ *   as UNILOG_ERR_INVALID (decoders on the host still expand them).
+ * - UNILOG_HELPING: draining by producers. Requires
+ *   UNILOG_THREAD_LEVEL, as producers opt in per thread. Without
+ *   either, unilog_set_helper returns UNILOG_ERR_INVALID.
+ * - UNILOG_RESIZE: moving a log to a new buffer at runtime, at the cost
+ *   of one more load per write. Without it, unilog_resize returns
+ *   UNILOG_ERR_INVALID.
+ */
+#ifndef UNILOG_FORMAT
+#define UNILOG_FORMAT 1
+#endif
+
+#ifndef UNILOG_COMPRESSION
+#define UNILOG_COMPRESSION 1
+#endif
+
+#ifndef UNILOG_HELPING
+#define UNILOG_HELPING 1
+#endif
+
+#ifndef UNILOG_RESIZE
+#define UNILOG_RESIZE 1
+#endif
+
+/**
+ * @brief Size of unilog_format's stack buffer, limiting formatted messages
+ *
+ * Only affects the library build.
+ */
+#ifndef UNILOG_FORMAT_BUFFER_SIZE
+#define UNILOG_FORMAT_BUFFER_SIZE 256
+#endif
+
+/**
+ * @brief Size of the match table used when compressing, as a power of 2
+ *
+ * The table lives on the writer's stack (4 bytes per entry) during
+ * compressed writes. Only affects the library build.
+ */
+#ifndef UNILOG_LZ_HASH_BITS
+#define UNILOG_LZ_HASH_BITS 9
+#endif
+
+/**
+ * @brief CPU ID reported when the platform cannot determine it
+ */
+#define UNILOG_CPU_UNKNOWN UINT32_MAX
+
 /**
  * @brief Log levels supported by unilog
  */
@@ -32,6 +135,15 @@ typedef enum {
     UNILOG_LEVEL_NONE = 6
 } unilog_level_t;
 
+/**
+ * @brief Entry flags, stored above the level in the header's level field
+ */
+#define UNILOG_LEVEL_MASK 0xFFu
+#define UNILOG_FLAGS_SHIFT 8
+#define UNILOG_FLAG_INTERNED 0x01    /**< Message contains interned string references */
+#define UNILOG_FLAG_DEFINITION 0x02  /**< Entry defines an interned string */
+#define UNILOG_FLAG_COMPRESSED 0x04  /**< Message is LZ compressed, see unilog_set_compression */
+
 /**
  * @brief Return codes for unilog operations
  */
@@ -54,6 +166,7 @@ typedef struct {
     _Atomic(uint32_t) read_pos;   /**< Read position (consumer) */
     uint32_t capacity;             /**< Buffer capacity in bytes */
     uint8_t *buffer;               /**< Pointer to buffer storage */
+    bool mirrored;                 /**< Storage is mapped again right after itself */
 } unilog_buffer_t;
 
 /**
@@ -65,16 +178,119 @@ typedef struct {
  */
 typedef struct {
     uint32_t length;        /**< Total length including header and message */
-    unilog_level_t level;   /**< Log level */
+    uint32_t level;         /**< Log level (unilog_level_t) and entry flags, fixed width */
     uint32_t timestamp;     /**< Timestamp (implementation-defined units) */
+#if UNILOG_THREAD_INFO
+    uint32_t thread_id;     /**< Producer thread ID (cached per thread) */
+    uint32_t cpu_id;        /**< CPU the producer was running on */
+#endif
+#if UNILOG_ENTRY_CRC
+    uint32_t crc;           /**< CRC32C of header (with crc = 0) and message */
+#endif
 } unilog_entry_header_t;
 
+/**
+ * @brief Byte order values of unilog_layout_t
+ */
+#define UNILOG_BYTE_ORDER_LITTLE 1
+#define UNILOG_BYTE_ORDER_BIG 2
+
+/**
+ * @brief Optional header fields, as flags in unilog_layout_t.variant
+ */
+#define UNILOG_VARIANT_THREAD_INFO 0x01
+#define UNILOG_VARIANT_CRC 0x02
+
+/**
+ * @brief Self-description of the entry layout of a build
+ * 
+ * Only contains single bytes, so it can be read on any host before
+ * knowing the byte order of the target that produced it. Header fields
+ * are stored in the order length, level, timestamp, then the optional
+ * fields selected by variant (thread and CPU ID, then a 32-bit CRC),
+ * without padding between them.
+ */
+typedef struct {
+    uint8_t byte_order;      /**< UNILOG_BYTE_ORDER_LITTLE or _BIG */
+    uint8_t alignment;       /**< Entry alignment in bytes */
+    uint8_t header_size;     /**< Size of the entry header in bytes */
+    uint8_t variant;         /**< Optional header fields (UNILOG_VARIANT_*) */
+    uint8_t length_width;    /**< Width of the length field in bytes */
+    uint8_t level_width;     /**< Width of the level field in bytes */
+    uint8_t timestamp_width; /**< Width of the timestamp field in bytes */
+    uint8_t id_width;        /**< Width of thread and CPU ID fields in bytes */
+} unilog_layout_t;
+
+/** @brief Ring dump magic, "ULDP" */
+#define UNILOG_DUMP_MAGIC "ULDP"
+
+/**
+ * @brief Header to store in front of a raw copy of the ring buffer
+ * 
+ * Position fields use the byte order given in the layout.
+ */
+typedef struct {
+    char magic[4];           /**< UNILOG_DUMP_MAGIC */
+    unilog_layout_t layout;  /**< Entry layout of the producing target */
+    uint32_t capacity;       /**< Buffer capacity in bytes */
+    uint32_t read_pos;       /**< Consumer position at dump time */
+    uint32_t write_pos;      /**< Producer position at dump time */
+} unilog_dump_header_t;
+
+/**
+ * @brief Decoded metadata of a log entry, filled in by unilog_read_entry
+ */
+typedef struct {
+    unilog_level_t level;   /**< Log level */
+    uint32_t timestamp;     /**< Timestamp (implementation-defined units) */
+    uint32_t thread_id;     /**< Producer thread ID, 0 if not recorded */
+    uint32_t cpu_id;        /**< Producer CPU, UNILOG_CPU_UNKNOWN if not recorded */
+    uint32_t flags;         /**< Entry flags (UNILOG_FLAG_*) */
+} unilog_entry_info_t;
+
+/** @brief Receives entries drained by a producer that found the log full */
+typedef void (*unilog_sink_fn)(void *ctx, const unilog_entry_info_t *info,
+                               const char *message, size_t length);
+
+/**
+ * @brief Sink for cooperative draining, see unilog_set_helper
+ */
+typedef struct {
+    unilog_sink_fn sink;        /**< Called for each drained entry */
+    void *ctx;                  /**< Context passed to sink */
+    char *buffer;               /**< Message buffer, used by one producer at a time */
+    size_t buffer_size;         /**< Size of message buffer */
+    uint32_t max_batch;         /**< Most entries drained by one producer at a time */
+    _Atomic(uint32_t) helped;   /**< Entries drained by producers so far */
+} unilog_helper_t;
+
+/** @brief Called once an armed waiter's watermark is reached */
+typedef void (*unilog_notify_fn)(void *ctx);
+
+/**
+ * @brief Waiter for consumers on an event loop, see unilog_wait_async
+ */
+typedef struct {
+    unilog_notify_fn notify;    /**< Called by the producer that reached the watermark */
+    void *ctx;                  /**< Context passed to notify */
+    uint32_t watermark;         /**< Bytes to wait for, 1 for any entry */
+} unilog_waiter_t;
+
 /**
  * @brief Main unilog context structure
  */
 typedef struct {
     unilog_buffer_t buffer;         /**< Lock-free ring buffer */
     _Atomic(unilog_level_t) min_level;  /**< Minimum log level to record */
+    _Atomic(uint32_t) waiters;          /**< Consumers blocked until the next entry */
+    _Atomic(unilog_waiter_t *) waiter;  /**< Armed asynchronous waiter, NULL if none */
+    _Atomic(uint32_t) watermark;        /**< Watermark of the armed waiter */
+    _Atomic(bool) draining;             /**< Consumer token, held while reading with a helper */
+    _Atomic(unilog_helper_t *) helper;  /**< Sink for cooperative draining, NULL if off */
+    _Atomic(uint32_t) compress_threshold;  /**< Smallest message to compress, 0 if off */
+    unilog_buffer_t spare;              /**< Second ring, used by unilog_resize */
+    _Atomic(unilog_buffer_t *) ring;    /**< Ring producers write to (buffer or spare) */
+    _Atomic(unilog_buffer_t *) read_ring;  /**< Ring the consumer reads, the old one while resizing */
 } unilog_t;
 
 /**
@@ -87,6 +303,22 @@ typedef struct {
  */
 unilog_result_t unilog_init(unilog_t *log, void *buffer, uint32_t capacity);
 
+/**
+ * @brief Initialize a unilog buffer with memory that is already zero
+ * 
+ * Like unilog_init, but without clearing the buffer, which the commit
+ * protocol needs to be zero. Takes constant time and leaves the pages
+ * of large rings untouched, so fresh anonymous mappings (mmap, calloc
+ * of large sizes) or .bss are faulted in lazily as producers reach
+ * them. The consumer keeps the buffer zero behind itself.
+ * 
+ * @param log Pointer to unilog context
+ * @param buffer Pointer to zeroed buffer memory (must remain valid)
+ * @param capacity Buffer capacity in bytes (must be power of 2)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_init_zeroed(unilog_t *log, void *buffer, uint32_t capacity);
+
 /**
  * @brief Set the minimum log level
  * 
@@ -103,6 +335,127 @@ void unilog_set_level(unilog_t *log, unilog_level_t level);
  */
 unilog_level_t unilog_get_level(const unilog_t *log);
 
+/**
+ * @brief Compress large messages before writing them
+ * 
+ * Messages of at least threshold bytes are LZ compressed in the write
+ * path, without allocation, if that makes them smaller. Readers and
+ * decoders decompress them transparently; unilog_peek returns them as
+ * stored, flagged with UNILOG_FLAG_COMPRESSED. Messages that fit only
+ * when compressed may now exceed half the ring size.
+ * 
+ * @param log Pointer to unilog context
+ * @param threshold Smallest message size to compress, 0 to disable
+ */
+void unilog_set_compression(unilog_t *log, uint32_t threshold);
+
+/**
+ * @brief Override the minimum log level for the calling thread
+ * 
+ * Entries from this thread are recorded if they pass either the
+ * override or the log's own minimum level, so the override can only
+ * enable more output, e.g. DEBUG for a single request being traced.
+ * Applies to all logs. Interrupt handlers see the override of the
+ * thread they interrupted.
+ * 
+ * @param level Minimum level for this thread, UNILOG_LEVEL_NONE to clear
+ * @return Previous override, for restoring it at the end of a scope
+ */
+unilog_level_t unilog_set_thread_level(unilog_level_t level);
+
+/**
+ * @brief Remove the calling thread's level override
+ */
+void unilog_clear_thread_level(void);
+
+/**
+ * @brief Get the calling thread's level override
+ * 
+ * @return Current override, UNILOG_LEVEL_NONE if none is set
+ */
+unilog_level_t unilog_get_thread_level(void);
+
+/**
+ * @brief Let producers drain a full log themselves
+ * 
+ * With a helper set, a producer thread that opted in with
+ * unilog_set_thread_helping and finds the log full takes the consumer
+ * token, drains up to max_batch entries into the helper's sink and
+ * retries once, instead of dropping its entry. Readers then take the
+ * same token, and unilog_read_entry returns UNILOG_ERR_BUSY while a
+ * producer is draining. Set before producers and consumer start.
+ * 
+ * @param log Pointer to unilog context
+ * @param helper Helper (must remain valid), NULL to disable
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID on invalid arguments
+ *         or in builds without UNILOG_HELPING or UNILOG_THREAD_LEVEL
+ */
+unilog_result_t unilog_set_helper(unilog_t *log, unilog_helper_t *helper);
+
+/**
+ * @brief Opt the calling thread in or out of cooperative draining
+ * 
+ * Only for threads that may run the helper's sink; never for
+ * interrupt handlers, which see the setting of the thread they
+ * interrupted and should not be delayed by draining.
+ * 
+ * @param enable true to help when a log with a helper is full
+ * @return Previous setting
+ */
+bool unilog_set_thread_helping(bool enable);
+
+/**
+ * @brief Move a log to a new buffer while it is in use
+ * 
+ * Producers switch to the new buffer at once, without blocking. The
+ * consumer first reads the rest of the old buffer, in order, then
+ * continues with the new one, where entries of producers that raced
+ * with the switch may come first. Once it has done so,
+ * unilog_resize_finish hands back the old buffer. The new buffer can
+ * be larger, e.g. for a verbose debug session, or smaller again;
+ * entries over half its capacity are then rejected.
+ * 
+ * Call from one thread at a time.
+ * 
+ * @param log Pointer to unilog context
+ * @param buffer New buffer memory (must remain valid)
+ * @param capacity New buffer capacity in bytes (must be power of 2)
+ * @return UNILOG_OK on success, UNILOG_ERR_BUSY if the previous resize
+ *         is not finished, UNILOG_ERR_INVALID on invalid arguments
+ */
+unilog_result_t unilog_resize(unilog_t *log, void *buffer, uint32_t capacity);
+
+/**
+ * @brief Take back the old buffer after unilog_resize
+ * 
+ * Succeeds once the consumer has read every entry of the old buffer;
+ * poll it, e.g. from the thread that resized. Needed before the next
+ * resize.
+ * 
+ * @param log Pointer to unilog context
+ * @param old_buffer Output pointer for the buffer the log used before
+ * @return UNILOG_OK on success, UNILOG_ERR_BUSY while the old buffer
+ *         is still being read, UNILOG_ERR_INVALID if no resize is pending
+ */
+unilog_result_t unilog_resize_finish(unilog_t *log, void **old_buffer);
+
+/**
+ * @brief Recover a ring buffer that survived a crash or reset
+ * 
+ * For logs whose context and buffer are kept in retained memory (e.g.
+ * a .noinit section). Must be called before any producer or consumer
+ * uses the log again. Validates all entries between read and write
+ * position. Torn or corrupt entries are replaced with gaps that
+ * unilog_read skips; this needs UNILOG_ENTRY_CRC to find the next intact
+ * entry. Without entry CRCs, the buffer is truncated at the first torn
+ * entry instead.
+ * 
+ * @param log Pointer to unilog context to recover
+ * @return Number of corrupt regions found, UNILOG_ERR_INVALID if the
+ *         context itself is damaged and must be initialized again
+ */
+int unilog_recover(unilog_t *log);
+
 /**
  * @brief Write a formatted log message
  * 
@@ -167,6 +520,124 @@ unilog_result_t unilog_write(unilog_t *log, unilog_level_t level,
 int unilog_read(unilog_t *log, unilog_level_t *level, uint32_t *timestamp,
                 char *buffer, size_t buffer_size);
 
+/**
+ * @brief Read the next log entry including all recorded metadata
+ * 
+ * Same as unilog_read, but also returns the producer thread and CPU
+ * when the library was built with UNILOG_THREAD_INFO.
+ * This function should only be called from the consumer thread.
+ * 
+ * @param log Pointer to unilog context
+ * @param info Output pointer for entry metadata
+ * @param buffer Output buffer for message
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes read on success, negative error code otherwise
+ */
+int unilog_read_entry(unilog_t *log, unilog_entry_info_t *info,
+                      char *buffer, size_t buffer_size);
+
+/**
+ * @brief Part of a message left in place in the ring
+ */
+typedef struct {
+    const char *data;   /**< Start of the part */
+    size_t length;      /**< Length of the part in bytes */
+} unilog_span_t;
+
+/**
+ * @brief Look at the next log entry without copying it
+ * 
+ * The message is returned as one span, or two if it wraps around the end
+ * of the ring, which a mirrored ring (see unilog_mirror.h) never does.
+ * The spans are not NUL-terminated and stay valid until unilog_consume.
+ * Compressed messages are returned as stored, with UNILOG_FLAG_COMPRESSED
+ * set in info->flags; see unilog_decompress.
+ * Gaps are skipped. Not available while a helper is set.
+ * This function should only be called from the consumer thread.
+ * 
+ * @param log Pointer to unilog context
+ * @param info Output pointer for entry metadata
+ * @param spans Output array for the message parts
+ * @return Number of spans (1 or 2) on success, negative error code otherwise
+ */
+int unilog_peek(unilog_t *log, unilog_entry_info_t *info, unilog_span_t spans[2]);
+
+/**
+ * @brief Release the entry returned by unilog_peek
+ * 
+ * @param log Pointer to unilog context
+ * @return UNILOG_OK on success, UNILOG_ERR_EMPTY if there is no entry
+ */
+unilog_result_t unilog_consume(unilog_t *log);
+
+/**
+ * @brief Get notified of new entries without blocking
+ * 
+ * For consumers on an event loop or coroutine executor. Arms the waiter
+ * unless the log already holds watermark bytes; the producer whose
+ * write reaches the watermark then disarms it and calls notify, once.
+ * notify runs in that producer's context, possibly an interrupt or
+ * signal handler, so it should only schedule the consumer, e.g. post
+ * to the executor or write to an eventfd. While no waiter is armed,
+ * producers pay nothing beyond the load they already do for blocked
+ * consumer threads.
+ * 
+ * The watermark counts reserved entries, so the next entry may still be
+ * being written when the consumer runs; it then reads what is there and
+ * waits again. One waiter per log, which must remain valid until it was
+ * notified or cancelled.
+ * This function should only be called from the consumer thread.
+ * 
+ * @param log Pointer to unilog context
+ * @param waiter Waiter with a watermark of at least 1
+ * @return 1 if armed, 0 if the watermark is already reached,
+ *         UNILOG_ERR_BUSY if another waiter is armed, UNILOG_ERR_INVALID
+ *         on invalid arguments
+ */
+int unilog_wait_async(unilog_t *log, unilog_waiter_t *waiter);
+
+/**
+ * @brief Disarm a waiter, e.g. on timeout or shutdown
+ * 
+ * @param log Pointer to unilog context
+ * @param waiter Waiter armed with unilog_wait_async
+ * @return true if disarmed, false if it was not armed or notify has been
+ *         or is about to be called
+ */
+bool unilog_cancel_wait(unilog_t *log, unilog_waiter_t *waiter);
+
+/**
+ * @brief Decompress a message stored with UNILOG_FLAG_COMPRESSED
+ * 
+ * @param spans Compressed message, e.g. from unilog_peek
+ * @param count Number of spans (1 or 2)
+ * @param buffer Output buffer, not NUL-terminated
+ * @param buffer_size Size of output buffer, longer messages are truncated
+ * @return Number of bytes written on success, UNILOG_ERR_INVALID if the
+ *         input is corrupt
+ */
+int unilog_decompress(const unilog_span_t *spans, int count, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Describe the entry layout used by this build
+ * 
+ * @param layout Output pointer for the layout description
+ */
+void unilog_get_layout(unilog_layout_t *layout);
+
+/**
+ * @brief Prepare the header for dumping the ring buffer
+ * 
+ * A dump is this header followed by the capacity bytes of the buffer,
+ * and can be decoded on any host with unilog_decode_dump. While a
+ * resize is in progress, the header describes the old buffer.
+ * 
+ * @param log Pointer to unilog context
+ * @param header Output pointer for the dump header
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_dump_header(const unilog_t *log, unilog_dump_header_t *header);
+
 /**
  * @brief Get the number of bytes available to read
  * 
@@ -183,6 +654,20 @@ uint32_t unilog_available(const unilog_t *log);
  */
 bool unilog_is_empty(const unilog_t *log);
 
+/**
+ * @brief Compute or continue a CRC32C (Castagnoli) checksum
+ * 
+ * Uses the SSE4.2 or ARMv8 CRC instructions where available and a
+ * lookup table otherwise. Start with crc = 0; passing the result of a
+ * previous call continues the checksum over more data.
+ * 
+ * @param crc Previous CRC value, or 0
+ * @param data Data to checksum
+ * @param length Length of data in bytes
+ * @return Updated CRC value
+ */
+uint32_t unilog_crc32c(uint32_t crc, const void *data, size_t length);
+
 /**
  * @brief Get level name as string
  * 
@@ -191,6 +676,15 @@ bool unilog_is_empty(const unilog_t *log);
  */
 const char *unilog_level_name(unilog_level_t level);
 
+/**
+ * @brief Parse a level name as returned by unilog_level_name
+ * 
+ * @param name Level name (case-sensitive, need not be null-terminated)
+ * @param length Length of name
+ * @return Log level, or UNILOG_LEVEL_NONE if the name is unknown
+ */
+unilog_level_t unilog_level_from_name(const char *name, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,181 @@
+/**
+ * @file unilog_aggregate.h
+ * @brief Column decoding and aggregation over archived segments
+ *
+ * Answers dashboard queries such as "count by level per minute" or "top
+ * format IDs in the last hour" without formatting any text. Segments
+ * are decoded into columns (timestamp, level, format ID, thread ID),
+ * reading only entry headers and the start of each message, and the
+ * kernels then filter, group and count whole columns at a time using
+ * SSE2 or NEON where available. Results of several segments, e.g.
+ * aggregated on different cores, are combined with unilog_agg_merge
+ * and unilog_histogram_merge.
+ */
+
+#ifndef UNILOG_AGGREGATE_H
+#define UNILOG_AGGREGATE_H
+
+#include "unilog/unilog_intern.h"
+#include "unilog/unilog_segment.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Format ID of entries without interned strings */
+#define UNILOG_FORMAT_NONE 0
+
+/**
+ * @brief A batch of decoded entries, one array per field
+ */
+typedef struct {
+    uint32_t *timestamp;    /**< Entry timestamps */
+    uint8_t *level;         /**< Entry levels */
+    uint32_t *format;       /**< ID of the first interned string, UNILOG_FORMAT_NONE if none */
+    uint32_t *thread;       /**< Producer thread IDs, 0 if not recorded */
+    uint32_t count;         /**< Number of entries in the batch */
+    uint32_t capacity;      /**< Size of each array */
+} unilog_columns_t;
+
+/**
+ * @brief Entries an aggregation applies to
+ */
+typedef struct {
+    uint32_t begin;             /**< First timestamp included */
+    uint32_t end;               /**< First timestamp excluded */
+    unilog_level_t min_level;   /**< Lowest level included */
+} unilog_agg_filter_t;
+
+/**
+ * @brief Entry counts per time bucket and level
+ */
+typedef struct {
+    uint32_t begin;     /**< Timestamp at the start of the first bucket */
+    uint32_t width;     /**< Timestamp units per bucket, e.g. ticks per minute */
+    uint32_t buckets;   /**< Number of buckets */
+    uint64_t *counts;   /**< buckets * UNILOG_LEVEL_NONE counts, by bucket then level */
+} unilog_histogram_t;
+
+/**
+ * @brief Fields entries can be grouped by
+ */
+typedef enum {
+    UNILOG_GROUP_LEVEL = 0,     /**< Entry level */
+    UNILOG_GROUP_FORMAT = 1,    /**< Format ID (first interned string) */
+    UNILOG_GROUP_THREAD = 2     /**< Producer thread ID */
+} unilog_group_by_t;
+
+/**
+ * @brief Count of one group
+ */
+typedef struct {
+    uint32_t key;       /**< Value of the grouped field */
+    uint64_t count;     /**< Number of entries, 0 for unused slots */
+} unilog_agg_group_t;
+
+/**
+ * @brief Entry counts by the value of one field
+ */
+typedef struct {
+    unilog_group_by_t by;           /**< Grouped field */
+    unilog_agg_filter_t filter;     /**< Entries counted */
+    unilog_agg_group_t *groups;     /**< Open-addressed table of groups */
+    uint32_t capacity;              /**< Number of slots, a power of 2 */
+    uint32_t used;                  /**< Number of groups */
+    uint64_t dropped;               /**< Entries not counted because the table was full */
+} unilog_agg_count_t;
+
+/**
+ * @brief Decode the next batch of entries of a segment into columns
+ *
+ * Definition records are passed to map, if given, and are not part of
+ * the columns.
+ *
+ * @param reader Segment reader
+ * @param columns Columns to fill (count is replaced)
+ * @param map Intern map to collect definitions in, may be NULL
+ * @return Number of entries decoded, 0 at the end of the segment,
+ *         negative error code otherwise
+ */
+int unilog_segment_read_columns(unilog_segment_reader_t *reader, unilog_columns_t *columns,
+                                unilog_intern_map_t *map);
+
+/**
+ * @brief Initialize a histogram
+ *
+ * @param histogram Pointer to histogram
+ * @param begin Start of the first bucket
+ * @param width Timestamp units per bucket
+ * @param buckets Number of buckets
+ * @param counts Storage for buckets * UNILOG_LEVEL_NONE counts
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_histogram_init(unilog_histogram_t *histogram, uint32_t begin,
+                                      uint32_t width, uint32_t buckets, uint64_t *counts);
+
+/**
+ * @brief Count entries by time bucket and level
+ *
+ * Entries outside the buckets are ignored.
+ *
+ * @param histogram Pointer to histogram
+ * @param columns Decoded entries
+ */
+void unilog_histogram_add(unilog_histogram_t *histogram, const unilog_columns_t *columns);
+
+/**
+ * @brief Add the counts of another histogram with the same buckets
+ *
+ * @param histogram Pointer to histogram
+ * @param other Histogram to add
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if the buckets differ
+ */
+unilog_result_t unilog_histogram_merge(unilog_histogram_t *histogram,
+                                       const unilog_histogram_t *other);
+
+/**
+ * @brief Initialize a group count
+ *
+ * @param count Pointer to group count
+ * @param by Field to group by
+ * @param filter Entries to count
+ * @param groups Storage for the group table
+ * @param capacity Number of slots, a power of 2
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_agg_init(unilog_agg_count_t *count, unilog_group_by_t by,
+                                const unilog_agg_filter_t *filter, unilog_agg_group_t *groups,
+                                uint32_t capacity);
+
+/**
+ * @brief Count entries passing the filter by the grouped field
+ *
+ * @param count Pointer to group count
+ * @param columns Decoded entries
+ */
+void unilog_agg_add(unilog_agg_count_t *count, const unilog_columns_t *columns);
+
+/**
+ * @brief Add the groups of another group count
+ *
+ * @param count Pointer to group count
+ * @param other Group count to add
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if it groups by another field
+ */
+unilog_result_t unilog_agg_merge(unilog_agg_count_t *count, const unilog_agg_count_t *other);
+
+/**
+ * @brief Get the largest groups
+ *
+ * @param count Pointer to group count
+ * @param top Output array, sorted by count, largest first (ties by key)
+ * @param n Size of output array
+ * @return Number of groups written
+ */
+uint32_t unilog_agg_top(const unilog_agg_count_t *count, unilog_agg_group_t *top, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_AGGREGATE_H */
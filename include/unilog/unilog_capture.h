@@ -0,0 +1,121 @@
+/**
+ * @file unilog_capture.h
+ * @brief Request-scoped capture buffers committed to a log on demand
+ *
+ * A request takes a capture buffer from a caller-provided pool and
+ * writes its verbose entries there instead of the log. At the end of
+ * the request, the buffer is either discarded at no further cost, or
+ * committed to the log as one batch with a single reservation, e.g.
+ * only for requests that failed or ran slow.
+ *
+ * A capture buffer belongs to one request at a time and must only be
+ * written by its owner. Taking and returning buffers is lock-free.
+ */
+
+#ifndef UNILOG_CAPTURE_H
+#define UNILOG_CAPTURE_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Capture buffer for the entries of one request
+ */
+typedef struct {
+    uint8_t *buffer;            /**< Entry storage */
+    uint32_t size;              /**< Size of entry storage in bytes */
+    uint32_t used;              /**< Bytes of captured entries */
+    uint32_t dropped;           /**< Entries that did not fit */
+    unilog_level_t min_level;   /**< Minimum level captured */
+    _Atomic(bool) in_use;       /**< Owned by a request */
+} unilog_capture_t;
+
+/**
+ * @brief Pool of capture buffers
+ */
+typedef struct {
+    unilog_capture_t *captures;     /**< Capture buffer descriptors */
+    uint32_t count;                 /**< Number of capture buffers */
+    _Atomic(uint32_t) next;         /**< Where to start looking for a free buffer */
+} unilog_capture_pool_t;
+
+/**
+ * @brief Initialize a pool of capture buffers with provided memory
+ *
+ * @param pool Pointer to pool
+ * @param captures Array of count descriptors (must remain valid)
+ * @param count Number of capture buffers
+ * @param storage Memory for all buffers, count * buffer_size bytes, 4-byte aligned
+ * @param buffer_size Size of each buffer in bytes (multiple of 4)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_capture_pool_init(unilog_capture_pool_t *pool,
+                                         unilog_capture_t *captures, uint32_t count,
+                                         void *storage, uint32_t buffer_size);
+
+/**
+ * @brief Take an empty capture buffer from the pool
+ *
+ * @param pool Pointer to pool
+ * @param min_level Minimum level to capture, typically UNILOG_LEVEL_TRACE
+ * @return Capture buffer, NULL if all buffers are in use
+ */
+unilog_capture_t *unilog_capture_begin(unilog_capture_pool_t *pool, unilog_level_t min_level);
+
+/**
+ * @brief Capture a null-terminated message
+ *
+ * @param capture Capture buffer owned by the caller
+ * @param level Log level
+ * @param timestamp Timestamp value
+ * @param message Message string
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if the buffer is full
+ *         (the entry is counted in dropped)
+ */
+unilog_result_t unilog_capture_write(unilog_capture_t *capture, unilog_level_t level,
+                                     uint32_t timestamp, const char *message);
+
+/**
+ * @brief Capture a raw message
+ *
+ * @param capture Capture buffer owned by the caller
+ * @param level Log level
+ * @param timestamp Timestamp value
+ * @param message Message data
+ * @param length Message length in bytes
+ * @return See unilog_capture_write
+ */
+unilog_result_t unilog_capture_write_raw(unilog_capture_t *capture, unilog_level_t level,
+                                         uint32_t timestamp, const char *message,
+                                         size_t length);
+
+/**
+ * @brief Drop all captured entries and return the buffer to the pool
+ *
+ * @param capture Capture buffer owned by the caller
+ */
+void unilog_capture_discard(unilog_capture_t *capture);
+
+/**
+ * @brief Append all captured entries to a log as one batch
+ *
+ * Reserves space for the whole batch at once, so the entries end up
+ * contiguous in the log, regardless of the log's level. On success the
+ * buffer is returned to the pool; on failure the caller still owns it
+ * and may retry or discard it.
+ *
+ * @param log Pointer to unilog context
+ * @param capture Capture buffer owned by the caller
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if the log has no room
+ *         for the batch, UNILOG_ERR_INVALID if the batch can never fit
+ */
+unilog_result_t unilog_capture_commit(unilog_t *log, unilog_capture_t *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_CAPTURE_H */
@@ -0,0 +1,142 @@
+/**
+ * @file unilog_consumer.h
+ * @brief Managed consumer thread draining a log
+ *
+ * Replaces the hand-written `while (running) unilog_read(...)` loop.
+ * unilog_consumer_start creates a drain thread, optionally pinned to a
+ * CPU and running under a real-time scheduling policy, which passes
+ * every entry to a handler. What the thread does while the log is
+ * empty is chosen by an idle strategy, trading latency against CPU use.
+ *
+ * A consumer that falls behind can shed load: while the ring fill or
+ * the age of the oldest entry exceeds its budget, entries below a
+ * level are released without being read or handled, and counted.
+ * Definitions of interned strings are never shed.
+ *
+ * Needs POSIX threads; built with the CMake option UNILOG_BUILD_CONSUMER.
+ */
+
+#ifndef UNILOG_CONSUMER_H
+#define UNILOG_CONSUMER_H
+
+#include "unilog/unilog.h"
+#include "unilog/unilog_redact.h"
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What the consumer thread does while the log is empty
+ */
+typedef enum {
+    UNILOG_IDLE_SPIN = 0,   /**< Busy-spin: lowest latency, occupies a core */
+    UNILOG_IDLE_YIELD = 1,  /**< Spin briefly, then yield the CPU between polls */
+    UNILOG_IDLE_PARK = 2,   /**< Spin, yield, then sleep with exponential backoff */
+    UNILOG_IDLE_WAIT = 3    /**< Sleep until a producer commits an entry (futex on Linux) */
+} unilog_idle_t;
+
+/** @brief Entry handler, called on the consumer thread */
+typedef void (*unilog_consumer_fn)(void *ctx, const unilog_entry_info_t *info,
+                                   const char *message, size_t length);
+
+/** @brief Called after each batch of entries, e.g. to flush an output */
+typedef void (*unilog_batch_fn)(void *ctx);
+
+/** @brief Current time in entry timestamp units, for the age budget */
+typedef uint32_t (*unilog_clock_fn)(void *ctx);
+
+/** @brief Scheduling policy value that keeps the creating thread's policy */
+#define UNILOG_SCHED_INHERIT (-1)
+
+/**
+ * @brief Consumer configuration
+ *
+ * The redactor is not applied to interned entries and definition
+ * records; a handler that expands them redacts the result itself.
+ */
+typedef struct {
+    unilog_consumer_fn handler; /**< Entry handler (required) */
+    unilog_batch_fn batch_end;  /**< Called after each batch, may be NULL */
+    void *ctx;                  /**< Context passed to handler and batch_end */
+    const unilog_redactor_t *redactor;  /**< Applied to messages before the handler, may be NULL */
+    unilog_idle_t idle;         /**< Idle strategy */
+    int cpu;                    /**< CPU to pin the thread to, -1 for none */
+    int sched_policy;           /**< e.g. SCHED_FIFO, or UNILOG_SCHED_INHERIT */
+    int sched_priority;         /**< Priority for sched_policy */
+    uint32_t max_batch;         /**< Largest number of entries per batch */
+    uint32_t max_park_us;       /**< Longest sleep of UNILOG_IDLE_PARK */
+    uint32_t shed_fill;         /**< Lag budget: bytes in use in the ring, 0 for none */
+    uint32_t shed_age;          /**< Lag budget: age of the oldest entry, 0 for none */
+    unilog_clock_fn clock;      /**< Current time for shed_age, called with ctx */
+    unilog_level_t shed_below;  /**< Over budget, entries below this level are not handled */
+} unilog_consumer_config_t;
+
+/**
+ * @brief Consumer thread state
+ */
+typedef struct {
+    unilog_t *log;                      /**< Log being drained */
+    unilog_consumer_config_t config;    /**< Configuration */
+    char *buffer;                       /**< Message buffer */
+    size_t buffer_size;                 /**< Size of message buffer */
+    pthread_t thread;                   /**< Drain thread */
+    _Atomic(bool) running;              /**< Cleared to stop the thread */
+    uint32_t batch;                     /**< Current batch size */
+    _Atomic(uint64_t) entries;          /**< Entries handled */
+    _Atomic(uint64_t) batches;          /**< Batches completed */
+    _Atomic(uint64_t) sleeps;           /**< Times the thread slept or blocked */
+    _Atomic(uint64_t) shed[UNILOG_LEVEL_NONE];  /**< Entries released unhandled, per level */
+} unilog_consumer_t;
+
+/**
+ * @brief Fill in a default configuration
+ *
+ * Defaults to UNILOG_IDLE_PARK, no pinning, inherited scheduling,
+ * batches of up to 256 entries, sleeps of up to 1 ms, no redaction and
+ * no lag budget (shedding below UNILOG_LEVEL_WARN once one is set).
+ *
+ * @param config Pointer to configuration
+ * @param handler Entry handler
+ * @param ctx Context for handler
+ */
+void unilog_consumer_config_init(unilog_consumer_config_t *config, unilog_consumer_fn handler,
+                                 void *ctx);
+
+/**
+ * @brief Start a consumer thread draining a log
+ *
+ * The calling application must not read from the log while the
+ * consumer is running.
+ *
+ * @param consumer Pointer to consumer state (must remain valid until stopped)
+ * @param log Log to drain
+ * @param config Configuration (copied)
+ * @param buffer Message buffer, longer messages are truncated
+ * @param buffer_size Size of message buffer
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if the configuration
+ *         is invalid or the thread could not be created with it (e.g.
+ *         a real-time policy without the needed privileges)
+ */
+unilog_result_t unilog_consumer_start(unilog_consumer_t *consumer, unilog_t *log,
+                                      const unilog_consumer_config_t *config,
+                                      char *buffer, size_t buffer_size);
+
+/**
+ * @brief Stop a consumer thread
+ *
+ * Drains all entries committed before the call, as usual in batches
+ * followed by batch_end, then joins the thread. Producers should be
+ * stopped first; entries written concurrently may remain in the log.
+ *
+ * @param consumer Pointer to consumer state
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_consumer_stop(unilog_consumer_t *consumer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_CONSUMER_H */
@@ -0,0 +1,208 @@
+/**
+ * @file unilog_coro.hpp
+ * @brief C++20 coroutine consumer: co_await batches of entries
+ *
+ * For services on coroutine executors, where a consumer thread that
+ * blocks or polls does not fit. A reader suspends the draining
+ * coroutine with unilog_wait_async until the log holds entries, or as
+ * many bytes as the watermark asks for, and the producer that gets it
+ * there schedules the coroutine on the executor. Batches are views of
+ * the entries in place in the ring, so draining shares the executor's
+ * threads with the rest of the I/O and copies nothing:
+ *
+ *     unilog::reader reader(&log, [&](std::coroutine_handle<> h) { loop.post(h); });
+ *     for (;;) {
+ *         for (const unilog::entry &e : co_await reader.next_batch()) {
+ *             write(fd, e.spans[0].data, e.spans[0].length);
+ *         }
+ *     }
+ *
+ * The schedule function is called from the producer's context, which
+ * may be a signal handler; it should only queue the handle. Uses
+ * unilog_peek, so not for logs with a helper set. One reader per log.
+ */
+
+#ifndef UNILOG_CORO_HPP
+#define UNILOG_CORO_HPP
+
+#include "unilog/unilog.h"
+#include <coroutine>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace unilog {
+
+/**
+ * @brief Entry left in place in the ring, valid until its batch moves past it
+ */
+struct entry {
+    unilog_entry_info_t info;   /**< Entry metadata */
+    unilog_span_t spans[2];     /**< Message, in two parts if it wraps around the ring */
+    int count;                  /**< Number of spans (1 or 2) */
+
+    /** @brief Message part, see unilog_peek for compressed entries */
+    std::string_view part(int index) const {
+        return std::string_view(spans[index].data, spans[index].length);
+    }
+};
+
+/**
+ * @brief Up to max_entries entries, read one by one with a range-for
+ *
+ * Moving past an entry releases it to the producers. Entries not
+ * reached, e.g. after a break, remain for the next batch.
+ */
+class batch {
+public:
+    struct sentinel {};
+
+    class iterator {
+    public:
+        explicit iterator(batch *owner) : owner_(owner) {}
+        const entry &operator*() const { return owner_->current_; }
+        const entry *operator->() const { return &owner_->current_; }
+        iterator &operator++() {
+            owner_->advance();
+            return *this;
+        }
+        bool operator==(sentinel) const { return !owner_->has_current_; }
+
+    private:
+        batch *owner_;
+    };
+
+    batch(unilog_t *log, uint32_t max_entries) : log_(log), remaining_(max_entries) {}
+    batch(const batch &) = delete;
+    batch &operator=(const batch &) = delete;
+
+    iterator begin() {
+        if (!started_) {
+            started_ = true;
+            fetch();
+        }
+        return iterator(this);
+    }
+    sentinel end() const { return {}; }
+
+    /** @brief Entries released so far */
+    uint32_t consumed() const { return consumed_; }
+
+private:
+    void fetch() {
+        if (remaining_ == 0) {
+            return;
+        }
+        int count = unilog_peek(log_, &current_.info, current_.spans);
+        if (count > 0) {
+            current_.count = count;
+            has_current_ = true;
+        }
+    }
+
+    void advance() {
+        unilog_consume(log_);
+        has_current_ = false;
+        consumed_++;
+        remaining_--;
+        fetch();
+    }
+
+    unilog_t *log_;
+    uint32_t remaining_;
+    uint32_t consumed_ = 0;
+    bool started_ = false;
+    bool has_current_ = false;
+    entry current_{};
+};
+
+/**
+ * @brief Drains a log from a coroutine
+ *
+ * @tparam Schedule Callable taking std::coroutine_handle<>, which
+ *         resumes it on the executor
+ */
+template <typename Schedule>
+class reader {
+public:
+    /**
+     * @param log Log to drain (must remain valid)
+     * @param schedule Queues a coroutine to be resumed on the executor
+     * @param max_entries Most entries per batch
+     */
+    reader(unilog_t *log, Schedule schedule, uint32_t max_entries = 64)
+        : log_(log), schedule_(std::move(schedule)), max_entries_(max_entries) {
+        waiter_.notify = &reader::notify;
+        waiter_.ctx = this;
+        waiter_.watermark = 1;
+    }
+
+    reader(const reader &) = delete;
+    reader &operator=(const reader &) = delete;
+
+    /** @brief Disarms the waiter; destroy only while not waiting, or after cancel succeeded */
+    ~reader() { cancel(); }
+
+    class awaiter {
+    public:
+        awaiter(reader *owner, uint32_t watermark) : owner_(owner), watermark_(watermark) {}
+
+        bool await_ready() const noexcept {
+            return unilog_available(owner_->log_) >= watermark_;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            owner_->handle_ = handle;
+            owner_->waiter_.watermark = watermark_;
+            int armed = unilog_wait_async(owner_->log_, &owner_->waiter_);
+            if (armed < 0) {
+                throw std::logic_error("unilog: another waiter is armed on this log");
+            }
+            return armed == 1;
+        }
+
+        batch await_resume() const { return batch(owner_->log_, owner_->max_entries_); }
+
+    private:
+        reader *owner_;
+        uint32_t watermark_;
+    };
+
+    /**
+     * @brief Wait for entries and return them as a batch
+     *
+     * Completes at once if the log holds watermark bytes already. The
+     * batch may be empty if the producer is still writing the first
+     * entry; await again.
+     *
+     * @param watermark Bytes to wait for, 1 for any entry
+     */
+    awaiter next_batch(uint32_t watermark = 1) {
+        return awaiter(this, watermark > 0 ? watermark : 1);
+    }
+
+    /**
+     * @brief Stop waiting, e.g. on timeout or shutdown
+     *
+     * @return true if the coroutine will not be scheduled by a producer
+     *         and may be resumed or destroyed by the caller
+     */
+    bool cancel() { return unilog_cancel_wait(log_, &waiter_); }
+
+private:
+    static void notify(void *ctx) {
+        reader *self = static_cast<reader *>(ctx);
+        self->schedule_(self->handle_);
+    }
+
+    unilog_t *log_;
+    Schedule schedule_;
+    uint32_t max_entries_;
+    unilog_waiter_t waiter_{};
+    std::coroutine_handle<> handle_;
+};
+
+}  // namespace unilog
+
+#endif /* UNILOG_CORO_HPP */
@@ -0,0 +1,165 @@
+/**
+ * @file unilog_decode.h
+ * @brief Host-side decoding of entries produced by any target
+ *
+ * Decodes entries described by a unilog_layout_t, which may come from a
+ * target with different byte order or header variant than the host.
+ * Entries in the host's own layout take a memcpy-only fast path.
+ */
+
+#ifndef UNILOG_DECODE_H
+#define UNILOG_DECODE_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest raw entry header supported by the decoder */
+#define UNILOG_MAX_HEADER_SIZE 64
+
+/**
+ * @brief Callback receiving decoded entries
+ *
+ * @param ctx User context
+ * @param info Entry metadata
+ * @param message Message bytes (not null-terminated)
+ * @param length Message length
+ * @return 0 to continue decoding, nonzero to stop
+ */
+typedef int (*unilog_entry_fn)(void *ctx, const unilog_entry_info_t *info,
+                               const char *message, size_t length);
+
+/**
+ * @brief Statistics of a decoding run
+ */
+typedef struct {
+    uint32_t entries;        /**< Entries passed to the callback */
+    uint32_t corrupt;        /**< Torn or corrupt regions skipped */
+    uint32_t corrupt_bytes;  /**< Total size of skipped regions */
+} unilog_decode_stats_t;
+
+/**
+ * @brief Layout of a stream of entries, with the checks decoding needs made once
+ *
+ * Set up with unilog_decoder_init for each dump or segment, then
+ * passed to unilog_decoder_header for every entry of it.
+ */
+typedef struct {
+    unilog_layout_t layout; /**< Layout of the entries */
+    bool native;            /**< Layout equals the layout of this build */
+    bool swap;              /**< Byte order differs from the host */
+    bool words;             /**< All decoded fields are 32 bits wide */
+} unilog_decoder_t;
+
+/**
+ * @brief Check whether a layout equals the layout of this build
+ *
+ * @param layout Layout description
+ * @return true if entries can be used without conversion
+ */
+bool unilog_layout_is_native(const unilog_layout_t *layout);
+
+/**
+ * @brief Check whether entries in a layout can be decoded
+ *
+ * @param layout Layout description
+ * @return true if supported
+ */
+bool unilog_layout_is_supported(const unilog_layout_t *layout);
+
+/**
+ * @brief Decode a raw entry header
+ *
+ * Checks the layout on each call; to decode many entries of the same
+ * layout, use unilog_decoder_header.
+ *
+ * @param layout Layout of the raw header
+ * @param raw Raw header bytes (layout->header_size bytes, any alignment)
+ * @param length Output pointer for the total entry length (unpadded)
+ * @param info Output pointer for entry metadata
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID for unsupported layouts
+ */
+unilog_result_t unilog_decode_header(const unilog_layout_t *layout, const void *raw,
+                                     uint32_t *length, unilog_entry_info_t *info);
+
+/**
+ * @brief Prepare decoding entries of a layout
+ *
+ * @param decoder Decoder to initialize
+ * @param layout Layout of the entries
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID for unsupported layouts
+ */
+unilog_result_t unilog_decoder_init(unilog_decoder_t *decoder, const unilog_layout_t *layout);
+
+/**
+ * @brief Decode a raw entry header with a prepared decoder
+ *
+ * Like unilog_decode_header, without checking the layout again.
+ *
+ * @param decoder Decoder set up by unilog_decoder_init
+ * @param raw Raw header bytes (layout header_size bytes, any alignment)
+ * @param length Output pointer for the total entry length (unpadded)
+ * @param info Output pointer for entry metadata
+ */
+void unilog_decoder_header(const unilog_decoder_t *decoder, const void *raw,
+                           uint32_t *length, unilog_entry_info_t *info);
+
+/**
+ * @brief Start verifying the CRC of an entry
+ *
+ * Computes the CRC32C over a raw header with its CRC field zeroed. The
+ * caller continues it over the message with unilog_crc32c and compares
+ * the result with the expected value.
+ *
+ * @param layout Layout of the raw header, must include UNILOG_VARIANT_CRC
+ * @param raw Raw header bytes
+ * @param expected Output pointer for the CRC stored in the header
+ * @return CRC over the header, 0 if the layout has no CRC
+ */
+uint32_t unilog_decode_crc_start(const unilog_layout_t *layout, const void *raw,
+                                 uint32_t *expected);
+
+/**
+ * @brief Decode the committed entries of a ring dump
+ *
+ * The dump is a unilog_dump_header_t followed by the ring buffer.
+ * Messages are passed to the callback in place; messages wrapping
+ * around the end of the ring are copied to scratch first, truncated
+ * to scratch_size if necessary, as are compressed messages, which are
+ * decompressed. Gaps left by unilog_recover are skipped.
+ *
+ * If the layout includes entry CRCs, torn and corrupt entries are
+ * skipped and decoding resumes at the next intact entry. Otherwise,
+ * decoding stops at the first entry that was not yet committed when
+ * the dump was taken, and fails on corrupt entries.
+ *
+ * @param dump Dump bytes (any alignment)
+ * @param size Size of dump in bytes
+ * @param scratch Buffer for wrapped messages
+ * @param scratch_size Size of scratch buffer
+ * @param fn Callback receiving each entry
+ * @param ctx User context for callback
+ * @param stats Output pointer for statistics (may be NULL)
+ * @return Number of entries decoded, negative error code on invalid dumps
+ */
+int unilog_decode_dump(const void *dump, size_t size, char *scratch, size_t scratch_size,
+                       unilog_entry_fn fn, void *ctx, unilog_decode_stats_t *stats);
+
+/**
+ * @brief Reverse the byte order of an array of 32-bit words in place
+ *
+ * Uses SSSE3/SSE2 or NEON for each group of four words, so it pays
+ * off on blocks of words, like a run of segment index entries.
+ *
+ * @param words Words to convert
+ * @param count Number of words
+ */
+void unilog_bswap32_array(uint32_t *words, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_DECODE_H */
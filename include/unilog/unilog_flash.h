@@ -0,0 +1,209 @@
+/**
+ * @file unilog_flash.h
+ * @brief Log-structured storage of drained entries in NOR/NAND flash
+ *
+ * Collects drained entries into page-sized blocks and programs each
+ * page once, into a circular region of erase sectors. The region wears
+ * evenly, as every sector is erased once per lap. A window of sectors
+ * ahead of the head is kept erased, and erases run while the consumer
+ * is otherwise idle, so programming a page never waits for one. When
+ * the window runs out, the oldest sector is erased and its entries are
+ * lost.
+ *
+ * Every page starts with a header holding a sequence number and a
+ * CRC32C, followed by entries in the ring buffer layout. Mounting reads
+ * the first page of each sector and a few pages of the newest one to
+ * find the head, so it does not depend on how much has been written.
+ * Torn pages from a power loss fail their CRC and are skipped.
+ *
+ * The device is accessed through a small driver; unilog_flash_sim.h
+ * provides a file-backed simulator for testing on a host. Like the
+ * ping-pong and capture code, this performs no dynamic allocation: the
+ * page buffer is provided by the caller.
+ */
+
+#ifndef UNILOG_FLASH_H
+#define UNILOG_FLASH_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Value of erased flash bytes */
+#define UNILOG_FLASH_ERASED 0xFF
+
+/** @brief Page header magic, "UL" */
+#define UNILOG_FLASH_MAGIC 0x4C55
+
+/**
+ * @brief Flash device driver
+ *
+ * Addresses are relative to the start of the log region. Program and
+ * read block until done, waiting for a running erase first. Erase may
+ * return as soon as the erase has started, if busy reports its
+ * progress; otherwise it blocks too.
+ */
+typedef struct {
+    uint32_t page_size;     /**< Program unit in bytes, a multiple of 4 up to 65536 */
+    uint32_t sector_size;   /**< Erase unit in bytes, a multiple of page_size */
+    uint32_t sector_count;  /**< Sectors in the log region, at least 2 */
+    void *ctx;              /**< Passed to every call */
+    /** Read length bytes at address */
+    unilog_result_t (*read)(void *ctx, uint32_t address, void *data, uint32_t length);
+    /** Program one erased page at a page-aligned address */
+    unilog_result_t (*program)(void *ctx, uint32_t address, const void *data, uint32_t length);
+    /** Erase one sector to UNILOG_FLASH_ERASED */
+    unilog_result_t (*erase)(void *ctx, uint32_t sector);
+    /** True while an erase is running, NULL if erase blocks */
+    bool (*busy)(void *ctx);
+} unilog_flash_dev_t;
+
+/**
+ * @brief Header at the start of every programmed page
+ *
+ * Pages are numbered consecutively; the first page of a sector carries
+ * the sector's number, and the other pages follow on from it.
+ */
+typedef struct {
+    uint32_t sequence;  /**< Page number since the region was first written */
+    uint16_t magic;     /**< UNILOG_FLASH_MAGIC */
+    uint16_t used;      /**< Bytes of entries following the header */
+    uint32_t crc;       /**< CRC32C of header (with crc = 0) and entries */
+} unilog_flash_page_t;
+
+/**
+ * @brief Flash log state
+ */
+typedef struct {
+    const unilog_flash_dev_t *dev;  /**< Device driver */
+    uint8_t *page;                  /**< Page being filled (caller-provided) */
+    uint32_t fill;                  /**< Bytes used in page, including the header */
+    uint32_t head;                  /**< Next page to program, index in the region */
+    uint32_t sequence;              /**< Sequence number of that page */
+    uint32_t tail;                  /**< Oldest page that may hold entries */
+    uint32_t erase_ahead;           /**< Erased sectors to keep ahead of the head */
+    uint32_t ready;                 /**< Erased sectors following the head's sector */
+    uint32_t erasing;               /**< Sector being erased, UINT32_MAX if none */
+    uint32_t pages_written;         /**< Pages programmed */
+    uint32_t erases;                /**< Sectors erased */
+    uint32_t stalls;                /**< Page programs that had to wait for an erase */
+    uint32_t truncated;             /**< Messages cut to fit a page */
+    uint32_t errors;                /**< Failed driver calls */
+} unilog_flash_log_t;
+
+/**
+ * @brief Reader over the entries stored in flash, oldest first
+ */
+typedef struct {
+    const unilog_flash_dev_t *dev;  /**< Device driver */
+    uint8_t *page;                  /**< Page buffer (caller-provided) */
+    uint32_t next;                  /**< Next page to load */
+    uint32_t remaining;             /**< Pages left to load */
+    uint32_t offset;                /**< Position in the loaded page */
+    uint32_t used;                  /**< End of the entries in the loaded page */
+    uint32_t corrupt;               /**< Pages skipped for a bad header or CRC */
+} unilog_flash_reader_t;
+
+/**
+ * @brief Mount a log region, finding the head left by earlier runs
+ *
+ * An empty or erased region yields an empty log. Sectors ahead of the
+ * head are checked and reused if still erased.
+ *
+ * @param flog Pointer to flash log state
+ * @param dev Device driver (must remain valid)
+ * @param page_buffer Buffer of dev->page_size bytes, 4-byte aligned (must remain valid)
+ * @param erase_ahead Erased sectors to keep ahead of the head, 1 to sector_count - 1
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID on invalid arguments or
+ *         a failing device
+ */
+unilog_result_t unilog_flash_mount(unilog_flash_log_t *flog, const unilog_flash_dev_t *dev,
+                                   void *page_buffer, uint32_t erase_ahead);
+
+/**
+ * @brief Append an entry, programming the page once it is full
+ *
+ * Messages too long for one page are truncated. If the full page
+ * cannot be programmed, the entry is not appended; when no sector could
+ * be erased for it, the page stays buffered and is retried on the next
+ * write or flush.
+ *
+ * @param flog Pointer to flash log state
+ * @param info Entry metadata
+ * @param message Message bytes
+ * @param length Message length in bytes
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID on invalid arguments or
+ *         if the device failed
+ */
+unilog_result_t unilog_flash_write(unilog_flash_log_t *flog, const unilog_entry_info_t *info,
+                                   const char *message, size_t length);
+
+/**
+ * @brief Program the partly filled page, e.g. before a shutdown
+ *
+ * The rest of the page stays unused.
+ *
+ * @param flog Pointer to flash log state
+ * @return UNILOG_OK on success (also if nothing was pending), error code otherwise
+ */
+unilog_result_t unilog_flash_flush(unilog_flash_log_t *flog);
+
+/**
+ * @brief Schedule erases ahead of the head while the device is idle
+ *
+ * Starts at most one erase and returns without waiting. Call when the
+ * consumer has nothing else to do, e.g. after each batch.
+ *
+ * @param flog Pointer to flash log state
+ */
+void unilog_flash_service(unilog_flash_log_t *flog);
+
+/**
+ * @brief Entry handler writing to a flash log, for unilog_consumer_config_t or unilog_helper_t
+ *
+ * @param ctx Pointer to flash log state
+ */
+void unilog_flash_sink(void *ctx, const unilog_entry_info_t *info, const char *message,
+                       size_t length);
+
+/**
+ * @brief Batch handler calling unilog_flash_service, for unilog_consumer_config_t
+ *
+ * @param ctx Pointer to flash log state
+ */
+void unilog_flash_batch_end(void *ctx);
+
+/**
+ * @brief Start reading the entries of a mounted log
+ *
+ * Not to be used while the log is written. Entries still in the page
+ * buffer are not included; flush first to read them.
+ *
+ * @param reader Pointer to reader state
+ * @param flog Mounted flash log
+ * @param page_buffer Buffer of page_size bytes, 4-byte aligned, other than the log's
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_flash_reader_init(unilog_flash_reader_t *reader,
+                                         const unilog_flash_log_t *flog, void *page_buffer);
+
+/**
+ * @brief Read the next entry
+ *
+ * @param reader Pointer to reader state
+ * @param info Output pointer for entry metadata
+ * @param message Output pointer to the message in the page buffer (not null-terminated),
+ *                valid until the next call
+ * @return Message length, UNILOG_ERR_EMPTY after the last entry,
+ *         UNILOG_ERR_INVALID if the device failed
+ */
+int unilog_flash_read(unilog_flash_reader_t *reader, unilog_entry_info_t *info,
+                      const char **message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_FLASH_H */
@@ -0,0 +1,96 @@
+/**
+ * @file unilog_flash_sim.h
+ * @brief File-backed flash simulator for testing unilog_flash.h on a host
+ *
+ * Stores the region in a file and behaves like NOR flash: programming
+ * can only clear bits, erasing sets a whole sector to 0xFF, and erases
+ * run in the background for as long as the real part would take. The
+ * device time is kept on a virtual clock by default, so tests run fast
+ * and report the time the device would have spent, and the time writers
+ * spent waiting for erases.
+ *
+ * POSIX only; built with the CMake option UNILOG_BUILD_FLASH_SIM.
+ */
+
+#ifndef UNILOG_FLASH_SIM_H
+#define UNILOG_FLASH_SIM_H
+
+#include "unilog/unilog_flash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default page program time in ns, typical of serial NOR flash */
+#ifndef UNILOG_FLASH_SIM_PROGRAM_NS
+#define UNILOG_FLASH_SIM_PROGRAM_NS 400000
+#endif
+
+/** @brief Default sector erase time in ns */
+#ifndef UNILOG_FLASH_SIM_ERASE_NS
+#define UNILOG_FLASH_SIM_ERASE_NS 45000000
+#endif
+
+/** @brief Default read time per byte in ns */
+#ifndef UNILOG_FLASH_SIM_READ_NS
+#define UNILOG_FLASH_SIM_READ_NS 20
+#endif
+
+/**
+ * @brief Simulated flash device
+ */
+typedef struct {
+    unilog_flash_dev_t dev;  /**< Driver to pass to unilog_flash_mount */
+    int fd;                  /**< Backing file */
+    bool realtime;           /**< Sleep for device time instead of advancing the clock */
+    uint64_t program_ns;     /**< Time to program one page */
+    uint64_t erase_ns;       /**< Time to erase one sector */
+    uint64_t read_ns;        /**< Time to read one byte */
+    uint64_t now;            /**< Virtual clock in ns */
+    uint64_t busy_until;     /**< End of the running erase */
+    uint64_t stall_ns;       /**< Time reads and programs waited for an erase */
+    uint32_t *wear;          /**< Erase count per sector (caller-provided) */
+    uint32_t programs;       /**< Pages programmed */
+    uint32_t violations;     /**< Programs over bytes that were not erased */
+} unilog_flash_sim_t;
+
+/**
+ * @brief Open or create a simulated flash region
+ *
+ * A new or short file is extended with erased bytes; an existing one
+ * keeps its contents, as flash does across power cycles. Timings start
+ * at the defaults above and may be changed afterwards.
+ *
+ * @param sim Pointer to simulator
+ * @param path Backing file
+ * @param page_size Program unit in bytes
+ * @param sector_size Erase unit in bytes
+ * @param sector_count Sectors in the region
+ * @param wear Array of sector_count erase counters, zeroed here (must remain valid)
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID on invalid arguments or
+ *         if the file could not be opened
+ */
+unilog_result_t unilog_flash_sim_open(unilog_flash_sim_t *sim, const char *path,
+                                      uint32_t page_size, uint32_t sector_size,
+                                      uint32_t sector_count, uint32_t *wear);
+
+/**
+ * @brief Let time pass, e.g. for work done between calls
+ *
+ * @param sim Pointer to simulator
+ * @param ns Nanoseconds to advance the virtual clock (ignored in realtime mode)
+ */
+void unilog_flash_sim_advance(unilog_flash_sim_t *sim, uint64_t ns);
+
+/**
+ * @brief Close the backing file
+ *
+ * @param sim Pointer to simulator
+ */
+void unilog_flash_sim_close(unilog_flash_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_FLASH_SIM_H */
@@ -0,0 +1,197 @@
+/**
+ * @file unilog_intern.h
+ * @brief Runtime string interning for repeated message parts
+ *
+ * Producers intern strings that recur across entries, such as format
+ * strings, module or peer names. The first occurrence of a string
+ * writes a definition record (UNILOG_FLAG_DEFINITION) with its ID and
+ * text; entries using it afterwards carry a 5-byte reference instead
+ * (UNILOG_FLAG_INTERNED). The producer table is lock-free and needs no
+ * memory beyond the slots provided by the caller.
+ *
+ * The consumer keeps the mapping from IDs to strings per stream in a
+ * unilog_intern_map_t, fed with every entry in stream order. Definitions
+ * always precede the first reference to them in the ring, but a reader
+ * that starts late (e.g. on a dump after the ring wrapped) may see
+ * references it cannot resolve; these are shown as "#ID".
+ */
+
+#ifndef UNILOG_INTERN_H
+#define UNILOG_INTERN_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Longest string that can be interned, in bytes */
+#define UNILOG_INTERN_MAX_LENGTH 48
+
+/**
+ * @brief Escape byte starting a reference in interned messages
+ *
+ * Followed by the 32-bit ID in little-endian byte order. ID 0 stands
+ * for a literal escape byte.
+ */
+#define UNILOG_INTERN_ESCAPE 0x1A
+
+/** @brief Size of a reference in an interned message */
+#define UNILOG_INTERN_REF_SIZE 5
+
+/** @brief Largest message written by unilog_intern_write, in bytes after encoding */
+#define UNILOG_INTERN_MESSAGE_SIZE 256
+
+/**
+ * @brief Producer-side slot of an interned string
+ */
+typedef struct {
+    _Atomic(uint32_t) state;                /**< Empty, being defined or defined */
+    uint32_t hash;                          /**< Hash of text */
+    uint32_t length;                        /**< Length of text in bytes */
+    char text[UNILOG_INTERN_MAX_LENGTH];    /**< String contents */
+} unilog_intern_slot_t;
+
+/**
+ * @brief Producer-side intern table of a log
+ */
+typedef struct {
+    unilog_intern_slot_t *slots;    /**< Open-addressed slots, ID = index + 1 */
+    uint32_t capacity;              /**< Number of slots (power of 2) */
+    unilog_t *log;                  /**< Log receiving definitions and entries */
+} unilog_intern_t;
+
+/**
+ * @brief Part of a message written with unilog_intern_write
+ */
+typedef struct {
+    const char *text;   /**< Part contents */
+    size_t length;      /**< Part length in bytes */
+    bool intern;        /**< Write as a reference to an interned string */
+} unilog_part_t;
+
+/**
+ * @brief Consumer-side location of an interned string
+ */
+typedef struct {
+    uint32_t offset;    /**< Offset in the arena, UINT32_MAX if undefined */
+    uint32_t length;    /**< Length in bytes */
+} unilog_intern_entry_t;
+
+/**
+ * @brief Consumer-side mapping from IDs to strings of one stream
+ */
+typedef struct {
+    unilog_intern_entry_t *entries; /**< Locations, indexed by ID - 1 */
+    uint32_t count;                 /**< Number of entries */
+    char *arena;                    /**< Storage for string contents */
+    uint32_t arena_size;            /**< Size of arena in bytes */
+    uint32_t arena_used;            /**< Bytes of arena in use */
+} unilog_intern_map_t;
+
+/**
+ * @brief Initialize an intern table with provided slots
+ *
+ * @param table Pointer to intern table
+ * @param log Log to write to (must be initialized)
+ * @param slots Slot storage (must remain valid)
+ * @param capacity Number of slots (must be a power of 2)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_intern_init(unilog_intern_t *table, unilog_t *log,
+                                   unilog_intern_slot_t *slots, uint32_t capacity);
+
+/**
+ * @brief Get the ID of a string, defining it on first use
+ *
+ * Writes a definition record at the given level if the string is new.
+ * Lock-free: if another producer is defining a string in the same
+ * slot at the same time, this call does not wait and fails with
+ * UNILOG_ERR_BUSY.
+ *
+ * @param table Pointer to intern table
+ * @param level Level of the definition record
+ * @param timestamp Timestamp of the definition record
+ * @param text String contents
+ * @param length String length in bytes (1 to UNILOG_INTERN_MAX_LENGTH)
+ * @param id Output pointer for the ID
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if the table or log has
+ *         no room for the definition, UNILOG_ERR_BUSY as described above
+ */
+unilog_result_t unilog_intern_id(unilog_intern_t *table, unilog_level_t level,
+                                 uint32_t timestamp, const char *text, size_t length,
+                                 uint32_t *id);
+
+/**
+ * @brief Write an entry assembled from literal and interned parts
+ *
+ * Parts that cannot be interned right now are written literally, so
+ * the entry is never lost because of interning. The message is limited
+ * to UNILOG_INTERN_MESSAGE_SIZE bytes after encoding, like
+ * unilog_format; parts beyond that are truncated.
+ *
+ * @param table Pointer to intern table
+ * @param level Log level
+ * @param timestamp Timestamp value
+ * @param parts Message parts
+ * @param count Number of parts
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_intern_write(unilog_intern_t *table, unilog_level_t level,
+                                    uint32_t timestamp, const unilog_part_t *parts,
+                                    size_t count);
+
+/**
+ * @brief Initialize a consumer-side map with provided memory
+ *
+ * @param map Pointer to map
+ * @param entries Storage for count locations (must remain valid)
+ * @param count Number of IDs that can be mapped, usually the producer's capacity
+ * @param arena Storage for string contents (must remain valid)
+ * @param arena_size Size of arena in bytes
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_intern_map_init(unilog_intern_map_t *map, unilog_intern_entry_t *entries,
+                                       uint32_t count, char *arena, uint32_t arena_size);
+
+/**
+ * @brief Forget all definitions, before reading another stream
+ *
+ * @param map Pointer to map
+ */
+void unilog_intern_map_reset(unilog_intern_map_t *map);
+
+/**
+ * @brief Look up an interned string
+ *
+ * @param map Pointer to map
+ * @param id String ID
+ * @param length Output pointer for the string length
+ * @return String contents (not null-terminated), NULL if undefined
+ */
+const char *unilog_intern_lookup(const unilog_intern_map_t *map, uint32_t id,
+                                 uint32_t *length);
+
+/**
+ * @brief Process an entry read from a stream
+ *
+ * Definition records are added to the map and produce no output.
+ * Interned messages are expanded, others are copied unchanged.
+ *
+ * @param map Pointer to map
+ * @param info Entry metadata
+ * @param message Message data
+ * @param length Message length in bytes
+ * @param out Output buffer for the expanded message (null-terminated, truncated to fit)
+ * @param out_size Size of output buffer
+ * @return Length of the expanded message, UNILOG_ERR_EMPTY for a
+ *         definition record, or another error code
+ */
+int unilog_intern_process(unilog_intern_map_t *map, const unilog_entry_info_t *info,
+                          const char *message, size_t length, char *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_INTERN_H */
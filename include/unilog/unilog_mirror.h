@@ -0,0 +1,66 @@
+/**
+ * @file unilog_mirror.h
+ * @brief Ring storage mapped twice, back to back, in virtual memory
+ *
+ * The same pages of a memfd are mapped at [base, base + capacity) and
+ * again at [base + capacity, base + 2 * capacity). An access that runs
+ * past the end of the ring continues at its start, so every entry and
+ * every message is one contiguous span: writers and readers copy in one
+ * piece and unilog_peek always returns a single span.
+ *
+ * Linux only; built with the CMake option UNILOG_BUILD_MIRROR.
+ */
+
+#ifndef UNILOG_MIRROR_H
+#define UNILOG_MIRROR_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mirrored ring storage
+ */
+typedef struct {
+    uint8_t *base;      /**< Start of the ring, followed by its mirror */
+    uint32_t capacity;  /**< Size of the ring in bytes */
+} unilog_mirror_t;
+
+/**
+ * @brief Allocate mirrored ring storage
+ *
+ * @param mirror Pointer to mirror
+ * @param capacity Ring size, a power of 2 and a multiple of the page size
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if the size is not
+ *         supported or the mappings could not be created
+ */
+unilog_result_t unilog_mirror_create(unilog_mirror_t *mirror, uint32_t capacity);
+
+/**
+ * @brief Initialize a logger on mirrored storage
+ *
+ * Like unilog_init, but marks the ring as mirrored so wrap-around
+ * handling is skipped. Instead of clearing the storage, releases its
+ * pages, so that startup does not depend on the capacity and pages are
+ * only backed once producers reach them.
+ *
+ * @param log Pointer to unilog context
+ * @param mirror Storage from unilog_mirror_create (must remain valid)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_mirror_init(unilog_t *log, unilog_mirror_t *mirror);
+
+/**
+ * @brief Unmap mirrored ring storage
+ *
+ * @param mirror Pointer to mirror, no longer used by any logger
+ */
+void unilog_mirror_destroy(unilog_mirror_t *mirror);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_MIRROR_H */
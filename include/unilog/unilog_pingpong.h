@@ -0,0 +1,141 @@
+/**
+ * @file unilog_pingpong.h
+ * @brief Double-buffered logging with whole-block hand-off
+ *
+ * The user buffer is split into two halves. Producers append entries to
+ * the active half; the consumer swaps halves and receives the previous
+ * one as a single contiguous block of entries, e.g. to write it to a
+ * flash page or send it as one USB bulk transfer. Entries in a block
+ * use the same layout as the ring buffer, but never wrap.
+ *
+ * Producers are lock-free and interrupt-safe like unilog_write. The
+ * consumer side (swap and release) must be called from one context.
+ */
+
+#ifndef UNILOG_PINGPONG_H
+#define UNILOG_PINGPONG_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Double-buffered logger state
+ */
+typedef struct {
+    _Atomic(uint32_t) active;       /**< Half producers append to (0 or 1) */
+    _Atomic(uint32_t) fill[2];      /**< Bytes reserved per half, plus closed flag */
+    _Atomic(uint32_t) writers[2];   /**< Producers in flight per half */
+    uint32_t half_size;             /**< Size of each half in bytes */
+    uint8_t *buffer;                /**< Pointer to buffer storage */
+    _Atomic(unilog_level_t) min_level;  /**< Minimum log level to record */
+    int8_t closing;                 /**< Half being swapped out, -1 if none (consumer) */
+    int8_t handed_off;              /**< Half owned by the consumer, -1 if none (consumer) */
+} unilog_pingpong_t;
+
+/**
+ * @brief Block of complete entries handed to the consumer
+ */
+typedef struct {
+    const uint8_t *data;    /**< First entry */
+    uint32_t size;          /**< Size of all entries including padding */
+} unilog_block_t;
+
+/**
+ * @brief Initialize a double-buffered logger with provided memory
+ *
+ * @param pp Pointer to logger state
+ * @param buffer Pointer to buffer memory (must remain valid, 4-byte aligned)
+ * @param capacity Buffer capacity in bytes (multiple of 8), split into two halves
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_pingpong_init(unilog_pingpong_t *pp, void *buffer, uint32_t capacity);
+
+/**
+ * @brief Set the minimum log level
+ *
+ * @param pp Pointer to logger state
+ * @param level Minimum level to record
+ */
+void unilog_pingpong_set_level(unilog_pingpong_t *pp, unilog_level_t level);
+
+/**
+ * @brief Append a null-terminated message to the active half
+ *
+ * @param pp Pointer to logger state
+ * @param level Log level
+ * @param timestamp Timestamp value
+ * @param message Message string
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if the active half is full
+ */
+unilog_result_t unilog_pingpong_write(unilog_pingpong_t *pp, unilog_level_t level,
+                                      uint32_t timestamp, const char *message);
+
+/**
+ * @brief Append a raw message to the active half
+ *
+ * @param pp Pointer to logger state
+ * @param level Log level
+ * @param timestamp Timestamp value
+ * @param message Message data
+ * @param length Message length in bytes
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if the active half is full
+ */
+unilog_result_t unilog_pingpong_write_raw(unilog_pingpong_t *pp, unilog_level_t level,
+                                          uint32_t timestamp, const char *message,
+                                          size_t length);
+
+/**
+ * @brief Get the number of bytes used in the active half
+ *
+ * Lets the consumer swap before the half is completely full.
+ *
+ * @param pp Pointer to logger state
+ * @return Bytes reserved in the active half
+ */
+uint32_t unilog_pingpong_used(const unilog_pingpong_t *pp);
+
+/**
+ * @brief Swap halves and take the filled one (consumer only)
+ *
+ * Producers continue in the other half immediately. The filled half is
+ * handed out once all producers that reserved space in it have
+ * finished; until then this returns UNILOG_ERR_BUSY and must be called
+ * again. The block stays valid until unilog_pingpong_release.
+ *
+ * @param pp Pointer to logger state
+ * @param block Output pointer for the filled block
+ * @return UNILOG_OK with a block, UNILOG_ERR_EMPTY if nothing was logged,
+ *         UNILOG_ERR_BUSY if producers are still writing or the
+ *         previous block was not released yet
+ */
+unilog_result_t unilog_pingpong_swap(unilog_pingpong_t *pp, unilog_block_t *block);
+
+/**
+ * @brief Return the block from the last swap to the producers (consumer only)
+ *
+ * @param pp Pointer to logger state
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if no block is held
+ */
+unilog_result_t unilog_pingpong_release(unilog_pingpong_t *pp);
+
+/**
+ * @brief Iterate over the entries of a block
+ *
+ * @param block Block from unilog_pingpong_swap
+ * @param offset In/out position in the block, start with 0
+ * @param info Output pointer for entry metadata
+ * @param message Output pointer to the message inside the block (not null-terminated)
+ * @return Message length, UNILOG_ERR_EMPTY at the end of the block,
+ *         UNILOG_ERR_INVALID on malformed blocks
+ */
+int unilog_block_next(const unilog_block_t *block, uint32_t *offset,
+                      unilog_entry_info_t *info, const char **message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_PINGPONG_H */
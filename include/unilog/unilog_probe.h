@@ -0,0 +1,124 @@
+/**
+ * @file unilog_probe.h
+ * @brief USDT probes at log call sites, for bpftrace and perf
+ *
+ * With UNILOG_USDT set to 1 (CMake option UNILOG_ENABLE_USDT, needs
+ * <sys/sdt.h> from SystemTap), UNILOG_LOGF places a statically defined
+ * probe at each call site, and the library one in its write path.
+ * Probes fire before the level check, so a tracer sees sites
+ * whose level is disabled too. An idle probe is a single nop; its
+ * arguments are only evaluated while a tracer is attached, which it
+ * signals through the probe's semaphore. The probe notes describe
+ * where each argument lives (register or stack slot), so tools read
+ * them directly:
+ *
+ *     bpftrace -e 'usdt:./app:unilog:log /arg0 >= 3/ {
+ *         printf("%s %d\n", str(arg2), arg3); }'
+ *
+ * Probes:
+ * - unilog:log (level, timestamp, format, args...), at each UNILOG_LOGF
+ *   site. Each site is a probe location of its own, told apart by
+ *   address or by format.
+ * - unilog:write (level, timestamp, message, length), for every entry
+ *   written through unilog_write, unilog_write_raw or unilog_format.
+ *
+ * Without UNILOG_USDT, UNILOG_LOGF is just unilog_format.
+ */
+
+#ifndef UNILOG_PROBE_H
+#define UNILOG_PROBE_H
+
+#include "unilog/unilog.h"
+
+/**
+ * @brief Compile USDT probes into call sites and the write path
+ *
+ * Must be defined identically for the library and all code including
+ * this header. The CMake option UNILOG_ENABLE_USDT takes care of this.
+ */
+#ifndef UNILOG_USDT
+#define UNILOG_USDT 0
+#endif
+
+#if UNILOG_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Non-zero while a tracer is attached to unilog:log */
+extern volatile unsigned short unilog_log_semaphore;
+
+/** @brief Non-zero while a tracer is attached to unilog:write */
+extern volatile unsigned short unilog_write_semaphore;
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Pick the probe for the number of format arguments */
+#define UNILOG_PROBE_COUNT(...) UNILOG_PROBE_COUNT_(__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+#define UNILOG_PROBE_COUNT_(a1, a2, a3, a4, a5, a6, a7, n, ...) n
+#define UNILOG_PROBE_CAT(a, b) UNILOG_PROBE_CAT_(a, b)
+#define UNILOG_PROBE_CAT_(a, b) a##b
+
+#define UNILOG_PROBE_LOG_1(l, t, f) STAP_PROBE3(unilog, log, l, t, f)
+#define UNILOG_PROBE_LOG_2(l, t, f, a) STAP_PROBE4(unilog, log, l, t, f, a)
+#define UNILOG_PROBE_LOG_3(l, t, f, a, b) STAP_PROBE5(unilog, log, l, t, f, a, b)
+#define UNILOG_PROBE_LOG_4(l, t, f, a, b, c) STAP_PROBE6(unilog, log, l, t, f, a, b, c)
+#define UNILOG_PROBE_LOG_5(l, t, f, a, b, c, d) STAP_PROBE7(unilog, log, l, t, f, a, b, c, d)
+#define UNILOG_PROBE_LOG_6(l, t, f, a, b, c, d, e) \
+    STAP_PROBE8(unilog, log, l, t, f, a, b, c, d, e)
+#define UNILOG_PROBE_LOG_7(l, t, f, a, b, c, d, e, g) \
+    STAP_PROBE9(unilog, log, l, t, f, a, b, c, d, e, g)
+
+/**
+ * @brief Fire unilog:log, if a tracer is attached
+ *
+ * Arguments are integers or pointers, up to 6 after the format.
+ */
+#define UNILOG_PROBE_LOG(level, timestamp, ...)                                           \
+    do {                                                                                  \
+        if (__builtin_expect(unilog_log_semaphore != 0, 0)) {                             \
+            UNILOG_PROBE_CAT(UNILOG_PROBE_LOG_, UNILOG_PROBE_COUNT(__VA_ARGS__))(         \
+                level, timestamp, __VA_ARGS__);                                           \
+        }                                                                                 \
+    } while (0)
+
+/** @brief Fire unilog:write, if a tracer is attached */
+#define UNILOG_PROBE_WRITE(level, timestamp, message, length)                             \
+    do {                                                                                  \
+        if (__builtin_expect(unilog_write_semaphore != 0, 0)) {                           \
+            STAP_PROBE4(unilog, write, level, timestamp, message, length);                \
+        }                                                                                 \
+    } while (0)
+
+#else
+
+#define UNILOG_PROBE_LOG(level, timestamp, ...) ((void)0)
+#define UNILOG_PROBE_WRITE(level, timestamp, message, length) ((void)0)
+
+#endif /* UNILOG_USDT */
+
+/**
+ * @brief Write a formatted entry, with a unilog:log probe at the call site
+ *
+ * Like unilog_format, without its result. While a tracer is attached,
+ * the arguments are evaluated for the probe as well, so they should
+ * have no side effects.
+ *
+ * @param log Pointer to unilog context
+ * @param level Log level
+ * @param timestamp Timestamp
+ * @param ... Format string, then up to 6 integer or pointer arguments
+ */
+#define UNILOG_LOGF(log, level, timestamp, ...)                                           \
+    do {                                                                                  \
+        UNILOG_PROBE_LOG(level, timestamp, __VA_ARGS__);                                  \
+        (void)unilog_format(log, level, timestamp, __VA_ARGS__);                          \
+    } while (0)
+
+#endif /* UNILOG_PROBE_H */
@@ -0,0 +1,87 @@
+/**
+ * @file unilog_redact.h
+ * @brief Consumer-side redaction of personal data and secrets
+ *
+ * Masks email addresses, payment card numbers and the values following
+ * keywords such as "password=" in messages before they are passed to a
+ * sink. Candidate positions are found with a Teddy-style SIMD prefilter
+ * matching two-byte fingerprints of all patterns at once (SSSE3 or
+ * NEON, scalar elsewhere), and only candidates are verified. Masking
+ * happens in place and keeps the message length.
+ */
+
+#ifndef UNILOG_REDACT_H
+#define UNILOG_REDACT_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum number of keywords */
+#define UNILOG_REDACT_MAX_KEYWORDS 16
+
+/** @brief Maximum keyword length */
+#define UNILOG_REDACT_MAX_KEYWORD 32
+
+/**
+ * @brief Built-in rules
+ */
+#define UNILOG_REDACT_EMAIL 0x01    /**< local@domain.tld */
+#define UNILOG_REDACT_CARD 0x02     /**< 13-19 digits, optionally grouped, passing the Luhn check */
+#define UNILOG_REDACT_SECRETS 0x04  /**< Values after password=, token=, secret=, api_key=, bearer */
+#define UNILOG_REDACT_ALL 0x07
+
+/**
+ * @brief Redaction rules and their prefilter tables
+ */
+typedef struct {
+    uint32_t rules;                     /**< Enabled built-in rules */
+    char mask;                          /**< Byte replacing redacted data */
+    uint32_t keyword_count;             /**< Number of keywords */
+    uint8_t keyword_length[UNILOG_REDACT_MAX_KEYWORDS];  /**< Keyword lengths */
+    char keywords[UNILOG_REDACT_MAX_KEYWORDS][UNILOG_REDACT_MAX_KEYWORD];  /**< Lowercase keywords */
+    uint8_t nibbles[4][16];             /**< Bucket masks by low/high nibble of the first/second byte */
+} unilog_redactor_t;
+
+/**
+ * @brief Initialize a redactor
+ *
+ * @param redactor Pointer to redactor
+ * @param rules Built-in rules to enable (UNILOG_REDACT_*)
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID for unknown rules
+ */
+unilog_result_t unilog_redactor_init(unilog_redactor_t *redactor, uint32_t rules);
+
+/**
+ * @brief Mask the value following a keyword
+ *
+ * The keyword is matched case-insensitively, and the value runs up to
+ * the next whitespace, quote or one of ",;&)<".
+ *
+ * @param redactor Pointer to redactor
+ * @param keyword Keyword including its separator, e.g. "session=" (2+ bytes)
+ * @return UNILOG_OK on success, UNILOG_ERR_FULL if there are too many
+ *         keywords, UNILOG_ERR_INVALID if the keyword is too short or long
+ */
+unilog_result_t unilog_redactor_add_keyword(unilog_redactor_t *redactor, const char *keyword);
+
+/**
+ * @brief Redact a message in place
+ *
+ * Run it on the expanded text, after unilog_intern_process if interning
+ * is used.
+ *
+ * @param redactor Pointer to redactor
+ * @param message Message to redact
+ * @param length Message length
+ * @return Number of redacted items
+ */
+uint32_t unilog_redact(const unilog_redactor_t *redactor, char *message, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_REDACT_H */
@@ -0,0 +1,376 @@
+/**
+ * @file unilog_segment.h
+ * @brief Binary segment files for archiving drained log entries
+ *
+ * A segment stores log entries in the same layout as the ring buffer,
+ * preceded by a file header and followed by a sparse time index. The
+ * header describes the entry layout, so segments written on any target
+ * can be read on any host.
+ * Segments are written by the consumer and processed on the host, so
+ * this part of the library uses stdio. It still performs no dynamic
+ * allocation - index storage is provided by the caller.
+ */
+
+#ifndef UNILOG_SEGMENT_H
+#define UNILOG_SEGMENT_H
+
+#include "unilog/unilog.h"
+#include "unilog/unilog_decode.h"
+#include "unilog/unilog_intern.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Segment file magic, "ULSG" */
+#define UNILOG_SEGMENT_MAGIC "ULSG"
+
+/** @brief Current segment format version */
+#define UNILOG_SEGMENT_VERSION 2
+
+/** @brief Retention value that keeps entries of a level forever */
+#define UNILOG_RETAIN_FOREVER UINT32_MAX
+
+/** @brief Largest message compressed by the compactor, and stored compressed message read */
+#define UNILOG_SEGMENT_COMPRESS_SIZE 8192
+
+/**
+ * @brief Segment file header
+ *
+ * The header is rewritten when the segment is closed, so readers can
+ * rely on the summary fields of any properly closed segment. Readers
+ * convert it to host byte order.
+ */
+typedef struct {
+    char magic[4];          /**< UNILOG_SEGMENT_MAGIC */
+    unilog_layout_t layout; /**< Entry layout, also byte order of this header */
+    uint16_t version;       /**< Format version */
+    uint16_t header_size;   /**< Size of this header in bytes */
+    uint32_t entry_count;   /**< Number of entries in the segment */
+    uint32_t ts_min;        /**< Smallest entry timestamp */
+    uint32_t ts_max;        /**< Largest entry timestamp */
+    uint32_t data_size;     /**< Size of the entry area in bytes */
+    uint32_t index_count;   /**< Number of index entries after the data */
+    uint32_t index_stride;  /**< Entries between two index entries */
+} unilog_segment_header_t;
+
+/**
+ * @brief Sparse time index entry
+ */
+typedef struct {
+    uint32_t timestamp;     /**< Timestamp of the indexed entry */
+    uint32_t offset;        /**< Offset of the entry from the start of data */
+} unilog_segment_index_t;
+
+/**
+ * @brief Segment writer state
+ */
+typedef struct {
+    FILE *file;                     /**< Output file, positioned at start */
+    unilog_segment_header_t header; /**< Header being built */
+    unilog_segment_index_t *index;  /**< Caller-provided index storage */
+    uint32_t index_capacity;        /**< Number of index slots */
+} unilog_segment_writer_t;
+
+/**
+ * @brief Segment reader state
+ */
+typedef struct {
+    FILE *file;                     /**< Input file */
+    unilog_segment_header_t header; /**< Header read from the file */
+    uint32_t offset;                /**< Offset of the next entry in data */
+    uint32_t entry_size;            /**< Padded size of the current entry */
+    unilog_decoder_t decoder;       /**< Entry layout, checked once */
+    uint32_t corrupt;               /**< Corrupt regions skipped (CRC layouts only) */
+} unilog_segment_reader_t;
+
+/**
+ * @brief Per-level retention policy
+ *
+ * An entry is kept if its age (now - timestamp, in timestamp units)
+ * does not exceed max_age for its level. Ages are unsigned, so any
+ * max_age up to UINT32_MAX - 1 works, and timestamps that wrap around
+ * (e.g. milliseconds) are aged correctly. Entries at most skew units
+ * newer than now, written by a host whose clock runs ahead, are kept;
+ * anything further ahead counts as a wrapped-around, old timestamp.
+ */
+typedef struct {
+    uint32_t now;                           /**< Current time */
+    uint32_t skew;                          /**< Tolerated clock skew, in timestamp units */
+    uint32_t max_age[UNILOG_LEVEL_NONE];    /**< Maximum age per level */
+} unilog_retention_t;
+
+/**
+ * @brief Incremental segment compactor state
+ *
+ * Copies the retained entries of several input segments, in order,
+ * into one output segment with a freshly built index. Optionally,
+ * large messages are LZ compressed on the way, see
+ * unilog_compactor_set_compression.
+ */
+typedef struct {
+    FILE *const *inputs;                /**< Input segment files */
+    size_t input_count;                 /**< Number of input files */
+    size_t current;                     /**< Index of the current input */
+    unilog_segment_reader_t reader;     /**< Reader for the current input */
+    bool reader_open;                   /**< Reader has been opened */
+    bool finished;                      /**< Output segment has been finished */
+    unilog_segment_writer_t *writer;    /**< Output segment writer */
+    unilog_retention_t policy;          /**< Retention policy */
+    uint32_t compress_threshold;        /**< Smallest message to compress, 0 for none */
+    uint32_t kept;                      /**< Entries copied so far */
+    uint32_t dropped;                   /**< Entries dropped so far */
+    uint32_t compressed;                /**< Entries written compressed so far */
+} unilog_compactor_t;
+
+/**
+ * @brief Input of a k-way merge
+ */
+typedef struct {
+    unilog_segment_reader_t reader; /**< Reader for this input */
+    uint32_t end;                   /**< Data offset where the merged range ends */
+    unilog_entry_info_t info;       /**< Metadata of the pending entry */
+    uint32_t msg_len;               /**< Message length of the pending entry */
+    unilog_intern_map_t *map;       /**< Definitions of this input, NULL if not tracked */
+} unilog_merge_source_t;
+
+/**
+ * @brief Incremental k-way merge state
+ *
+ * Merges ranges of several segments, each ordered by timestamp, into
+ * one output segment ordered by timestamp. Entries with equal timestamps
+ * are taken in input order, and entries of one input keep their order.
+ *
+ * Intern IDs are assigned per process, so inputs from different
+ * processes use the same IDs for different strings. The merger tracks
+ * the definitions of each input in a map of its own, and writes
+ * interned entries with their references expanded; definition records
+ * are not copied.
+ */
+typedef struct {
+    unilog_merge_source_t *sources;     /**< Caller-provided input state */
+    uint32_t *heap;                     /**< Min-heap of sources with pending entries */
+    uint32_t heap_size;                 /**< Number of sources in the heap */
+    uint32_t count;                     /**< Number of inputs */
+    unilog_segment_writer_t *writer;    /**< Output segment writer */
+    bool finished;                      /**< Output segment has been finished */
+    uint32_t merged;                    /**< Entries copied so far */
+} unilog_merger_t;
+
+/**
+ * @brief Start writing a new segment
+ *
+ * @param writer Pointer to writer state
+ * @param file Output file opened for binary writing (must be seekable)
+ * @param index Index storage, the index gets sparser when it fills up
+ * @param index_capacity Number of entries in index storage (may be 0)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_writer_init(unilog_segment_writer_t *writer, FILE *file,
+                                           unilog_segment_index_t *index,
+                                           uint32_t index_capacity);
+
+/**
+ * @brief Append an entry to a segment
+ *
+ * @param writer Pointer to writer state
+ * @param info Entry metadata
+ * @param message Message bytes
+ * @param length Message length
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_write(unilog_segment_writer_t *writer,
+                                     const unilog_entry_info_t *info,
+                                     const char *message, size_t length);
+
+/**
+ * @brief Write index and final header of a segment
+ *
+ * The file is not closed.
+ *
+ * @param writer Pointer to writer state
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_writer_finish(unilog_segment_writer_t *writer);
+
+/**
+ * @brief Open a segment for reading
+ *
+ * @param reader Pointer to reader state
+ * @param file Input file opened for binary reading
+ * @return UNILOG_OK on success, UNILOG_ERR_INVALID if not a valid segment
+ */
+unilog_result_t unilog_segment_reader_init(unilog_segment_reader_t *reader, FILE *file);
+
+/**
+ * @brief Read the next entry of a segment
+ *
+ * For segments with entry CRCs, corrupt entries are skipped and
+ * counted in reader->corrupt. Compressed messages of up to
+ * UNILOG_SEGMENT_COMPRESS_SIZE stored bytes are expanded and the flag
+ * cleared; larger ones are returned as stored, with
+ * UNILOG_FLAG_COMPRESSED set (see unilog_decompress).
+ *
+ * @param reader Pointer to reader state
+ * @param info Output pointer for entry metadata
+ * @param buffer Output buffer for message
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes read on success, UNILOG_ERR_EMPTY at the end
+ *         of the segment, other negative error code otherwise
+ */
+int unilog_segment_read(unilog_segment_reader_t *reader, unilog_entry_info_t *info,
+                        char *buffer, size_t buffer_size);
+
+/**
+ * @brief Position reader near the first entry at or after a timestamp
+ *
+ * Uses the sparse index, so the reader may be positioned up to
+ * index_stride entries before the requested one.
+ *
+ * @param reader Pointer to reader state
+ * @param timestamp Timestamp to seek to
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_seek(unilog_segment_reader_t *reader, uint32_t timestamp);
+
+/**
+ * @brief Position reader exactly at the first entry at or after a timestamp
+ *
+ * Seeks using the index, then scans forward. Afterwards, reader->offset
+ * is the data offset of that entry, or data_size if there is none.
+ *
+ * @param reader Pointer to reader state
+ * @param timestamp Timestamp to find
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_find(unilog_segment_reader_t *reader, uint32_t timestamp);
+
+/**
+ * @brief Get an entry of the sparse time index
+ *
+ * Each index entry stands for header.index_stride entries, so the index
+ * tells how entries are distributed over time without reading them.
+ * The read position is not changed.
+ *
+ * @param reader Pointer to reader state
+ * @param position Index entry number, below header.index_count
+ * @param entry Output pointer for the index entry
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_index_entry(unilog_segment_reader_t *reader, uint32_t position,
+                                           unilog_segment_index_t *entry);
+
+/**
+ * @brief Get a run of entries of the sparse time index
+ *
+ * Reads them with one read and converts their byte order in bulk.
+ * The read position is not changed.
+ *
+ * @param reader Pointer to reader state
+ * @param first First index entry number
+ * @param entries Output array of count index entries
+ * @param count Number of entries to read, at most header.index_count - first
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_segment_read_index(unilog_segment_reader_t *reader, uint32_t first,
+                                          unilog_segment_index_t *entries, uint32_t count);
+
+/**
+ * @brief Check whether a retention policy keeps an entry
+ *
+ * @param policy Retention policy
+ * @param level Entry log level
+ * @param timestamp Entry timestamp
+ * @return true if the entry is kept
+ */
+bool unilog_retention_keep(const unilog_retention_t *policy, unilog_level_t level,
+                           uint32_t timestamp);
+
+/**
+ * @brief Set up a compaction job
+ *
+ * @param compactor Pointer to compactor state
+ * @param inputs Input segment files, oldest first (must remain valid)
+ * @param input_count Number of input files
+ * @param writer Initialized output writer (must remain valid)
+ * @param policy Retention policy to apply
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_compactor_init(unilog_compactor_t *compactor,
+                                      FILE *const *inputs, size_t input_count,
+                                      unilog_segment_writer_t *writer,
+                                      const unilog_retention_t *policy);
+
+/**
+ * @brief Compress large messages of cold segments while compacting
+ *
+ * Retained messages of threshold to UNILOG_SEGMENT_COMPRESS_SIZE bytes
+ * are LZ compressed if that makes them smaller, and stored with
+ * UNILOG_FLAG_COMPRESSED like those from the write path (see
+ * unilog_set_compression). Interned entries and definition records are
+ * copied as they are, so the merger and intern maps can still read
+ * them, and so are entries compressed already.
+ *
+ * @param compactor Pointer to compactor state, after unilog_compactor_init
+ * @param threshold Smallest message size to compress, 0 to disable
+ */
+void unilog_compactor_set_compression(unilog_compactor_t *compactor, uint32_t threshold);
+
+/**
+ * @brief Perform a bounded amount of compaction work
+ *
+ * Meant to be called repeatedly from a low-priority background thread,
+ * so the sink is never blocked for long. Finishes the output segment
+ * once all inputs are processed.
+ *
+ * @param compactor Pointer to compactor state
+ * @param max_entries Maximum number of input entries to process
+ * @return UNILOG_OK when done, UNILOG_ERR_BUSY if more work remains,
+ *         other error code on failure
+ */
+unilog_result_t unilog_compactor_step(unilog_compactor_t *compactor, uint32_t max_entries);
+
+/**
+ * @brief Set up a k-way merge
+ *
+ * Each input may be limited to a range of data offsets, e.g. as found
+ * with unilog_segment_find, so that several mergers can work on
+ * disjoint time ranges of the same inputs in parallel, each with its
+ * own file handles. Definitions made before an input's range are
+ * read from the start of the input.
+ *
+ * Without maps, merging fails with UNILOG_ERR_INVALID at the first
+ * interned entry or definition record.
+ *
+ * @param merger Pointer to merger state
+ * @param inputs Input segment files (must remain valid)
+ * @param begin Data offset of the first entry to merge per input, NULL for all
+ * @param end Data offset where merging stops per input, NULL for all
+ * @param count Number of inputs
+ * @param sources Storage for count input states (must remain valid)
+ * @param heap Storage for count heap slots (must remain valid)
+ * @param maps Initialized intern maps, one per input (must remain valid), or NULL
+ * @param writer Initialized output writer (must remain valid)
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_merger_init(unilog_merger_t *merger, FILE *const *inputs,
+                                   const uint32_t *begin, const uint32_t *end, uint32_t count,
+                                   unilog_merge_source_t *sources, uint32_t *heap,
+                                   unilog_intern_map_t *maps, unilog_segment_writer_t *writer);
+
+/**
+ * @brief Perform a bounded amount of merge work
+ *
+ * @param merger Pointer to merger state
+ * @param max_entries Maximum number of entries to copy in this call
+ * @return UNILOG_ERR_BUSY if more work remains, UNILOG_OK once the output
+ *         segment is finished, other error code on failure
+ */
+unilog_result_t unilog_merger_step(unilog_merger_t *merger, uint32_t max_entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_SEGMENT_H */
@@ -0,0 +1,136 @@
+/**
+ * @file unilog_status.h
+ * @brief Lock-free status board holding the latest value per key
+ *
+ * Much of what gets logged is state ("link up", "queue depth 37") where
+ * only the latest value matters. A status board keeps one slot per key
+ * in a caller-provided table instead of streaming every update through
+ * the ring. Updates use a seqlock-style protocol and are safe from any
+ * context including interrupt handlers; the consumer takes consistent
+ * snapshots whenever it likes.
+ */
+
+#ifndef UNILOG_STATUS_H
+#define UNILOG_STATUS_H
+
+#include "unilog/unilog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum size of a status value in bytes
+ */
+#ifndef UNILOG_STATUS_VALUE_SIZE
+#define UNILOG_STATUS_VALUE_SIZE 32
+#endif
+
+/**
+ * @brief One keyed slot of a status board
+ *
+ * The sequence number is odd while an update is in progress and counts
+ * completed updates in steps of two.
+ */
+typedef struct {
+    _Atomic(uint32_t) seq;      /**< Sequence number */
+    uint32_t timestamp;         /**< Timestamp of the latest update */
+    uint32_t length;            /**< Length of the value in bytes */
+    uint8_t value[UNILOG_STATUS_VALUE_SIZE];  /**< Latest value */
+} unilog_status_slot_t;
+
+/**
+ * @brief Status board over a table of slots, indexed by key
+ */
+typedef struct {
+    unilog_status_slot_t *slots;    /**< Slot storage */
+    uint32_t count;                 /**< Number of slots (valid keys are 0..count-1) */
+} unilog_status_t;
+
+/**
+ * @brief Consistent copy of one slot
+ */
+typedef struct {
+    uint32_t version;       /**< Number of updates so far, 0 if never set */
+    uint32_t timestamp;     /**< Timestamp of the latest update */
+    uint32_t length;        /**< Length of the value in bytes */
+    char value[UNILOG_STATUS_VALUE_SIZE + 1];  /**< Value, null-terminated */
+} unilog_status_value_t;
+
+/**
+ * @brief Initialize a status board with provided slot storage
+ *
+ * @param board Pointer to status board
+ * @param slots Slot storage (must remain valid)
+ * @param count Number of slots
+ * @return UNILOG_OK on success, error code otherwise
+ */
+unilog_result_t unilog_status_init(unilog_status_t *board, unilog_status_slot_t *slots,
+                                   uint32_t count);
+
+/**
+ * @brief Set the value of a key
+ *
+ * Lock-free and interrupt-safe. Concurrent updates of the same key from
+ * contexts that can interrupt each other cannot wait for one another;
+ * the interrupting update then fails with UNILOG_ERR_BUSY.
+ *
+ * @param board Pointer to status board
+ * @param key Slot index
+ * @param timestamp Timestamp value
+ * @param value Value bytes
+ * @param length Value length (at most UNILOG_STATUS_VALUE_SIZE)
+ * @return UNILOG_OK on success, UNILOG_ERR_BUSY if the key is being
+ *         updated by another context, UNILOG_ERR_INVALID otherwise
+ */
+unilog_result_t unilog_status_set(unilog_status_t *board, uint32_t key, uint32_t timestamp,
+                                  const void *value, size_t length);
+
+/**
+ * @brief Set the value of a key to a formatted string
+ *
+ * Output longer than UNILOG_STATUS_VALUE_SIZE is truncated. Like
+ * unilog_format, this is thread-safe but NOT interrupt-safe.
+ *
+ * @param board Pointer to status board
+ * @param key Slot index
+ * @param timestamp Timestamp value
+ * @param format Printf-style format string
+ * @param ... Variable arguments for format string
+ * @return See unilog_status_set
+ */
+unilog_result_t unilog_status_format(unilog_status_t *board, uint32_t key, uint32_t timestamp,
+                                     const char *format, ...);
+
+/**
+ * @brief Read a consistent copy of one key
+ *
+ * @param board Pointer to status board
+ * @param key Slot index
+ * @param out Output pointer for the value
+ * @return UNILOG_OK on success, UNILOG_ERR_EMPTY if the key was never
+ *         set, UNILOG_ERR_BUSY if updates kept interfering
+ */
+unilog_result_t unilog_status_get(const unilog_status_t *board, uint32_t key,
+                                  unilog_status_value_t *out);
+
+/**
+ * @brief Read consistent copies of all keys
+ *
+ * Keys that were never set, or could not be read due to interfering
+ * updates, are reported with version 0. Comparing versions with a
+ * previous snapshot tells which keys changed.
+ *
+ * @param board Pointer to status board
+ * @param out Output array with one element per slot
+ * @param count Number of elements in out
+ * @return Number of keys copied with version > 0, negative error code on failure
+ */
+int unilog_status_snapshot(const unilog_status_t *board, unilog_status_value_t *out,
+                           uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNILOG_STATUS_H */
@@ -3,22 +3,91 @@
  * @brief Implementation of unilog lock-free logging library
  */
 
-#include "unilog/unilog.h"
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* sched_getcpu, syscall */
+#endif
+
+#include "unilog_internal.h"
+#include "unilog/unilog_probe.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
-/* Internal helper to check if value is power of 2 */
-static inline bool is_power_of_2(uint32_t x) {
-    return x > 0 && (x & (x - 1)) == 0;
+#if UNILOG_THREAD_INFO && defined(__linux__)
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if UNILOG_USDT
+/* Probe semaphores, incremented by tracers while attached */
+__attribute__((section(".probes"))) volatile unsigned short unilog_log_semaphore;
+__attribute__((section(".probes"))) volatile unsigned short unilog_write_semaphore;
+#endif
+
+#if UNILOG_THREAD_INFO
+/*
+ * Thread and CPU identification. Ports can provide their own cheap
+ * implementations (e.g. RTOS task number, core ID register) by defining
+ * UNILOG_PORT_THREAD_ID() and UNILOG_PORT_CPU_ID() when building.
+ */
+#ifndef UNILOG_PORT_THREAD_ID
+static _Thread_local uint32_t tls_thread_id;
+
+static inline uint32_t current_thread_id(void) {
+    uint32_t id = tls_thread_id;
+    if (id == 0) {
+        /* First entry from this thread: one syscall, cached afterwards */
+#ifdef __linux__
+        id = (uint32_t)syscall(SYS_gettid);
+#else
+        static _Atomic(uint32_t) next_thread_id = 1;
+        id = atomic_fetch_add_explicit(&next_thread_id, 1, memory_order_relaxed);
+#endif
+        tls_thread_id = id;
+    }
+    return id;
 }
+#define UNILOG_PORT_THREAD_ID() current_thread_id()
+#endif
 
-/* Internal helper to align size to 4-byte boundary */
-static inline uint32_t align_up(uint32_t size) {
-    return (size + 3) & ~3;
+#ifndef UNILOG_PORT_CPU_ID
+static inline uint32_t current_cpu_id(void) {
+#ifdef __linux__
+    /* glibc reads rseq's cpu_id if registered, otherwise uses vDSO getcpu */
+    int cpu = sched_getcpu();
+    return cpu < 0 ? UNILOG_CPU_UNKNOWN : (uint32_t)cpu;
+#else
+    return UNILOG_CPU_UNKNOWN;
+#endif
 }
+#define UNILOG_PORT_CPU_ID() current_cpu_id()
+#endif
+#endif /* UNILOG_THREAD_INFO */
 
-unilog_result_t unilog_init(unilog_t *log, void *buffer, uint32_t capacity) {
+void unilog_fill_header(unilog_entry_header_t *header, uint32_t level,
+                        uint32_t timestamp, const char *message, size_t msg_len) {
+    header->length = sizeof(*header) + msg_len;
+    header->level = level;
+    header->timestamp = timestamp;
+#if UNILOG_THREAD_INFO
+    header->thread_id = UNILOG_PORT_THREAD_ID();
+    header->cpu_id = UNILOG_PORT_CPU_ID();
+#endif
+#if UNILOG_ENTRY_CRC
+    header->crc = 0;
+    header->crc = unilog_crc32c(unilog_crc32c(0, header, sizeof(*header)), message, msg_len);
+#else
+    (void)message;
+#endif
+}
+
+unilog_result_t unilog_init_zeroed(unilog_t *log, void *buffer, uint32_t capacity) {
     if (!log || !buffer || !is_power_of_2(capacity)) {
         return UNILOG_ERR_INVALID;
     }
@@ -28,16 +97,36 @@ unilog_result_t unilog_init(unilog_t *log, void *buffer, uint32_t capacity) {
     atomic_init(&log->buffer.read_pos, 0);
     log->buffer.capacity = capacity;
     log->buffer.buffer = (uint8_t *)buffer;
+    log->buffer.mirrored = false;
+    atomic_init(&log->spare.write_pos, 0);
+    atomic_init(&log->spare.read_pos, 0);
+    log->spare.capacity = 0;
+    log->spare.buffer = NULL;
+    log->spare.mirrored = false;
+    atomic_init(&log->ring, &log->buffer);
+    atomic_init(&log->read_ring, &log->buffer);
     
     /* Initialize minimum log level */
     atomic_init(&log->min_level, UNILOG_LEVEL_TRACE);
-    
-    /* Clear the buffer */
-    memset(buffer, 0, capacity);
+    atomic_init(&log->waiters, 0);
+    atomic_init(&log->waiter, NULL);
+    atomic_init(&log->watermark, 0);
+    atomic_init(&log->draining, false);
+    atomic_init(&log->helper, NULL);
+    atomic_init(&log->compress_threshold, 0);
     
     return UNILOG_OK;
 }
 
+unilog_result_t unilog_init(unilog_t *log, void *buffer, uint32_t capacity) {
+    unilog_result_t result = unilog_init_zeroed(log, buffer, capacity);
+    if (result == UNILOG_OK) {
+        /* Clear the buffer */
+        memset(buffer, 0, capacity);
+    }
+    return result;
+}
+
 void unilog_set_level(unilog_t *log, unilog_level_t level) {
     if (!log) {
         return;
@@ -45,6 +134,18 @@ void unilog_set_level(unilog_t *log, unilog_level_t level) {
     atomic_store(&log->min_level, level);
 }
 
+void unilog_set_compression(unilog_t *log, uint32_t threshold) {
+#if UNILOG_COMPRESSION
+    if (!log) {
+        return;
+    }
+    atomic_store_explicit(&log->compress_threshold, threshold, memory_order_relaxed);
+#else
+    (void)log;
+    (void)threshold;
+#endif
+}
+
 unilog_level_t unilog_get_level(const unilog_t *log) {
     if (!log) {
         return UNILOG_LEVEL_NONE;
@@ -52,97 +153,553 @@ unilog_level_t unilog_get_level(const unilog_t *log) {
     return atomic_load(&log->min_level);
 }
 
-static unilog_result_t unilog_write_internal(unilog_t *log, unilog_level_t level,
-                                               uint32_t timestamp, const char *message,
-                                               size_t msg_len) {
-    if (!log || !message) {
+#if UNILOG_THREAD_LEVEL
+_Thread_local unilog_level_t unilog_tls_level = UNILOG_LEVEL_NONE;
+static _Thread_local bool tls_helping;
+#endif
+
+unilog_level_t unilog_set_thread_level(unilog_level_t level) {
+#if UNILOG_THREAD_LEVEL
+    unilog_level_t previous = unilog_tls_level;
+    unilog_tls_level = (uint32_t)level > UNILOG_LEVEL_NONE ? UNILOG_LEVEL_NONE : level;
+    return previous;
+#else
+    (void)level;
+    return UNILOG_LEVEL_NONE;
+#endif
+}
+
+void unilog_clear_thread_level(void) {
+    unilog_set_thread_level(UNILOG_LEVEL_NONE);
+}
+
+unilog_level_t unilog_get_thread_level(void) {
+#if UNILOG_THREAD_LEVEL
+    return unilog_tls_level;
+#else
+    return UNILOG_LEVEL_NONE;
+#endif
+}
+
+unilog_result_t unilog_set_helper(unilog_t *log, unilog_helper_t *helper) {
+#if !(UNILOG_HELPING && UNILOG_THREAD_LEVEL)
+    /* Producers opt in to helping per thread, so no one could help */
+    if (helper) {
+        return UNILOG_ERR_INVALID;
+    }
+#endif
+    if (!log || (helper && (!helper->sink || !helper->buffer || helper->buffer_size == 0 ||
+                            helper->max_batch == 0))) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (helper) {
+        atomic_init(&helper->helped, 0);
+    }
+    atomic_store_explicit(&log->helper, helper, memory_order_release);
+    return UNILOG_OK;
+}
+
+bool unilog_set_thread_helping(bool enable) {
+#if UNILOG_THREAD_LEVEL
+    bool previous = tls_helping;
+    tls_helping = enable;
+    return previous;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
+unilog_result_t unilog_resize(unilog_t *log, void *buffer, uint32_t capacity) {
+#if UNILOG_RESIZE
+    if (!log || !buffer || !is_power_of_2(capacity)) {
         return UNILOG_ERR_INVALID;
     }
     
-    /* Check if this level should be logged */
-    unilog_level_t min_level = atomic_load(&log->min_level);
-    if (level < min_level) {
-        return UNILOG_OK;  /* Silently ignore */
+    unilog_buffer_t *old = producer_ring(log);
+    unilog_buffer_t *ring = old == &log->buffer ? &log->spare : &log->buffer;
+    if (ring->buffer) {
+        return UNILOG_ERR_BUSY;  /* Old buffer of the last resize not taken back yet */
     }
     
-    /* Calculate total entry size (aligned) */
-    uint32_t header_size = sizeof(unilog_entry_header_t);
-    uint32_t total_size = header_size + msg_len;
-    uint32_t advance_by = align_up(total_size);
+    /* Set up the other ring; its write position goes last, so producers
+       still holding it from its earlier use see it sealed until then */
+    memset(buffer, 0, capacity);
+    atomic_store_explicit(&ring->read_pos, 0, memory_order_relaxed);
+    ring->capacity = capacity;
+    ring->buffer = (uint8_t *)buffer;
+    ring->mirrored = false;
+    atomic_store_explicit(&ring->write_pos, 0, memory_order_release);
     
-    /* Check if entry is too large */
-    if (total_size > log->buffer.capacity / 2) {
-        /* TODO: Check if we really need this restriction */
+    /* Redirect producers, then seal the old ring: from here on a
+       reservation in it fails, and the producer moves on to the new one.
+       Reservations made before remain for the consumer to read. */
+    atomic_store(&log->ring, ring);
+    atomic_fetch_or(&old->write_pos, RING_SEALED);
+    unilog_wake_consumer(log);
+    return UNILOG_OK;
+#else
+    (void)log;
+    (void)buffer;
+    (void)capacity;
+    return UNILOG_ERR_INVALID;
+#endif
+}
+
+unilog_result_t unilog_resize_finish(unilog_t *log, void **old_buffer) {
+#if UNILOG_RESIZE
+    if (!log || !old_buffer) {
         return UNILOG_ERR_INVALID;
     }
     
-    /* Get current positions atomically */
-    uint32_t capacity = log->buffer.capacity;
-    uint32_t mask = capacity - 1;
+    unilog_buffer_t *ring = producer_ring(log);
+    unilog_buffer_t *old = ring == &log->buffer ? &log->spare : &log->buffer;
+    if (!old->buffer) {
+        return UNILOG_ERR_INVALID;
+    }
+    /* Pairs with the consumer moving on once it has read the old ring */
+    if (consumer_ring(log) != ring) {
+        return UNILOG_ERR_BUSY;
+    }
+    
+    *old_buffer = old->buffer;
+    old->buffer = NULL;
+    return UNILOG_OK;
+#else
+    (void)log;
+    (void)old_buffer;
+    return UNILOG_ERR_INVALID;
+#endif
+}
+
+#if UNILOG_HELPING && UNILOG_THREAD_LEVEL
+/*
+ * Drain a bounded batch into the helper's sink on behalf of a producer
+ * that found the log full. Returns the number of entries drained.
+ */
+static uint32_t help_drain(unilog_t *log) {
+    if (!tls_helping) {
+        return 0;
+    }
+    unilog_helper_t *helper = atomic_load_explicit(&log->helper, memory_order_acquire);
+    if (!helper || !consumer_token_acquire(log)) {
+        return 0;  /* The consumer or another producer is already draining */
+    }
+
+    unilog_entry_info_t info;
+    uint32_t drained = 0;
+    while (drained < helper->max_batch) {
+        int len = unilog_read_next(log, &info, helper->buffer, helper->buffer_size);
+        if (len < 0) {
+            break;
+        }
+        helper->sink(helper->ctx, &info, helper->buffer, (size_t)len);
+        drained++;
+    }
+    consumer_token_release(log);
+
+    atomic_fetch_add_explicit(&helper->helped, drained, memory_order_relaxed);
+    return drained;
+}
+#endif
+
+/* Copy bytes out of the ring starting at pos, handling wrap-around */
+static void ring_copy_out(const unilog_buffer_t *ring, uint32_t pos, void *dst, uint32_t len) {
+    uint32_t first = ring->capacity - pos;
+    if (ring_contiguous(ring, pos, len)) {
+        memcpy(dst, ring->buffer + pos, len);
+    } else {
+        memcpy(dst, ring->buffer + pos, first);
+        memcpy((uint8_t *)dst + first, ring->buffer, len - first);
+    }
+}
+
+/* Zero a region of the ring starting at pos, handling wrap-around */
+static void ring_clear(unilog_buffer_t *ring, uint32_t pos, uint32_t len) {
+    uint32_t first = ring->capacity - pos;
+    if (ring_contiguous(ring, pos, len)) {
+        memset(ring->buffer + pos, 0, len);
+    } else {
+        memset(ring->buffer + pos, 0, first);
+        memset(ring->buffer, 0, len - first);
+    }
+}
+
+#if UNILOG_ENTRY_CRC
+/* CRC32C over a region of the ring, handling wrap-around */
+static uint32_t ring_crc(const unilog_buffer_t *ring, uint32_t crc, uint32_t pos, uint32_t len) {
+    uint32_t first = ring->capacity - pos;
+    if (ring_contiguous(ring, pos, len)) {
+        return unilog_crc32c(crc, ring->buffer + pos, len);
+    }
+    crc = unilog_crc32c(crc, ring->buffer + pos, first);
+    return unilog_crc32c(crc, ring->buffer, len - first);
+}
+#endif
+
+/* Check whether a complete, intact entry starts at pos */
+static bool recover_entry_valid(const unilog_buffer_t *ring, uint32_t pos, uint32_t used) {
+    unilog_entry_header_t header;
+    if (used < sizeof(header)) {
+        return false;
+    }
+    ring_copy_out(ring, pos, &header, sizeof(header));
+    if (header.length < sizeof(header) || header.length > ring->capacity / 2 ||
+        align_up(header.length) > used ||
+        (header.level & UNILOG_LEVEL_MASK) > UNILOG_LEVEL_NONE) {
+        return false;
+    }
+#if UNILOG_ENTRY_CRC
+    uint32_t expected = header.crc;
+    header.crc = 0;
+    uint32_t crc = unilog_crc32c(0, &header, sizeof(header));
+    crc = ring_crc(ring, crc, (pos + sizeof(header)) & (ring->capacity - 1),
+                   header.length - sizeof(header));
+    return crc == expected;
+#else
+    return true;
+#endif
+}
+
+#if UNILOG_ENTRY_CRC
+/* Turn a corrupt region into gap entries skipped by readers */
+static void recover_write_gap(unilog_buffer_t *ring, uint32_t pos, uint32_t len) {
+    uint32_t mask = ring->capacity - 1;
+    uint32_t max_gap = (ring->capacity / 2) & ~3u;
+
+    ring_clear(ring, pos, len);
+    while (len > 0) {
+        uint32_t gap = len < max_gap ? len : max_gap;
+        if (len - gap > 0 && len - gap < sizeof(unilog_entry_header_t)) {
+            gap = len - sizeof(unilog_entry_header_t);
+        }
+
+        unilog_entry_header_t header;
+        memset(&header, 0, sizeof(header));
+        header.length = gap;
+        header.level = UNILOG_LEVEL_NONE;
+        header.crc = ring_crc(ring, unilog_crc32c(0, &header, sizeof(header)),
+                              (pos + sizeof(header)) & mask, gap - sizeof(header));
+        for (size_t i = 0; i < sizeof(header); i++) {
+            ring->buffer[(pos + i) & mask] = ((const uint8_t *)&header)[i];
+        }
+
+        pos = (pos + gap) & mask;
+        len -= gap;
+    }
+}
+#endif
+
+/* Validate the entries of one ring; returns the number of corrupt regions */
+static int recover_ring(unilog_buffer_t *ring) {
+    if (!ring->buffer || !is_power_of_2(ring->capacity)) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    uint32_t mask = ring->capacity - 1;
+    uint32_t read_pos = atomic_load(&ring->read_pos);
+    uint32_t write_pos = atomic_load(&ring->write_pos);
+    uint32_t sealed = write_pos & RING_SEALED;
+    write_pos &= ~RING_SEALED;
+    if (read_pos > mask || write_pos > mask || (read_pos & 3) || (write_pos & 3)) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    int corrupt = 0;
+    uint32_t pos = read_pos;
+    while (pos != write_pos) {
+        uint32_t used = (write_pos - pos) & mask;
+        if (recover_entry_valid(ring, pos, used)) {
+            uint32_t length;
+            ring_copy_out(ring, pos, &length, sizeof(length));
+            pos = (pos + align_up(length)) & mask;
+            continue;
+        }
+        
+        corrupt++;
+#if UNILOG_ENTRY_CRC
+        /* Resynchronize at the next intact entry */
+        uint32_t skip = sizeof(unilog_entry_header_t);
+        while (skip < used && !recover_entry_valid(ring, (pos + skip) & mask, used - skip)) {
+            skip += 4;
+        }
+        if (skip < used) {
+            recover_write_gap(ring, pos, skip);
+            pos = (pos + skip) & mask;
+            continue;
+        }
+#endif
+        /* Nothing intact follows, drop the rest */
+        ring_clear(ring, pos, used);
+        write_pos = pos;
+    }
+    
+    atomic_store(&ring->write_pos, write_pos | sealed);
+    return corrupt;
+}
+
+int unilog_recover(unilog_t *log) {
+    if (!log || (uint32_t)atomic_load(&log->min_level) > UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    unilog_buffer_t *writing = producer_ring(log);
+    unilog_buffer_t *reading = consumer_ring(log);
+#if UNILOG_RESIZE
+    /* A resize may have been in progress, then both rings hold entries */
+    if ((writing != &log->buffer && writing != &log->spare) ||
+        (reading != &log->buffer && reading != &log->spare)) {
+        return UNILOG_ERR_INVALID;
+    }
+#endif
+    /* Waiters did not survive */
+    atomic_store(&log->waiters, 0);
+    atomic_store(&log->waiter, NULL);
+    
+    int corrupt = recover_ring(reading);
+    if (corrupt >= 0 && writing != reading) {
+        int more = recover_ring(writing);
+        corrupt = more < 0 ? more : corrupt + more;
+    }
+    return corrupt;
+}
+
+static unilog_result_t ring_reserve(unilog_t *log, uint32_t advance_by, uint32_t largest,
+                                    unilog_buffer_t **ring, uint32_t *write_pos) {
+    unilog_buffer_t *target = producer_ring(log);
     
     /* Try to reserve space using atomic compare-exchange */
-    uint32_t write_pos, new_write_pos;
+    uint32_t pos, new_write_pos;
     do {
-        write_pos = atomic_load_explicit(&log->buffer.write_pos, memory_order_acquire);
-        uint32_t read_pos = atomic_load_explicit(&log->buffer.read_pos, memory_order_acquire);
+        pos = atomic_load_explicit(&target->write_pos, memory_order_acquire);
+#if UNILOG_RESIZE
+        if (pos & RING_SEALED) {
+            /* Resized, the new ring was published before the old one was sealed */
+            target = producer_ring(log);
+            continue;
+        }
+#endif
+        uint32_t read_pos = atomic_load_explicit(&target->read_pos, memory_order_acquire);
+        uint32_t capacity = target->capacity;
+        uint32_t mask = capacity - 1;
+        
+        /* Entries take at most half of the ring */
+        if (largest > capacity / 2 || advance_by >= capacity) {
+            return UNILOG_ERR_INVALID;
+        }
         
         /* Calculate available space */
-        uint32_t used = (write_pos - read_pos) & mask;
+        uint32_t used = (pos - read_pos) & mask;
         uint32_t available = capacity - used - 1;  /* -1 to distinguish full from empty */
         
         if (advance_by > available) {
             return UNILOG_ERR_FULL;
         }
         
-        new_write_pos = (write_pos + advance_by) & mask;
-    } while (!atomic_compare_exchange_weak_explicit(&log->buffer.write_pos, &write_pos, 
-                                                      new_write_pos, memory_order_release, 
-                                                      memory_order_acquire));
+        new_write_pos = (pos + advance_by) & mask;
+    /* Sequentially consistent, so that either notify_consumer sees a
+       consumer about to block, or the consumer sees the new write_pos */
+    } while ((pos & RING_SEALED) ||
+             !atomic_compare_exchange_weak_explicit(&target->write_pos, &pos,
+                                                    new_write_pos, memory_order_seq_cst,
+                                                    memory_order_acquire));
+    
+    *ring = target;
+    *write_pos = pos;
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_reserve(unilog_t *log, uint32_t advance_by, uint32_t largest,
+                               unilog_buffer_t **ring, uint32_t *write_pos) {
+    unilog_result_t result = ring_reserve(log, advance_by, largest, ring, write_pos);
+#if UNILOG_HELPING && UNILOG_THREAD_LEVEL
+    if (result == UNILOG_ERR_FULL && help_drain(log) > 0) {
+        result = ring_reserve(log, advance_by, largest, ring, write_pos);
+    }
+#endif
+    return result;
+}
+
+void unilog_wake_consumer(unilog_t *log) {
+    uint32_t waiters = atomic_load(&log->waiters);
+    if (waiters >= ASYNC_WAITER) {
+        /* Read the watermark from the log: once disarmed, the waiter may be gone */
+        unilog_waiter_t *waiter = atomic_load_explicit(&log->waiter, memory_order_acquire);
+        if (waiter && unilog_available(log) >=
+                          atomic_load_explicit(&log->watermark, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&log->waiter, &waiter, NULL)) {
+            atomic_fetch_sub(&log->waiters, ASYNC_WAITER);
+            waiter->notify(waiter->ctx);
+        }
+    }
+#ifdef __linux__
+    /* Consumers block on write_pos, which producers have just advanced */
+    if (waiters % ASYNC_WAITER != 0) {
+        syscall(SYS_futex, &consumer_ring(log)->write_pos, FUTEX_WAKE_PRIVATE, INT_MAX,
+                NULL, NULL, 0);
+    }
+#endif
+}
+
+int unilog_wait_async(unilog_t *log, unilog_waiter_t *waiter) {
+    if (!log || !waiter || !waiter->notify || waiter->watermark == 0) {
+        return UNILOG_ERR_INVALID;
+    }
     
-    /* Now we have exclusive access to [write_pos, new_write_pos) */
-    uint8_t *buffer = log->buffer.buffer;
+    unilog_waiter_t *expected = NULL;
+    if (!atomic_compare_exchange_strong(&log->waiter, &expected, waiter)) {
+        return UNILOG_ERR_BUSY;
+    }
     
-    /* Write header */
+    /* Producers only look at the waiter once they see it counted */
+    atomic_store_explicit(&log->watermark, waiter->watermark, memory_order_relaxed);
+    
+    /* Pairs with notify_consumer, as in unilog_consumer: either the
+       producer sees us waiting, or we see its reservation */
+    atomic_fetch_add(&log->waiters, ASYNC_WAITER);
+    if (unilog_available(log) < waiter->watermark) {
+        return 1;
+    }
+    
+    /* Reached already, unless a producer has just claimed the waiter */
+    return unilog_cancel_wait(log, waiter) ? 0 : 1;
+}
+
+bool unilog_cancel_wait(unilog_t *log, unilog_waiter_t *waiter) {
+    if (!log || !waiter ||
+        !atomic_compare_exchange_strong(&log->waiter, &waiter, NULL)) {
+        return false;
+    }
+    atomic_fetch_sub(&log->waiters, ASYNC_WAITER);
+    return true;
+}
+
+#if UNILOG_COMPRESSION
+/*
+ * Write a message compressed, if that makes it smaller. Compresses once
+ * to measure, then again straight into the reserved space.
+ */
+static unilog_result_t write_compressed(unilog_t *log, uint32_t level, uint32_t timestamp,
+                                        const char *message, size_t msg_len) {
+    uint32_t packed = unilog_lz_compress(message, (uint32_t)msg_len, NULL, 0, 0,
+                                         (uint32_t)msg_len - 1);
+    uint32_t total_size = sizeof(unilog_entry_header_t) + packed;
+    if (packed == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    uint32_t advance_by = align_up(total_size);
+    unilog_buffer_t *ring;
+    uint32_t write_pos;
+    unilog_result_t result = unilog_reserve(log, advance_by, total_size, &ring, &write_pos);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+    
+    uint32_t mask = ring->capacity - 1;
+    uint32_t msg_pos = (write_pos + sizeof(unilog_entry_header_t)) & mask;
+    unilog_lz_compress(message, (uint32_t)msg_len, ring->buffer, msg_pos, mask, packed);
+    ring_clear(ring, (write_pos + total_size) & mask, advance_by - total_size);
+    
+    /* The header (and CRC) describe the message as stored */
     unilog_entry_header_t header;
+    unilog_fill_header(&header, level | (uint32_t)UNILOG_FLAG_COMPRESSED << UNILOG_FLAGS_SHIFT,
+                       timestamp, NULL, 0);
     header.length = total_size;
-    header.level = level;
-    header.timestamp = timestamp;
+#if UNILOG_ENTRY_CRC
+    header.crc = 0;
+    header.crc = ring_crc(ring, unilog_crc32c(0, &header, sizeof(header)), msg_pos, packed);
+#endif
+    ring_copy_in(ring, (write_pos + sizeof(header.length)) & mask,
+                 (const uint8_t *)&header + sizeof(header.length),
+                 sizeof(header) - sizeof(header.length));
     
-    uint32_t pos = (write_pos + sizeof(header.length)) & mask;
+    atomic_store_explicit((_Atomic uint32_t *)&ring->buffer[write_pos],
+            header.length, memory_order_release);
     
-    /* Copy header, excluding length */
-    for (size_t i = sizeof(header.length); i < sizeof(header); i++) {
-        buffer[pos] = ((uint8_t *)&header)[i];
-        pos = (pos + 1) & mask;
+    notify_consumer(log);
+    return UNILOG_OK;
+}
+#endif
+
+unilog_result_t unilog_write_record(unilog_t *log, uint32_t level, uint32_t timestamp,
+                                    const char *message, size_t msg_len) {
+#if UNILOG_COMPRESSION
+    /* Large messages are compressed when enabled, and written as is if
+       they do not shrink */
+    uint32_t threshold = atomic_load_explicit(&log->compress_threshold, memory_order_relaxed);
+    if (threshold != 0 && msg_len >= threshold) {
+        unilog_result_t result = write_compressed(log, level, timestamp, message, msg_len);
+        if (result != UNILOG_ERR_INVALID) {
+            return result;
+        }
     }
+#endif
     
-    /* Copy message */
-    for (size_t i = 0; i < msg_len; i++) {
-        buffer[pos] = message[i];
-        pos = (pos + 1) & mask;
-    }
+    /* Calculate total entry size (aligned) */
+    uint32_t header_size = sizeof(unilog_entry_header_t);
+    uint32_t total_size = header_size + msg_len;
+    uint32_t advance_by = align_up(total_size);
     
-    /* Pad to alignment */
-    while (pos != new_write_pos) {
-        buffer[pos] = 0;
-        pos = (pos + 1) & mask;
+    /* Fails with UNILOG_ERR_INVALID if the entry is too large */
+    unilog_buffer_t *ring;
+    uint32_t write_pos;
+    unilog_result_t result = unilog_reserve(log, advance_by, total_size, &ring, &write_pos);
+    if (result != UNILOG_OK) {
+        return result;
     }
+    
+    /* Now we have exclusive access to [write_pos, write_pos + advance_by) */
+    uint32_t mask = ring->capacity - 1;
+    uint8_t *buffer = ring->buffer;
+    
+    /* Write header */
+    unilog_entry_header_t header;
+    unilog_fill_header(&header, level, timestamp, message, msg_len);
+    
+    /* Copy header excluding length, message and padding */
+    ring_copy_in(ring, (write_pos + sizeof(header.length)) & mask,
+                 (const uint8_t *)&header + sizeof(header.length),
+                 sizeof(header) - sizeof(header.length));
+    ring_copy_in(ring, (write_pos + sizeof(header)) & mask, message, (uint32_t)msg_len);
+    ring_clear(ring, (write_pos + header.length) & mask, advance_by - header.length);
 
     /* Mark entry as complete by writing length last (atomic release) */
     atomic_store_explicit((_Atomic uint32_t *)&buffer[write_pos],
             header.length, memory_order_release);
     
+    notify_consumer(log);
     return UNILOG_OK;
 }
 
+static unilog_result_t unilog_write_internal(unilog_t *log, unilog_level_t level,
+                                               uint32_t timestamp, const char *message,
+                                               size_t msg_len) {
+    if (!log || !message || (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    /* Before the level check, so tracers see disabled levels too */
+    UNILOG_PROBE_WRITE(level, timestamp, message, msg_len);
+    
+    /* Check if this level should be logged */
+    unilog_level_t min_level = atomic_load(&log->min_level);
+    if (!level_enabled(level, min_level)) {
+        return UNILOG_OK;  /* Silently ignore */
+    }
+    
+    return unilog_write_record(log, level, timestamp, message, msg_len);
+}
+
 unilog_result_t unilog_format(unilog_t *log, unilog_level_t level,
                               uint32_t timestamp, const char *format, ...) {
+#if UNILOG_FORMAT
     if (!log || !format) {
         return UNILOG_ERR_INVALID;
     }
     
     /* Format message into a temporary buffer */
-    char temp_buffer[256];  /* Stack-allocated, no dynamic memory */
+    char temp_buffer[UNILOG_FORMAT_BUFFER_SIZE];  /* Stack-allocated, no dynamic memory */
     va_list args;
     va_start(args, format);
     int len = vsnprintf(temp_buffer, sizeof(temp_buffer), format, args);
@@ -158,6 +715,13 @@ unilog_result_t unilog_format(unilog_t *log, unilog_level_t level,
     }
     
     return unilog_write_internal(log, level, timestamp, temp_buffer, len);
+#else
+    (void)log;
+    (void)level;
+    (void)timestamp;
+    (void)format;
+    return UNILOG_ERR_INVALID;
+#endif
 }
 
 unilog_result_t unilog_write_raw(unilog_t *log, unilog_level_t level,
@@ -174,28 +738,93 @@ unilog_result_t unilog_write(unilog_t *log, unilog_level_t level,
     return unilog_write_internal(log, level, timestamp, message, strlen(message));
 }
 
+static int read_one(unilog_t *log, unilog_entry_info_t *info,
+                    char *buffer, size_t buffer_size);
+
 int unilog_read(unilog_t *log, unilog_level_t *level, uint32_t *timestamp,
                 char *buffer, size_t buffer_size) {
-    if (!log || !level || !timestamp || !buffer || buffer_size == 0) {
+    if (!level || !timestamp) {
         return UNILOG_ERR_INVALID;
     }
     
-    uint32_t capacity = log->buffer.capacity;
-    uint32_t mask = capacity - 1;
+    unilog_entry_info_t info;
+    int result = unilog_read_entry(log, &info, buffer, buffer_size);
+    if (result >= 0) {
+        *level = info.level;
+        *timestamp = info.timestamp;
+    }
+    return result;
+}
+
+int unilog_read_entry(unilog_t *log, unilog_entry_info_t *info,
+                      char *buffer, size_t buffer_size) {
+    if (!log || !info || !buffer || buffer_size == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    
+    /* Producers may be draining, take turns with them */
+    if (atomic_load_explicit(&log->helper, memory_order_acquire) == NULL) {
+        return unilog_read_next(log, info, buffer, buffer_size);
+    }
+    if (!consumer_token_acquire(log)) {
+        return UNILOG_ERR_BUSY;
+    }
+    int result = unilog_read_next(log, info, buffer, buffer_size);
+    consumer_token_release(log);
+    return result;
+}
+
+int unilog_read_next(unilog_t *log, unilog_entry_info_t *info,
+                     char *buffer, size_t buffer_size) {
+    /* Skip gaps left by unilog_recover */
+    int result;
+    do {
+        result = read_one(log, info, buffer, buffer_size);
+    } while (result >= 0 && info->level == UNILOG_LEVEL_NONE);
+    
+    return result;
+}
+
+/*
+ * Ring to read from. After unilog_resize, that is the old ring until
+ * everything reserved in it before it was sealed has been read.
+ */
+static unilog_buffer_t *reading_ring(unilog_t *log) {
+    unilog_buffer_t *ring = consumer_ring(log);
+#if UNILOG_RESIZE
+    uint32_t write_pos = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+    if ((write_pos & RING_SEALED) &&
+        atomic_load_explicit(&ring->read_pos, memory_order_relaxed) == (write_pos & ~RING_SEALED)) {
+        /* Drained; release, so unilog_resize_finish hands it back only now */
+        ring = producer_ring(log);
+        atomic_store_explicit(&log->read_ring, ring, memory_order_release);
+    }
+#endif
+    return ring;
+}
+
+/*
+ * Load the header of the committed entry at the read position.
+ * Returns 0 on success, negative error code otherwise.
+ */
+static int peek_header(unilog_t *log, unilog_buffer_t **ring, unilog_entry_header_t *header,
+                       uint32_t *read_pos) {
+    unilog_buffer_t *source = reading_ring(log);
+    uint32_t capacity = source->capacity;
+    *ring = source;
     
     /* Get current read position */
-    uint32_t read_pos = atomic_load_explicit(&log->buffer.read_pos, memory_order_acquire);
-    uint32_t write_pos = atomic_load_explicit(&log->buffer.write_pos, memory_order_acquire);
+    *read_pos = atomic_load_explicit(&source->read_pos, memory_order_acquire);
+    uint32_t write_pos = atomic_load_explicit(&source->write_pos, memory_order_acquire);
     
     /* Check if buffer is empty */
-    if (read_pos == write_pos) {
+    if (*read_pos == (write_pos & ~RING_SEALED)) {
         return UNILOG_ERR_EMPTY;
     }
     
-    uint8_t *buf = log->buffer.buffer;
-    
     /* Check if message was written completely (load length with acquire) */
-    uint32_t total_size = atomic_load_explicit((_Atomic uint32_t *)&buf[read_pos], memory_order_acquire);
+    uint32_t total_size = atomic_load_explicit(
+            (_Atomic uint32_t *)&source->buffer[*read_pos], memory_order_acquire);
     if (total_size == 0) {
         return UNILOG_ERR_BUSY;  /* Message not yet complete */
     }
@@ -204,69 +833,223 @@ int unilog_read(unilog_t *log, unilog_level_t *level, uint32_t *timestamp,
         return UNILOG_ERR_INVALID;
     }
 
-    atomic_store_explicit((_Atomic uint32_t *)&buf[read_pos], 0, memory_order_relaxed);
+    header->length = total_size;
+    ring_copy_out(source, (*read_pos + sizeof(header->length)) & (capacity - 1),
+                  (uint8_t *)header + sizeof(header->length),
+                  sizeof(*header) - sizeof(header->length));
+    return 0;
+}
 
-    /* Read header */
-    unilog_entry_header_t header;
-    header.length = total_size;
+/* Zero the entry at read_pos for the next lap, then hand its space back */
+static void release_entry(unilog_buffer_t *ring, uint32_t read_pos, uint32_t length) {
+    uint32_t advance_by = align_up(length);
+    ring_clear(ring, read_pos, advance_by);
+    atomic_store_explicit(&ring->read_pos, (read_pos + advance_by) & (ring->capacity - 1),
+                          memory_order_release);
+}
 
-    uint32_t pos = (read_pos + sizeof(header.length)) & mask;
-    for (size_t i = sizeof(header.length); i < sizeof(header); i++) {
-        ((uint8_t *)&header)[i] = buf[pos];
-        buf[pos] = 0;
-        pos = (pos + 1) & mask;
+/* Describe len bytes at pos as one span, or two if they wrap */
+static int ring_spans(const unilog_buffer_t *ring, uint32_t pos, uint32_t len,
+                      unilog_span_t spans[2]) {
+    spans[0].data = (const char *)ring->buffer + pos;
+    if (ring_contiguous(ring, pos, len)) {
+        spans[0].length = len;
+        return 1;
     }
-    
-    *level = header.level;
-    *timestamp = header.timestamp;
+    spans[0].length = ring->capacity - pos;
+    spans[1].data = (const char *)ring->buffer;
+    spans[1].length = len - spans[0].length;
+    return 2;
+}
+
+static void fill_info(unilog_entry_info_t *info, const unilog_entry_header_t *header) {
+    info->level = (unilog_level_t)(header->level & UNILOG_LEVEL_MASK);
+    info->flags = header->level >> UNILOG_FLAGS_SHIFT;
+    info->timestamp = header->timestamp;
+#if UNILOG_THREAD_INFO
+    info->thread_id = header->thread_id;
+    info->cpu_id = header->cpu_id;
+#else
+    info->thread_id = 0;
+    info->cpu_id = UNILOG_CPU_UNKNOWN;
+#endif
+}
+
+static int read_one(unilog_t *log, unilog_entry_info_t *info,
+                    char *buffer, size_t buffer_size) {
+    unilog_buffer_t *ring;
+    unilog_entry_header_t header;
+    uint32_t read_pos;
+    int result = peek_header(log, &ring, &header, &read_pos);
+    if (result < 0) {
+        return result;
+    }
+    fill_info(info, &header);
     
     /* Calculate message length */
-    uint32_t msg_len = total_size - sizeof(header);
+    uint32_t msg_pos = (read_pos + sizeof(header)) & (ring->capacity - 1);
+    uint32_t msg_len = header.length - sizeof(header);
     uint32_t copy_len = msg_len < buffer_size ? msg_len : buffer_size - 1;
     
     /* Read message */
-    for (size_t i = 0; i < copy_len; i++) {
-        buffer[i] = buf[pos];
-        buf[pos] = 0;
-        pos = (pos + 1) & mask;
+    if (info->flags & UNILOG_FLAG_COMPRESSED) {
+#if UNILOG_COMPRESSION
+        unilog_span_t spans[2];
+        int count = ring_spans(ring, msg_pos, msg_len, spans);
+        result = unilog_decompress(spans, count, buffer, buffer_size - 1);
+        copy_len = result < 0 ? 0 : (uint32_t)result;
+#else
+        result = UNILOG_ERR_INVALID;
+        copy_len = 0;
+#endif
+        info->flags &= ~(uint32_t)UNILOG_FLAG_COMPRESSED;
+    } else {
+        ring_copy_out(ring, msg_pos, buffer, copy_len);
     }
     buffer[copy_len] = '\0';
     
-    /* Update read position with release semantics */
-    uint32_t advance_by = align_up(header.length);
-    uint32_t new_read_pos = (read_pos + advance_by) & mask;
-    atomic_store_explicit(&log->buffer.read_pos, new_read_pos, memory_order_release);
+    release_entry(ring, read_pos, header.length);
+    return result < 0 ? UNILOG_ERR_INVALID : (int)copy_len;
+}
 
-    /* Clear padding */
-    while (pos != new_read_pos) {
-        buf[pos] = 0;
-        pos = (pos + 1) & mask;
+int unilog_peek(unilog_t *log, unilog_entry_info_t *info, unilog_span_t spans[2]) {
+    if (!log || !info || !spans ||
+        atomic_load_explicit(&log->helper, memory_order_acquire) != NULL) {
+        return UNILOG_ERR_INVALID;
     }
     
-    return (int)copy_len;
+    unilog_buffer_t *ring;
+    unilog_entry_header_t header;
+    uint32_t read_pos;
+    int result;
+    while ((result = peek_header(log, &ring, &header, &read_pos)) == 0 &&
+           (header.level & UNILOG_LEVEL_MASK) == UNILOG_LEVEL_NONE) {
+        release_entry(ring, read_pos, header.length);  /* Skip gaps */
+    }
+    if (result < 0) {
+        return result;
+    }
+    fill_info(info, &header);
+    
+    return ring_spans(ring, (read_pos + sizeof(header)) & (ring->capacity - 1),
+                      header.length - sizeof(header), spans);
 }
 
-uint32_t unilog_available(const unilog_t *log) {
+int unilog_read_shed(unilog_t *log, unilog_entry_info_t *info, char *buffer,
+                     size_t buffer_size, unilog_level_t keep_level,
+                     uint32_t shed[UNILOG_LEVEL_NONE]) {
+    unilog_buffer_t *ring;
+    unilog_entry_header_t header;
+    uint32_t read_pos;
+    int result;
+    while ((result = peek_header(log, &ring, &header, &read_pos)) == 0) {
+        unilog_level_t level = (unilog_level_t)(header.level & UNILOG_LEVEL_MASK);
+        if (level == UNILOG_LEVEL_NONE) {
+            release_entry(ring, read_pos, header.length);  /* Skip gaps */
+            continue;
+        }
+        /* Interned string definitions are needed by later entries, never shed them */
+        if (level >= keep_level ||
+            (header.level >> UNILOG_FLAGS_SHIFT) & UNILOG_FLAG_DEFINITION) {
+            break;
+        }
+        shed[level]++;
+        release_entry(ring, read_pos, header.length);
+    }
+    if (result < 0) {
+        return result;
+    }
+    return read_one(log, info, buffer, buffer_size);
+}
+
+int unilog_oldest_timestamp(unilog_t *log, uint32_t *timestamp) {
+    unilog_buffer_t *ring;
+    unilog_entry_header_t header;
+    uint32_t read_pos;
+    int result = peek_header(log, &ring, &header, &read_pos);
+    if (result == 0) {
+        *timestamp = header.timestamp;
+    }
+    return result;
+}
+
+unilog_result_t unilog_consume(unilog_t *log) {
     if (!log) {
-        return 0;
+        return UNILOG_ERR_INVALID;
     }
     
-    uint32_t read_pos = atomic_load_explicit(&log->buffer.read_pos, memory_order_acquire);
-    uint32_t write_pos = atomic_load_explicit(&log->buffer.write_pos, memory_order_acquire);
-    uint32_t mask = log->buffer.capacity - 1;
+    unilog_buffer_t *ring;
+    unilog_entry_header_t header;
+    uint32_t read_pos;
+    if (peek_header(log, &ring, &header, &read_pos) < 0) {
+        return UNILOG_ERR_EMPTY;
+    }
+    release_entry(ring, read_pos, header.length);
+    return UNILOG_OK;
+}
+
+void unilog_get_layout(unilog_layout_t *layout) {
+    if (!layout) {
+        return;
+    }
     
-    return (write_pos - read_pos) & mask;
+    const uint16_t probe = 1;
+    layout->byte_order = *(const uint8_t *)&probe ? UNILOG_BYTE_ORDER_LITTLE
+                                                  : UNILOG_BYTE_ORDER_BIG;
+    layout->alignment = 4;
+    layout->header_size = sizeof(unilog_entry_header_t);
+    layout->variant = 0;
+#if UNILOG_THREAD_INFO
+    layout->variant |= UNILOG_VARIANT_THREAD_INFO;
+#endif
+#if UNILOG_ENTRY_CRC
+    layout->variant |= UNILOG_VARIANT_CRC;
+#endif
+    layout->length_width = sizeof(((unilog_entry_header_t *)0)->length);
+    layout->level_width = sizeof(((unilog_entry_header_t *)0)->level);
+    layout->timestamp_width = sizeof(((unilog_entry_header_t *)0)->timestamp);
+    layout->id_width = sizeof(uint32_t);
 }
 
-bool unilog_is_empty(const unilog_t *log) {
-    if (!log) {
-        return true;
+unilog_result_t unilog_dump_header(const unilog_t *log, unilog_dump_header_t *header) {
+    if (!log || !header) {
+        return UNILOG_ERR_INVALID;
     }
     
-    uint32_t read_pos = atomic_load_explicit(&log->buffer.read_pos, memory_order_acquire);
-    uint32_t write_pos = atomic_load_explicit(&log->buffer.write_pos, memory_order_acquire);
+    memcpy(header->magic, UNILOG_DUMP_MAGIC, sizeof(header->magic));
+    unilog_get_layout(&header->layout);
+    const unilog_buffer_t *ring = consumer_ring(log);
+    header->capacity = ring->capacity;
+    header->read_pos = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+    header->write_pos = atomic_load_explicit(&ring->write_pos, memory_order_acquire) &
+                        ~RING_SEALED;
+    
+    return UNILOG_OK;
+}
+
+/* Bytes in use in one ring */
+static uint32_t ring_used(const unilog_buffer_t *ring) {
+    uint32_t read_pos = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+    uint32_t write_pos = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+    uint32_t mask = ring->capacity - 1;
+    
+    return ((write_pos & ~RING_SEALED) - read_pos) & mask;
+}
+
+uint32_t unilog_available(const unilog_t *log) {
+    if (!log) {
+        return 0;
+    }
     
-    return write_pos == read_pos;
+    /* While resizing, both the old and the new ring hold entries */
+    const unilog_buffer_t *reading = consumer_ring(log);
+    const unilog_buffer_t *writing = producer_ring(log);
+    uint32_t used = ring_used(reading);
+    return reading == writing ? used : used + ring_used(writing);
+}
+
+bool unilog_is_empty(const unilog_t *log) {
+    return unilog_available(log) == 0;
 }
 
 const char *unilog_level_name(unilog_level_t level) {
@@ -281,3 +1064,16 @@ const char *unilog_level_name(unilog_level_t level) {
         default: return "UNKNOWN";
     }
 }
+
+unilog_level_t unilog_level_from_name(const char *name, size_t length) {
+    if (!name) {
+        return UNILOG_LEVEL_NONE;
+    }
+    for (int level = UNILOG_LEVEL_TRACE; level < UNILOG_LEVEL_NONE; level++) {
+        const char *candidate = unilog_level_name((unilog_level_t)level);
+        if (strlen(candidate) == length && memcmp(candidate, name, length) == 0) {
+            return (unilog_level_t)level;
+        }
+    }
+    return UNILOG_LEVEL_NONE;
+}
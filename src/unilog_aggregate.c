@@ -0,0 +1,393 @@
+/**
+ * @file unilog_aggregate.c
+ * @brief Implementation of column decoding and aggregation kernels
+ */
+
+#include "unilog/unilog_aggregate.h"
+#include "unilog_internal.h"
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define AGG_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AGG_NEON 1
+#endif
+
+/* Message bytes read per entry; holds a definition record and the
+   references at the start of an interned message */
+#define SCAN_BYTES 64
+
+/* Entries whose bucket indexes are computed before counting them */
+#define CHUNK 256
+
+/* Bucket index of entries outside the histogram */
+#define OUTSIDE UINT32_MAX
+
+/* ID of the first reference in an interned message, UNILOG_FORMAT_NONE if none */
+static uint32_t first_reference(const uint8_t *m, size_t length) {
+    for (size_t i = 0; i + UNILOG_INTERN_REF_SIZE <= length; i++) {
+        if (m[i] != UNILOG_INTERN_ESCAPE) {
+            continue;
+        }
+        uint32_t id = m[i + 1] | (uint32_t)m[i + 2] << 8 | (uint32_t)m[i + 3] << 16 |
+                      (uint32_t)m[i + 4] << 24;
+        if (id != 0) {
+            return id;
+        }
+        i += UNILOG_INTERN_REF_SIZE - 1;
+    }
+    return UNILOG_FORMAT_NONE;
+}
+
+int unilog_segment_read_columns(unilog_segment_reader_t *reader, unilog_columns_t *columns,
+                                unilog_intern_map_t *map) {
+    if (!reader || !columns || !columns->timestamp || !columns->level || !columns->format ||
+        !columns->thread || columns->capacity == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    char message[SCAN_BYTES + 1];
+    char expanded[1];
+    unilog_entry_info_t info;
+    uint32_t n = 0;
+    while (n < columns->capacity) {
+        int length = unilog_segment_read(reader, &info, message, sizeof(message));
+        if (length == UNILOG_ERR_EMPTY) {
+            break;
+        }
+        if (length < 0) {
+            return length;
+        }
+        if (info.flags & UNILOG_FLAG_DEFINITION) {
+            if (map) {
+                unilog_intern_process(map, &info, message, (size_t)length, expanded,
+                                      sizeof(expanded));
+            }
+            continue;
+        }
+
+        /* Compressed messages are not expanded to find their format */
+        bool interned = (info.flags & (UNILOG_FLAG_INTERNED | UNILOG_FLAG_COMPRESSED)) ==
+                        UNILOG_FLAG_INTERNED;
+        columns->timestamp[n] = info.timestamp;
+        columns->level[n] = (uint8_t)info.level;
+        columns->format[n] = interned ? first_reference((const uint8_t *)message, (size_t)length)
+                                      : UNILOG_FORMAT_NONE;
+        columns->thread[n] = info.thread_id;
+        n++;
+    }
+
+    columns->count = n;
+    return (int)n;
+}
+
+/*
+ * Histogram
+ *
+ * The bucket of an entry is (timestamp - begin) / width. Division is
+ * replaced by a multiplication with the reciprocal UINT32_MAX / width,
+ * whose estimate is at most one too small and corrected with a single
+ * comparison, so four buckets are computed per SIMD step.
+ */
+
+unilog_result_t unilog_histogram_init(unilog_histogram_t *histogram, uint32_t begin,
+                                      uint32_t width, uint32_t buckets, uint64_t *counts) {
+    if (!histogram || !counts || width == 0 || buckets == 0 ||
+        (uint64_t)width * buckets > UINT32_MAX) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    histogram->begin = begin;
+    histogram->width = width;
+    histogram->buckets = buckets;
+    histogram->counts = counts;
+    memset(counts, 0, (size_t)buckets * UNILOG_LEVEL_NONE * sizeof(*counts));
+    return UNILOG_OK;
+}
+
+static inline uint32_t bucket_scalar(uint32_t delta, uint32_t width, uint32_t reciprocal) {
+    uint32_t q = (uint32_t)(((uint64_t)delta * reciprocal) >> 32);
+    return delta - q * width >= width ? q + 1 : q;
+}
+
+#ifdef AGG_SSE2
+/* Low 32 bits of the lane-wise product, which SSE2 lacks */
+static inline __m128i mullo_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* High 32 bits of the lane-wise product */
+static inline __m128i mulhi_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+/* Unsigned a < b */
+static inline __m128i cmplt_epu32(__m128i a, __m128i b) {
+    __m128i sign = _mm_set1_epi32((int)0x80000000u);
+    return _mm_cmplt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+static inline __m128i load_levels(const uint8_t *p) {
+    int32_t packed;
+    memcpy(&packed, p, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+}
+#endif
+
+#ifdef AGG_NEON
+static inline uint32x4_t load_levels(const uint8_t *p) {
+    uint32_t packed;
+    memcpy(&packed, p, sizeof(packed));
+    uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(packed));
+    return vmovl_u16(vget_low_u16(vmovl_u8(bytes)));
+}
+#endif
+
+/* Count slot of each entry, OUTSIDE if it falls into no bucket */
+static void histogram_slots(const unilog_histogram_t *h, const uint32_t *ts, const uint8_t *level,
+                            uint32_t count, uint32_t *slots) {
+    uint32_t reciprocal = UINT32_MAX / h->width;
+    uint32_t span = h->width * h->buckets;
+    uint32_t i = 0;
+
+#if defined(AGG_SSE2)
+    __m128i begin = _mm_set1_epi32((int)h->begin);
+    __m128i width = _mm_set1_epi32((int)h->width);
+    __m128i recip = _mm_set1_epi32((int)reciprocal);
+    __m128i limit = _mm_set1_epi32((int)span);
+    __m128i levels = _mm_set1_epi32(UNILOG_LEVEL_NONE);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i outside = _mm_set1_epi32(-1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i delta = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(ts + i)), begin);
+        __m128i lvl = load_levels(level + i);
+        __m128i q = mulhi_sse2(delta, recip);
+        __m128i rem = _mm_sub_epi32(delta, mullo_sse2(q, width));
+        q = _mm_add_epi32(q, _mm_andnot_si128(cmplt_epu32(rem, width), one));
+        __m128i slot = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(q, 2), _mm_slli_epi32(q, 1)),
+                                     lvl);
+        __m128i valid = _mm_and_si128(cmplt_epu32(delta, limit), _mm_cmplt_epi32(lvl, levels));
+        slot = _mm_or_si128(_mm_and_si128(valid, slot), _mm_andnot_si128(valid, outside));
+        _mm_storeu_si128((__m128i *)(slots + i), slot);
+    }
+#elif defined(AGG_NEON)
+    uint32x4_t begin = vdupq_n_u32(h->begin);
+    uint32x4_t width = vdupq_n_u32(h->width);
+    uint32x2_t recip = vdup_n_u32(reciprocal);
+    uint32x4_t limit = vdupq_n_u32(span);
+    uint32x4_t levels = vdupq_n_u32(UNILOG_LEVEL_NONE);
+    uint32x4_t outside = vdupq_n_u32(OUTSIDE);
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t delta = vsubq_u32(vld1q_u32(ts + i), begin);
+        uint32x4_t lvl = load_levels(level + i);
+        uint32x4_t q = vcombine_u32(vshrn_n_u64(vmull_u32(vget_low_u32(delta), recip), 32),
+                                    vshrn_n_u64(vmull_u32(vget_high_u32(delta), recip), 32));
+        uint32x4_t rem = vsubq_u32(delta, vmulq_u32(q, width));
+        q = vsubq_u32(q, vcgeq_u32(rem, width));
+        uint32x4_t slot = vmlaq_u32(lvl, q, levels);
+        uint32x4_t valid = vandq_u32(vcltq_u32(delta, limit), vcltq_u32(lvl, levels));
+        vst1q_u32(slots + i, vbslq_u32(valid, slot, outside));
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint32_t delta = ts[i] - h->begin;
+        slots[i] = delta < span && level[i] < UNILOG_LEVEL_NONE
+                       ? bucket_scalar(delta, h->width, reciprocal) * UNILOG_LEVEL_NONE + level[i]
+                       : OUTSIDE;
+    }
+}
+
+void unilog_histogram_add(unilog_histogram_t *histogram, const unilog_columns_t *columns) {
+    if (!histogram || !columns) {
+        return;
+    }
+
+    uint32_t slots[CHUNK];
+    for (uint32_t start = 0; start < columns->count; start += CHUNK) {
+        uint32_t n = columns->count - start < CHUNK ? columns->count - start : CHUNK;
+        histogram_slots(histogram, columns->timestamp + start, columns->level + start, n, slots);
+        for (uint32_t i = 0; i < n; i++) {
+            if (slots[i] != OUTSIDE) {
+                histogram->counts[slots[i]]++;
+            }
+        }
+    }
+}
+
+unilog_result_t unilog_histogram_merge(unilog_histogram_t *histogram,
+                                       const unilog_histogram_t *other) {
+    if (!histogram || !other || histogram->begin != other->begin ||
+        histogram->width != other->width || histogram->buckets != other->buckets) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    size_t n = (size_t)histogram->buckets * UNILOG_LEVEL_NONE;
+    for (size_t i = 0; i < n; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+    return UNILOG_OK;
+}
+
+/*
+ * Group count
+ *
+ * The filter is evaluated four entries at a time into a bit mask; the
+ * selected keys go into an open-addressed table with linear probing.
+ */
+
+unilog_result_t unilog_agg_init(unilog_agg_count_t *count, unilog_group_by_t by,
+                                const unilog_agg_filter_t *filter, unilog_agg_group_t *groups,
+                                uint32_t capacity) {
+    if (!count || !filter || !groups || (uint32_t)by > UNILOG_GROUP_THREAD ||
+        !is_power_of_2(capacity)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    count->by = by;
+    count->filter = *filter;
+    count->groups = groups;
+    count->capacity = capacity;
+    count->used = 0;
+    count->dropped = 0;
+    memset(groups, 0, capacity * sizeof(*groups));
+    return UNILOG_OK;
+}
+
+static void agg_insert(unilog_agg_count_t *count, uint32_t key, uint64_t n) {
+    uint32_t mask = count->capacity - 1;
+    uint32_t slot = (key * 0x9E3779B1u) & mask;
+
+    for (uint32_t probes = 0; probes < count->capacity; probes++) {
+        unilog_agg_group_t *group = &count->groups[slot];
+        if (group->count == 0) {
+            group->key = key;
+            group->count = n;
+            count->used++;
+            return;
+        }
+        if (group->key == key) {
+            group->count += n;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    count->dropped += n;
+}
+
+/* Bit i of the result is set if entry i passes the filter, for up to 32 entries */
+static uint32_t filter_mask(const unilog_agg_filter_t *f, const uint32_t *ts,
+                            const uint8_t *level, uint32_t count) {
+    uint32_t span = f->end > f->begin ? f->end - f->begin : 0;
+    uint32_t mask = 0;
+    uint32_t i = 0;
+
+#if defined(AGG_SSE2)
+    __m128i begin = _mm_set1_epi32((int)f->begin);
+    __m128i limit = _mm_set1_epi32((int)span);
+    __m128i below = _mm_set1_epi32((int)f->min_level);
+    for (; i + 4 <= count; i += 4) {
+        __m128i delta = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(ts + i)), begin);
+        __m128i pass = _mm_andnot_si128(_mm_cmplt_epi32(load_levels(level + i), below),
+                                        cmplt_epu32(delta, limit));
+        mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(pass)) << i;
+    }
+#elif defined(AGG_NEON)
+    static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+    uint32x4_t bits = vld1q_u32(lane_bits);
+    uint32x4_t begin = vdupq_n_u32(f->begin);
+    uint32x4_t limit = vdupq_n_u32(span);
+    uint32x4_t min_level = vdupq_n_u32((uint32_t)f->min_level);
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t delta = vsubq_u32(vld1q_u32(ts + i), begin);
+        uint32x4_t pass = vandq_u32(vcltq_u32(delta, limit),
+                                    vcgeq_u32(load_levels(level + i), min_level));
+        mask |= vaddvq_u32(vandq_u32(pass, bits)) << i;
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (ts[i] - f->begin < span && level[i] >= f->min_level) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+void unilog_agg_add(unilog_agg_count_t *count, const unilog_columns_t *columns) {
+    if (!count || !columns) {
+        return;
+    }
+
+    const uint32_t *keys = count->by == UNILOG_GROUP_FORMAT ? columns->format : columns->thread;
+    uint64_t levels[UNILOG_LEVEL_NONE] = { 0 };
+    for (uint32_t start = 0; start < columns->count; start += 32) {
+        uint32_t n = columns->count - start < 32 ? columns->count - start : 32;
+        uint32_t mask = filter_mask(&count->filter, columns->timestamp + start,
+                                    columns->level + start, n);
+        while (mask) {
+            uint32_t i = start + (uint32_t)__builtin_ctz(mask);
+            mask &= mask - 1;
+            if (count->by != UNILOG_GROUP_LEVEL) {
+                agg_insert(count, keys[i], 1);
+            } else if (columns->level[i] < UNILOG_LEVEL_NONE) {
+                levels[columns->level[i]]++;
+            }
+        }
+    }
+
+    /* Levels are few, so they are counted directly and inserted once */
+    for (uint32_t l = 0; l < UNILOG_LEVEL_NONE; l++) {
+        if (levels[l] > 0) {
+            agg_insert(count, l, levels[l]);
+        }
+    }
+}
+
+unilog_result_t unilog_agg_merge(unilog_agg_count_t *count, const unilog_agg_count_t *other) {
+    if (!count || !other || count->by != other->by) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    for (uint32_t i = 0; i < other->capacity; i++) {
+        if (other->groups[i].count > 0) {
+            agg_insert(count, other->groups[i].key, other->groups[i].count);
+        }
+    }
+    count->dropped += other->dropped;
+    return UNILOG_OK;
+}
+
+static inline bool ranks_before(const unilog_agg_group_t *a, const unilog_agg_group_t *b) {
+    return a->count > b->count || (a->count == b->count && a->key < b->key);
+}
+
+uint32_t unilog_agg_top(const unilog_agg_count_t *count, unilog_agg_group_t *top, uint32_t n) {
+    if (!count || !top) {
+        return 0;
+    }
+
+    /* Insertion into the sorted output, as n is small */
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count->capacity; i++) {
+        const unilog_agg_group_t *group = &count->groups[i];
+        if (group->count == 0 || (found == n && (n == 0 || !ranks_before(group, &top[n - 1])))) {
+            continue;
+        }
+        uint32_t k = found < n ? found++ : n - 1;
+        while (k > 0 && ranks_before(group, &top[k - 1])) {
+            top[k] = top[k - 1];
+            k--;
+        }
+        top[k] = *group;
+    }
+    return found;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file unilog_capture.c
+ * @brief Implementation of request-scoped capture buffers
+ */
+
+#include "unilog/unilog_capture.h"
+#include "unilog_internal.h"
+#include <string.h>
+
+unilog_result_t unilog_capture_pool_init(unilog_capture_pool_t *pool,
+                                         unilog_capture_t *captures, uint32_t count,
+                                         void *storage, uint32_t buffer_size) {
+    if (!pool || !captures || count == 0 || !storage ||
+        buffer_size < sizeof(unilog_entry_header_t) || buffer_size % 4 != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        captures[i].buffer = (uint8_t *)storage + (size_t)i * buffer_size;
+        captures[i].size = buffer_size;
+        captures[i].used = 0;
+        captures[i].dropped = 0;
+        captures[i].min_level = UNILOG_LEVEL_TRACE;
+        atomic_init(&captures[i].in_use, false);
+    }
+    pool->captures = captures;
+    pool->count = count;
+    atomic_init(&pool->next, 0);
+
+    return UNILOG_OK;
+}
+
+unilog_capture_t *unilog_capture_begin(unilog_capture_pool_t *pool, unilog_level_t min_level) {
+    if (!pool) {
+        return NULL;
+    }
+
+    /* Start after the last buffer taken, so a busy pool is not scanned from the front */
+    uint32_t start = atomic_load_explicit(&pool->next, memory_order_relaxed);
+    for (uint32_t i = 0; i < pool->count; i++) {
+        uint32_t index = (start + i) % pool->count;
+        unilog_capture_t *capture = &pool->captures[index];
+        bool expected = false;
+        if (atomic_compare_exchange_strong_explicit(&capture->in_use, &expected, true,
+                                                    memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            atomic_store_explicit(&pool->next, (index + 1) % pool->count,
+                                  memory_order_relaxed);
+            capture->used = 0;
+            capture->dropped = 0;
+            capture->min_level = min_level;
+            return capture;
+        }
+    }
+
+    return NULL;
+}
+
+unilog_result_t unilog_capture_write_raw(unilog_capture_t *capture, unilog_level_t level,
+                                         uint32_t timestamp, const char *message,
+                                         size_t length) {
+    if (!capture || (!message && length > 0) || (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (level < capture->min_level) {
+        return UNILOG_OK;  /* Silently ignore */
+    }
+
+    /* Entries are stored exactly as they will appear in the log */
+    uint32_t total_size = sizeof(unilog_entry_header_t) + length;
+    if (length > capture->size || align_up(total_size) > capture->size - capture->used) {
+        capture->dropped++;
+        return UNILOG_ERR_FULL;
+    }
+
+    uint8_t *entry = capture->buffer + capture->used;
+    unilog_entry_header_t header;
+    unilog_fill_header(&header, level, timestamp, message, length);
+    memcpy(entry, &header, sizeof(header));
+    if (length > 0) {
+        memcpy(entry + sizeof(header), message, length);
+    }
+    memset(entry + total_size, 0, align_up(total_size) - total_size);
+    capture->used += align_up(total_size);
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_capture_write(unilog_capture_t *capture, unilog_level_t level,
+                                     uint32_t timestamp, const char *message) {
+    if (!message) {
+        return UNILOG_ERR_INVALID;
+    }
+    return unilog_capture_write_raw(capture, level, timestamp, message, strlen(message));
+}
+
+void unilog_capture_discard(unilog_capture_t *capture) {
+    if (!capture) {
+        return;
+    }
+    capture->used = 0;
+    atomic_store_explicit(&capture->in_use, false, memory_order_release);
+}
+
+unilog_result_t unilog_capture_commit(unilog_t *log, unilog_capture_t *capture) {
+    if (!log || !capture) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t used = capture->used;
+    if (used == 0) {
+        unilog_capture_discard(capture);
+        return UNILOG_OK;
+    }
+
+    /* Every entry fits into a log, but the whole batch may not */
+    uint32_t entry_length;
+    uint32_t largest = 0;
+    for (uint32_t offset = 0; offset < used; offset += align_up(entry_length)) {
+        memcpy(&entry_length, capture->buffer + offset, sizeof(entry_length));
+        if (entry_length > largest) {
+            largest = entry_length;
+        }
+    }
+
+    unilog_buffer_t *ring;
+    uint32_t write_pos;
+    unilog_result_t result = unilog_reserve(log, used, largest, &ring, &write_pos);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+
+    /* Copy everything but the first length word. The consumer cannot
+       read past the first entry before it is committed, so the other
+       length words need no ordering of their own. */
+    uint32_t mask = ring->capacity - 1;
+    ring_copy_in(ring, (write_pos + sizeof(uint32_t)) & mask,
+                 capture->buffer + sizeof(uint32_t), used - sizeof(uint32_t));
+
+    /* Commit the whole batch by writing the first length last (atomic release) */
+    memcpy(&entry_length, capture->buffer, sizeof(entry_length));
+    atomic_store_explicit((_Atomic uint32_t *)&ring->buffer[write_pos],
+            entry_length, memory_order_release);
+
+    notify_consumer(log);
+    unilog_capture_discard(capture);
+    return UNILOG_OK;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file unilog_consumer.c
+ * @brief Implementation of the managed consumer thread
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* pthread_attr_setaffinity_np */
+#endif
+
+#include "unilog/unilog_consumer.h"
+#include "unilog_internal.h"
+#include <sched.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Empty polls spent spinning, then yielding, before sleeping */
+#define SPIN_POLLS 128
+#define YIELD_POLLS 64
+
+/* First sleep of UNILOG_IDLE_PARK, doubled up to max_park_us */
+#define PARK_START_NS 1000L
+
+/* Upper bound for a blocked wait, covering a stop racing with blocking */
+#define WAIT_TIMEOUT_NS 50000000L
+
+/* Yields to wait for in-flight entries when stopping */
+#define STOP_BUSY_RETRIES 10000
+
+#define DEFAULT_MAX_BATCH 256
+#define DEFAULT_MAX_PARK_US 1000
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static void sleep_ns(long ns) {
+    struct timespec ts = { ns / 1000000000L, ns % 1000000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* Block until a producer moves write_pos, unless entries are already there */
+static void wait_for_entries(unilog_consumer_t *consumer) {
+    unilog_t *log = consumer->log;
+
+    /* Pairs with notify_consumer: either the producer sees us waiting,
+       or we see its reservation and do not block */
+    atomic_fetch_add(&log->waiters, 1);
+    unilog_buffer_t *ring = consumer_ring(log);
+    uint32_t write_pos = atomic_load(&ring->write_pos);
+    if (write_pos == atomic_load(&ring->read_pos) && atomic_load(&consumer->running)) {
+#ifdef __linux__
+        struct timespec timeout = { 0, WAIT_TIMEOUT_NS };
+        syscall(SYS_futex, &ring->write_pos, FUTEX_WAIT_PRIVATE, write_pos, &timeout,
+                NULL, 0);
+#else
+        sleep_ns((long)consumer->config.max_park_us * 1000);
+#endif
+        atomic_fetch_add_explicit(&consumer->sleeps, 1, memory_order_relaxed);
+    }
+    atomic_fetch_sub(&log->waiters, 1);
+}
+
+/* Idle after the given number of consecutive empty polls */
+static void idle(unilog_consumer_t *consumer, uint32_t polls, long *park_ns) {
+    unilog_idle_t strategy = consumer->config.idle;
+
+    if (strategy == UNILOG_IDLE_SPIN || polls < SPIN_POLLS) {
+        cpu_relax();
+    } else if (strategy == UNILOG_IDLE_YIELD || polls < SPIN_POLLS + YIELD_POLLS) {
+        sched_yield();
+    } else if (strategy == UNILOG_IDLE_WAIT) {
+        wait_for_entries(consumer);
+    } else {
+        sleep_ns(*park_ns);
+        atomic_fetch_add_explicit(&consumer->sleeps, 1, memory_order_relaxed);
+        long max_ns = (long)consumer->config.max_park_us * 1000;
+        *park_ns = *park_ns * 2 < max_ns ? *park_ns * 2 : max_ns;
+    }
+}
+
+/* True if the consumer is behind by more than its budget */
+static bool over_budget(unilog_consumer_t *consumer) {
+    const unilog_consumer_config_t *config = &consumer->config;
+    if (config->shed_fill > 0 && unilog_available(consumer->log) > config->shed_fill) {
+        return true;
+    }
+
+    uint32_t oldest;
+    return config->shed_age > 0 && unilog_oldest_timestamp(consumer->log, &oldest) == 0 &&
+           config->clock(config->ctx) - oldest > config->shed_age;
+}
+
+/* Handle up to one batch of entries; *last is the result of the last read */
+static uint32_t drain_batch(unilog_consumer_t *consumer, int *last) {
+    unilog_t *log = consumer->log;
+    unilog_entry_info_t info;
+    uint32_t count = 0;
+
+    /* With helping producers, hold the consumer token for the whole
+       batch rather than per entry, keeping handler calls in order */
+    bool token = atomic_load_explicit(&log->helper, memory_order_acquire) != NULL;
+    if (token && !consumer_token_acquire(log)) {
+        *last = UNILOG_ERR_BUSY;
+        return 0;
+    }
+    /* Behind by more than the budget, skip over entries nobody will miss
+       for the rest of the batch, so the backlog clears quickly */
+    uint32_t shed[UNILOG_LEVEL_NONE] = { 0 };
+    unilog_level_t keep_level = over_budget(consumer) ? consumer->config.shed_below
+                                                      : UNILOG_LEVEL_TRACE;
+    while (count < consumer->batch) {
+        *last = keep_level == UNILOG_LEVEL_TRACE
+                    ? unilog_read_next(log, &info, consumer->buffer, consumer->buffer_size)
+                    : unilog_read_shed(log, &info, consumer->buffer, consumer->buffer_size,
+                                       keep_level, shed);
+        if (*last < 0) {
+            break;
+        }
+        /* Interned parts are only text once expanded, and masking could
+           hit the IDs of references; the handler redacts those entries */
+        if (consumer->config.redactor &&
+            !(info.flags & (UNILOG_FLAG_INTERNED | UNILOG_FLAG_DEFINITION))) {
+            unilog_redact(consumer->config.redactor, consumer->buffer, (size_t)*last);
+        }
+        consumer->config.handler(consumer->config.ctx, &info, consumer->buffer,
+                                 (size_t)*last);
+        count++;
+    }
+    if (token) {
+        consumer_token_release(log);
+    }
+    if (keep_level != UNILOG_LEVEL_TRACE) {
+        for (int level = 0; level < UNILOG_LEVEL_NONE; level++) {
+            if (shed[level] > 0) {
+                atomic_fetch_add_explicit(&consumer->shed[level], shed[level],
+                                          memory_order_relaxed);
+            }
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    if (consumer->config.batch_end) {
+        consumer->config.batch_end(consumer->config.ctx);
+    }
+    atomic_fetch_add_explicit(&consumer->entries, count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&consumer->batches, 1, memory_order_relaxed);
+
+    /* Grow batches while the log keeps them full, shrink them when it
+       runs dry, so batch_end is amortized under load and prompt otherwise */
+    if (count == consumer->batch && consumer->batch < consumer->config.max_batch) {
+        consumer->batch *= 2;
+        if (consumer->batch > consumer->config.max_batch) {
+            consumer->batch = consumer->config.max_batch;
+        }
+    } else if (count < consumer->batch / 4) {
+        consumer->batch /= 2;
+    }
+    return count;
+}
+
+static void *consumer_main(void *arg) {
+    unilog_consumer_t *consumer = (unilog_consumer_t *)arg;
+    uint32_t polls = 0;
+    uint32_t stop_retries = 0;
+    long park_ns = PARK_START_NS;
+
+    for (;;) {
+        /* Load before draining, so a stop never misses earlier entries */
+        bool running = atomic_load(&consumer->running);
+        int last = UNILOG_ERR_EMPTY;
+        if (drain_batch(consumer, &last) > 0) {
+            polls = 0;
+            park_ns = PARK_START_NS;
+            continue;
+        }
+
+        if (last == UNILOG_ERR_BUSY) {
+            /* A producer is between reserving and committing */
+            if (!running && ++stop_retries > STOP_BUSY_RETRIES) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if (!running) {
+            break;
+        }
+        idle(consumer, polls++, &park_ns);
+    }
+
+    return NULL;
+}
+
+void unilog_consumer_config_init(unilog_consumer_config_t *config, unilog_consumer_fn handler,
+                                 void *ctx) {
+    if (!config) {
+        return;
+    }
+    config->handler = handler;
+    config->batch_end = NULL;
+    config->ctx = ctx;
+    config->redactor = NULL;
+    config->idle = UNILOG_IDLE_PARK;
+    config->cpu = -1;
+    config->sched_policy = UNILOG_SCHED_INHERIT;
+    config->sched_priority = 0;
+    config->max_batch = DEFAULT_MAX_BATCH;
+    config->max_park_us = DEFAULT_MAX_PARK_US;
+    config->shed_fill = 0;
+    config->shed_age = 0;
+    config->clock = NULL;
+    config->shed_below = UNILOG_LEVEL_WARN;
+}
+
+unilog_result_t unilog_consumer_start(unilog_consumer_t *consumer, unilog_t *log,
+                                      const unilog_consumer_config_t *config,
+                                      char *buffer, size_t buffer_size) {
+    if (!consumer || !log || !config || !config->handler || !buffer || buffer_size == 0 ||
+        (uint32_t)config->idle > UNILOG_IDLE_WAIT || config->max_batch == 0 ||
+        config->max_park_us == 0 || (config->shed_age > 0 && !config->clock) ||
+        (uint32_t)config->shed_below > UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    consumer->log = log;
+    consumer->config = *config;
+    consumer->buffer = buffer;
+    consumer->buffer_size = buffer_size;
+    consumer->batch = 1;
+    atomic_init(&consumer->running, true);
+    atomic_init(&consumer->entries, 0);
+    atomic_init(&consumer->batches, 0);
+    atomic_init(&consumer->sleeps, 0);
+    for (int level = 0; level < UNILOG_LEVEL_NONE; level++) {
+        atomic_init(&consumer->shed[level], 0);
+    }
+
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    int error = 0;
+    if (config->sched_policy != UNILOG_SCHED_INHERIT) {
+        struct sched_param param = { .sched_priority = config->sched_priority };
+        error = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) ||
+                pthread_attr_setschedpolicy(&attr, config->sched_policy) ||
+                pthread_attr_setschedparam(&attr, &param);
+    }
+#ifdef __linux__
+    if (!error && config->cpu >= 0) {
+        if (config->cpu >= CPU_SETSIZE) {
+            error = 1;
+        } else {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(config->cpu, &cpus);
+            error = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+    }
+#endif
+    if (!error) {
+        error = pthread_create(&consumer->thread, &attr, consumer_main, consumer);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (error) {
+        atomic_store(&consumer->running, false);
+        return UNILOG_ERR_INVALID;
+    }
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_consumer_stop(unilog_consumer_t *consumer) {
+    if (!consumer || !atomic_load(&consumer->running)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    atomic_store(&consumer->running, false);
+    unilog_wake_consumer(consumer->log);
+    return pthread_join(consumer->thread, NULL) == 0 ? UNILOG_OK : UNILOG_ERR_INVALID;
+}
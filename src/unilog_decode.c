@@ -0,0 +1,415 @@
+/**
+ * @file unilog_decode.c
+ * @brief Implementation of host-side entry decoding
+ */
+
+#include "unilog/unilog_decode.h"
+#include <string.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Internal helper to align size to a power of 2 boundary */
+static inline uint32_t align_to(uint32_t size, uint32_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static inline bool is_power_of_2(uint32_t x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+static inline uint32_t bswap32(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_bswap32(x);
+#else
+    return (x >> 24) | ((x >> 8) & 0xFF00) | ((x << 8) & 0xFF0000) | (x << 24);
+#endif
+}
+
+/* Read an unsigned field of 1, 2 or 4 bytes in the given byte order */
+static uint32_t read_field(const uint8_t *p, uint8_t width, bool big_endian) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < width; i++) {
+        if (big_endian) {
+            value = (value << 8) | p[i];
+        } else {
+            value |= (uint32_t)p[i] << (8 * i);
+        }
+    }
+    return value;
+}
+
+static inline bool valid_width(uint8_t width) {
+    return width == 1 || width == 2 || width == 4;
+}
+
+/* Sum of the field widths of a layout */
+static uint32_t fields_size(const unilog_layout_t *layout) {
+    uint32_t size = layout->length_width + layout->level_width + layout->timestamp_width;
+    if (layout->variant & UNILOG_VARIANT_THREAD_INFO) {
+        size += 2u * layout->id_width;
+    }
+    if (layout->variant & UNILOG_VARIANT_CRC) {
+        size += sizeof(uint32_t);
+    }
+    return size;
+}
+
+void unilog_bswap32_array(uint32_t *words, size_t count) {
+    size_t i = 0;
+    if (!words) {
+        return;
+    }
+
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                          11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&words[i]);
+        _mm_storeu_si128((__m128i *)&words[i], _mm_shuffle_epi8(v, shuffle));
+    }
+#elif defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&words[i]);
+        /* Swap bytes within 16-bit halves, then swap the halves */
+        v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), mask),
+                         _mm_andnot_si128(mask, _mm_slli_epi16(v, 8)));
+        v = _mm_shufflelo_epi16(_mm_shufflehi_epi16(v, 0xB1), 0xB1);
+        _mm_storeu_si128((__m128i *)&words[i], v);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t v = vreinterpretq_u8_u32(vld1q_u32(&words[i]));
+        vst1q_u32(&words[i], vreinterpretq_u32_u8(vrev32q_u8(v)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        words[i] = bswap32(words[i]);
+    }
+}
+
+bool unilog_layout_is_native(const unilog_layout_t *layout) {
+    unilog_layout_t native;
+    unilog_get_layout(&native);
+    return layout && memcmp(layout, &native, sizeof(native)) == 0;
+}
+
+bool unilog_layout_is_supported(const unilog_layout_t *layout) {
+    if (!layout) {
+        return false;
+    }
+    if (layout->byte_order != UNILOG_BYTE_ORDER_LITTLE &&
+        layout->byte_order != UNILOG_BYTE_ORDER_BIG) {
+        return false;
+    }
+    if (!is_power_of_2(layout->alignment) || layout->alignment > 8 ||
+        (layout->variant & ~(UNILOG_VARIANT_THREAD_INFO | UNILOG_VARIANT_CRC)) != 0) {
+        return false;
+    }
+    if (!valid_width(layout->length_width) || layout->length_width == 1 ||
+        !valid_width(layout->level_width) ||
+        !valid_width(layout->timestamp_width) ||
+        ((layout->variant & UNILOG_VARIANT_THREAD_INFO) && !valid_width(layout->id_width))) {
+        return false;
+    }
+    return layout->header_size >= fields_size(layout) && layout->header_size <= UNILOG_MAX_HEADER_SIZE;
+}
+
+unilog_result_t unilog_decoder_init(unilog_decoder_t *decoder, const unilog_layout_t *layout) {
+    if (!decoder || !unilog_layout_is_supported(layout)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    unilog_layout_t native;
+    unilog_get_layout(&native);
+    bool thread_info = (layout->variant & UNILOG_VARIANT_THREAD_INFO) != 0;
+    decoder->layout = *layout;
+    decoder->native = memcmp(layout, &native, sizeof(native)) == 0;
+    decoder->swap = layout->byte_order != native.byte_order;
+    decoder->words = layout->length_width == 4 && layout->level_width == 4 &&
+                     layout->timestamp_width == 4 && (!thread_info || layout->id_width == 4);
+    return UNILOG_OK;
+}
+
+void unilog_decoder_header(const unilog_decoder_t *decoder, const void *raw,
+                           uint32_t *length, unilog_entry_info_t *info) {
+    const unilog_layout_t *layout = &decoder->layout;
+    bool thread_info = (layout->variant & UNILOG_VARIANT_THREAD_INFO) != 0;
+
+    info->thread_id = 0;
+    info->cpu_id = UNILOG_CPU_UNKNOWN;
+    info->flags = 0;
+
+    /* Fast path: header is in our own layout */
+    if (decoder->native) {
+        unilog_entry_header_t header;
+        memcpy(&header, raw, sizeof(header));
+        *length = header.length;
+        info->level = (unilog_level_t)(header.level & UNILOG_LEVEL_MASK);
+        info->flags = header.level >> UNILOG_FLAGS_SHIFT;
+        info->timestamp = header.timestamp;
+#if UNILOG_THREAD_INFO
+        info->thread_id = header.thread_id;
+        info->cpu_id = header.cpu_id;
+#endif
+        return;
+    }
+
+    /* Common case of 32-bit fields: convert the words of the header */
+    if (decoder->words) {
+        uint32_t words[5];
+        size_t count = thread_info ? 5 : 3;  /* CRC is not decoded here */
+        memcpy(words, raw, count * sizeof(uint32_t));
+        if (decoder->swap) {
+            for (size_t i = 0; i < count; i++) {
+                words[i] = bswap32(words[i]);
+            }
+        }
+        *length = words[0];
+        info->level = (unilog_level_t)(words[1] & UNILOG_LEVEL_MASK);
+        info->flags = words[1] >> UNILOG_FLAGS_SHIFT;
+        info->timestamp = words[2];
+        if (thread_info) {
+            info->thread_id = words[3];
+            info->cpu_id = words[4];
+        }
+        return;
+    }
+
+    /* Generic path for narrow fields */
+    const uint8_t *p = (const uint8_t *)raw;
+    bool big = layout->byte_order == UNILOG_BYTE_ORDER_BIG;
+    *length = read_field(p, layout->length_width, big);
+    p += layout->length_width;
+    uint32_t level = read_field(p, layout->level_width, big);
+    info->level = (unilog_level_t)(level & UNILOG_LEVEL_MASK);
+    info->flags = layout->level_width > 1 ? level >> UNILOG_FLAGS_SHIFT : 0;
+    p += layout->level_width;
+    info->timestamp = read_field(p, layout->timestamp_width, big);
+    p += layout->timestamp_width;
+    if (thread_info) {
+        info->thread_id = read_field(p, layout->id_width, big);
+        p += layout->id_width;
+        info->cpu_id = read_field(p, layout->id_width, big);
+        if (layout->id_width < 4 && info->cpu_id == (1u << (8 * layout->id_width)) - 1) {
+            info->cpu_id = UNILOG_CPU_UNKNOWN;
+        }
+    }
+}
+
+unilog_result_t unilog_decode_header(const unilog_layout_t *layout, const void *raw,
+                                     uint32_t *length, unilog_entry_info_t *info) {
+    unilog_decoder_t decoder;
+    if (!raw || !length || !info || unilog_decoder_init(&decoder, layout) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    unilog_decoder_header(&decoder, raw, length, info);
+    return UNILOG_OK;
+}
+
+/* Copy bytes out of a ring starting at pos, handling wrap-around */
+static void ring_copy(uint8_t *dst, const uint8_t *ring, uint32_t mask, uint32_t pos, uint32_t len) {
+    uint32_t first = mask + 1 - pos;
+    if (len <= first) {
+        memcpy(dst, ring + pos, len);
+    } else {
+        memcpy(dst, ring + pos, first);
+        memcpy(dst + first, ring, len - first);
+    }
+}
+
+/* Raw ring of a dump being decoded */
+typedef struct {
+    const uint8_t *ring;
+    uint32_t capacity;
+    const unilog_layout_t *layout;
+    unilog_decoder_t decoder;
+} dump_ring_t;
+
+/* CRC32C over a region of the ring, handling wrap-around */
+static uint32_t ring_crc(const dump_ring_t *d, uint32_t crc, uint32_t pos, uint32_t len) {
+    uint32_t first = d->capacity - pos;
+    if (len <= first) {
+        return unilog_crc32c(crc, d->ring + pos, len);
+    }
+    crc = unilog_crc32c(crc, d->ring + pos, first);
+    return unilog_crc32c(crc, d->ring, len - first);
+}
+
+/* Decode and check the entry at pos; UNILOG_ERR_BUSY if it is not yet committed */
+static int dump_entry_at(const dump_ring_t *d, uint32_t pos, uint32_t used,
+                         uint32_t *length, unilog_entry_info_t *info) {
+    const unilog_layout_t *layout = d->layout;
+    uint32_t mask = d->capacity - 1;
+    uint8_t raw[UNILOG_MAX_HEADER_SIZE];
+
+    if (used < layout->header_size) {
+        return UNILOG_ERR_INVALID;
+    }
+    ring_copy(raw, d->ring, mask, pos, layout->header_size);
+    unilog_decoder_header(&d->decoder, raw, length, info);
+    if (*length == 0) {
+        return UNILOG_ERR_BUSY;
+    }
+    if (*length < layout->header_size || align_to(*length, layout->alignment) > used ||
+        (uint32_t)info->level > UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (layout->variant & UNILOG_VARIANT_CRC) {
+        uint32_t expected;
+        uint32_t crc = unilog_decode_crc_start(layout, raw, &expected);
+        crc = ring_crc(d, crc, (pos + layout->header_size) & mask, *length - layout->header_size);
+        if (crc != expected) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+    return UNILOG_OK;
+}
+
+uint32_t unilog_decode_crc_start(const unilog_layout_t *layout, const void *raw,
+                                 uint32_t *expected) {
+    uint8_t header[UNILOG_MAX_HEADER_SIZE];
+    if (!layout || !raw || !(layout->variant & UNILOG_VARIANT_CRC) ||
+        layout->header_size > sizeof(header)) {
+        if (expected) {
+            *expected = 0;
+        }
+        return 0;
+    }
+
+    /* The CRC is the last field and covers the header with itself zeroed */
+    uint32_t crc_offset = fields_size(layout) - sizeof(uint32_t);
+    memcpy(header, raw, layout->header_size);
+    if (expected) {
+        *expected = read_field(header + crc_offset, sizeof(uint32_t),
+                               layout->byte_order == UNILOG_BYTE_ORDER_BIG);
+    }
+    memset(header + crc_offset, 0, sizeof(uint32_t));
+    return unilog_crc32c(0, header, layout->header_size);
+}
+
+int unilog_decode_dump(const void *dump, size_t size, char *scratch, size_t scratch_size,
+                       unilog_entry_fn fn, void *ctx, unilog_decode_stats_t *stats) {
+    unilog_dump_header_t header;
+    if (!dump || !fn || size < sizeof(header) || (!scratch && scratch_size > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    memcpy(&header, dump, sizeof(header));
+    if (memcmp(header.magic, UNILOG_DUMP_MAGIC, sizeof(header.magic)) != 0 ||
+        !unilog_layout_is_supported(&header.layout)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Positions are stored in the target's byte order */
+    const uint8_t *raw_header = (const uint8_t *)dump;
+    bool big = header.layout.byte_order == UNILOG_BYTE_ORDER_BIG;
+    uint32_t capacity = read_field(raw_header + offsetof(unilog_dump_header_t, capacity), 4, big);
+    uint32_t read_pos = read_field(raw_header + offsetof(unilog_dump_header_t, read_pos), 4, big);
+    uint32_t write_pos = read_field(raw_header + offsetof(unilog_dump_header_t, write_pos), 4, big);
+    if (!is_power_of_2(capacity) || size - sizeof(header) < capacity ||
+        read_pos >= capacity || write_pos >= capacity) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    dump_ring_t d;
+    d.ring = raw_header + sizeof(header);
+    d.capacity = capacity;
+    d.layout = &header.layout;
+    if (unilog_decoder_init(&d.decoder, &header.layout) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    const unilog_layout_t *layout = &header.layout;
+    bool can_resync = (layout->variant & UNILOG_VARIANT_CRC) != 0;
+    uint32_t mask = capacity - 1;
+    uint32_t pos = read_pos;
+    unilog_decode_stats_t local_stats;
+    int count = 0;
+
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    while (pos != write_pos) {
+        uint32_t used = (write_pos - pos) & mask;
+        uint32_t length;
+        unilog_entry_info_t info;
+
+        int result = dump_entry_at(&d, pos, used, &length, &info);
+        if (result != UNILOG_OK) {
+            if (!can_resync) {
+                if (result == UNILOG_ERR_BUSY) {
+                    break;  /* Entry was still being written */
+                }
+                return UNILOG_ERR_INVALID;
+            }
+
+            /* Skip torn or corrupt data up to the next intact entry */
+            uint32_t skip = align_to(layout->header_size, layout->alignment);
+            while (skip < used &&
+                   dump_entry_at(&d, (pos + skip) & mask, used - skip, &length, &info) != UNILOG_OK) {
+                skip += layout->alignment;
+            }
+            if (skip >= used) {
+                if (result != UNILOG_ERR_BUSY) {
+                    stats->corrupt++;
+                    stats->corrupt_bytes += used;
+                }
+                break;
+            }
+            stats->corrupt++;
+            stats->corrupt_bytes += skip;
+            pos = (pos + skip) & mask;
+            continue;
+        }
+
+        uint32_t advance_by = align_to(length, layout->alignment);
+        if (info.level == UNILOG_LEVEL_NONE) {
+            pos = (pos + advance_by) & mask;  /* Gap left by unilog_recover */
+            continue;
+        }
+
+        /* Pass message in place unless it wraps */
+        uint32_t msg_pos = (pos + layout->header_size) & mask;
+        uint32_t msg_len = length - layout->header_size;
+        const char *message = (const char *)d.ring + msg_pos;
+        if (info.flags & UNILOG_FLAG_COMPRESSED) {
+            unilog_span_t spans[2] = {
+                { message, msg_len < capacity - msg_pos ? msg_len : capacity - msg_pos },
+                { (const char *)d.ring, 0 }
+            };
+            spans[1].length = msg_len - spans[0].length;
+            int unpacked = unilog_decompress(spans, 2, scratch, scratch_size);
+            if (unpacked < 0) {
+                return UNILOG_ERR_INVALID;
+            }
+            message = scratch;
+            msg_len = (uint32_t)unpacked;
+            info.flags &= ~(uint32_t)UNILOG_FLAG_COMPRESSED;
+        } else if (msg_len > capacity - msg_pos) {
+            if (msg_len > scratch_size) {
+                msg_len = (uint32_t)scratch_size;
+            }
+            ring_copy((uint8_t *)scratch, d.ring, mask, msg_pos, msg_len);
+            message = scratch;
+        }
+
+        count++;
+        stats->entries++;
+        if (fn(ctx, &info, message, msg_len) != 0) {
+            break;
+        }
+        pos = (pos + advance_by) & mask;
+    }
+
+    return count;
+}
@@ -0,0 +1,377 @@
+/**
+ * @file unilog_flash.c
+ * @brief Implementation of log-structured flash storage
+ */
+
+#include "unilog/unilog_flash.h"
+#include "unilog/unilog_pingpong.h"
+#include "unilog_internal.h"
+#include <string.h>
+
+#define NO_SECTOR UINT32_MAX
+
+/* Smallest page that holds a header and one empty entry */
+#define MIN_PAGE_SIZE (sizeof(unilog_flash_page_t) + sizeof(unilog_entry_header_t))
+
+typedef enum {
+    PAGE_VALID,
+    PAGE_BLANK,
+    PAGE_CORRUPT,
+    PAGE_ERROR
+} page_state_t;
+
+static inline uint32_t pages_per_sector(const unilog_flash_dev_t *dev) {
+    return dev->sector_size / dev->page_size;
+}
+
+static inline uint32_t total_pages(const unilog_flash_dev_t *dev) {
+    return pages_per_sector(dev) * dev->sector_count;
+}
+
+/* Sector holding the page before the head, which new sectors follow */
+static uint32_t current_sector(const unilog_flash_log_t *flog) {
+    uint32_t total = total_pages(flog->dev);
+    return ((flog->head + total - 1) % total) / pages_per_sector(flog->dev);
+}
+
+static uint32_t page_crc(const unilog_flash_page_t *header, const uint8_t *entries) {
+    unilog_flash_page_t copy = *header;
+    copy.crc = 0;
+    return unilog_crc32c(unilog_crc32c(0, &copy, sizeof(copy)), entries, header->used);
+}
+
+static bool is_blank(const uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != UNILOG_FLASH_ERASED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Load a page into buffer and check it */
+static page_state_t load_page(const unilog_flash_dev_t *dev, uint32_t page, uint8_t *buffer,
+                              unilog_flash_page_t *header) {
+    if (dev->read(dev->ctx, page * dev->page_size, buffer, dev->page_size) != UNILOG_OK) {
+        return PAGE_ERROR;
+    }
+    memcpy(header, buffer, sizeof(*header));
+    if (header->magic != UNILOG_FLASH_MAGIC) {
+        return is_blank(buffer, dev->page_size) ? PAGE_BLANK : PAGE_CORRUPT;
+    }
+    if (header->used > dev->page_size - sizeof(*header) ||
+        page_crc(header, buffer + sizeof(*header)) != header->crc) {
+        return PAGE_CORRUPT;
+    }
+    return PAGE_VALID;
+}
+
+/* Whether every page of a sector is erased */
+static bool sector_blank(const unilog_flash_dev_t *dev, uint32_t sector, uint8_t *buffer) {
+    uint32_t first = sector * pages_per_sector(dev);
+    for (uint32_t i = 0; i < pages_per_sector(dev); i++) {
+        if (dev->read(dev->ctx, (first + i) * dev->page_size, buffer, dev->page_size) !=
+                UNILOG_OK ||
+            !is_blank(buffer, dev->page_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Erase the next sector ahead of the erased ones, dropping what it held */
+static void start_erase(unilog_flash_log_t *flog) {
+    const unilog_flash_dev_t *dev = flog->dev;
+    uint32_t pps = pages_per_sector(dev);
+    uint32_t target = (current_sector(flog) + flog->ready + 1) % dev->sector_count;
+
+    if (flog->tail != flog->head && flog->tail / pps == target) {
+        flog->tail = (target + 1) % dev->sector_count * pps;
+    }
+    if (dev->erase(dev->ctx, target) != UNILOG_OK) {
+        flog->errors++;
+        return;
+    }
+    flog->erases++;
+    if (dev->busy) {
+        flog->erasing = target;
+    } else {
+        flog->ready++;
+    }
+}
+
+void unilog_flash_service(unilog_flash_log_t *flog) {
+    if (!flog || !flog->dev) {
+        return;
+    }
+
+    const unilog_flash_dev_t *dev = flog->dev;
+    if (flog->erasing != NO_SECTOR) {
+        if (dev->busy(dev->ctx)) {
+            return;
+        }
+        flog->erasing = NO_SECTOR;
+        flog->ready++;
+    }
+    if (flog->ready < flog->erase_ahead) {
+        start_erase(flog);
+    }
+}
+
+/* Program the page buffer at the head and start a new page. If no
+   sector could be erased for it, the page stays buffered as it is. */
+static unilog_result_t program_page(unilog_flash_log_t *flog) {
+    const unilog_flash_dev_t *dev = flog->dev;
+    uint32_t pps = pages_per_sector(dev);
+
+    /* A new sector must have been erased ahead. If not, the program
+       waits for the erase, as the driver finishes it first. */
+    if (flog->head % pps == 0) {
+        if (flog->ready == 0) {
+            flog->stalls++;
+            if (flog->erasing == NO_SECTOR) {
+                start_erase(flog);
+            }
+            if (flog->erasing != NO_SECTOR) {
+                flog->erasing = NO_SECTOR;
+                flog->ready++;
+            }
+        }
+        if (flog->ready == 0) {
+            return UNILOG_ERR_INVALID;  /* The erase failed */
+        }
+        flog->ready--;
+    }
+
+    unilog_flash_page_t header;
+    header.sequence = flog->sequence;
+    header.magic = UNILOG_FLASH_MAGIC;
+    header.used = (uint16_t)(flog->fill - sizeof(header));
+    header.crc = page_crc(&header, flog->page + sizeof(header));
+    memcpy(flog->page, &header, sizeof(header));
+
+    unilog_result_t result = dev->program(dev->ctx, flog->head * dev->page_size, flog->page,
+                                          dev->page_size);
+    if (result != UNILOG_OK) {
+        flog->errors++;
+    }
+
+    /* Advance even on failure, so page numbers keep following the sector's */
+    flog->head = (flog->head + 1) % total_pages(dev);
+    flog->sequence++;
+    flog->pages_written++;
+    flog->fill = sizeof(header);
+    memset(flog->page, UNILOG_FLASH_ERASED, dev->page_size);
+    return result;
+}
+
+unilog_result_t unilog_flash_mount(unilog_flash_log_t *flog, const unilog_flash_dev_t *dev,
+                                   void *page_buffer, uint32_t erase_ahead) {
+    if (!flog || !dev || !dev->read || !dev->program || !dev->erase || !page_buffer ||
+        dev->page_size < MIN_PAGE_SIZE || dev->page_size % 4 != 0 ||
+        dev->page_size > 65536 || dev->sector_size == 0 ||
+        dev->sector_size % dev->page_size != 0 || dev->sector_count < 2 ||
+        (uint64_t)dev->sector_size * dev->sector_count > UINT32_MAX ||
+        erase_ahead == 0 || erase_ahead >= dev->sector_count) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint8_t *page = (uint8_t *)page_buffer;
+    uint32_t pps = pages_per_sector(dev);
+    uint32_t sectors = dev->sector_count;
+    unilog_flash_page_t header;
+
+    /* The newest sector has the highest first page number */
+    uint32_t newest = NO_SECTOR;
+    uint32_t newest_sequence = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        page_state_t state = load_page(dev, s * pps, page, &header);
+        if (state == PAGE_ERROR) {
+            return UNILOG_ERR_INVALID;
+        }
+        if (state == PAGE_VALID &&
+            (newest == NO_SECTOR || (int32_t)(header.sequence - newest_sequence) > 0)) {
+            newest = s;
+            newest_sequence = header.sequence;
+        }
+    }
+
+    flog->dev = dev;
+    flog->page = page;
+    flog->erase_ahead = erase_ahead;
+    flog->erasing = NO_SECTOR;
+    flog->pages_written = 0;
+    flog->erases = 0;
+    flog->stalls = 0;
+    flog->truncated = 0;
+    flog->errors = 0;
+
+    if (newest == NO_SECTOR) {
+        flog->head = 0;
+        flog->sequence = 0;
+        flog->tail = 0;
+    } else {
+        /* Pages of a sector are programmed in order: find the first blank one */
+        uint32_t low = 1;
+        uint32_t high = pps;
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            if (dev->read(dev->ctx, (newest * pps + mid) * dev->page_size, page,
+                          dev->page_size) != UNILOG_OK) {
+                return UNILOG_ERR_INVALID;
+            }
+            if (is_blank(page, dev->page_size)) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        flog->head = (newest * pps + low) % total_pages(dev);
+        flog->sequence = newest_sequence + low;
+
+        /* Behind the erased sectors that follow it lies the oldest one */
+        flog->tail = newest * pps;
+        for (uint32_t i = 1; i < sectors; i++) {
+            uint32_t s = (newest + i) % sectors;
+            page_state_t state = load_page(dev, s * pps, page, &header);
+            if (state == PAGE_ERROR) {
+                return UNILOG_ERR_INVALID;
+            }
+            if (state == PAGE_VALID) {
+                flog->tail = s * pps;
+                break;
+            }
+        }
+    }
+
+    /* Reuse sectors that are still erased, rather than wearing them again */
+    flog->ready = 0;
+    uint32_t current = current_sector(flog);
+    while (flog->ready < erase_ahead &&
+           sector_blank(dev, (current + flog->ready + 1) % sectors, page)) {
+        flog->ready++;
+    }
+
+    flog->fill = sizeof(unilog_flash_page_t);
+    memset(page, UNILOG_FLASH_ERASED, dev->page_size);
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_flash_write(unilog_flash_log_t *flog, const unilog_entry_info_t *info,
+                                   const char *message, size_t length) {
+    if (!flog || !flog->dev || !info || (!message && length > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t page_size = flog->dev->page_size;
+    size_t max_length = page_size - MIN_PAGE_SIZE;
+    if (length > max_length) {
+        length = max_length & ~(size_t)3;
+        flog->truncated++;
+    }
+
+    unilog_entry_header_t header;
+    uint32_t advance_by = align_up((uint32_t)(sizeof(header) + length));
+    if (flog->fill + advance_by > page_size) {
+        /* Keep the entry out rather than overrun a page left full */
+        unilog_result_t result = program_page(flog);
+        if (result != UNILOG_OK) {
+            return result;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.length = sizeof(header) + (uint32_t)length;
+    header.level = info->level | info->flags << UNILOG_FLAGS_SHIFT;
+    header.timestamp = info->timestamp;
+#if UNILOG_THREAD_INFO
+    header.thread_id = info->thread_id;
+    header.cpu_id = info->cpu_id;
+#endif
+#if UNILOG_ENTRY_CRC
+    header.crc = unilog_crc32c(unilog_crc32c(0, &header, sizeof(header)), message, length);
+#endif
+
+    /* Entries use the ring layout, padding included */
+    uint8_t *entry = flog->page + flog->fill;
+    memcpy(entry, &header, sizeof(header));
+    if (length > 0) {
+        memcpy(entry + sizeof(header), message, length);
+    }
+    memset(entry + header.length, 0, advance_by - header.length);
+    flog->fill += advance_by;
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_flash_flush(unilog_flash_log_t *flog) {
+    if (!flog || !flog->dev) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (flog->fill == sizeof(unilog_flash_page_t)) {
+        return UNILOG_OK;
+    }
+    return program_page(flog);
+}
+
+void unilog_flash_sink(void *ctx, const unilog_entry_info_t *info, const char *message,
+                       size_t length) {
+    unilog_flash_write((unilog_flash_log_t *)ctx, info, message, length);
+}
+
+void unilog_flash_batch_end(void *ctx) {
+    unilog_flash_service((unilog_flash_log_t *)ctx);
+}
+
+unilog_result_t unilog_flash_reader_init(unilog_flash_reader_t *reader,
+                                         const unilog_flash_log_t *flog, void *page_buffer) {
+    if (!reader || !flog || !flog->dev || !page_buffer || page_buffer == flog->page) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t total = total_pages(flog->dev);
+    reader->dev = flog->dev;
+    reader->page = (uint8_t *)page_buffer;
+    reader->next = flog->tail;
+    reader->remaining = (flog->head + total - flog->tail) % total;
+    reader->offset = 0;
+    reader->used = 0;
+    reader->corrupt = 0;
+    return UNILOG_OK;
+}
+
+int unilog_flash_read(unilog_flash_reader_t *reader, unilog_entry_info_t *info,
+                      const char **message) {
+    if (!reader || !info || !message) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    for (;;) {
+        if (reader->offset < reader->used) {
+            unilog_block_t block = { reader->page, reader->used };
+            int length = unilog_block_next(&block, &reader->offset, info, message);
+            if (length >= 0) {
+                return length;
+            }
+            reader->offset = reader->used;  /* Cannot happen with a valid CRC */
+            continue;
+        }
+
+        if (reader->remaining == 0) {
+            return UNILOG_ERR_EMPTY;
+        }
+        unilog_flash_page_t header;
+        page_state_t state = load_page(reader->dev, reader->next, reader->page, &header);
+        reader->next = (reader->next + 1) % total_pages(reader->dev);
+        reader->remaining--;
+        if (state == PAGE_ERROR) {
+            return UNILOG_ERR_INVALID;
+        }
+        if (state == PAGE_CORRUPT) {
+            reader->corrupt++;
+        }
+        if (state == PAGE_VALID) {
+            reader->offset = sizeof(header);
+            reader->used = sizeof(header) + header.used;
+        }
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * @file unilog_flash_sim.c
+ * @brief Implementation of the file-backed flash simulator
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L  /* pread, pwrite, clock_gettime, nanosleep */
+#endif
+
+#include "unilog/unilog_flash_sim.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHUNK 4096
+
+static uint64_t current_time(const unilog_flash_sim_t *sim) {
+    if (!sim->realtime) {
+        return sim->now;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void wait_until(unilog_flash_sim_t *sim, uint64_t time) {
+    uint64_t now = current_time(sim);
+    if (now >= time) {
+        return;
+    }
+    if (sim->realtime) {
+        uint64_t ns = time - now;
+        struct timespec ts = { (time_t)(ns / 1000000000u), (long)(ns % 1000000000u) };
+        while (nanosleep(&ts, &ts) != 0) {
+        }
+    } else {
+        sim->now = time;
+    }
+}
+
+/* Reads and programs wait for a running erase, like the real part */
+static void wait_for_erase(unilog_flash_sim_t *sim) {
+    uint64_t now = current_time(sim);
+    if (now < sim->busy_until) {
+        sim->stall_ns += sim->busy_until - now;
+        wait_until(sim, sim->busy_until);
+    }
+}
+
+static bool in_region(const unilog_flash_sim_t *sim, uint32_t address, uint32_t length) {
+    return (uint64_t)address + length <= (uint64_t)sim->dev.sector_size * sim->dev.sector_count;
+}
+
+static unilog_result_t sim_read(void *ctx, uint32_t address, void *data, uint32_t length) {
+    unilog_flash_sim_t *sim = (unilog_flash_sim_t *)ctx;
+    if (!in_region(sim, address, length)) {
+        return UNILOG_ERR_INVALID;
+    }
+    wait_for_erase(sim);
+    if (pread(sim->fd, data, length, address) != (ssize_t)length) {
+        return UNILOG_ERR_INVALID;
+    }
+    wait_until(sim, current_time(sim) + sim->read_ns * length);
+    return UNILOG_OK;
+}
+
+static unilog_result_t sim_program(void *ctx, uint32_t address, const void *data,
+                                   uint32_t length) {
+    unilog_flash_sim_t *sim = (unilog_flash_sim_t *)ctx;
+    if (!in_region(sim, address, length) || address % sim->dev.page_size != 0 ||
+        length > sim->dev.page_size) {
+        return UNILOG_ERR_INVALID;
+    }
+    wait_for_erase(sim);
+
+    /* Programming clears bits only */
+    uint8_t page[65536];
+    if (pread(sim->fd, page, length, address) != (ssize_t)length) {
+        return UNILOG_ERR_INVALID;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    bool erased = true;
+    for (uint32_t i = 0; i < length; i++) {
+        erased = erased && page[i] == UNILOG_FLASH_ERASED;
+        page[i] &= bytes[i];
+    }
+    if (!erased) {
+        sim->violations++;
+    }
+    if (pwrite(sim->fd, page, length, address) != (ssize_t)length) {
+        return UNILOG_ERR_INVALID;
+    }
+    sim->programs++;
+    wait_until(sim, current_time(sim) + sim->program_ns);
+    return UNILOG_OK;
+}
+
+static unilog_result_t sim_erase(void *ctx, uint32_t sector) {
+    unilog_flash_sim_t *sim = (unilog_flash_sim_t *)ctx;
+    if (sector >= sim->dev.sector_count) {
+        return UNILOG_ERR_INVALID;
+    }
+    wait_for_erase(sim);
+
+    uint8_t erased[CHUNK];
+    memset(erased, UNILOG_FLASH_ERASED, sizeof(erased));
+    off_t start = (off_t)sector * sim->dev.sector_size;
+    for (uint32_t done = 0; done < sim->dev.sector_size; done += CHUNK) {
+        size_t length = sim->dev.sector_size - done < CHUNK ? sim->dev.sector_size - done : CHUNK;
+        if (pwrite(sim->fd, erased, length, start + done) != (ssize_t)length) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+    sim->wear[sector]++;
+
+    /* The contents change at once; the device stays busy in the background */
+    sim->busy_until = current_time(sim) + sim->erase_ns;
+    return UNILOG_OK;
+}
+
+static bool sim_busy(void *ctx) {
+    unilog_flash_sim_t *sim = (unilog_flash_sim_t *)ctx;
+    return current_time(sim) < sim->busy_until;
+}
+
+unilog_result_t unilog_flash_sim_open(unilog_flash_sim_t *sim, const char *path,
+                                      uint32_t page_size, uint32_t sector_size,
+                                      uint32_t sector_count, uint32_t *wear) {
+    if (!sim || !path || !wear || page_size == 0 || page_size > 65536 || sector_size == 0 ||
+        sector_size % page_size != 0 || sector_count == 0 ||
+        (uint64_t)sector_size * sector_count > UINT32_MAX) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Fresh flash reads as erased */
+    struct stat st;
+    uint64_t size = (uint64_t)sector_size * sector_count;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return UNILOG_ERR_INVALID;
+    }
+    uint8_t erased[CHUNK];
+    memset(erased, UNILOG_FLASH_ERASED, sizeof(erased));
+    for (uint64_t done = (uint64_t)st.st_size; done < size; done += CHUNK) {
+        size_t length = size - done < CHUNK ? (size_t)(size - done) : CHUNK;
+        if (pwrite(fd, erased, length, (off_t)done) != (ssize_t)length) {
+            close(fd);
+            return UNILOG_ERR_INVALID;
+        }
+    }
+
+    memset(sim, 0, sizeof(*sim));
+    memset(wear, 0, sector_count * sizeof(*wear));
+    sim->dev.page_size = page_size;
+    sim->dev.sector_size = sector_size;
+    sim->dev.sector_count = sector_count;
+    sim->dev.ctx = sim;
+    sim->dev.read = sim_read;
+    sim->dev.program = sim_program;
+    sim->dev.erase = sim_erase;
+    sim->dev.busy = sim_busy;
+    sim->fd = fd;
+    sim->program_ns = UNILOG_FLASH_SIM_PROGRAM_NS;
+    sim->erase_ns = UNILOG_FLASH_SIM_ERASE_NS;
+    sim->read_ns = UNILOG_FLASH_SIM_READ_NS;
+    sim->wear = wear;
+    return UNILOG_OK;
+}
+
+void unilog_flash_sim_advance(unilog_flash_sim_t *sim, uint64_t ns) {
+    if (sim && !sim->realtime) {
+        sim->now += ns;
+    }
+}
+
+void unilog_flash_sim_close(unilog_flash_sim_t *sim) {
+    if (sim && sim->fd >= 0) {
+        close(sim->fd);
+        sim->fd = -1;
+    }
+}
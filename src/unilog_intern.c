@@ -0,0 +1,292 @@
+/**
+ * @file unilog_intern.c
+ * @brief Implementation of runtime string interning
+ */
+
+#include "unilog/unilog_intern.h"
+#include "unilog_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Slot states */
+#define SLOT_EMPTY 0
+#define SLOT_DEFINING 1
+#define SLOT_DEFINED 2
+
+/* Size of the ID in front of the text of a definition record */
+#define DEFINITION_ID_SIZE 4
+
+#define UNDEFINED_OFFSET UINT32_MAX
+
+/* FNV-1a, good enough for short strings */
+static uint32_t intern_hash(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void put_id(uint8_t *p, uint32_t id) {
+    p[0] = (uint8_t)id;
+    p[1] = (uint8_t)(id >> 8);
+    p[2] = (uint8_t)(id >> 16);
+    p[3] = (uint8_t)(id >> 24);
+}
+
+static uint32_t get_id(const uint8_t *p) {
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+unilog_result_t unilog_intern_init(unilog_intern_t *table, unilog_t *log,
+                                   unilog_intern_slot_t *slots, uint32_t capacity) {
+    if (!table || !log || !slots || !is_power_of_2(capacity)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(&slots[i].state, SLOT_EMPTY);
+        slots[i].hash = 0;
+        slots[i].length = 0;
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+    table->log = log;
+
+    return UNILOG_OK;
+}
+
+/* Claim an empty slot: fill it in and write the definition record */
+static unilog_result_t intern_define(unilog_intern_t *table, unilog_intern_slot_t *slot,
+                                     uint32_t id, unilog_level_t level, uint32_t timestamp,
+                                     uint32_t hash, const char *text, size_t length) {
+    uint8_t record[DEFINITION_ID_SIZE + UNILOG_INTERN_MAX_LENGTH];
+
+    slot->hash = hash;
+    slot->length = (uint32_t)length;
+    memcpy(slot->text, text, length);
+
+    put_id(record, id);
+    memcpy(record + DEFINITION_ID_SIZE, text, length);
+    unilog_result_t result = unilog_write_record(
+            table->log, level | UNILOG_FLAG_DEFINITION << UNILOG_FLAGS_SHIFT, timestamp,
+            (const char *)record, DEFINITION_ID_SIZE + length);
+
+    /* Only publish the ID once its definition is in the ring, so every
+       reference is reserved after it. Otherwise give the slot back. */
+    atomic_store_explicit(&slot->state, result == UNILOG_OK ? SLOT_DEFINED : SLOT_EMPTY,
+                          memory_order_release);
+    return result;
+}
+
+unilog_result_t unilog_intern_id(unilog_intern_t *table, unilog_level_t level,
+                                 uint32_t timestamp, const char *text, size_t length,
+                                 uint32_t *id) {
+    if (!table || !text || !id || length == 0 || length > UNILOG_INTERN_MAX_LENGTH ||
+        (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t hash = intern_hash(text, length);
+    uint32_t mask = table->capacity - 1;
+
+    /* Linear probing; slots are never removed, so a miss ends at the first empty slot */
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        uint32_t index = (hash + i) & mask;
+        unilog_intern_slot_t *slot = &table->slots[index];
+        uint32_t state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        if (state == SLOT_EMPTY) {
+            if (atomic_compare_exchange_strong_explicit(&slot->state, &state, SLOT_DEFINING,
+                                                        memory_order_acquire,
+                                                        memory_order_acquire)) {
+                unilog_result_t result = intern_define(table, slot, index + 1, level,
+                                                       timestamp, hash, text, length);
+                if (result == UNILOG_OK) {
+                    *id = index + 1;
+                }
+                return result;
+            }
+        }
+        if (state == SLOT_DEFINING) {
+            /* Contents are not readable yet, and this may be our string */
+            return UNILOG_ERR_BUSY;
+        }
+        if (slot->hash == hash && slot->length == length &&
+            memcmp(slot->text, text, length) == 0) {
+            *id = index + 1;
+            return UNILOG_OK;
+        }
+    }
+
+    return UNILOG_ERR_FULL;
+}
+
+unilog_result_t unilog_intern_write(unilog_intern_t *table, unilog_level_t level,
+                                    uint32_t timestamp, const unilog_part_t *parts,
+                                    size_t count) {
+    if (!table || (!parts && count > 0) || (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Do not define strings for entries that are filtered anyway */
+    if (!level_enabled(level, atomic_load(&table->log->min_level))) {
+        return UNILOG_OK;  /* Silently ignore */
+    }
+
+    uint8_t message[UNILOG_INTERN_MESSAGE_SIZE];  /* Stack-allocated, no dynamic memory */
+    size_t used = 0;
+    uint32_t flags = 0;
+    bool truncated = false;
+
+    for (size_t p = 0; p < count && !truncated; p++) {
+        const unilog_part_t *part = &parts[p];
+        if (!part->text && part->length > 0) {
+            return UNILOG_ERR_INVALID;
+        }
+
+        uint32_t id;
+        if (part->intern && part->length > 0 && part->length <= UNILOG_INTERN_MAX_LENGTH &&
+            unilog_intern_id(table, level, timestamp, part->text, part->length, &id) ==
+                UNILOG_OK) {
+            if (sizeof(message) - used < UNILOG_INTERN_REF_SIZE) {
+                break;
+            }
+            message[used] = UNILOG_INTERN_ESCAPE;
+            put_id(message + used + 1, id);
+            used += UNILOG_INTERN_REF_SIZE;
+            flags |= UNILOG_FLAG_INTERNED;
+            continue;
+        }
+
+        /* Literal text; escape bytes are written as a reference to ID 0 */
+        for (size_t i = 0; i < part->length; i++) {
+            uint8_t c = (uint8_t)part->text[i];
+            size_t size = c == UNILOG_INTERN_ESCAPE ? UNILOG_INTERN_REF_SIZE : 1;
+            if (sizeof(message) - used < size) {
+                truncated = true;
+                break;
+            }
+            message[used] = c;
+            if (c == UNILOG_INTERN_ESCAPE) {
+                put_id(message + used + 1, 0);
+                flags |= UNILOG_FLAG_INTERNED;
+            }
+            used += size;
+        }
+    }
+
+    return unilog_write_record(table->log, level | flags << UNILOG_FLAGS_SHIFT, timestamp,
+                               (const char *)message, used);
+}
+
+unilog_result_t unilog_intern_map_init(unilog_intern_map_t *map, unilog_intern_entry_t *entries,
+                                       uint32_t count, char *arena, uint32_t arena_size) {
+    if (!map || (!entries && count > 0) || (!arena && arena_size > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    map->entries = entries;
+    map->count = count;
+    map->arena = arena;
+    map->arena_size = arena_size;
+    unilog_intern_map_reset(map);
+
+    return UNILOG_OK;
+}
+
+void unilog_intern_map_reset(unilog_intern_map_t *map) {
+    if (!map) {
+        return;
+    }
+    for (uint32_t i = 0; i < map->count; i++) {
+        map->entries[i].offset = UNDEFINED_OFFSET;
+        map->entries[i].length = 0;
+    }
+    map->arena_used = 0;
+}
+
+const char *unilog_intern_lookup(const unilog_intern_map_t *map, uint32_t id,
+                                 uint32_t *length) {
+    if (!map || !length || id == 0 || id > map->count ||
+        map->entries[id - 1].offset == UNDEFINED_OFFSET) {
+        return NULL;
+    }
+    *length = map->entries[id - 1].length;
+    return map->arena + map->entries[id - 1].offset;
+}
+
+static unilog_result_t map_define(unilog_intern_map_t *map, const uint8_t *record,
+                                  size_t length) {
+    if (length <= DEFINITION_ID_SIZE || length > DEFINITION_ID_SIZE + UNILOG_INTERN_MAX_LENGTH) {
+        return UNILOG_ERR_INVALID;
+    }
+    uint32_t id = get_id(record);
+    const char *text = (const char *)record + DEFINITION_ID_SIZE;
+    uint32_t text_length = (uint32_t)(length - DEFINITION_ID_SIZE);
+    if (id == 0 || id > map->count) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* The same definition may be seen again, e.g. in overlapping dumps */
+    uint32_t known_length;
+    const char *known = unilog_intern_lookup(map, id, &known_length);
+    if (known && known_length == text_length && memcmp(known, text, text_length) == 0) {
+        return UNILOG_OK;
+    }
+
+    if (text_length > map->arena_size - map->arena_used) {
+        return UNILOG_ERR_FULL;
+    }
+    memcpy(map->arena + map->arena_used, text, text_length);
+    map->entries[id - 1].offset = map->arena_used;
+    map->entries[id - 1].length = text_length;
+    map->arena_used += text_length;
+
+    return UNILOG_OK;
+}
+
+int unilog_intern_process(unilog_intern_map_t *map, const unilog_entry_info_t *info,
+                          const char *message, size_t length, char *out, size_t out_size) {
+    if (!map || !info || (!message && length > 0) || !out || out_size == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    const uint8_t *in = (const uint8_t *)message;
+    if (info->flags & UNILOG_FLAG_DEFINITION) {
+        unilog_result_t result = map_define(map, in, length);
+        return result == UNILOG_OK ? UNILOG_ERR_EMPTY : result;
+    }
+
+    size_t used = 0;
+    size_t limit = out_size - 1;
+    bool interned = (info->flags & UNILOG_FLAG_INTERNED) != 0;
+    for (size_t i = 0; i < length && used < limit; i++) {
+        if (!interned || in[i] != UNILOG_INTERN_ESCAPE || length - i < UNILOG_INTERN_REF_SIZE) {
+            out[used++] = (char)in[i];
+            continue;
+        }
+
+        uint32_t id = get_id(in + i + 1);
+        i += UNILOG_INTERN_REF_SIZE - 1;
+        if (id == 0) {
+            out[used++] = (char)UNILOG_INTERN_ESCAPE;
+            continue;
+        }
+
+        uint32_t text_length;
+        const char *text = unilog_intern_lookup(map, id, &text_length);
+        if (text) {
+            size_t n = text_length < limit - used ? text_length : limit - used;
+            memcpy(out + used, text, n);
+            used += n;
+        } else {
+            /* Defined before this reader started */
+            int n = snprintf(out + used, limit - used + 1, "#%u", id);
+            used += (size_t)n < limit - used ? (size_t)n : limit - used;
+        }
+    }
+    out[used] = '\0';
+
+    return (int)used;
+}
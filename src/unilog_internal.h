@@ -0,0 +1,161 @@
+/**
+ * @file unilog_internal.h
+ * @brief Helpers shared between the unilog sources (not installed)
+ */
+
+#ifndef UNILOG_INTERNAL_H
+#define UNILOG_INTERNAL_H
+
+#include "unilog/unilog.h"
+#include <string.h>
+
+/* Internal helper to check if value is power of 2 */
+static inline bool is_power_of_2(uint32_t x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+/* Internal helper to align size to 4-byte boundary */
+static inline uint32_t align_up(uint32_t size) {
+    return (size + 3) & ~3;
+}
+
+#if UNILOG_THREAD_LEVEL
+/* Per-thread level override, UNILOG_LEVEL_NONE if not set */
+extern _Thread_local unilog_level_t unilog_tls_level;
+#endif
+
+/*
+ * Check a level against a log's minimum level and the calling thread's
+ * override. The TLS load is only needed for levels below the minimum.
+ */
+static inline bool level_enabled(unilog_level_t level, unilog_level_t min_level) {
+#if UNILOG_THREAD_LEVEL
+    return level >= min_level || level >= unilog_tls_level;
+#else
+    return level >= min_level;
+#endif
+}
+
+/*
+ * Set in the write position of a ring that unilog_resize has replaced.
+ * Positions stay below the capacity, so the bit is otherwise unused.
+ */
+#define RING_SEALED 0x80000000u
+
+/* Ring producers reserve in */
+static inline unilog_buffer_t *producer_ring(const unilog_t *log) {
+#if UNILOG_RESIZE
+    return atomic_load_explicit(&log->ring, memory_order_acquire);
+#else
+    return (unilog_buffer_t *)&log->buffer;
+#endif
+}
+
+/* Ring the consumer last read from */
+static inline unilog_buffer_t *consumer_ring(const unilog_t *log) {
+#if UNILOG_RESIZE
+    return atomic_load_explicit(&log->read_ring, memory_order_acquire);
+#else
+    return (unilog_buffer_t *)&log->buffer;
+#endif
+}
+
+/*
+ * Reserve advance_by bytes for the calling producer, in the ring
+ * returned in *ring. The reserved region starts at *write_pos and is
+ * zero; the producer commits it by storing the first length word last,
+ * with release. largest is the length of the largest entry to be
+ * stored there; UNILOG_ERR_INVALID if it or the region cannot fit.
+ */
+unilog_result_t unilog_reserve(unilog_t *log, uint32_t advance_by, uint32_t largest,
+                               unilog_buffer_t **ring, uint32_t *write_pos);
+
+/*
+ * Read the next entry, skipping gaps. Like unilog_read_entry, but
+ * without taking the consumer token; the caller holds it if needed.
+ */
+int unilog_read_next(unilog_t *log, unilog_entry_info_t *info,
+                     char *buffer, size_t buffer_size);
+
+/*
+ * Like unilog_read_next, but first releases entries below keep_level
+ * without copying them, counting them per level in shed. Interned
+ * string definitions are always kept.
+ */
+int unilog_read_shed(unilog_t *log, unilog_entry_info_t *info, char *buffer,
+                     size_t buffer_size, unilog_level_t keep_level,
+                     uint32_t shed[UNILOG_LEVEL_NONE]);
+
+/* Get the timestamp of the oldest entry; 0 on success, negative error code otherwise */
+int unilog_oldest_timestamp(unilog_t *log, uint32_t *timestamp);
+
+/* Take the consumer token, which serializes the consumer with helping producers */
+static inline bool consumer_token_acquire(unilog_t *log) {
+    bool expected = false;
+    return atomic_compare_exchange_strong_explicit(&log->draining, &expected, true,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+static inline void consumer_token_release(unilog_t *log) {
+    atomic_store_explicit(&log->draining, false, memory_order_release);
+}
+
+/* Added to waiters while a unilog_waiter_t is armed */
+#define ASYNC_WAITER 0x10000u
+
+/* Wake consumers blocked in unilog_consumer's UNILOG_IDLE_WAIT, and
+   notify an armed waiter whose watermark is reached */
+void unilog_wake_consumer(unilog_t *log);
+
+/*
+ * Called by producers after committing entries. Costs one load unless
+ * a consumer is blocked or waiting for entries.
+ */
+static inline void notify_consumer(unilog_t *log) {
+    if (atomic_load(&log->waiters) != 0) {
+        unilog_wake_consumer(log);
+    }
+}
+
+/*
+ * Write one entry to the ring without checking the level filter. The
+ * level may carry entry flags above UNILOG_FLAGS_SHIFT.
+ */
+unilog_result_t unilog_write_record(unilog_t *log, uint32_t level, uint32_t timestamp,
+                                    const char *message, size_t msg_len);
+
+/* Whether len bytes at pos can be accessed in one piece */
+static inline bool ring_contiguous(const unilog_buffer_t *ring, uint32_t pos, uint32_t len) {
+    /* A mirrored ring continues past its end with its own start */
+    return ring->mirrored || len <= ring->capacity - pos;
+}
+
+/* Copy bytes into the ring starting at pos, handling wrap-around */
+static inline void ring_copy_in(unilog_buffer_t *ring, uint32_t pos, const void *src,
+                                uint32_t len) {
+    uint32_t first = ring->capacity - pos;
+    if (ring_contiguous(ring, pos, len)) {
+        memcpy(ring->buffer + pos, src, len);
+    } else {
+        memcpy(ring->buffer + pos, src, first);
+        memcpy(ring->buffer, (const uint8_t *)src + first, len - first);
+    }
+}
+
+/*
+ * Compress len bytes of src to dst at pos (a ring with the given mask,
+ * or ~0 for a flat buffer), or only measure the result if dst is NULL.
+ * Returns the compressed size, or 0 if it would exceed limit.
+ */
+uint32_t unilog_lz_compress(const void *src, uint32_t len, uint8_t *dst, uint32_t pos,
+                            uint32_t mask, uint32_t limit);
+
+/*
+ * Fill in a complete entry header for a message, including the optional
+ * thread/CPU and CRC fields of this build. The level may carry entry
+ * flags above UNILOG_FLAGS_SHIFT. Called by producers.
+ */
+void unilog_fill_header(unilog_entry_header_t *header, uint32_t level,
+                        uint32_t timestamp, const char *message, size_t msg_len);
+
+#endif /* UNILOG_INTERNAL_H */
@@ -0,0 +1,179 @@
+/**
+ * @file unilog_lz.c
+ * @brief Allocation-free LZ compression of large messages
+ *
+ * The format follows LZ4 block sequences: a token holding the literal
+ * length (high nibble) and match length minus UNILOG_LZ_MIN_MATCH (low
+ * nibble), 255-byte length extensions for nibbles of 15, the literals,
+ * and a 2-byte little-endian match offset. The last sequence has
+ * literals only and ends the input.
+ */
+
+#include "unilog/unilog.h"
+#include "unilog_internal.h"
+
+#define UNILOG_LZ_MIN_MATCH 4
+#define UNILOG_LZ_MAX_OFFSET 0xFFFFu
+#define UNILOG_LZ_HASH_SIZE (1u << UNILOG_LZ_HASH_BITS)
+
+/* Output into a ring (or a flat buffer with mask ~0), or only counted */
+typedef struct {
+    uint8_t *dst;       /* NULL to only count */
+    uint32_t pos;       /* Start position in dst */
+    uint32_t mask;      /* Position mask of dst */
+    uint32_t size;      /* Bytes emitted */
+    uint32_t limit;     /* Maximum size */
+} lz_out_t;
+
+static inline void emit(lz_out_t *out, uint8_t byte) {
+    if (out->size < out->limit && out->dst) {
+        out->dst[(out->pos + out->size) & out->mask] = byte;
+    }
+    out->size++;
+}
+
+static void emit_length(lz_out_t *out, uint32_t length) {
+    for (; length >= 255; length -= 255) {
+        emit(out, 255);
+    }
+    emit(out, (uint8_t)length);
+}
+
+static void emit_sequence(lz_out_t *out, const uint8_t *literals, uint32_t literal_len,
+                          uint32_t offset, uint32_t match_len) {
+    uint32_t match_code = match_len ? match_len - UNILOG_LZ_MIN_MATCH : 0;
+    emit(out, (uint8_t)((literal_len < 15 ? literal_len : 15) << 4 |
+                        (match_code < 15 ? match_code : 15)));
+    if (literal_len >= 15) {
+        emit_length(out, literal_len - 15);
+    }
+    for (uint32_t i = 0; i < literal_len && out->size <= out->limit; i++) {
+        emit(out, literals[i]);
+    }
+    if (match_len == 0) {
+        return;  /* Last sequence */
+    }
+    emit(out, (uint8_t)offset);
+    emit(out, (uint8_t)(offset >> 8));
+    if (match_code >= 15) {
+        emit_length(out, match_code - 15);
+    }
+}
+
+static inline uint32_t hash4(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - UNILOG_LZ_HASH_BITS);
+}
+
+uint32_t unilog_lz_compress(const void *src, uint32_t len, uint8_t *dst, uint32_t pos,
+                            uint32_t mask, uint32_t limit) {
+    const uint8_t *in = (const uint8_t *)src;
+    uint32_t table[UNILOG_LZ_HASH_SIZE];    /* Position + 1 of the last occurrence */
+    lz_out_t out = { dst, pos, mask, 0, limit };
+    uint32_t anchor = 0;
+    uint32_t i = 0;
+
+    memset(table, 0, sizeof(table));
+    while (len >= UNILOG_LZ_MIN_MATCH && i <= len - UNILOG_LZ_MIN_MATCH && out.size <= limit) {
+        uint32_t h = hash4(in + i);
+        uint32_t candidate = table[h];
+        table[h] = i + 1;
+        if (candidate == 0 || i - (candidate - 1) > UNILOG_LZ_MAX_OFFSET ||
+            memcmp(in + candidate - 1, in + i, UNILOG_LZ_MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+
+        uint32_t match = candidate - 1;
+        uint32_t match_len = UNILOG_LZ_MIN_MATCH;
+        while (i + match_len < len && in[match + match_len] == in[i + match_len]) {
+            match_len++;
+        }
+        emit_sequence(&out, in + anchor, i - anchor, i - match, match_len);
+        i += match_len;
+        anchor = i;
+    }
+    emit_sequence(&out, in + anchor, len - anchor, 0, 0);
+
+    return out.size <= limit ? out.size : 0;
+}
+
+/* Input spread over up to two spans */
+typedef struct {
+    const unilog_span_t *spans;
+    int count;
+    int span;
+    size_t offset;
+} lz_in_t;
+
+static int next_byte(lz_in_t *in) {
+    while (in->span < in->count && in->offset == in->spans[in->span].length) {
+        in->span++;
+        in->offset = 0;
+    }
+    if (in->span == in->count) {
+        return -1;
+    }
+    return (uint8_t)in->spans[in->span].data[in->offset++];
+}
+
+static int read_length(lz_in_t *in, uint32_t *length) {
+    int byte;
+    do {
+        if ((byte = next_byte(in)) < 0) {
+            return -1;
+        }
+        *length += (uint32_t)byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int unilog_decompress(const unilog_span_t *spans, int count, char *buffer, size_t buffer_size) {
+    if (!spans || count < 1 || count > 2 || (!buffer && buffer_size > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    lz_in_t in = { spans, count, 0, 0 };
+    size_t size = 0;
+    int token;
+    while ((token = next_byte(&in)) >= 0) {
+        uint32_t literal_len = (uint32_t)token >> 4;
+        if (literal_len == 15 && read_length(&in, &literal_len) < 0) {
+            return UNILOG_ERR_INVALID;
+        }
+        for (uint32_t k = 0; k < literal_len; k++) {
+            int byte = next_byte(&in);
+            if (byte < 0) {
+                return UNILOG_ERR_INVALID;
+            }
+            if (size < buffer_size) {
+                buffer[size++] = (char)byte;
+            }
+        }
+
+        int low = next_byte(&in);
+        if (low < 0) {
+            break;  /* Last sequence */
+        }
+        int high = next_byte(&in);
+        uint32_t offset = (uint32_t)low | (uint32_t)high << 8;
+        uint32_t match_len = ((uint32_t)token & 15) + UNILOG_LZ_MIN_MATCH;
+        if (high < 0 || offset == 0 ||
+            ((token & 15) == 15 && read_length(&in, &match_len) < 0)) {
+            return UNILOG_ERR_INVALID;
+        }
+        if (size == buffer_size) {
+            break;  /* Truncated, the rest is not needed */
+        }
+        if (offset > size) {
+            return UNILOG_ERR_INVALID;
+        }
+
+        /* Byte by byte, as matches may overlap their own output */
+        for (uint32_t k = 0; k < match_len && size < buffer_size; k++, size++) {
+            buffer[size] = buffer[size - offset];
+        }
+    }
+    return (int)size;
+}
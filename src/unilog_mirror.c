@@ -0,0 +1,78 @@
+/**
+ * @file unilog_mirror.c
+ * @brief Implementation of mirrored ring storage
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* memfd_create */
+#endif
+
+#include "unilog/unilog_mirror.h"
+#include "unilog_internal.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+unilog_result_t unilog_mirror_create(unilog_mirror_t *mirror, uint32_t capacity) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (!mirror || !is_power_of_2(capacity) || capacity > UINT32_MAX / 2 || page_size <= 0 ||
+        capacity % (uint32_t)page_size != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    int fd = memfd_create("unilog", MFD_CLOEXEC);
+    if (fd < 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (ftruncate(fd, capacity) != 0) {
+        close(fd);
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Reserve both halves at once, then map the file over each */
+    size_t size = (size_t)capacity * 2;
+    uint8_t *base = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return UNILOG_ERR_INVALID;
+    }
+    for (int half = 0; half < 2; half++) {
+        if (mmap(base + (size_t)half * capacity, capacity, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, size);
+            close(fd);
+            return UNILOG_ERR_INVALID;
+        }
+    }
+
+    /* The mappings keep the file alive */
+    close(fd);
+    mirror->base = base;
+    mirror->capacity = capacity;
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_mirror_init(unilog_t *log, unilog_mirror_t *mirror) {
+    if (!mirror || !mirror->base) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Give the pages back instead of clearing them: the next access
+       faults in a zero page, so large rings start in constant time */
+    if (madvise(mirror->base, mirror->capacity, MADV_REMOVE) != 0) {
+        memset(mirror->base, 0, mirror->capacity);
+    }
+
+    unilog_result_t result = unilog_init_zeroed(log, mirror->base, mirror->capacity);
+    if (result == UNILOG_OK) {
+        log->buffer.mirrored = true;
+    }
+    return result;
+}
+
+void unilog_mirror_destroy(unilog_mirror_t *mirror) {
+    if (!mirror || !mirror->base) {
+        return;
+    }
+    munmap(mirror->base, (size_t)mirror->capacity * 2);
+    mirror->base = NULL;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file unilog_pingpong.c
+ * @brief Implementation of double-buffered logging with block hand-off
+ */
+
+#include "unilog/unilog_pingpong.h"
+#include "unilog_internal.h"
+#include <string.h>
+
+/* Set in fill[] once a half has been swapped out; no more reservations */
+#define FILL_CLOSED 0x80000000u
+
+unilog_result_t unilog_pingpong_init(unilog_pingpong_t *pp, void *buffer, uint32_t capacity) {
+    if (!pp || !buffer || capacity == 0 || capacity % 8 != 0 || capacity / 2 >= FILL_CLOSED) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    atomic_init(&pp->active, 0);
+    for (int i = 0; i < 2; i++) {
+        atomic_init(&pp->fill[i], 0);
+        atomic_init(&pp->writers[i], 0);
+    }
+    pp->half_size = capacity / 2;
+    pp->buffer = (uint8_t *)buffer;
+    atomic_init(&pp->min_level, UNILOG_LEVEL_TRACE);
+    pp->closing = -1;
+    pp->handed_off = -1;
+
+    return UNILOG_OK;
+}
+
+void unilog_pingpong_set_level(unilog_pingpong_t *pp, unilog_level_t level) {
+    if (!pp) {
+        return;
+    }
+    atomic_store(&pp->min_level, level);
+}
+
+/*
+ * Reserve space in the active half and register as a writer of it.
+ *
+ * The writer count is raised before the reservation and the consumer
+ * closes a half before checking its writer count (both sequentially
+ * consistent), so either the consumer sees this producer, or the
+ * producer sees the closed flag and moves to the other half.
+ */
+static unilog_result_t pingpong_reserve(unilog_pingpong_t *pp, uint32_t advance_by,
+                                        uint32_t *half, uint32_t *offset) {
+    for (;;) {
+        uint32_t h = atomic_load(&pp->active);
+        atomic_fetch_add(&pp->writers[h], 1);
+        if (atomic_load(&pp->active) != h) {
+            /* Swapped in between, retry in the new half */
+            atomic_fetch_sub(&pp->writers[h], 1);
+            continue;
+        }
+
+        uint32_t fill = atomic_load(&pp->fill[h]);
+        do {
+            if (fill & FILL_CLOSED) {
+                break;
+            }
+            if (advance_by > pp->half_size - fill) {
+                atomic_fetch_sub_explicit(&pp->writers[h], 1, memory_order_release);
+                return UNILOG_ERR_FULL;
+            }
+        } while (!atomic_compare_exchange_weak(&pp->fill[h], &fill, fill + advance_by));
+
+        if (fill & FILL_CLOSED) {
+            atomic_fetch_sub_explicit(&pp->writers[h], 1, memory_order_release);
+            continue;
+        }
+
+        *half = h;
+        *offset = fill;
+        return UNILOG_OK;
+    }
+}
+
+unilog_result_t unilog_pingpong_write_raw(unilog_pingpong_t *pp, unilog_level_t level,
+                                          uint32_t timestamp, const char *message,
+                                          size_t length) {
+    if (!pp || (!message && length > 0) || (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (!level_enabled(level, atomic_load(&pp->min_level))) {
+        return UNILOG_OK;  /* Silently ignore */
+    }
+
+    uint32_t total_size = sizeof(unilog_entry_header_t) + length;
+    if (length > pp->half_size || total_size > pp->half_size) {
+        return UNILOG_ERR_INVALID;
+    }
+    uint32_t advance_by = align_up(total_size);
+
+    uint32_t half, offset;
+    unilog_result_t result = pingpong_reserve(pp, advance_by, &half, &offset);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+
+    /* Entries never wrap, so header and message are plain copies */
+    uint8_t *entry = pp->buffer + half * pp->half_size + offset;
+    unilog_entry_header_t header;
+    unilog_fill_header(&header, level, timestamp, message, length);
+    memcpy(entry, &header, sizeof(header));
+    if (length > 0) {
+        memcpy(entry + sizeof(header), message, length);
+    }
+    memset(entry + total_size, 0, advance_by - total_size);
+
+    /* Publish the entry to the consumer waiting in unilog_pingpong_swap */
+    atomic_fetch_sub_explicit(&pp->writers[half], 1, memory_order_release);
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_pingpong_write(unilog_pingpong_t *pp, unilog_level_t level,
+                                      uint32_t timestamp, const char *message) {
+    if (!message) {
+        return UNILOG_ERR_INVALID;
+    }
+    return unilog_pingpong_write_raw(pp, level, timestamp, message, strlen(message));
+}
+
+uint32_t unilog_pingpong_used(const unilog_pingpong_t *pp) {
+    if (!pp) {
+        return 0;
+    }
+    uint32_t h = atomic_load_explicit(&pp->active, memory_order_acquire);
+    return atomic_load_explicit(&pp->fill[h], memory_order_acquire) & ~FILL_CLOSED;
+}
+
+unilog_result_t unilog_pingpong_swap(unilog_pingpong_t *pp, unilog_block_t *block) {
+    if (!pp || !block) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (pp->handed_off >= 0) {
+        return UNILOG_ERR_BUSY;
+    }
+
+    if (pp->closing < 0) {
+        uint32_t old = atomic_load(&pp->active);
+        if (atomic_load(&pp->fill[old]) == 0) {
+            return UNILOG_ERR_EMPTY;
+        }
+        /* The other half was released, so it is empty and open */
+        atomic_store(&pp->active, old ^ 1);
+        atomic_fetch_or(&pp->fill[old], FILL_CLOSED);
+        pp->closing = (int8_t)old;
+    }
+
+    /* Wait for producers that reserved space before the swap */
+    uint32_t h = (uint32_t)pp->closing;
+    if (atomic_load(&pp->writers[h]) != 0) {
+        return UNILOG_ERR_BUSY;
+    }
+
+    block->data = pp->buffer + h * pp->half_size;
+    block->size = atomic_load_explicit(&pp->fill[h], memory_order_acquire) & ~FILL_CLOSED;
+    pp->handed_off = pp->closing;
+    pp->closing = -1;
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_pingpong_release(unilog_pingpong_t *pp) {
+    if (!pp || pp->handed_off < 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    atomic_store_explicit(&pp->fill[pp->handed_off], 0, memory_order_release);
+    pp->handed_off = -1;
+
+    return UNILOG_OK;
+}
+
+int unilog_block_next(const unilog_block_t *block, uint32_t *offset,
+                      unilog_entry_info_t *info, const char **message) {
+    if (!block || !offset || !info || !message) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (*offset >= block->size) {
+        return UNILOG_ERR_EMPTY;
+    }
+
+    unilog_entry_header_t header;
+    uint32_t remaining = block->size - *offset;
+    if (remaining < sizeof(header)) {
+        return UNILOG_ERR_INVALID;
+    }
+    memcpy(&header, block->data + *offset, sizeof(header));
+    if (header.length < sizeof(header) || align_up(header.length) > remaining) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    info->level = (unilog_level_t)(header.level & UNILOG_LEVEL_MASK);
+    info->flags = header.level >> UNILOG_FLAGS_SHIFT;
+    info->timestamp = header.timestamp;
+#if UNILOG_THREAD_INFO
+    info->thread_id = header.thread_id;
+    info->cpu_id = header.cpu_id;
+#else
+    info->thread_id = 0;
+    info->cpu_id = UNILOG_CPU_UNKNOWN;
+#endif
+    *message = (const char *)block->data + *offset + sizeof(header);
+    *offset += align_up(header.length);
+
+    return (int)(header.length - sizeof(header));
+}
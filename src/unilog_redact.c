@@ -0,0 +1,329 @@
+/**
+ * @file unilog_redact.c
+ * @brief Implementation of consumer-side redaction
+ */
+
+#include "unilog/unilog_redact.h"
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define REDACT_SSSE3 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define REDACT_NEON 1
+#endif
+
+/* Prefilter buckets; keywords share the remaining bits */
+#define BUCKET_EMAIL 0x01
+#define BUCKET_CARD 0x02
+#define KEYWORD_BUCKET_SHIFT 2
+#define KEYWORD_BUCKETS 6
+
+#define CARD_MIN_DIGITS 13
+#define CARD_MAX_DIGITS 19
+
+static const char *const secret_keywords[] = {
+    "password=", "passwd=", "token=", "secret=", "api_key=", "bearer "
+};
+
+static inline bool is_digit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_alnum(uint8_t c) {
+    return is_digit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+static inline uint8_t to_lower(uint8_t c) {
+    return c >= 'A' && c <= 'Z' ? (uint8_t)(c | 0x20) : c;
+}
+
+static inline bool is_email_local(uint8_t c) {
+    return is_alnum(c) || c == '.' || c == '_' || c == '%' || c == '+' || c == '-';
+}
+
+static inline bool is_email_domain(uint8_t c) {
+    return is_alnum(c) || c == '.' || c == '-';
+}
+
+static inline bool ends_value(uint8_t c) {
+    return c <= ' ' || c == '"' || c == '\'' || c == ',' || c == ';' || c == '&' ||
+           c == ')' || c == '<';
+}
+
+/* Add a byte to a bucket of the first (which 0) or second (which 1) byte tables */
+static void add_byte(unilog_redactor_t *r, int which, uint8_t c, uint8_t bucket) {
+    r->nibbles[which * 2][c & 15] |= bucket;
+    r->nibbles[which * 2 + 1][c >> 4] |= bucket;
+}
+
+static inline uint8_t fingerprint(const unilog_redactor_t *r, uint8_t a, uint8_t b) {
+    return r->nibbles[0][a & 15] & r->nibbles[1][a >> 4] &
+           r->nibbles[2][b & 15] & r->nibbles[3][b >> 4];
+}
+
+unilog_result_t unilog_redactor_init(unilog_redactor_t *redactor, uint32_t rules) {
+    if (!redactor || (rules & ~(uint32_t)UNILOG_REDACT_ALL)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    memset(redactor, 0, sizeof(*redactor));
+    redactor->rules = rules;
+    redactor->mask = '*';
+    if (rules & UNILOG_REDACT_EMAIL) {
+        /* Any byte may follow the @ */
+        add_byte(redactor, 0, '@', BUCKET_EMAIL);
+        for (int n = 0; n < 16; n++) {
+            redactor->nibbles[2][n] |= BUCKET_EMAIL;
+            redactor->nibbles[3][n] |= BUCKET_EMAIL;
+        }
+    }
+    if (rules & UNILOG_REDACT_CARD) {
+        for (uint8_t c = '0'; c <= '9'; c++) {
+            add_byte(redactor, 0, c, BUCKET_CARD);
+            add_byte(redactor, 1, c, BUCKET_CARD);
+        }
+    }
+    if (rules & UNILOG_REDACT_SECRETS) {
+        for (size_t i = 0; i < sizeof(secret_keywords) / sizeof(secret_keywords[0]); i++) {
+            unilog_redactor_add_keyword(redactor, secret_keywords[i]);
+        }
+    }
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_redactor_add_keyword(unilog_redactor_t *redactor, const char *keyword) {
+    if (!redactor || !keyword) {
+        return UNILOG_ERR_INVALID;
+    }
+    size_t length = strlen(keyword);
+    if (length < 2 || length > UNILOG_REDACT_MAX_KEYWORD) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (redactor->keyword_count == UNILOG_REDACT_MAX_KEYWORDS) {
+        return UNILOG_ERR_FULL;
+    }
+
+    uint32_t k = redactor->keyword_count++;
+    uint8_t bucket = (uint8_t)(1u << (KEYWORD_BUCKET_SHIFT + k % KEYWORD_BUCKETS));
+    for (size_t i = 0; i < length; i++) {
+        redactor->keywords[k][i] = (char)to_lower((uint8_t)keyword[i]);
+    }
+    redactor->keyword_length[k] = (uint8_t)length;
+
+    /* Both cases of the first two bytes */
+    for (int which = 0; which < 2; which++) {
+        uint8_t c = (uint8_t)redactor->keywords[k][which];
+        add_byte(redactor, which, c, bucket);
+        if (c >= 'a' && c <= 'z') {
+            add_byte(redactor, which, (uint8_t)(c & ~0x20), bucket);
+        }
+    }
+    return UNILOG_OK;
+}
+
+/* Mask the value following a keyword that starts at pos */
+static bool try_keyword(const unilog_redactor_t *r, uint8_t *m, size_t len, size_t pos,
+                        uint8_t buckets, size_t *end) {
+    for (uint32_t k = 0; k < r->keyword_count; k++) {
+        size_t klen = r->keyword_length[k];
+        if (!(buckets & (1u << (KEYWORD_BUCKET_SHIFT + k % KEYWORD_BUCKETS))) ||
+            klen > len - pos) {
+            continue;
+        }
+        size_t i = 0;
+        while (i < klen && to_lower(m[pos + i]) == (uint8_t)r->keywords[k][i]) {
+            i++;
+        }
+        if (i < klen) {
+            continue;
+        }
+
+        size_t v = pos + klen;
+        while (v < len && !ends_value(m[v])) {
+            m[v++] = (uint8_t)r->mask;
+        }
+        if (v > pos + klen) {
+            *end = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Mask an address around the @ at pos */
+static bool try_email(const unilog_redactor_t *r, uint8_t *m, size_t len, size_t pos,
+                      size_t *end) {
+    size_t start = pos;
+    while (start > 0 && is_email_local(m[start - 1])) {
+        start--;
+    }
+    size_t stop = pos + 1;
+    while (stop < len && is_email_domain(m[stop])) {
+        stop++;
+    }
+    while (stop > pos + 1 && (m[stop - 1] == '.' || m[stop - 1] == '-')) {
+        stop--;
+    }
+
+    /* The domain needs an inner dot */
+    const void *dot = memchr(m + pos + 2, '.', stop > pos + 2 ? stop - pos - 2 : 0);
+    if (start == pos || !dot) {
+        return false;
+    }
+    memset(m + start, r->mask, stop - start);
+    *end = stop;
+    return true;
+}
+
+/* Mask a card number starting at pos; *end skips the digits otherwise */
+static bool try_card(const unilog_redactor_t *r, uint8_t *m, size_t len, size_t pos,
+                     size_t *end) {
+    uint8_t digits[CARD_MAX_DIGITS + 1];
+    size_t count = 0;
+    size_t i = pos;
+    size_t last = pos;
+
+    /* Digits, optionally grouped by single spaces or dashes */
+    while (i < len && count <= CARD_MAX_DIGITS) {
+        if (is_digit(m[i])) {
+            digits[count++] = (uint8_t)(m[i] - '0');
+            last = ++i;
+        } else if ((m[i] == ' ' || m[i] == '-') && i + 1 < len && is_digit(m[i + 1])) {
+            i++;
+        } else {
+            break;
+        }
+    }
+    *end = last;
+    if (count < CARD_MIN_DIGITS || count > CARD_MAX_DIGITS ||
+        (last < len && is_alnum(m[last]))) {
+        return false;
+    }
+
+    /* Luhn check */
+    uint32_t sum = 0;
+    for (size_t d = 0; d < count; d++) {
+        uint32_t v = digits[count - 1 - d];
+        if (d & 1) {
+            v = v * 2 > 9 ? v * 2 - 9 : v * 2;
+        }
+        sum += v;
+    }
+    if (sum % 10 != 0) {
+        return false;
+    }
+    for (i = pos; i < last; i++) {
+        if (is_digit(m[i])) {
+            m[i] = (uint8_t)r->mask;
+        }
+    }
+    return true;
+}
+
+/* Verify a prefilter candidate; *resume is where scanning continues */
+static uint32_t verify(const unilog_redactor_t *r, uint8_t *m, size_t len, size_t pos,
+                       uint8_t buckets, size_t *resume) {
+    size_t end;
+    if ((buckets >> KEYWORD_BUCKET_SHIFT) && try_keyword(r, m, len, pos, buckets, &end)) {
+        *resume = end;
+        return 1;
+    }
+    if ((buckets & BUCKET_EMAIL) && m[pos] == '@' && try_email(r, m, len, pos, &end)) {
+        *resume = end;
+        return 1;
+    }
+    if ((buckets & BUCKET_CARD) && is_digit(m[pos]) && (pos == 0 || !is_alnum(m[pos - 1]))) {
+        bool card = try_card(r, m, len, pos, &end);
+        *resume = end;
+        return card ? 1 : 0;
+    }
+    return 0;
+}
+
+#ifdef REDACT_SSSE3
+/* Candidate bits of 16 positions, reading 17 bytes */
+__attribute__((target("ssse3")))
+static uint32_t block_ssse3(const unilog_redactor_t *r, const uint8_t *p) {
+    const __m128i low = _mm_set1_epi8(0x0F);
+    __m128i f = _mm_set1_epi8(-1);
+    for (int which = 0; which < 2; which++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + which));
+        __m128i lo = _mm_loadu_si128((const __m128i *)r->nibbles[which * 2]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)r->nibbles[which * 2 + 1]);
+        f = _mm_and_si128(f, _mm_shuffle_epi8(lo, _mm_and_si128(v, low)));
+        f = _mm_and_si128(f, _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+    }
+    return ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(f, _mm_setzero_si128())) & 0xFFFF;
+}
+#endif
+
+#ifdef REDACT_NEON
+static uint32_t block_neon(const unilog_redactor_t *r, const uint8_t *p) {
+    uint8x16_t f = vdupq_n_u8(0xFF);
+    for (int which = 0; which < 2; which++) {
+        uint8x16_t v = vld1q_u8(p + which);
+        f = vandq_u8(f, vqtbl1q_u8(vld1q_u8(r->nibbles[which * 2]), vandq_u8(v, vdupq_n_u8(15))));
+        f = vandq_u8(f, vqtbl1q_u8(vld1q_u8(r->nibbles[which * 2 + 1]), vshrq_n_u8(v, 4)));
+    }
+    /* One nibble per byte, then one bit per byte */
+    uint64_t nibbles = vget_lane_u64(
+            vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(vtstq_u8(f, f)), 4)), 0);
+    uint32_t bits = 0;
+    for (int i = 0; nibbles; i++, nibbles >>= 4) {
+        bits |= (uint32_t)(nibbles & 1) << i;
+    }
+    return bits;
+}
+#endif
+
+#if defined(REDACT_SSSE3) || defined(REDACT_NEON)
+typedef uint32_t (*block_fn)(const unilog_redactor_t *r, const uint8_t *p);
+#endif
+
+uint32_t unilog_redact(const unilog_redactor_t *redactor, char *message, size_t length) {
+    if (!redactor || !message || length < 2) {
+        return 0;
+    }
+
+    uint8_t *m = (uint8_t *)message;
+    uint32_t count = 0;
+    size_t resume = 0;
+    size_t i = 0;
+
+#if defined(REDACT_SSSE3) || defined(REDACT_NEON)
+    block_fn block = NULL;
+#if defined(REDACT_SSSE3) && defined(__SSSE3__)
+    block = block_ssse3;
+#elif defined(REDACT_SSSE3)
+    if (__builtin_cpu_supports("ssse3")) {
+        block = block_ssse3;
+    }
+#else
+    block = block_neon;
+#endif
+
+    /* Blocks of 16 candidate positions; patterns are at least 2 bytes */
+    if (block) {
+        for (; i + 17 <= length; i += 16) {
+            uint32_t bits = block(redactor, m + i);
+            while (bits) {
+                size_t pos = i + (size_t)__builtin_ctz(bits);
+                bits &= bits - 1;
+                if (pos >= resume) {
+                    uint8_t buckets = fingerprint(redactor, m[pos], m[pos + 1]);
+                    count += verify(redactor, m, length, pos, buckets, &resume);
+                }
+            }
+        }
+    }
+#endif
+    for (; i + 1 < length; i++) {
+        uint8_t buckets = fingerprint(redactor, m[i], m[i + 1]);
+        if (buckets && i >= resume) {
+            count += verify(redactor, m, length, i, buckets, &resume);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,842 @@
+/**
+ * @file unilog_segment.c
+ * @brief Implementation of unilog segment files and compaction
+ */
+
+#include "unilog/unilog_segment.h"
+#include "unilog/unilog_decode.h"
+#include "unilog/unilog_intern.h"
+#include "unilog_internal.h"
+#include <string.h>
+
+/* Internal helper to align size to a power of 2 boundary */
+static inline uint32_t align_to(uint32_t size, uint32_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/* Copy buffer size for moving entry bodies between files */
+#define SEGMENT_COPY_CHUNK 256
+
+/* Room for an expanded message: every reference may stand for a longest string */
+#define MERGE_EXPANDED_SIZE \
+    (UNILOG_INTERN_MESSAGE_SIZE / UNILOG_INTERN_REF_SIZE * UNILOG_INTERN_MAX_LENGTH + 1)
+
+static const uint8_t zero_pad[4];
+
+/* Build a native entry header */
+static void make_header(unilog_entry_header_t *header, const unilog_entry_info_t *info,
+                        size_t msg_len) {
+    memset(header, 0, sizeof(*header));
+    header->length = sizeof(*header) + msg_len;
+    header->level = info->level | info->flags << UNILOG_FLAGS_SHIFT;
+    header->timestamp = info->timestamp;
+#if UNILOG_THREAD_INFO
+    header->thread_id = info->thread_id;
+    header->cpu_id = info->cpu_id;
+#endif
+}
+
+#if UNILOG_ENTRY_CRC
+/* Compute the CRC of the current input entry's message, leaving the file position unchanged */
+static unilog_result_t reader_body_crc(unilog_segment_reader_t *reader, uint32_t msg_len,
+                                       uint32_t *crc) {
+    uint8_t chunk[SEGMENT_COPY_CHUNK];
+    uint32_t remaining = msg_len;
+
+    while (remaining > 0) {
+        size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        if (fread(chunk, 1, n, reader->file) != n) {
+            return UNILOG_ERR_INVALID;
+        }
+        *crc = unilog_crc32c(*crc, chunk, n);
+        remaining -= n;
+    }
+
+    if (msg_len > 0 && fseek(reader->file, -(long)msg_len, SEEK_CUR) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    return UNILOG_OK;
+}
+#endif
+
+/* Account for a new entry in header and index, then write its header */
+static unilog_result_t writer_begin_entry(unilog_segment_writer_t *writer,
+                                          const unilog_entry_header_t *header) {
+    unilog_segment_header_t *seg = &writer->header;
+
+    /* Record every index_stride-th entry, thinning the index when full */
+    if (writer->index_capacity > 0 && seg->entry_count % seg->index_stride == 0) {
+        if (seg->index_count == writer->index_capacity) {
+            for (uint32_t i = 0; i < (seg->index_count + 1) / 2; i++) {
+                writer->index[i] = writer->index[i * 2];
+            }
+            seg->index_count = (seg->index_count + 1) / 2;
+            seg->index_stride *= 2;
+        }
+        if (seg->entry_count % seg->index_stride == 0) {
+            writer->index[seg->index_count].timestamp = header->timestamp;
+            writer->index[seg->index_count].offset = seg->data_size;
+            seg->index_count++;
+        }
+    }
+
+    if (fwrite(header, sizeof(*header), 1, writer->file) != 1) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (seg->entry_count == 0 || header->timestamp < seg->ts_min) {
+        seg->ts_min = header->timestamp;
+    }
+    if (seg->entry_count == 0 || header->timestamp > seg->ts_max) {
+        seg->ts_max = header->timestamp;
+    }
+    seg->entry_count++;
+    seg->data_size += align_up(header->length);
+
+    return UNILOG_OK;
+}
+
+/* Write the padding after an entry of the given total length */
+static unilog_result_t writer_end_entry(unilog_segment_writer_t *writer, uint32_t length) {
+    size_t pad = align_up(length) - length;
+    if (pad > 0 && fwrite(zero_pad, 1, pad, writer->file) != pad) {
+        return UNILOG_ERR_INVALID;
+    }
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_segment_writer_init(unilog_segment_writer_t *writer, FILE *file,
+                                           unilog_segment_index_t *index,
+                                           uint32_t index_capacity) {
+    if (!writer || !file || (!index && index_capacity > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    memset(&writer->header, 0, sizeof(writer->header));
+    memcpy(writer->header.magic, UNILOG_SEGMENT_MAGIC, sizeof(writer->header.magic));
+    unilog_get_layout(&writer->header.layout);
+    writer->header.version = UNILOG_SEGMENT_VERSION;
+    writer->header.header_size = sizeof(unilog_segment_header_t);
+    writer->header.index_stride = 1;
+
+    writer->file = file;
+    writer->index = index;
+    writer->index_capacity = index_capacity;
+
+    /* Placeholder header, rewritten by unilog_segment_writer_finish */
+    if (fwrite(&writer->header, sizeof(writer->header), 1, file) != 1) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_segment_write(unilog_segment_writer_t *writer,
+                                     const unilog_entry_info_t *info,
+                                     const char *message, size_t length) {
+    if (!writer || !info || (!message && length > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    unilog_entry_header_t header;
+    make_header(&header, info, length);
+#if UNILOG_ENTRY_CRC
+    header.crc = unilog_crc32c(unilog_crc32c(0, &header, sizeof(header)), message, length);
+#endif
+
+    unilog_result_t result = writer_begin_entry(writer, &header);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+    if (length > 0 && fwrite(message, 1, length, writer->file) != length) {
+        return UNILOG_ERR_INVALID;
+    }
+    return writer_end_entry(writer, header.length);
+}
+
+unilog_result_t unilog_segment_writer_finish(unilog_segment_writer_t *writer) {
+    if (!writer) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    unilog_segment_header_t *seg = &writer->header;
+    if (seg->index_count > 0 &&
+        fwrite(writer->index, sizeof(*writer->index), seg->index_count, writer->file)
+            != seg->index_count) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (fseek(writer->file, 0, SEEK_SET) != 0 ||
+        fwrite(seg, sizeof(*seg), 1, writer->file) != 1 ||
+        fseek(writer->file, 0, SEEK_END) != 0 ||
+        fflush(writer->file) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_segment_reader_init(unilog_segment_reader_t *reader, FILE *file) {
+    if (!reader || !file) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    reader->file = file;
+    reader->offset = 0;
+    reader->entry_size = 0;
+    reader->corrupt = 0;
+
+    unilog_segment_header_t *seg = &reader->header;
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(seg, sizeof(*seg), 1, file) != 1) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (memcmp(seg->magic, UNILOG_SEGMENT_MAGIC, sizeof(seg->magic)) != 0 ||
+        !unilog_layout_is_supported(&seg->layout)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Convert header fields written by a target of other byte order */
+    if (unilog_decoder_init(&reader->decoder, &seg->layout) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (reader->decoder.swap) {
+        uint32_t words[6];
+        seg->version = (uint16_t)((seg->version >> 8) | (seg->version << 8));
+        seg->header_size = (uint16_t)((seg->header_size >> 8) | (seg->header_size << 8));
+        memcpy(words, &seg->entry_count, sizeof(words));
+        unilog_bswap32_array(words, 6);
+        memcpy(&seg->entry_count, words, sizeof(words));
+    }
+
+    if (seg->version != UNILOG_SEGMENT_VERSION ||
+        seg->header_size < sizeof(*seg) ||
+        seg->index_stride == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    if (fseek(file, seg->header_size, SEEK_SET) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    return UNILOG_OK;
+}
+
+/* Check the CRC of an entry whose header was just read, leaving the file position unchanged */
+static bool reader_crc_valid(unilog_segment_reader_t *reader, const uint8_t *raw,
+                             uint32_t msg_len) {
+    uint8_t chunk[SEGMENT_COPY_CHUNK];
+    uint32_t expected;
+    uint32_t crc = unilog_decode_crc_start(&reader->header.layout, raw, &expected);
+    uint32_t remaining = msg_len;
+
+    while (remaining > 0) {
+        size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        if (fread(chunk, 1, n, reader->file) != n) {
+            return false;
+        }
+        crc = unilog_crc32c(crc, chunk, n);
+        remaining -= n;
+    }
+    if (msg_len > 0 && fseek(reader->file, -(long)msg_len, SEEK_CUR) != 0) {
+        return false;
+    }
+    return crc == expected;
+}
+
+/* Decode the entry header at the current offset */
+static int reader_decode_at(unilog_segment_reader_t *reader, unilog_entry_info_t *info,
+                            uint32_t *msg_len) {
+    const unilog_layout_t *layout = &reader->header.layout;
+    uint32_t remaining = reader->header.data_size - reader->offset;
+    uint8_t raw[UNILOG_MAX_HEADER_SIZE];
+    uint32_t length;
+
+    if (remaining < layout->header_size ||
+        fread(raw, layout->header_size, 1, reader->file) != 1) {
+        return UNILOG_ERR_INVALID;
+    }
+    unilog_decoder_header(&reader->decoder, raw, &length, info);
+    if (length < layout->header_size || length > remaining ||
+        (uint32_t)info->level >= UNILOG_LEVEL_NONE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    *msg_len = length - layout->header_size;
+    if ((layout->variant & UNILOG_VARIANT_CRC) && !reader_crc_valid(reader, raw, *msg_len)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    reader->entry_size = align_to(length, layout->alignment);
+    return UNILOG_OK;
+}
+
+/* Read and decode the header of the next entry, skipping corrupt data if possible */
+static int reader_next_header(unilog_segment_reader_t *reader, unilog_entry_info_t *info,
+                              uint32_t *msg_len) {
+    const unilog_layout_t *layout = &reader->header.layout;
+    bool corrupt = false;
+
+    while (reader->offset < reader->header.data_size) {
+        if (reader_decode_at(reader, info, msg_len) == UNILOG_OK) {
+            if (corrupt) {
+                reader->corrupt++;
+            }
+            return UNILOG_OK;
+        }
+        if (!(layout->variant & UNILOG_VARIANT_CRC)) {
+            return UNILOG_ERR_INVALID;
+        }
+
+        /* Resynchronize at the next aligned position holding an intact entry */
+        reader->offset += corrupt ? layout->alignment
+                                  : align_to(layout->header_size, layout->alignment);
+        corrupt = true;
+        if (fseek(reader->file, (long)reader->header.header_size + reader->offset,
+                  SEEK_SET) != 0) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+
+    if (corrupt) {
+        reader->corrupt++;
+    }
+    return UNILOG_ERR_EMPTY;
+}
+
+/* Skip the rest of the current entry, given the message bytes already consumed */
+static int reader_skip_rest(unilog_segment_reader_t *reader, uint32_t consumed) {
+    uint32_t rest = reader->entry_size - reader->header.layout.header_size - consumed;
+    if (rest > 0 && fseek(reader->file, rest, SEEK_CUR) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    reader->offset += reader->entry_size;
+    return UNILOG_OK;
+}
+
+/* Read and expand the compressed message of the current entry */
+static int read_compressed(unilog_segment_reader_t *reader, unilog_entry_info_t *info,
+                           uint32_t msg_len, char *buffer, size_t buffer_size) {
+    char stored[UNILOG_SEGMENT_COMPRESS_SIZE];
+    if (msg_len > 0 && fread(stored, 1, msg_len, reader->file) != msg_len) {
+        return UNILOG_ERR_INVALID;
+    }
+    int result = reader_skip_rest(reader, msg_len);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+
+    unilog_span_t span = { stored, msg_len };
+    int length = unilog_decompress(&span, 1, buffer, buffer_size - 1);
+    if (length < 0) {
+        return length;
+    }
+    buffer[length] = '\0';
+    info->flags &= ~(uint32_t)UNILOG_FLAG_COMPRESSED;
+    return length;
+}
+
+int unilog_segment_read(unilog_segment_reader_t *reader, unilog_entry_info_t *info,
+                        char *buffer, size_t buffer_size) {
+    if (!reader || !info || !buffer || buffer_size == 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t msg_len;
+    int result = reader_next_header(reader, info, &msg_len);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+
+    if ((info->flags & UNILOG_FLAG_COMPRESSED) && msg_len <= UNILOG_SEGMENT_COMPRESS_SIZE) {
+        return read_compressed(reader, info, msg_len, buffer, buffer_size);
+    }
+
+    /* Read message, truncating if necessary */
+    uint32_t copy_len = msg_len < buffer_size ? msg_len : buffer_size - 1;
+    if (copy_len > 0 && fread(buffer, 1, copy_len, reader->file) != copy_len) {
+        return UNILOG_ERR_INVALID;
+    }
+    buffer[copy_len] = '\0';
+
+    result = reader_skip_rest(reader, copy_len);
+    return result == UNILOG_OK ? (int)copy_len : result;
+}
+
+unilog_result_t unilog_segment_seek(unilog_segment_reader_t *reader, uint32_t timestamp) {
+    if (!reader) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Binary search for the last index entry before the timestamp */
+    const unilog_segment_header_t *seg = &reader->header;
+    long index_start = (long)seg->header_size + seg->data_size;
+    uint32_t lo = 0, hi = seg->index_count;
+    uint32_t offset = 0;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t entry[2];  /* timestamp, offset */
+        if (fseek(reader->file, index_start + (long)(mid * sizeof(entry)), SEEK_SET) != 0 ||
+            fread(entry, sizeof(entry), 1, reader->file) != 1) {
+            return UNILOG_ERR_INVALID;
+        }
+        if (reader->decoder.swap) {
+            unilog_bswap32_array(entry, 2);
+        }
+        if (entry[0] < timestamp) {
+            offset = entry[1];
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (fseek(reader->file, (long)seg->header_size + offset, SEEK_SET) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    reader->offset = offset;
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_segment_find(unilog_segment_reader_t *reader, uint32_t timestamp) {
+    unilog_result_t result = unilog_segment_seek(reader, timestamp);
+    if (result != UNILOG_OK) {
+        return result;
+    }
+
+    /* Scan forward from the index entry, then step back to the header */
+    for (;;) {
+        unilog_entry_info_t info;
+        uint32_t msg_len;
+        int next = reader_next_header(reader, &info, &msg_len);
+        if (next == UNILOG_ERR_EMPTY) {
+            reader->offset = reader->header.data_size;
+            return UNILOG_OK;
+        }
+        if (next != UNILOG_OK) {
+            return (unilog_result_t)next;
+        }
+        if (info.timestamp >= timestamp) {
+            long pos = (long)reader->header.header_size + reader->offset;
+            return fseek(reader->file, pos, SEEK_SET) == 0 ? UNILOG_OK : UNILOG_ERR_INVALID;
+        }
+        if (reader_skip_rest(reader, 0) != UNILOG_OK) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+}
+
+unilog_result_t unilog_segment_index_entry(unilog_segment_reader_t *reader, uint32_t position,
+                                           unilog_segment_index_t *entry) {
+    return unilog_segment_read_index(reader, position, entry, 1);
+}
+
+unilog_result_t unilog_segment_read_index(unilog_segment_reader_t *reader, uint32_t first,
+                                          unilog_segment_index_t *entries, uint32_t count) {
+    if (!reader || !entries || first > reader->header.index_count ||
+        count > reader->header.index_count - first) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    const unilog_segment_header_t *seg = &reader->header;
+    long index_start = (long)seg->header_size + seg->data_size;
+    if (fseek(reader->file, index_start + (long)((size_t)first * sizeof(*entries)),
+              SEEK_SET) != 0 ||
+        fread(entries, sizeof(*entries), count, reader->file) != count ||
+        fseek(reader->file, (long)seg->header_size + reader->offset, SEEK_SET) != 0) {
+        return UNILOG_ERR_INVALID;
+    }
+    /* Index entries are pairs of 32-bit words */
+    if (reader->decoder.swap) {
+        unilog_bswap32_array((uint32_t *)entries, 2 * (size_t)count);
+    }
+    return UNILOG_OK;
+}
+
+bool unilog_retention_keep(const unilog_retention_t *policy, unilog_level_t level,
+                           uint32_t timestamp) {
+    if (!policy || (uint32_t)level >= UNILOG_LEVEL_NONE) {
+        return true;
+    }
+
+    uint32_t max_age = policy->max_age[level];
+    if (max_age == UNILOG_RETAIN_FOREVER) {
+        return true;
+    }
+
+    /* Entries slightly from the future (clock skew) are kept */
+    if (timestamp - policy->now <= policy->skew) {
+        return true;
+    }
+    return policy->now - timestamp <= max_age;
+}
+
+unilog_result_t unilog_compactor_init(unilog_compactor_t *compactor,
+                                      FILE *const *inputs, size_t input_count,
+                                      unilog_segment_writer_t *writer,
+                                      const unilog_retention_t *policy) {
+    if (!compactor || (!inputs && input_count > 0) || !writer || !policy) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    memset(compactor, 0, sizeof(*compactor));
+    compactor->inputs = inputs;
+    compactor->input_count = input_count;
+    compactor->writer = writer;
+    compactor->policy = *policy;
+
+    return UNILOG_OK;
+}
+
+void unilog_compactor_set_compression(unilog_compactor_t *compactor, uint32_t threshold) {
+    if (compactor) {
+        compactor->compress_threshold = threshold;
+    }
+}
+
+/* Copy the message of the current input entry to the output */
+static unilog_result_t copy_body(unilog_segment_reader_t *reader,
+                                 unilog_segment_writer_t *writer, uint32_t msg_len) {
+    uint8_t chunk[SEGMENT_COPY_CHUNK];
+    uint32_t remaining = msg_len;
+
+    while (remaining > 0) {
+        size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        if (fread(chunk, 1, n, reader->file) != n ||
+            fwrite(chunk, 1, n, writer->file) != n) {
+            return UNILOG_ERR_INVALID;
+        }
+        remaining -= n;
+    }
+
+    return UNILOG_OK;
+}
+
+/* Re-encode the current input entry in the native layout and append it to the output */
+static unilog_result_t copy_entry(unilog_segment_reader_t *reader,
+                                  unilog_segment_writer_t *writer,
+                                  const unilog_entry_info_t *info, uint32_t msg_len) {
+    unilog_entry_header_t header;
+    make_header(&header, info, msg_len);
+#if UNILOG_ENTRY_CRC
+    header.crc = unilog_crc32c(0, &header, sizeof(header));
+    if (reader_body_crc(reader, msg_len, &header.crc) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+#endif
+    if (writer_begin_entry(writer, &header) != UNILOG_OK ||
+        copy_body(reader, writer, msg_len) != UNILOG_OK ||
+        writer_end_entry(writer, header.length) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    return UNILOG_OK;
+}
+
+/* Whether the compactor compresses a retained entry */
+static bool compact_compresses(const unilog_compactor_t *compactor,
+                               const unilog_entry_info_t *info, uint32_t msg_len) {
+    const uint32_t keep_as_is =
+            UNILOG_FLAG_INTERNED | UNILOG_FLAG_DEFINITION | UNILOG_FLAG_COMPRESSED;
+    return compactor->compress_threshold > 0 && msg_len >= compactor->compress_threshold &&
+           msg_len <= UNILOG_SEGMENT_COMPRESS_SIZE && !(info->flags & keep_as_is);
+}
+
+/* Append the current input entry compressed, or as it is if it does not shrink */
+static unilog_result_t compress_entry(unilog_compactor_t *compactor,
+                                      const unilog_entry_info_t *info, uint32_t msg_len) {
+    uint8_t message[UNILOG_SEGMENT_COMPRESS_SIZE];
+    uint8_t packed[UNILOG_SEGMENT_COMPRESS_SIZE];
+    if (fread(message, 1, msg_len, compactor->reader.file) != msg_len) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    uint32_t packed_len = unilog_lz_compress(message, msg_len, packed, 0, ~(uint32_t)0,
+                                             msg_len - 1);
+    if (packed_len == 0) {
+        return unilog_segment_write(compactor->writer, info, (const char *)message, msg_len);
+    }
+    unilog_entry_info_t packed_info = *info;
+    packed_info.flags |= UNILOG_FLAG_COMPRESSED;
+    compactor->compressed++;
+    return unilog_segment_write(compactor->writer, &packed_info, (const char *)packed,
+                                packed_len);
+}
+
+unilog_result_t unilog_compactor_step(unilog_compactor_t *compactor, uint32_t max_entries) {
+    if (!compactor) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (compactor->finished) {
+        return UNILOG_OK;
+    }
+
+    for (uint32_t processed = 0; processed < max_entries; processed++) {
+        if (!compactor->reader_open) {
+            if (compactor->current == compactor->input_count) {
+                compactor->finished = true;
+                return unilog_segment_writer_finish(compactor->writer);
+            }
+            unilog_result_t result = unilog_segment_reader_init(
+                    &compactor->reader, compactor->inputs[compactor->current]);
+            if (result != UNILOG_OK) {
+                return result;
+            }
+            compactor->reader_open = true;
+        }
+
+        unilog_entry_info_t info;
+        uint32_t msg_len;
+        int result = reader_next_header(&compactor->reader, &info, &msg_len);
+        if (result == UNILOG_ERR_EMPTY) {
+            /* Move on to the next input */
+            compactor->reader_open = false;
+            compactor->current++;
+            continue;
+        }
+        if (result != UNILOG_OK) {
+            return (unilog_result_t)result;
+        }
+
+        /* Retained entries are re-encoded in the native layout */
+        uint32_t consumed = 0;
+        /* Interned string definitions are needed by later entries, always keep them */
+        if ((info.flags & UNILOG_FLAG_DEFINITION) ||
+            unilog_retention_keep(&compactor->policy, info.level, info.timestamp)) {
+            unilog_result_t copied =
+                    compact_compresses(compactor, &info, msg_len)
+                            ? compress_entry(compactor, &info, msg_len)
+                            : copy_entry(&compactor->reader, compactor->writer, &info, msg_len);
+            if (copied != UNILOG_OK) {
+                return UNILOG_ERR_INVALID;
+            }
+            consumed = msg_len;
+            compactor->kept++;
+        } else {
+            compactor->dropped++;
+        }
+
+        if (reader_skip_rest(&compactor->reader, consumed) != UNILOG_OK) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+
+    return UNILOG_ERR_BUSY;
+}
+
+/* Order of pending merge sources: by timestamp, then by input */
+static bool merge_before(const unilog_merger_t *merger, uint32_t a, uint32_t b) {
+    uint32_t ts_a = merger->sources[a].info.timestamp;
+    uint32_t ts_b = merger->sources[b].info.timestamp;
+    return ts_a < ts_b || (ts_a == ts_b && a < b);
+}
+
+/* Restore the heap property below position i */
+static void merge_sift_down(unilog_merger_t *merger, uint32_t i) {
+    uint32_t *heap = merger->heap;
+    for (;;) {
+        uint32_t smallest = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = left + 1;
+        if (left < merger->heap_size && merge_before(merger, heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < merger->heap_size && merge_before(merger, heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        uint32_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/* Read the next entry header of a source; UNILOG_ERR_EMPTY at the end of its range */
+static int merge_advance(unilog_merge_source_t *source) {
+    if (source->reader.offset >= source->end) {
+        return UNILOG_ERR_EMPTY;
+    }
+    int result = reader_next_header(&source->reader, &source->info, &source->msg_len);
+    if (result == UNILOG_OK && source->reader.offset >= source->end) {
+        /* Resynchronized past the end, the entry belongs to the next range */
+        return UNILOG_ERR_EMPTY;
+    }
+    return result;
+}
+
+/* Read the message of the current entry of a source into buffer */
+static int merge_read_body(unilog_merge_source_t *source, char *buffer, size_t size) {
+    if (source->msg_len > size ||
+        (source->msg_len > 0 &&
+         fread(buffer, 1, source->msg_len, source->reader.file) != source->msg_len)) {
+        return UNILOG_ERR_INVALID;
+    }
+    return UNILOG_OK;
+}
+
+/* Add the current entry of a source, a definition record, to its map */
+static int merge_define(unilog_merge_source_t *source) {
+    char message[UNILOG_INTERN_MESSAGE_SIZE];
+    char none[1];
+
+    if (merge_read_body(source, message, sizeof(message)) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    int result = unilog_intern_process(source->map, &source->info, message, source->msg_len,
+                                       none, sizeof(none));
+    return result == UNILOG_ERR_EMPTY ? UNILOG_OK : result;
+}
+
+/* Add the definitions in front of begin to the map of a source */
+static int merge_load_definitions(unilog_merge_source_t *source, uint32_t begin) {
+    while (source->reader.offset < begin) {
+        int result = reader_next_header(&source->reader, &source->info, &source->msg_len);
+        if (result == UNILOG_ERR_EMPTY) {
+            break;
+        }
+        if (result != UNILOG_OK) {
+            return result;
+        }
+        uint32_t consumed = 0;
+        if (source->info.flags & UNILOG_FLAG_DEFINITION) {
+            result = merge_define(source);
+            if (result != UNILOG_OK) {
+                return result;
+            }
+            consumed = source->msg_len;
+        }
+        if (reader_skip_rest(&source->reader, consumed) != UNILOG_OK) {
+            return UNILOG_ERR_INVALID;
+        }
+    }
+    return UNILOG_OK;
+}
+
+/* Write the current, interned entry of a source with its references expanded */
+static unilog_result_t merge_expand(unilog_merge_source_t *source,
+                                    unilog_segment_writer_t *writer) {
+    char message[UNILOG_INTERN_MESSAGE_SIZE];
+    char expanded[MERGE_EXPANDED_SIZE];
+
+    if (merge_read_body(source, message, sizeof(message)) != UNILOG_OK) {
+        return UNILOG_ERR_INVALID;
+    }
+    int length = unilog_intern_process(source->map, &source->info, message, source->msg_len,
+                                       expanded, sizeof(expanded));
+    if (length < 0) {
+        return (unilog_result_t)length;
+    }
+    unilog_entry_info_t info = source->info;
+    info.flags &= ~(uint32_t)UNILOG_FLAG_INTERNED;
+    return unilog_segment_write(writer, &info, expanded, (size_t)length);
+}
+
+unilog_result_t unilog_merger_init(unilog_merger_t *merger, FILE *const *inputs,
+                                   const uint32_t *begin, const uint32_t *end, uint32_t count,
+                                   unilog_merge_source_t *sources, uint32_t *heap,
+                                   unilog_intern_map_t *maps, unilog_segment_writer_t *writer) {
+    if (!merger || (!inputs && count > 0) || (count > 0 && (!sources || !heap)) || !writer) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    memset(merger, 0, sizeof(*merger));
+    merger->sources = sources;
+    merger->heap = heap;
+    merger->count = count;
+    merger->writer = writer;
+
+    for (uint32_t i = 0; i < count; i++) {
+        unilog_merge_source_t *source = &sources[i];
+        unilog_result_t result = unilog_segment_reader_init(&source->reader, inputs[i]);
+        if (result != UNILOG_OK) {
+            return result;
+        }
+        uint32_t data_size = source->reader.header.data_size;
+        source->end = end && end[i] < data_size ? end[i] : data_size;
+        source->map = maps ? &maps[i] : NULL;
+        if (source->map) {
+            unilog_intern_map_reset(source->map);
+        }
+        if (begin && begin[i] > 0) {
+            /* References in the range may use definitions made before it */
+            if (source->map && begin[i] <= source->end &&
+                (result = (unilog_result_t)merge_load_definitions(source, begin[i])) !=
+                    UNILOG_OK) {
+                return result;
+            }
+            if (begin[i] > source->end ||
+                fseek(inputs[i], (long)source->reader.header.header_size + begin[i],
+                      SEEK_SET) != 0) {
+                return UNILOG_ERR_INVALID;
+            }
+            source->reader.offset = begin[i];
+        }
+
+        int next = merge_advance(source);
+        if (next == UNILOG_OK) {
+            heap[merger->heap_size++] = i;
+        } else if (next != UNILOG_ERR_EMPTY) {
+            return (unilog_result_t)next;
+        }
+    }
+
+    /* Heapify; sources with equal timestamps keep their input order */
+    for (uint32_t i = merger->heap_size / 2; i-- > 0;) {
+        merge_sift_down(merger, i);
+    }
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_merger_step(unilog_merger_t *merger, uint32_t max_entries) {
+    if (!merger) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    if (merger->finished) {
+        return UNILOG_OK;
+    }
+
+    for (uint32_t processed = 0; processed < max_entries; processed++) {
+        if (merger->heap_size == 0) {
+            merger->finished = true;
+            return unilog_segment_writer_finish(merger->writer);
+        }
+
+        /* Copy the earliest pending entry, then replace it by its successor */
+        uint32_t i = merger->heap[0];
+        unilog_merge_source_t *source = &merger->sources[i];
+        uint32_t interning = source->info.flags &
+                             (UNILOG_FLAG_INTERNED | UNILOG_FLAG_DEFINITION);
+        unilog_result_t result;
+        if (interning && !source->map) {
+            /* IDs are per process; they would clash with those of other inputs */
+            return UNILOG_ERR_INVALID;
+        }
+        if (interning & UNILOG_FLAG_DEFINITION) {
+            /* Only taken into the map of its input, the output has no references */
+            result = (unilog_result_t)merge_define(source);
+        } else if (interning) {
+            result = merge_expand(source, merger->writer);
+            merger->merged++;
+        } else {
+            result = copy_entry(&source->reader, merger->writer, &source->info, source->msg_len);
+            merger->merged++;
+        }
+        if (result != UNILOG_OK ||
+            reader_skip_rest(&source->reader, source->msg_len) != UNILOG_OK) {
+            return UNILOG_ERR_INVALID;
+        }
+
+        int next = merge_advance(source);
+        if (next == UNILOG_ERR_EMPTY) {
+            merger->heap[0] = merger->heap[--merger->heap_size];
+        } else if (next != UNILOG_OK) {
+            return (unilog_result_t)next;
+        }
+        merge_sift_down(merger, 0);
+    }
+
+    return UNILOG_ERR_BUSY;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file unilog_status.c
+ * @brief Implementation of the lock-free status board
+ */
+
+#include "unilog/unilog_status.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Attempts before a reader gives up on a slot that keeps changing */
+#define STATUS_READ_RETRIES 16
+
+unilog_result_t unilog_status_init(unilog_status_t *board, unilog_status_slot_t *slots,
+                                   uint32_t count) {
+    if (!board || (!slots && count > 0)) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        atomic_init(&slots[i].seq, 0);
+        slots[i].timestamp = 0;
+        slots[i].length = 0;
+    }
+    board->slots = slots;
+    board->count = count;
+
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_status_set(unilog_status_t *board, uint32_t key, uint32_t timestamp,
+                                  const void *value, size_t length) {
+    if (!board || key >= board->count || (!value && length > 0) ||
+        length > UNILOG_STATUS_VALUE_SIZE) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    unilog_status_slot_t *slot = &board->slots[key];
+
+    /* Make the sequence odd to claim the slot; an odd sequence means
+       another context is in the middle of an update we may have interrupted */
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    do {
+        if (seq & 1) {
+            return UNILOG_ERR_BUSY;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&slot->seq, &seq, seq + 1,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    /* Readers must not see new data together with the old, even sequence */
+    atomic_thread_fence(memory_order_release);
+
+    slot->timestamp = timestamp;
+    slot->length = (uint32_t)length;
+    if (length > 0) {
+        memcpy(slot->value, value, length);
+    }
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    return UNILOG_OK;
+}
+
+unilog_result_t unilog_status_format(unilog_status_t *board, uint32_t key, uint32_t timestamp,
+                                     const char *format, ...) {
+    if (!format) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    char temp_buffer[UNILOG_STATUS_VALUE_SIZE + 1];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(temp_buffer, sizeof(temp_buffer), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    /* Truncate if necessary */
+    if (len > UNILOG_STATUS_VALUE_SIZE) {
+        len = UNILOG_STATUS_VALUE_SIZE;
+    }
+
+    return unilog_status_set(board, key, timestamp, temp_buffer, (size_t)len);
+}
+
+unilog_result_t unilog_status_get(const unilog_status_t *board, uint32_t key,
+                                  unilog_status_value_t *out) {
+    if (!board || key >= board->count || !out) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    unilog_status_slot_t *slot = &board->slots[key];
+    for (int attempt = 0; attempt < STATUS_READ_RETRIES; attempt++) {
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == 0) {
+            return UNILOG_ERR_EMPTY;
+        }
+        if (seq & 1) {
+            continue;  /* Update in progress */
+        }
+
+        out->timestamp = slot->timestamp;
+        out->length = slot->length;
+        if (out->length > UNILOG_STATUS_VALUE_SIZE) {
+            continue;  /* Torn read */
+        }
+        memcpy(out->value, slot->value, out->length);
+
+        /* Copy must complete before the sequence is checked again */
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq) {
+            out->value[out->length] = '\0';
+            out->version = seq / 2;
+            return UNILOG_OK;
+        }
+    }
+
+    return UNILOG_ERR_BUSY;
+}
+
+int unilog_status_snapshot(const unilog_status_t *board, unilog_status_value_t *out,
+                           uint32_t count) {
+    if (!board || !out || count < board->count) {
+        return UNILOG_ERR_INVALID;
+    }
+
+    int copied = 0;
+    for (uint32_t key = 0; key < board->count; key++) {
+        if (unilog_status_get(board, key, &out[key]) == UNILOG_OK) {
+            copied++;
+        } else {
+            memset(&out[key], 0, sizeof(out[key]));
+        }
+    }
+
+    return copied;
+}
@@ -0,0 +1,279 @@
+/**
+ * @file test_aggregate.c
+ * @brief Column decoding and aggregation tests for unilog
+ */
+
+#include <unilog/unilog_aggregate.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_ENTRIES 1003
+#define NUM_KEYS 40
+
+#define LIT(s) { s, sizeof(s) - 1, false }
+#define INTERN(s) { s, sizeof(s) - 1, true }
+
+static uint32_t timestamps[NUM_ENTRIES];
+static uint8_t levels[NUM_ENTRIES];
+static uint32_t formats[NUM_ENTRIES];
+static uint32_t threads[NUM_ENTRIES];
+
+static uint32_t random_next(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/* Fill the columns with pseudo-random entries around base */
+static void fill_random(unilog_columns_t *columns, uint32_t base, uint32_t seed) {
+    for (uint32_t i = 0; i < NUM_ENTRIES; i++) {
+        timestamps[i] = base + random_next(&seed) % 100000;
+        levels[i] = (uint8_t)(random_next(&seed) % UNILOG_LEVEL_NONE);
+        formats[i] = random_next(&seed) % NUM_KEYS;
+        threads[i] = 1000 + random_next(&seed) % 7;
+    }
+    columns->timestamp = timestamps;
+    columns->level = levels;
+    columns->format = formats;
+    columns->thread = threads;
+    columns->count = NUM_ENTRIES;
+    columns->capacity = NUM_ENTRIES;
+}
+
+static void test_aggregate_columns(void) {
+    uint8_t buffer[2048];
+    unilog_t log;
+    unilog_intern_slot_t slots[4];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[4];
+    char arena[128];
+    unilog_intern_map_t map;
+    unilog_entry_info_t info;
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    char raw[256];
+    int len;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 4) == UNILOG_OK);
+    assert(unilog_intern_map_init(&map, entries, 4, arena, sizeof(arena)) == UNILOG_OK);
+
+    const unilog_part_t started[] = { INTERN("worker %d started"), LIT(" 1") };
+    const unilog_part_t stopped[] = { LIT("\x1A"), INTERN("worker %d stopped"), LIT(" 2") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 10, started, 2) == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_WARN, 11, "plain") == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_ERROR, 12, stopped, 3) == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 13, started, 2) == UNILOG_OK);
+
+    FILE *file = tmpfile();
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    while ((len = unilog_read_entry(&log, &info, raw, sizeof(raw))) >= 0) {
+        assert(unilog_segment_write(&writer, &info, raw, (size_t)len) == UNILOG_OK);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+
+    /* Definitions go to the map, the rest is decoded in batches of 3 */
+    uint32_t ts[3], format[3], thread[3];
+    uint8_t level[3];
+    unilog_columns_t columns = { ts, level, format, thread, 0, 3 };
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    assert(unilog_segment_read_columns(&reader, &columns, &map) == 3);
+    assert(ts[0] == 10 && level[0] == UNILOG_LEVEL_INFO && format[0] != UNILOG_FORMAT_NONE);
+    assert(ts[1] == 11 && level[1] == UNILOG_LEVEL_WARN && format[1] == UNILOG_FORMAT_NONE);
+    assert(ts[2] == 12 && level[2] == UNILOG_LEVEL_ERROR && format[2] != UNILOG_FORMAT_NONE);
+    assert(format[2] != format[0]);
+
+    /* The escaped literal before the reference is not a format */
+    uint32_t length;
+    const char *text = unilog_intern_lookup(&map, format[2], &length);
+    assert(text && length == 17 && memcmp(text, "worker %d stopped", length) == 0);
+    uint32_t first = format[0];
+
+    assert(unilog_segment_read_columns(&reader, &columns, &map) == 1);
+    assert(columns.count == 1 && ts[0] == 13 && format[0] == first);
+    assert(unilog_segment_read_columns(&reader, &columns, &map) == 0);
+    assert(columns.count == 0);
+
+    columns.capacity = 0;
+    assert(unilog_segment_read_columns(&reader, &columns, NULL) == UNILOG_ERR_INVALID);
+
+    fclose(file);
+    printf("✓ test_aggregate_columns passed\n");
+}
+
+static void check_histogram(const unilog_columns_t *columns, uint32_t begin, uint32_t width,
+                            uint32_t buckets) {
+    static uint64_t counts[64 * UNILOG_LEVEL_NONE];
+    static uint64_t expected[64 * UNILOG_LEVEL_NONE];
+    unilog_histogram_t histogram;
+
+    assert(unilog_histogram_init(&histogram, begin, width, buckets, counts) == UNILOG_OK);
+    unilog_histogram_add(&histogram, columns);
+
+    memset(expected, 0, sizeof(expected));
+    for (uint32_t i = 0; i < columns->count; i++) {
+        uint32_t delta = columns->timestamp[i] - begin;
+        if (columns->timestamp[i] >= begin && delta / width < buckets) {
+            expected[delta / width * UNILOG_LEVEL_NONE + columns->level[i]]++;
+        }
+    }
+    assert(memcmp(counts, expected, buckets * UNILOG_LEVEL_NONE * sizeof(uint64_t)) == 0);
+}
+
+static void test_histogram(void) {
+    unilog_columns_t columns;
+
+    fill_random(&columns, 1000000, 1);
+    check_histogram(&columns, 1000000, 60000, 2);
+    check_histogram(&columns, 1000000, 1000, 64);
+    check_histogram(&columns, 1030000, 7, 64);
+    check_histogram(&columns, 1050000, 999, 10);
+    check_histogram(&columns, 1099990, 1, 64);
+    check_histogram(&columns, 0, 65521, 64);
+
+    /* Timestamps near the top of the range */
+    fill_random(&columns, UINT32_MAX - 100000, 2);
+    check_histogram(&columns, UINT32_MAX - 100000, 3001, 33);
+    check_histogram(&columns, 0x80000000u, 0x3FFFFFFF, 2);
+
+    /* Odd counts take the scalar tail */
+    columns.count = 7;
+    check_histogram(&columns, UINT32_MAX - 100000, 12345, 9);
+
+    /* Histograms with the same buckets merge */
+    static uint64_t a_counts[4 * UNILOG_LEVEL_NONE], b_counts[4 * UNILOG_LEVEL_NONE];
+    unilog_histogram_t a, b;
+    fill_random(&columns, 0, 3);
+    assert(unilog_histogram_init(&a, 0, 25000, 4, a_counts) == UNILOG_OK);
+    assert(unilog_histogram_init(&b, 0, 25000, 4, b_counts) == UNILOG_OK);
+    columns.count = 500;
+    unilog_histogram_add(&a, &columns);
+    columns.timestamp += 500;
+    columns.level += 500;
+    columns.count = NUM_ENTRIES - 500;
+    unilog_histogram_add(&b, &columns);
+    assert(unilog_histogram_merge(&a, &b) == UNILOG_OK);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < 4 * UNILOG_LEVEL_NONE; i++) {
+        total += a_counts[i];
+    }
+    assert(total == NUM_ENTRIES);
+
+    b.width = 1000;
+    assert(unilog_histogram_merge(&a, &b) == UNILOG_ERR_INVALID);
+    assert(unilog_histogram_init(&a, 0, 0, 4, a_counts) == UNILOG_ERR_INVALID);
+    assert(unilog_histogram_init(&a, 0, 0x80000000u, 2, a_counts) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_histogram passed\n");
+}
+
+static uint64_t reference_count(const unilog_columns_t *columns, unilog_group_by_t by,
+                                const unilog_agg_filter_t *filter, uint32_t key) {
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < columns->count; i++) {
+        uint32_t value = by == UNILOG_GROUP_LEVEL    ? columns->level[i]
+                         : by == UNILOG_GROUP_FORMAT ? columns->format[i]
+                                                     : columns->thread[i];
+        if (columns->timestamp[i] >= filter->begin && columns->timestamp[i] < filter->end &&
+            columns->level[i] >= filter->min_level && value == key) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void check_groups(const unilog_columns_t *columns, unilog_group_by_t by,
+                         const unilog_agg_filter_t *filter) {
+    unilog_agg_group_t groups[64];
+    unilog_agg_group_t top[NUM_KEYS];
+    unilog_agg_count_t count;
+
+    assert(unilog_agg_init(&count, by, filter, groups, 64) == UNILOG_OK);
+    unilog_agg_add(&count, columns);
+    assert(count.dropped == 0);
+
+    uint32_t n = unilog_agg_top(&count, top, NUM_KEYS);
+    assert(n == count.used);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        assert(top[i].count == reference_count(columns, by, filter, top[i].key));
+        assert(i == 0 || top[i].count < top[i - 1].count ||
+               (top[i].count == top[i - 1].count && top[i].key > top[i - 1].key));
+        total += top[i].count;
+    }
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < columns->count; i++) {
+        expected += columns->timestamp[i] >= filter->begin &&
+                    columns->timestamp[i] < filter->end &&
+                    columns->level[i] >= filter->min_level;
+    }
+    assert(total == expected);
+}
+
+static void test_agg_count(void) {
+    unilog_columns_t columns;
+    fill_random(&columns, 5000, 4);
+
+    unilog_agg_filter_t all = { 0, UINT32_MAX, UNILOG_LEVEL_TRACE };
+    unilog_agg_filter_t recent = { 50000, 80000, UNILOG_LEVEL_WARN };
+    unilog_agg_filter_t none = { 80000, 50000, UNILOG_LEVEL_TRACE };
+    for (int by = UNILOG_GROUP_LEVEL; by <= UNILOG_GROUP_THREAD; by++) {
+        check_groups(&columns, (unilog_group_by_t)by, &all);
+        check_groups(&columns, (unilog_group_by_t)by, &recent);
+        check_groups(&columns, (unilog_group_by_t)by, &none);
+    }
+
+    /* Top n keeps the largest groups */
+    unilog_agg_group_t groups[64], other_groups[64], top[3], full[NUM_KEYS];
+    unilog_agg_count_t count, other;
+    assert(unilog_agg_init(&count, UNILOG_GROUP_FORMAT, &all, groups, 64) == UNILOG_OK);
+    unilog_agg_add(&count, &columns);
+    assert(unilog_agg_top(&count, full, NUM_KEYS) == NUM_KEYS);
+    assert(unilog_agg_top(&count, top, 3) == 3);
+    assert(memcmp(top, full, sizeof(top)) == 0);
+    assert(unilog_agg_top(&count, top, 0) == 0);
+
+    /* Partial counts merge into the same result */
+    assert(unilog_agg_init(&count, UNILOG_GROUP_FORMAT, &all, groups, 64) == UNILOG_OK);
+    assert(unilog_agg_init(&other, UNILOG_GROUP_FORMAT, &all, other_groups, 64) == UNILOG_OK);
+    columns.count = 300;
+    unilog_agg_add(&count, &columns);
+    columns.timestamp += 300;
+    columns.level += 300;
+    columns.format += 300;
+    columns.count = NUM_ENTRIES - 300;
+    unilog_agg_add(&other, &columns);
+    assert(unilog_agg_merge(&count, &other) == UNILOG_OK);
+    assert(unilog_agg_top(&count, top, 3) == 3);
+    assert(memcmp(top, full, sizeof(top)) == 0);
+
+    other.by = UNILOG_GROUP_THREAD;
+    assert(unilog_agg_merge(&count, &other) == UNILOG_ERR_INVALID);
+
+    /* Entries of groups that do not fit are counted as dropped */
+    fill_random(&columns, 5000, 4);
+    assert(unilog_agg_init(&count, UNILOG_GROUP_FORMAT, &all, groups, 16) == UNILOG_OK);
+    unilog_agg_add(&count, &columns);
+    assert(count.used == 16);
+    uint64_t total = count.dropped;
+    for (uint32_t i = 0; i < 16; i++) {
+        total += groups[i].count;
+    }
+    assert(total == NUM_ENTRIES && count.dropped > 0);
+
+    assert(unilog_agg_init(&count, UNILOG_GROUP_FORMAT, &all, groups, 12) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_agg_count passed\n");
+}
+
+int main(void) {
+    printf("Running aggregation tests...\n\n");
+
+    test_aggregate_columns();
+    test_histogram();
+    test_agg_count();
+
+    printf("\n✓ All aggregation tests passed!\n");
+    return 0;
+}
@@ -4,6 +4,7 @@
  */
 
 #include <unilog/unilog.h>
+#include <unilog/unilog_probe.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -20,6 +21,21 @@ static void test_init(void) {
     assert(unilog_init(&log, NULL, sizeof(buffer)) == UNILOG_ERR_INVALID);
     assert(unilog_init(&log, buffer, 1023) == UNILOG_ERR_INVALID);  /* Not power of 2 */
     
+    /* Zeroed memory is used as is, without touching it */
+    static uint8_t zeroed[1024];
+    char read_buf[32];
+    unilog_level_t level;
+    uint32_t timestamp;
+    assert(unilog_init_zeroed(&log, zeroed, sizeof(zeroed)) == UNILOG_OK);
+    zeroed[sizeof(zeroed) - 1] = 0x5A;
+    assert(unilog_init_zeroed(&log, zeroed, sizeof(zeroed)) == UNILOG_OK);
+    assert(zeroed[sizeof(zeroed) - 1] == 0x5A);
+    zeroed[sizeof(zeroed) - 1] = 0;
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 7, "Lazy") == UNILOG_OK);
+    assert(unilog_read(&log, &level, &timestamp, read_buf, sizeof(read_buf)) == 4);
+    assert(timestamp == 7 && strcmp(read_buf, "Lazy") == 0);
+    assert(unilog_init_zeroed(&log, zeroed, 1000) == UNILOG_ERR_INVALID);
+    
     printf("✓ test_init passed\n");
 }
 
@@ -172,6 +188,45 @@ static void test_level_filtering(void) {
     printf("✓ test_level_filtering passed\n");
 }
 
+static void test_read_entry(void) {
+    uint8_t buffer[1024];
+    unilog_t log;
+    char read_buf[256];
+    unilog_entry_info_t info;
+    
+    unilog_init(&log, buffer, sizeof(buffer));
+    
+    assert(unilog_write(&log, UNILOG_LEVEL_WARN, 77, "Entry with info") == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 78, "Second entry") == UNILOG_OK);
+    
+    /* Read with metadata */
+    int len = unilog_read_entry(&log, &info, read_buf, sizeof(read_buf));
+    assert(len == (int)strlen("Entry with info"));
+    assert(info.level == UNILOG_LEVEL_WARN);
+    assert(info.timestamp == 77);
+    assert(strcmp(read_buf, "Entry with info") == 0);
+#if UNILOG_THREAD_INFO
+    /* Same thread for both entries, ID cached after the first one */
+    uint32_t thread_id = info.thread_id;
+    assert(thread_id != 0);
+#else
+    assert(info.thread_id == 0);
+    assert(info.cpu_id == UNILOG_CPU_UNKNOWN);
+#endif
+    
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 78);
+#if UNILOG_THREAD_INFO
+    assert(info.thread_id == thread_id);
+#endif
+    
+    /* Invalid parameters */
+    assert(unilog_read_entry(&log, NULL, read_buf, sizeof(read_buf)) == UNILOG_ERR_INVALID);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+    
+    printf("✓ test_read_entry passed\n");
+}
+
 static void test_level_names(void) {
     assert(strcmp(unilog_level_name(UNILOG_LEVEL_TRACE), "TRACE") == 0);
     assert(strcmp(unilog_level_name(UNILOG_LEVEL_DEBUG), "DEBUG") == 0);
@@ -183,6 +238,144 @@ static void test_level_names(void) {
     printf("✓ test_level_names passed\n");
 }
 
+static void test_crc32c(void) {
+    const char *check = "123456789";
+    
+    /* Standard check value for CRC-32C */
+    assert(unilog_crc32c(0, check, 9) == 0xE3069283);
+    assert(unilog_crc32c(0, check, 0) == 0);
+    
+    /* Continuing a CRC gives the same result as one call */
+    uint32_t crc = unilog_crc32c(0, check, 4);
+    assert(unilog_crc32c(crc, check + 4, 5) == 0xE3069283);
+    
+    printf("✓ test_crc32c passed\n");
+}
+
+static void test_recover(void) {
+    uint8_t buffer[256];
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+    uint32_t first_size = (sizeof(unilog_entry_header_t) + strlen("First") + 3) & ~3u;
+    
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 1, "First") == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 2, "Second") == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 3, "Third") == UNILOG_OK);
+    
+    /* Intact logs are left alone */
+    assert(unilog_recover(&log) == 0);
+    
+#if UNILOG_ENTRY_CRC
+    /* A damaged message becomes a gap that readers skip */
+    buffer[first_size + sizeof(unilog_entry_header_t)] ^= 0x20;
+    assert(unilog_recover(&log) == 1);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 1);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 3);
+    assert(strcmp(read_buf, "Third") == 0);
+#else
+    /* A torn entry truncates the log */
+    memset(buffer + first_size, 0, sizeof(uint32_t));
+    assert(unilog_recover(&log) == 1);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 1);
+#endif
+    assert(unilog_is_empty(&log));
+    
+    /* Logging continues normally */
+    assert(unilog_write(&log, UNILOG_LEVEL_WARN, 4, "After recovery") == UNILOG_OK);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 4);
+    
+    /* NONE is reserved for gaps */
+    assert(unilog_write(&log, UNILOG_LEVEL_NONE, 5, "Reserved") == UNILOG_ERR_INVALID);
+    
+    /* Damaged contexts are rejected */
+    log.buffer.capacity = 100;
+    assert(unilog_recover(&log) == UNILOG_ERR_INVALID);
+    assert(unilog_recover(NULL) == UNILOG_ERR_INVALID);
+    
+    printf("✓ test_recover passed\n");
+}
+
+static void test_logf(void) {
+    uint8_t buffer[256];
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+    
+    unilog_init(&log, buffer, sizeof(buffer));
+    UNILOG_LOGF(&log, UNILOG_LEVEL_WARN, 7, "plain");
+    UNILOG_LOGF(&log, UNILOG_LEVEL_INFO, 8, "%d of %s", 3, "sites");
+    
+    /* Disabled levels are dropped as with unilog_format */
+    unilog_set_level(&log, UNILOG_LEVEL_ERROR);
+    UNILOG_LOGF(&log, UNILOG_LEVEL_INFO, 9, "hidden %d", 1);
+    
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) == 5);
+    assert(info.timestamp == 7 && strcmp(read_buf, "plain") == 0);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 8 && strcmp(read_buf, "3 of sites") == 0);
+    assert(unilog_is_empty(&log));
+    
+    printf("✓ test_logf passed\n");
+}
+
+static void count_notify(void *ctx) {
+    (*(int *)ctx)++;
+}
+
+static void test_wait_async(void) {
+    uint8_t buffer[256];
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+    int notified = 0;
+    unilog_waiter_t waiter = { count_notify, &notified, 1 };
+    unilog_waiter_t other = { count_notify, &notified, 1 };
+    
+    unilog_init(&log, buffer, sizeof(buffer));
+    
+    /* Armed while empty; the next write notifies once and disarms */
+    assert(unilog_wait_async(&log, &waiter) == 1);
+    assert(unilog_wait_async(&log, &other) == UNILOG_ERR_BUSY);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 1, "Wake") == UNILOG_OK);
+    assert(notified == 1);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 2, "Again") == UNILOG_OK);
+    assert(notified == 1);
+    assert(!unilog_cancel_wait(&log, &waiter));
+    
+    /* Not armed while entries are there */
+    assert(unilog_wait_async(&log, &waiter) == 0);
+    while (unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) >= 0) {
+    }
+    
+    /* A watermark waits for enough bytes */
+    waiter.watermark = 3 * sizeof(unilog_entry_header_t);
+    assert(unilog_wait_async(&log, &waiter) == 1);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 3, "One") == UNILOG_OK);
+    assert(notified == 1);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 4, "Two") == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 5, "Three") == UNILOG_OK);
+    assert(notified == 2);
+    
+    /* Cancelled waiters are not notified */
+    waiter.watermark = sizeof(buffer);
+    assert(unilog_wait_async(&log, &waiter) == 1);
+    assert(unilog_cancel_wait(&log, &waiter));
+    assert(!unilog_cancel_wait(&log, &waiter));
+    assert(log.waiters == 0);
+    
+    waiter.watermark = 0;
+    assert(unilog_wait_async(&log, &waiter) == UNILOG_ERR_INVALID);
+    assert(unilog_wait_async(NULL, &waiter) == UNILOG_ERR_INVALID);
+    
+    printf("✓ test_wait_async passed\n");
+}
+
 int main(void) {
     printf("Running basic tests...\n\n");
     
@@ -193,7 +386,12 @@ int main(void) {
     test_raw_write();
     test_multiple_messages();
     test_level_filtering();
+    test_read_entry();
     test_level_names();
+    test_crc32c();
+    test_recover();
+    test_wait_async();
+    test_logf();
     
     printf("\n✓ All basic tests passed!\n");
     return 0;
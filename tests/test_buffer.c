@@ -148,6 +148,46 @@ static void test_alternating_write_read(void) {
     printf("✓ test_alternating_write_read passed\n");
 }
 
+static void test_peek(void) {
+    uint8_t buffer[256];
+    unilog_t log;
+    unilog_entry_info_t info;
+    unilog_span_t spans[2];
+    char expected[64];
+    char joined[64];
+    int wrapped = 0;
+    
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_peek(&log, &info, spans) == UNILOG_ERR_EMPTY);
+    assert(unilog_consume(&log) == UNILOG_ERR_EMPTY);
+    
+    /* Varying lengths move messages across the end of the ring */
+    for (int i = 0; i < 200; i++) {
+        int len = snprintf(expected, sizeof(expected), "Peek %d %.*s", i, i % 23,
+                           "abcdefghijklmnopqrstuvw");
+        assert(unilog_write(&log, UNILOG_LEVEL_INFO, (uint32_t)i, expected) == UNILOG_OK);
+        
+        int count = unilog_peek(&log, &info, spans);
+        assert(count == 1 || count == 2);
+        assert(info.timestamp == (uint32_t)i && info.level == UNILOG_LEVEL_INFO);
+        size_t total = 0;
+        for (int k = 0; k < count; k++) {
+            memcpy(joined + total, spans[k].data, spans[k].length);
+            total += spans[k].length;
+        }
+        assert(total == (size_t)len && memcmp(joined, expected, total) == 0);
+        wrapped += count == 2;
+        
+        /* Peeking again returns the same entry until it is consumed */
+        assert(unilog_peek(&log, &info, spans) == count && info.timestamp == (uint32_t)i);
+        assert(unilog_consume(&log) == UNILOG_OK);
+        assert(unilog_is_empty(&log));
+    }
+    assert(wrapped > 0);
+    
+    printf("✓ test_peek passed (%d wrapped)\n", wrapped);
+}
+
 int main(void) {
     printf("Running buffer management tests...\n\n");
     
@@ -157,6 +197,7 @@ int main(void) {
     test_large_message();
     test_truncated_read();
     test_alternating_write_read();
+    test_peek();
     
     printf("\n✓ All buffer tests passed!\n");
     return 0;
@@ -0,0 +1,239 @@
+/**
+ * @file test_capture.c
+ * @brief Request-scoped capture buffer tests for unilog
+ */
+
+#include <unilog/unilog_capture.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_THREADS 4
+#define REQUESTS_PER_THREAD 500
+#define ENTRIES_PER_REQUEST 5
+
+static void test_capture_discard_commit(void) {
+    static uint32_t storage[2][64];
+    unilog_capture_t captures[2];
+    unilog_capture_pool_t pool;
+    uint8_t buffer[1024];
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    unilog_set_level(&log, UNILOG_LEVEL_WARN);
+    assert(unilog_capture_pool_init(&pool, captures, 2, storage, sizeof(storage[0])) == UNILOG_OK);
+
+    /* A successful request: verbose entries are discarded */
+    unilog_capture_t *capture = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    assert(capture != NULL);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_TRACE, 1, "Parsing request") == UNILOG_OK);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_DEBUG, 2, "Cache miss") == UNILOG_OK);
+    unilog_capture_discard(capture);
+    assert(unilog_is_empty(&log));
+
+    /* A failed request: the batch is committed regardless of the log level */
+    capture = unilog_capture_begin(&pool, UNILOG_LEVEL_DEBUG);
+    assert(capture != NULL);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_TRACE, 3, "Below capture level") == UNILOG_OK);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_DEBUG, 4, "Cache miss") == UNILOG_OK);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_ERROR, 5, "Backend timeout") == UNILOG_OK);
+    assert(unilog_capture_commit(&log, capture) == UNILOG_OK);
+
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.level == UNILOG_LEVEL_DEBUG);
+    assert(info.timestamp == 4);
+    assert(strcmp(read_buf, "Cache miss") == 0);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 5);
+    assert(strcmp(read_buf, "Backend timeout") == 0);
+    assert(unilog_is_empty(&log));
+
+    /* Committing an empty capture just returns it */
+    capture = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    assert(unilog_capture_commit(&log, capture) == UNILOG_OK);
+    assert(unilog_is_empty(&log));
+
+    printf("✓ test_capture_discard_commit passed\n");
+}
+
+static void test_capture_pool(void) {
+    static uint32_t storage[2][16];
+    unilog_capture_t captures[2];
+    unilog_capture_pool_t pool;
+
+    assert(unilog_capture_pool_init(&pool, captures, 2, storage, sizeof(storage[0])) == UNILOG_OK);
+
+    unilog_capture_t *a = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    unilog_capture_t *b = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    assert(a != NULL && b != NULL && a != b);
+    assert(unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE) == NULL);
+
+    /* Full buffers count dropped entries */
+    while (unilog_capture_write(a, UNILOG_LEVEL_INFO, 0, "Fill") == UNILOG_OK) {
+    }
+    assert(a->dropped == 1);
+    assert(a->used <= a->size);
+
+    unilog_capture_discard(a);
+    unilog_capture_t *c = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    assert(c == a);
+    assert(c->used == 0 && c->dropped == 0);
+
+    /* Invalid parameters */
+    assert(unilog_capture_pool_init(&pool, captures, 2, storage, 6) == UNILOG_ERR_INVALID);
+    assert(unilog_capture_write(c, UNILOG_LEVEL_NONE, 0, "Reserved") == UNILOG_ERR_INVALID);
+
+    printf("✓ test_capture_pool passed\n");
+}
+
+static void test_capture_commit_limits(void) {
+    static uint32_t storage[1][64];
+    unilog_capture_t captures[1];
+    unilog_capture_pool_t pool;
+    uint8_t buffer[128];
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_capture_pool_init(&pool, captures, 1, storage, sizeof(storage[0])) == UNILOG_OK);
+
+    /* Batches that can never fit are rejected */
+    unilog_capture_t *capture = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    while (unilog_capture_write(capture, UNILOG_LEVEL_INFO, 0, "Too much") == UNILOG_OK) {
+    }
+    assert(unilog_capture_commit(&log, capture) == UNILOG_ERR_INVALID);
+    unilog_capture_discard(capture);
+
+    /* Move the log position close to the end, so the batch wraps */
+    for (int i = 0; i < 3; i++) {
+        assert(unilog_write(&log, UNILOG_LEVEL_INFO, 0, "Move along the ring") == UNILOG_OK);
+        assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) >= 0);
+    }
+
+    capture = unilog_capture_begin(&pool, UNILOG_LEVEL_TRACE);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_DEBUG, 1, "First of batch") == UNILOG_OK);
+    assert(unilog_capture_write(capture, UNILOG_LEVEL_DEBUG, 2, "Second of batch") == UNILOG_OK);
+
+    /* No room: the caller keeps the capture and can retry */
+    while (unilog_write(&log, UNILOG_LEVEL_INFO, 0, "Blocking the ring") == UNILOG_OK) {
+    }
+    assert(unilog_capture_commit(&log, capture) == UNILOG_ERR_FULL);
+    assert(atomic_load(&capture->in_use));
+    while (unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) >= 0) {
+    }
+
+    assert(unilog_capture_commit(&log, capture) == UNILOG_OK);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(strcmp(read_buf, "First of batch") == 0);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(strcmp(read_buf, "Second of batch") == 0);
+    assert(info.timestamp == 2);
+
+    printf("✓ test_capture_commit_limits passed\n");
+}
+
+static unilog_t g_log;
+static unilog_capture_pool_t g_pool;
+static _Atomic(int) g_committed;
+static _Atomic(int) g_producers_done;
+
+static void *request_thread(void *arg) {
+    int tid = (int)(size_t)arg;
+    char msg[32];
+
+    for (int r = 0; r < REQUESTS_PER_THREAD; r++) {
+        unilog_capture_t *capture;
+        while ((capture = unilog_capture_begin(&g_pool, UNILOG_LEVEL_TRACE)) == NULL) {
+        }
+
+        /* Timestamps identify the request, every third one fails */
+        uint32_t request = (uint32_t)(tid * REQUESTS_PER_THREAD + r);
+        for (int e = 0; e < ENTRIES_PER_REQUEST; e++) {
+            snprintf(msg, sizeof(msg), "Request %u step %d", request, e);
+            assert(unilog_capture_write(capture, UNILOG_LEVEL_TRACE, request, msg) == UNILOG_OK);
+        }
+        if (r % 3 == 0) {
+            while (unilog_capture_commit(&g_log, capture) == UNILOG_ERR_FULL) {
+            }
+            atomic_fetch_add(&g_committed, 1);
+        } else {
+            unilog_capture_discard(capture);
+        }
+
+        /* Unrelated direct writes interleave with the batches */
+        while (unilog_write(&g_log, UNILOG_LEVEL_ERROR, UINT32_MAX, "Direct") == UNILOG_ERR_FULL) {
+        }
+    }
+    atomic_fetch_add(&g_producers_done, 1);
+    return NULL;
+}
+
+static void test_capture_concurrent(void) {
+    static uint8_t buffer[4096];
+    static uint32_t storage[3][64];
+    unilog_capture_t captures[3];
+    pthread_t threads[NUM_THREADS];
+    unilog_entry_info_t info;
+    char read_buf[64];
+    int batches = 0;
+
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_capture_pool_init(&g_pool, captures, 3, storage, sizeof(storage[0])) == UNILOG_OK);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_create(&threads[i], NULL, request_thread, (void *)(size_t)i);
+    }
+
+    /* Entries of a committed request are contiguous and complete */
+    int step = 0;
+    uint32_t request = 0;
+    for (;;) {
+        bool done = atomic_load(&g_producers_done) == NUM_THREADS;
+        int len = unilog_read_entry(&g_log, &info, read_buf, sizeof(read_buf));
+        if (len < 0) {
+            if (done) {
+                break;
+            }
+            continue;
+        }
+        if (info.timestamp == UINT32_MAX) {
+            assert(step == 0);
+            continue;
+        }
+
+        char expected[32];
+        if (step == 0) {
+            request = info.timestamp;
+        }
+        assert(info.timestamp == request);
+        snprintf(expected, sizeof(expected), "Request %u step %d", request, step);
+        assert(strcmp(read_buf, expected) == 0);
+        if (++step == ENTRIES_PER_REQUEST) {
+            step = 0;
+            batches++;
+        }
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(step == 0);
+    assert(batches == atomic_load(&g_committed));
+
+    printf("✓ test_capture_concurrent passed (%d batches)\n", batches);
+}
+
+int main(void) {
+    printf("Running capture tests...\n\n");
+
+    test_capture_discard_commit();
+    test_capture_pool();
+    test_capture_commit_limits();
+    test_capture_concurrent();
+
+    printf("\n✓ All capture tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file test_cat.c
+ * @brief Tests of the unilog_cat tool
+ *
+ * Usage: test_cat UNILOG_CAT
+ */
+
+#include <unilog/unilog_intern.h>
+#include <unilog/unilog_segment.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define INPUT "test_cat_in.seg"
+#define OUTPUT "test_cat_out.seg"
+
+#define LIT(s) { s, sizeof(s) - 1, false }
+#define INTERN(s) { s, sizeof(s) - 1, true }
+
+static const char *g_cat;
+
+/* Archive a ring holding interned entries into INPUT */
+static void write_input(void) {
+    uint8_t buffer[1024];
+    unilog_t log;
+    unilog_intern_slot_t slots[4];
+    unilog_intern_t table;
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_entry_info_t info;
+    char raw[256];
+    int len;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 4) == UNILOG_OK);
+    const unilog_part_t login[] = { LIT("Login by "), INTERN("jane@example.com") };
+    const unilog_part_t logout[] = { INTERN("jane@example.com"), LIT(" left") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 1, login, 2) == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 2, logout, 2) == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 3, "Mail to bob@example.com") == UNILOG_OK);
+
+    FILE *file = fopen(INPUT, "wb");
+    assert(file);
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    while ((len = unilog_read_entry(&log, &info, raw, sizeof(raw))) >= 0) {
+        assert(unilog_segment_write(&writer, &info, raw, (size_t)len) == UNILOG_OK);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+    fclose(file);
+}
+
+static int run_cat(const char *args) {
+    char command[1024];
+    snprintf(command, sizeof(command), "\"%s\" %s", g_cat, args);
+    return system(command);
+}
+
+static void test_cat_archive_redacted(void) {
+    static const char *const expected[] = {
+        "Login by ****************",
+        "**************** left",
+        "Mail to ***************",
+    };
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    char message[256];
+
+    write_input();
+    assert(run_cat("-r -o " OUTPUT " " INPUT) == 0);
+
+    /* Interned entries are archived expanded, and masked like the others */
+    FILE *file = fopen(OUTPUT, "rb");
+    assert(file);
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    for (int i = 0; i < 3; i++) {
+        assert(unilog_segment_read(&reader, &info, message, sizeof(message)) >= 0);
+        assert(info.flags == 0);
+        assert(strcmp(message, expected[i]) == 0);
+        assert(!strstr(message, "@example.com"));
+    }
+    assert(unilog_segment_read(&reader, &info, message, sizeof(message)) == UNILOG_ERR_EMPTY);
+    fclose(file);
+
+    /* Without -r, definitions and references are kept as they are */
+    assert(run_cat("-o " OUTPUT " " INPUT) == 0);
+    file = fopen(OUTPUT, "rb");
+    assert(file);
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    assert(unilog_segment_read(&reader, &info, message, sizeof(message)) >= 0);
+    assert(info.flags == UNILOG_FLAG_DEFINITION);
+    fclose(file);
+
+    remove(INPUT);
+    remove(OUTPUT);
+    printf("✓ test_cat_archive_redacted passed\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s UNILOG_CAT\n", argv[0]);
+        return 1;
+    }
+    g_cat = argv[1];
+
+    printf("Running unilog_cat tests...\n\n");
+
+    test_cat_archive_redacted();
+
+    printf("\nAll unilog_cat tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,486 @@
+/**
+ * @file test_consumer.c
+ * @brief Managed consumer thread tests for unilog
+ */
+
+#define _GNU_SOURCE  /* sched_getcpu */
+
+#include <unilog/unilog_consumer.h>
+#include <unilog/unilog_intern.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define NUM_PRODUCERS 2
+#define MESSAGES_PER_PRODUCER 2000
+
+typedef struct {
+    int next[NUM_PRODUCERS];    /* Next expected message per producer */
+    int handled;
+    int batch_ends;
+    int wrong_cpu;
+    int expected_cpu;
+} sink_t;
+
+static unilog_t g_log;
+
+static void handle(void *ctx, const unilog_entry_info_t *info, const char *message,
+                   size_t length) {
+    sink_t *sink = (sink_t *)ctx;
+    int producer = (int)(info->timestamp / MESSAGES_PER_PRODUCER);
+    int index = (int)(info->timestamp % MESSAGES_PER_PRODUCER);
+    char expected[32];
+
+    /* Entries of each producer arrive complete and in order */
+    snprintf(expected, sizeof(expected), "Producer %d message %d", producer, index);
+    assert(length == strlen(expected) && memcmp(message, expected, length) == 0);
+    assert(sink->next[producer] == index);
+    sink->next[producer]++;
+    sink->handled++;
+
+#ifdef __linux__
+    if (sink->expected_cpu >= 0 && sched_getcpu() != sink->expected_cpu) {
+        sink->wrong_cpu++;
+    }
+#endif
+}
+
+static void batch_end(void *ctx) {
+    ((sink_t *)ctx)->batch_ends++;
+}
+
+static void *producer_thread(void *arg) {
+    int producer = (int)(size_t)arg;
+    for (int i = 0; i < MESSAGES_PER_PRODUCER; i++) {
+        while (unilog_format(&g_log, UNILOG_LEVEL_INFO,
+                             (uint32_t)(producer * MESSAGES_PER_PRODUCER + i),
+                             "Producer %d message %d", producer, i) == UNILOG_ERR_FULL) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void run_strategy(unilog_idle_t idle, int cpu) {
+    static uint8_t buffer[2048];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    pthread_t threads[NUM_PRODUCERS];
+    sink_t sink;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.expected_cpu = cpu;
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    unilog_consumer_config_init(&config, handle, &sink);
+    config.batch_end = batch_end;
+    config.idle = idle;
+    config.cpu = cpu;
+    config.max_batch = 32;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer_thread, (void *)(size_t)i);
+    }
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Stopping flushes everything written before */
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(sink.handled == NUM_PRODUCERS * MESSAGES_PER_PRODUCER);
+    assert(atomic_load(&consumer.entries) == (uint64_t)sink.handled);
+    assert(atomic_load(&consumer.batches) == (uint64_t)sink.batch_ends);
+    assert(consumer.batch <= config.max_batch);
+    assert(sink.wrong_cpu == 0);
+    assert(unilog_is_empty(&g_log));
+}
+
+static void test_consumer_strategies(void) {
+    run_strategy(UNILOG_IDLE_SPIN, -1);
+    run_strategy(UNILOG_IDLE_YIELD, -1);
+    run_strategy(UNILOG_IDLE_PARK, -1);
+    run_strategy(UNILOG_IDLE_WAIT, -1);
+
+    printf("✓ test_consumer_strategies passed\n");
+}
+
+static void test_consumer_pinned(void) {
+    run_strategy(UNILOG_IDLE_PARK, 0);
+
+    printf("✓ test_consumer_pinned passed\n");
+}
+
+static void test_consumer_wait(void) {
+    static uint8_t buffer[1024];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    sink_t sink;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.expected_cpu = -1;
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    unilog_consumer_config_init(&config, handle, &sink);
+    config.idle = UNILOG_IDLE_WAIT;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+
+    /* An idle consumer blocks instead of polling */
+    struct timespec delay = { 0, 200 * 1000000L };
+    nanosleep(&delay, NULL);
+    uint64_t sleeps = atomic_load(&consumer.sleeps);
+    assert(sleeps >= 1 && sleeps < 1000);
+
+    /* A producer wakes it */
+    assert(unilog_write(&g_log, UNILOG_LEVEL_INFO, 0, "Producer 0 message 0") == UNILOG_OK);
+    while (atomic_load(&consumer.entries) == 0) {
+        sched_yield();
+    }
+    assert(sink.handled == 1);
+
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_consumer_wait passed (%llu sleeps)\n", (unsigned long long)sleeps);
+}
+
+static void *helping_producer_thread(void *arg) {
+    unilog_set_thread_helping(true);
+    return producer_thread(arg);
+}
+
+static void test_consumer_helping(void) {
+    static uint8_t buffer[512];
+    char message[64];
+    char helper_message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    pthread_t threads[NUM_PRODUCERS];
+    sink_t sink;
+
+    /* Producers drain into the same sink; handle() checks that entries
+       still arrive in order, whoever drains them */
+    memset(&sink, 0, sizeof(sink));
+    sink.expected_cpu = -1;
+    unilog_helper_t helper = {
+        .sink = handle,
+        .ctx = &sink,
+        .buffer = helper_message,
+        .buffer_size = sizeof(helper_message),
+        .max_batch = 16,
+    };
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_set_helper(&g_log, &helper) == UNILOG_OK);
+    unilog_consumer_config_init(&config, handle, &sink);
+    config.idle = UNILOG_IDLE_PARK;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, helping_producer_thread, (void *)(size_t)i);
+    }
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(sink.handled == NUM_PRODUCERS * MESSAGES_PER_PRODUCER);
+    assert(atomic_load(&consumer.entries) + atomic_load(&helper.helped) ==
+           (uint64_t)sink.handled);
+    assert(unilog_is_empty(&g_log));
+
+    printf("✓ test_consumer_helping passed (helped: %u)\n", atomic_load(&helper.helped));
+}
+
+typedef struct {
+    char message[64];
+    int handled;
+} last_t;
+
+static void keep_last(void *ctx, const unilog_entry_info_t *info, const char *message,
+                      size_t length) {
+    last_t *last = (last_t *)ctx;
+    (void)info;
+    memcpy(last->message, message, length);
+    last->message[length] = '\0';
+    last->handled++;
+}
+
+static void test_consumer_redact(void) {
+    static uint8_t buffer[1024];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    unilog_redactor_t redactor;
+    last_t last = { "", 0 };
+
+    /* Messages are redacted before the handler sees them */
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_redactor_init(&redactor, UNILOG_REDACT_ALL) == UNILOG_OK);
+    unilog_consumer_config_init(&config, keep_last, &last);
+    config.redactor = &redactor;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_INFO, 0, "Login jo@example.com password=x1") ==
+           UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+
+    assert(last.handled == 1);
+    assert(strcmp(last.message, "Login ************** password=**") == 0);
+
+    printf("✓ test_consumer_redact passed\n");
+}
+
+typedef struct {
+    unilog_intern_map_t map;
+    const unilog_redactor_t *redactor;
+    last_t last;
+} expanding_t;
+
+/* Expand interned entries, then redact them, as the consumer leaves them alone */
+static void expand_redact(void *ctx, const unilog_entry_info_t *info, const char *message,
+                          size_t length) {
+    expanding_t *expanding = (expanding_t *)ctx;
+    last_t *last = &expanding->last;
+    int expanded = unilog_intern_process(&expanding->map, info, message, length,
+                                         last->message, sizeof(last->message));
+    if (expanded < 0) {
+        return;
+    }
+    if (info->flags & UNILOG_FLAG_INTERNED) {
+        unilog_redact(expanding->redactor, last->message, (size_t)expanded);
+    }
+    last->handled++;
+}
+
+static void test_consumer_redact_interned(void) {
+    static uint8_t buffer[1024];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    unilog_redactor_t redactor;
+    unilog_intern_slot_t slots[4];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[4];
+    char arena[64];
+    expanding_t expanding;
+
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_redactor_init(&redactor, UNILOG_REDACT_ALL) == UNILOG_OK);
+    assert(unilog_intern_init(&table, &g_log, slots, 4) == UNILOG_OK);
+    memset(&expanding, 0, sizeof(expanding));
+    assert(unilog_intern_map_init(&expanding.map, entries, 4, arena, sizeof(arena)) ==
+           UNILOG_OK);
+    expanding.redactor = &redactor;
+    unilog_consumer_config_init(&config, expand_redact, &expanding);
+    config.redactor = &redactor;
+
+    /* The reference after token= reaches the handler intact, and the
+       secret it stands for is masked once expanded */
+    const unilog_part_t token[] = { { "token=", 6, false }, { "s3cr3t", 6, true } };
+    const unilog_part_t login[] = { { "Login ", 6, false }, { "jo@example.com", 14, true } };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 0, token, 2) == UNILOG_OK);
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(expanding.last.handled == 1);
+    assert(strcmp(expanding.last.message, "token=******") == 0);
+
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 1, login, 2) == UNILOG_OK);
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(expanding.last.handled == 2);
+    assert(strcmp(expanding.last.message, "Login **************") == 0);
+
+    /* Definition records reach the handler as written */
+    uint32_t id, length;
+    assert(unilog_intern_id(&table, UNILOG_LEVEL_INFO, 2, "jo@example.com", 14, &id) ==
+           UNILOG_OK);
+    const char *text = unilog_intern_lookup(&expanding.map, id, &length);
+    assert(text && length == 14 && memcmp(text, "jo@example.com", 14) == 0);
+
+    printf("✓ test_consumer_redact_interned passed\n");
+}
+
+typedef struct {
+    int handled[UNILOG_LEVEL_NONE];
+    uint32_t oldest_debug;      /* Smallest DEBUG timestamp handled */
+} levels_t;
+
+static void count_level(void *ctx, const unilog_entry_info_t *info, const char *message,
+                        size_t length) {
+    levels_t *levels = (levels_t *)ctx;
+    (void)message;
+    (void)length;
+    levels->handled[info->level]++;
+    if (info->level == UNILOG_LEVEL_DEBUG && info->timestamp < levels->oldest_debug) {
+        levels->oldest_debug = info->timestamp;
+    }
+}
+
+static uint32_t fixed_clock(void *ctx) {
+    (void)ctx;
+    return 1000;
+}
+
+/* Fill the log, then drain it with the given budgets */
+static void run_shedding(uint32_t shed_fill, uint32_t shed_age, levels_t *levels,
+                         uint64_t shed[UNILOG_LEVEL_NONE]) {
+    static uint8_t buffer[1024];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+
+    memset(levels, 0, sizeof(*levels));
+    levels->oldest_debug = UINT32_MAX;
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    for (uint32_t i = 0; i < 20; i++) {
+        assert(unilog_write(&g_log, i % 4 == 3 ? UNILOG_LEVEL_WARN : UNILOG_LEVEL_DEBUG, i * 50,
+                            "Lagging entry") == UNILOG_OK);
+    }
+
+    unilog_consumer_config_init(&config, count_level, levels);
+    config.shed_fill = shed_fill;
+    config.shed_age = shed_age;
+    config.clock = fixed_clock;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(unilog_is_empty(&g_log));
+
+    for (int level = 0; level < UNILOG_LEVEL_NONE; level++) {
+        shed[level] = atomic_load(&consumer.shed[level]);
+    }
+    assert(atomic_load(&consumer.entries) == (uint64_t)(levels->handled[UNILOG_LEVEL_DEBUG] +
+                                                        levels->handled[UNILOG_LEVEL_WARN]));
+}
+
+static void test_consumer_shedding(void) {
+    levels_t levels;
+    uint64_t shed[UNILOG_LEVEL_NONE];
+
+    /* Over the fill budget, DEBUG entries are released without handling,
+       while every WARN entry is still handled */
+    run_shedding(256, 0, &levels, shed);
+    assert(levels.handled[UNILOG_LEVEL_WARN] == 5);
+    assert(shed[UNILOG_LEVEL_DEBUG] > 0 && shed[UNILOG_LEVEL_WARN] == 0);
+    assert(levels.handled[UNILOG_LEVEL_DEBUG] + shed[UNILOG_LEVEL_DEBUG] == 15);
+
+    /* Over the age budget: entries older than 500 are never handled */
+    run_shedding(0, 500, &levels, shed);
+    assert(levels.handled[UNILOG_LEVEL_WARN] == 5);
+    assert(levels.oldest_debug > 500);
+    assert(levels.handled[UNILOG_LEVEL_DEBUG] + shed[UNILOG_LEVEL_DEBUG] == 15);
+
+    /* Within budget, nothing is shed */
+    run_shedding(1024, 2000, &levels, shed);
+    assert(levels.handled[UNILOG_LEVEL_DEBUG] == 15 && shed[UNILOG_LEVEL_DEBUG] == 0);
+
+    printf("✓ test_consumer_shedding passed\n");
+}
+
+/* Expand every entry, keeping the last WARN entry */
+static void expand_warn(void *ctx, const unilog_entry_info_t *info, const char *message,
+                        size_t length) {
+    expanding_t *expanding = (expanding_t *)ctx;
+    char expanded[64];
+    if (unilog_intern_process(&expanding->map, info, message, length, expanded,
+                              sizeof(expanded)) < 0) {
+        return;
+    }
+    if (info->level == UNILOG_LEVEL_WARN) {
+        strcpy(expanding->last.message, expanded);
+        expanding->last.handled++;
+    }
+}
+
+static void test_consumer_shedding_interned(void) {
+    static uint8_t buffer[1024];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+    unilog_intern_slot_t slots[4];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[4];
+    char arena[64];
+    expanding_t expanding;
+
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &g_log, slots, 4) == UNILOG_OK);
+    memset(&expanding, 0, sizeof(expanding));
+    assert(unilog_intern_map_init(&expanding.map, entries, 4, arena, sizeof(arena)) ==
+           UNILOG_OK);
+
+    /* "sda" is defined by a DEBUG entry, which is shed, but its
+       definition must survive for the WARN entry referring to it */
+    const unilog_part_t probe[] = { { "Probing ", 8, false }, { "sda", 3, true } };
+    const unilog_part_t failing[] = { { "Disk ", 5, false }, { "sda", 3, true },
+                                      { " failing", 8, false } };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_DEBUG, 0, probe, 2) == UNILOG_OK);
+    for (uint32_t i = 1; i < 16; i++) {
+        assert(unilog_write(&g_log, UNILOG_LEVEL_DEBUG, i, "Lagging entry") == UNILOG_OK);
+    }
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_WARN, 16, failing, 3) == UNILOG_OK);
+
+    unilog_consumer_config_init(&config, expand_warn, &expanding);
+    config.shed_fill = 128;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_OK);
+    assert(unilog_consumer_stop(&consumer) == UNILOG_OK);
+    assert(unilog_is_empty(&g_log));
+
+    assert(atomic_load(&consumer.shed[UNILOG_LEVEL_DEBUG]) > 0);
+    assert(expanding.last.handled == 1);
+    assert(strcmp(expanding.last.message, "Disk sda failing") == 0);
+
+    printf("✓ test_consumer_shedding_interned passed\n");
+}
+
+static void test_consumer_invalid(void) {
+    static uint8_t buffer[256];
+    char message[64];
+    unilog_consumer_config_t config;
+    unilog_consumer_t consumer;
+
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    unilog_consumer_config_init(&config, NULL, NULL);
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_ERR_INVALID);
+
+    unilog_consumer_config_init(&config, handle, NULL);
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, 0) == UNILOG_ERR_INVALID);
+    config.max_batch = 0;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_ERR_INVALID);
+
+    /* An age budget needs a clock */
+    unilog_consumer_config_init(&config, handle, NULL);
+    config.shed_age = 100;
+    assert(unilog_consumer_start(&consumer, &g_log, &config, message, sizeof(message)) ==
+           UNILOG_ERR_INVALID);
+
+    printf("✓ test_consumer_invalid passed\n");
+}
+
+int main(void) {
+    printf("Running consumer tests...\n\n");
+
+    test_consumer_strategies();
+    test_consumer_pinned();
+    test_consumer_wait();
+    test_consumer_helping();
+    test_consumer_redact();
+    test_consumer_redact_interned();
+    test_consumer_shedding();
+    test_consumer_shedding_interned();
+    test_consumer_invalid();
+
+    printf("\n✓ All consumer tests passed!\n");
+    return 0;
+}
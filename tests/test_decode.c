@@ -0,0 +1,304 @@
+/**
+ * @file test_decode.c
+ * @brief Layout description and dump decoding tests for unilog
+ */
+
+#include <unilog/unilog_decode.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define MAX_ENTRIES 16
+
+typedef struct {
+    int count;
+    unilog_entry_info_t info[MAX_ENTRIES];
+    char message[MAX_ENTRIES][64];
+    bool in_scratch[MAX_ENTRIES];
+    const char *scratch;
+} collected_t;
+
+static int collect(void *ctx, const unilog_entry_info_t *info, const char *message, size_t length) {
+    collected_t *c = (collected_t *)ctx;
+    assert(c->count < MAX_ENTRIES);
+    assert(length < sizeof(c->message[0]));
+    c->info[c->count] = *info;
+    memcpy(c->message[c->count], message, length);
+    c->message[c->count][length] = '\0';
+    c->in_scratch[c->count] = message == c->scratch;
+    c->count++;
+    return 0;
+}
+
+/* Store a value in big-endian byte order */
+static void put_be(uint8_t *p, uint32_t value, int width) {
+    for (int i = 0; i < width; i++) {
+        p[i] = (uint8_t)(value >> (8 * (width - 1 - i)));
+    }
+}
+
+static void test_native_layout(void) {
+    unilog_layout_t layout;
+    unilog_get_layout(&layout);
+
+    assert(layout.header_size == sizeof(unilog_entry_header_t));
+    assert(layout.alignment == 4);
+    assert(layout.length_width == 4);
+    assert(layout.level_width == 4);
+    assert(unilog_layout_is_native(&layout));
+    assert(unilog_layout_is_supported(&layout));
+    unilog_decoder_t decoder;
+    assert(unilog_decoder_init(&decoder, &layout) == UNILOG_OK);
+    assert(decoder.native && !decoder.swap && decoder.words);
+
+    layout.byte_order = layout.byte_order == UNILOG_BYTE_ORDER_LITTLE ? UNILOG_BYTE_ORDER_BIG
+                                                                      : UNILOG_BYTE_ORDER_LITTLE;
+    assert(!unilog_layout_is_native(&layout));
+    assert(unilog_layout_is_supported(&layout));
+    assert(unilog_decoder_init(&decoder, &layout) == UNILOG_OK);
+    assert(!decoder.native && decoder.swap && decoder.words);
+
+    layout.alignment = 3;
+    assert(!unilog_layout_is_supported(&layout));
+    assert(unilog_decoder_init(&decoder, &layout) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_native_layout passed\n");
+}
+
+static void test_bswap(void) {
+    for (size_t count = 0; count < 11; count++) {
+        uint32_t words[11];
+        for (size_t i = 0; i < count; i++) {
+            words[i] = 0x01020304u + (uint32_t)i * 0x10101010u;
+        }
+        unilog_bswap32_array(words, count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t v = 0x01020304u + (uint32_t)i * 0x10101010u;
+            uint32_t expected = (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+            assert(words[i] == expected);
+        }
+    }
+
+    printf("✓ test_bswap passed\n");
+}
+
+static void test_dump_native(void) {
+    static uint8_t dump[sizeof(unilog_dump_header_t) + 128];
+    uint8_t *buffer = dump + sizeof(unilog_dump_header_t);
+    unilog_dump_header_t header;
+    unilog_t log;
+    char read_buf[64];
+    unilog_entry_info_t info;
+
+    assert(unilog_init(&log, buffer, 128) == UNILOG_OK);
+
+    /* Advance positions so the next message starts 8 bytes before the end,
+       using entries of header_size and header_size + 4 bytes */
+    uint32_t header_size = sizeof(unilog_entry_header_t);
+    uint32_t target = 128 - 8 - header_size;
+    uint32_t pos = 0;
+    while (pos < target) {
+        const char *filler = (target - pos) % (header_size + 4) == 0 ? "Fill" : "";
+        assert(unilog_write(&log, UNILOG_LEVEL_DEBUG, 0, filler) == UNILOG_OK);
+        assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) >= 0);
+        pos += header_size + strlen(filler);
+    }
+    assert(unilog_dump_header(&log, &header) == UNILOG_OK);
+    assert(header.write_pos == target);
+
+    assert(unilog_write(&log, UNILOG_LEVEL_ERROR, 42, "This message wraps around") == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 43, "After wrap") == UNILOG_OK);
+    assert(unilog_dump_header(&log, &header) == UNILOG_OK);
+    memcpy(dump, &header, sizeof(header));
+
+    char scratch[64];
+    collected_t c = { .scratch = scratch };
+    assert(unilog_decode_dump(dump, sizeof(dump), scratch, sizeof(scratch), collect, &c, NULL) == 2);
+    assert(c.info[0].level == UNILOG_LEVEL_ERROR);
+    assert(c.info[0].timestamp == 42);
+    assert(strcmp(c.message[0], "This message wraps around") == 0);
+    assert(c.in_scratch[0]);
+    assert(c.info[1].timestamp == 43);
+    assert(strcmp(c.message[1], "After wrap") == 0);
+    assert(!c.in_scratch[1]);
+
+    /* Wrapped messages are truncated to the scratch buffer */
+    c.count = 0;
+    assert(unilog_decode_dump(dump, sizeof(dump), scratch, 4, collect, &c, NULL) == 2);
+    assert(strcmp(c.message[0], "This") == 0);
+
+    /* Truncated dumps are rejected */
+    assert(unilog_decode_dump(dump, sizeof(dump) - 1, scratch, sizeof(scratch), collect, &c, NULL)
+           == UNILOG_ERR_INVALID);
+
+    printf("✓ test_dump_native passed\n");
+}
+
+static void test_dump_big_endian(void) {
+    /* Dump from a 32-bit big-endian target with thread info */
+    static uint8_t dump[sizeof(unilog_dump_header_t) + 64];
+    uint8_t *ring = dump + sizeof(unilog_dump_header_t);
+    unilog_dump_header_t header;
+
+    memcpy(header.magic, UNILOG_DUMP_MAGIC, 4);
+    header.layout.byte_order = UNILOG_BYTE_ORDER_BIG;
+    header.layout.alignment = 4;
+    header.layout.header_size = 20;
+    header.layout.variant = UNILOG_VARIANT_THREAD_INFO;
+    header.layout.length_width = 4;
+    header.layout.level_width = 4;
+    header.layout.timestamp_width = 4;
+    header.layout.id_width = 4;
+    memcpy(dump, &header, sizeof(header));
+    put_be(dump + offsetof(unilog_dump_header_t, capacity), 64, 4);
+    put_be(dump + offsetof(unilog_dump_header_t, read_pos), 0, 4);
+    put_be(dump + offsetof(unilog_dump_header_t, write_pos), 48, 4);
+
+    /* Two entries: 20 + 5 bytes (padded to 28), then 20 + 0 bytes */
+    put_be(ring + 0, 25, 4);
+    put_be(ring + 4, UNILOG_LEVEL_WARN, 4);
+    put_be(ring + 8, 0x12345678, 4);
+    put_be(ring + 12, 7, 4);
+    put_be(ring + 16, 1, 4);
+    memcpy(ring + 20, "hello", 5);
+    put_be(ring + 28, 20, 4);
+    put_be(ring + 32, UNILOG_LEVEL_FATAL, 4);
+    put_be(ring + 36, 99, 4);
+    put_be(ring + 40, 8, 4);
+    put_be(ring + 44, 0, 4);
+
+    collected_t c = { 0 };
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, NULL) == 2);
+    assert(c.info[0].level == UNILOG_LEVEL_WARN);
+    assert(c.info[0].timestamp == 0x12345678);
+    assert(c.info[0].thread_id == 7);
+    assert(c.info[0].cpu_id == 1);
+    assert(strcmp(c.message[0], "hello") == 0);
+    assert(c.info[1].level == UNILOG_LEVEL_FATAL);
+    assert(c.info[1].thread_id == 8);
+    assert(c.message[1][0] == '\0');
+
+    /* Decoding stops at an entry that was not yet committed */
+    put_be(ring + 28, 0, 4);
+    c.count = 0;
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, NULL) == 1);
+
+    printf("✓ test_dump_big_endian passed\n");
+}
+
+/* Store a value in little-endian byte order */
+static void put_le(uint8_t *p, uint32_t value, int width) {
+    for (int i = 0; i < width; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/* Build an entry with a 16-byte CRC header, returning its padded size */
+static uint32_t put_crc_entry(uint8_t *p, uint32_t level, uint32_t timestamp, const char *msg) {
+    uint32_t length = 16 + (uint32_t)strlen(msg);
+    put_le(p, length, 4);
+    put_le(p + 4, level, 4);
+    put_le(p + 8, timestamp, 4);
+    put_le(p + 12, 0, 4);
+    memcpy(p + 16, msg, strlen(msg));
+    put_le(p + 12, unilog_crc32c(0, p, length), 4);
+    return (length + 3) & ~3u;
+}
+
+static void test_dump_crc(void) {
+    /* Dump from a little-endian target with entry CRCs */
+    static uint8_t dump[sizeof(unilog_dump_header_t) + 128];
+    uint8_t *ring = dump + sizeof(unilog_dump_header_t);
+    unilog_dump_header_t header;
+    unilog_decode_stats_t stats;
+
+    memcpy(header.magic, UNILOG_DUMP_MAGIC, 4);
+    header.layout.byte_order = UNILOG_BYTE_ORDER_LITTLE;
+    header.layout.alignment = 4;
+    header.layout.header_size = 16;
+    header.layout.variant = UNILOG_VARIANT_CRC;
+    header.layout.length_width = 4;
+    header.layout.level_width = 4;
+    header.layout.timestamp_width = 4;
+    header.layout.id_width = 0;
+    memcpy(dump, &header, sizeof(header));
+
+    uint32_t pos = put_crc_entry(ring, UNILOG_LEVEL_INFO, 1, "first");
+    uint32_t second = pos;
+    pos += put_crc_entry(ring + pos, UNILOG_LEVEL_INFO, 2, "second entry");
+    pos += put_crc_entry(ring + pos, UNILOG_LEVEL_NONE, 0, "gap");
+    pos += put_crc_entry(ring + pos, UNILOG_LEVEL_ERROR, 3, "third");
+    put_le(dump + offsetof(unilog_dump_header_t, capacity), 128, 4);
+    put_le(dump + offsetof(unilog_dump_header_t, read_pos), 0, 4);
+    put_le(dump + offsetof(unilog_dump_header_t, write_pos), pos, 4);
+
+    collected_t c = { 0 };
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, &stats) == 3);
+    assert(stats.entries == 3);
+    assert(stats.corrupt == 0);
+    assert(strcmp(c.message[1], "second entry") == 0);
+
+    /* Corrupt entries are skipped, decoding resumes at the next intact one */
+    ring[second + 20] ^= 0x01;
+    c.count = 0;
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, &stats) == 2);
+    assert(strcmp(c.message[0], "first") == 0);
+    assert(strcmp(c.message[1], "third") == 0);
+    assert(c.info[1].level == UNILOG_LEVEL_ERROR);
+    assert(stats.corrupt == 1);
+    assert(stats.corrupt_bytes == 28);
+
+    /* An entry still being written at the end is not corruption */
+    put_le(ring + pos - 24, 0, 4);
+    c.count = 0;
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, &stats) == 1);
+    assert(stats.corrupt == 1);
+
+    printf("✓ test_dump_crc passed\n");
+}
+
+static void test_narrow_header(void) {
+    /* Compact little-endian header: 16-bit length, 8-bit level, 32-bit timestamp */
+    unilog_layout_t layout = {
+        UNILOG_BYTE_ORDER_LITTLE, 2, 8, 0, 2, 1, 4, 0
+    };
+    const uint8_t raw[8] = { 13, 0, UNILOG_LEVEL_INFO, 0x78, 0x56, 0x34, 0x12, 0 };
+    unilog_entry_info_t info;
+    uint32_t length;
+
+    assert(unilog_layout_is_supported(&layout));
+    assert(unilog_decode_header(&layout, raw, &length, &info) == UNILOG_OK);
+    assert(length == 13);
+    assert(info.level == UNILOG_LEVEL_INFO);
+    assert(info.timestamp == 0x12345678);
+    assert(info.thread_id == 0);
+    assert(info.cpu_id == UNILOG_CPU_UNKNOWN);
+
+    printf("✓ test_narrow_header passed\n");
+}
+
+static void test_dump_invalid(void) {
+    uint8_t dump[sizeof(unilog_dump_header_t) + 64] = { 0 };
+    collected_t c = { 0 };
+
+    assert(unilog_decode_dump(dump, sizeof(dump), NULL, 0, collect, &c, NULL) == UNILOG_ERR_INVALID);
+    assert(unilog_decode_dump(NULL, sizeof(dump), NULL, 0, collect, &c, NULL) == UNILOG_ERR_INVALID);
+    assert(unilog_decode_dump(dump, 4, NULL, 0, collect, &c, NULL) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_dump_invalid passed\n");
+}
+
+int main(void) {
+    printf("Running decode tests...\n\n");
+
+    test_native_layout();
+    test_bswap();
+    test_dump_native();
+    test_dump_big_endian();
+    test_dump_crc();
+    test_narrow_header();
+    test_dump_invalid();
+
+    printf("\n✓ All decode tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file test_flash.c
+ * @brief Flash log tests for unilog, on the flash simulator
+ */
+
+#define _POSIX_C_SOURCE 200809L  /* pwrite */
+
+#include <unilog/unilog_flash.h>
+#include <unilog/unilog_flash_sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define PATH "test_flash.bin"
+#define PAGE_SIZE 256
+#define SECTOR_SIZE 1024
+#define SECTORS 8
+
+static uint32_t page_buf[PAGE_SIZE / 4];
+static uint32_t read_page[PAGE_SIZE / 4];
+static uint32_t wear[SECTORS];
+
+static void open_sim(unilog_flash_sim_t *sim, bool fresh) {
+    if (fresh) {
+        remove(PATH);
+    }
+    assert(unilog_flash_sim_open(sim, PATH, PAGE_SIZE, SECTOR_SIZE, SECTORS, wear) ==
+           UNILOG_OK);
+}
+
+static void write_entry(unilog_flash_log_t *flog, uint32_t seq) {
+    char message[32];
+    unilog_entry_info_t info = { 0 };
+    info.level = UNILOG_LEVEL_INFO;
+    info.timestamp = seq;
+    int length = snprintf(message, sizeof(message), "Entry %u", seq);
+    assert(unilog_flash_write(flog, &info, message, (size_t)length) == UNILOG_OK);
+}
+
+/* Read everything, checking entries are consecutive; returns the count */
+static uint32_t read_all(const unilog_flash_log_t *flog, uint32_t *first, uint32_t *corrupt) {
+    unilog_flash_reader_t reader;
+    unilog_entry_info_t info;
+    const char *message;
+    char expected[32];
+    uint32_t count = 0;
+    int length;
+
+    assert(unilog_flash_reader_init(&reader, flog, read_page) == UNILOG_OK);
+    while ((length = unilog_flash_read(&reader, &info, &message)) >= 0) {
+        if (count == 0) {
+            *first = info.timestamp;
+        }
+        snprintf(expected, sizeof(expected), "Entry %u", info.timestamp);
+        assert(length == (int)strlen(expected));
+        assert(memcmp(message, expected, (size_t)length) == 0);
+        assert(info.level == UNILOG_LEVEL_INFO);
+        count++;
+    }
+    assert(length == UNILOG_ERR_EMPTY);
+    if (corrupt) {
+        *corrupt = reader.corrupt;
+    }
+    return count;
+}
+
+static void test_flash_roundtrip(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    uint32_t first = 0;
+
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 1) == UNILOG_OK);
+    assert(flog.head == 0 && flog.tail == 0);
+    assert(read_all(&flog, &first, NULL) == 0);
+
+    for (uint32_t i = 0; i < 40; i++) {
+        write_entry(&flog, i);
+    }
+    /* Buffered entries show up after a flush; a second flush writes nothing */
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    uint32_t pages = flog.pages_written;
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    assert(flog.pages_written == pages);
+    assert(read_all(&flog, &first, NULL) == 40);
+    assert(first == 0);
+
+    /* Long messages are cut to fit a page */
+    char big[PAGE_SIZE * 2];
+    memset(big, 'x', sizeof(big));
+    unilog_entry_info_t info = { 0 };
+    assert(unilog_flash_write(&flog, &info, big, sizeof(big)) == UNILOG_OK);
+    assert(flog.truncated == 1);
+    assert(sim.violations == 0);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_roundtrip passed\n");
+}
+
+static void test_flash_remount(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    uint32_t first = 0;
+
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    for (uint32_t i = 0; i < 100; i++) {
+        write_entry(&flog, i);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    uint32_t head = flog.head;
+    uint32_t sequence = flog.sequence;
+    unilog_flash_sim_close(&sim);
+
+    /* A power cycle finds the head, and the erased sectors ahead of it */
+    open_sim(&sim, false);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    assert(flog.head == head);
+    assert(flog.sequence == sequence);
+    assert(flog.ready > 0);
+    assert(read_all(&flog, &first, NULL) == 100);
+    assert(first == 0);
+
+    /* Writing carries on where it stopped */
+    for (uint32_t i = 100; i < 150; i++) {
+        write_entry(&flog, i);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    assert(read_all(&flog, &first, NULL) == 150);
+    assert(sim.violations == 0);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_remount passed\n");
+}
+
+static void test_flash_wrap(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    uint32_t first = 0;
+    const uint32_t total = 5000;
+
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    for (uint32_t i = 0; i < total; i++) {
+        write_entry(&flog, i);
+        unilog_flash_service(&flog);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+
+    /* Oldest sectors were erased: what is left is the newest entries */
+    uint32_t count = read_all(&flog, &first, NULL);
+    assert(count > 0 && count < total);
+    assert(first + count == total);
+
+    /* Every sector was erased about as often */
+    uint32_t low = UINT32_MAX, high = 0;
+    for (uint32_t s = 0; s < SECTORS; s++) {
+        low = wear[s] < low ? wear[s] : low;
+        high = wear[s] > high ? wear[s] : high;
+    }
+    assert(low > 0 && high - low <= 1);
+    assert(sim.violations == 0);
+    unilog_flash_sim_close(&sim);
+
+    /* And mounting after the wrap still finds head and tail */
+    open_sim(&sim, false);
+    uint32_t remount_first = 0;
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    assert(read_all(&flog, &remount_first, NULL) == count);
+    assert(remount_first == first);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_wrap passed (%u entries kept, wear %u-%u)\n", count, low, high);
+}
+
+static void test_flash_torn_page(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    uint32_t first = 0;
+    uint32_t corrupt = 0;
+
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 1) == UNILOG_OK);
+    for (uint32_t i = 0; i < 60; i++) {
+        write_entry(&flog, i);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    uint32_t before = read_all(&flog, &first, NULL);
+    unilog_flash_sim_close(&sim);
+
+    /* Clear bits in the second page, as an interrupted program would */
+    open_sim(&sim, false);
+    uint8_t zero = 0;
+    assert(pwrite(sim.fd, &zero, 1, PAGE_SIZE + 40) == 1);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 1) == UNILOG_OK);
+    uint32_t after = read_all(&flog, &first, &corrupt);
+    assert(corrupt == 1);
+    assert(after > 0 && after < before);
+    assert(first == 0);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_torn_page passed\n");
+}
+
+static void test_flash_erase_ahead(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+
+    /* Erases finish between pages when serviced while idle */
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    for (uint32_t i = 0; i < 3000; i++) {
+        write_entry(&flog, i);
+        unilog_flash_service(&flog);
+        unilog_flash_sim_advance(&sim, sim.erase_ns / 8);
+    }
+    assert(flog.erases > SECTORS);
+    assert(flog.stalls == 0);
+    uint64_t serviced_stall_ns = sim.stall_ns;
+    unilog_flash_sim_close(&sim);
+
+    /* Without servicing, every new sector waits for its erase */
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 2) == UNILOG_OK);
+    for (uint32_t i = 0; i < 3000; i++) {
+        write_entry(&flog, i);
+    }
+    assert(flog.stalls > 0);
+    assert(sim.stall_ns > serviced_stall_ns);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_erase_ahead passed\n");
+}
+
+static bool g_erase_fails;
+static unilog_result_t (*g_sim_erase)(void *ctx, uint32_t sector);
+
+static unilog_result_t failing_erase(void *ctx, uint32_t sector) {
+    return g_erase_fails ? UNILOG_ERR_INVALID : g_sim_erase(ctx, sector);
+}
+
+static void test_flash_erase_failure(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    unilog_entry_info_t info = { 0 };
+    char message[32];
+    uint32_t first = 0;
+    uint32_t seq = 0;
+    int length;
+
+    open_sim(&sim, true);
+    unilog_flash_dev_t dev = sim.dev;
+    g_sim_erase = dev.erase;
+    dev.erase = failing_erase;
+    g_erase_fails = true;
+    assert(unilog_flash_mount(&flog, &dev, page_buf, 1) == UNILOG_OK);
+
+    /* Fill the erased sectors; the page after them needs an erase */
+    info.level = UNILOG_LEVEL_INFO;
+    for (;; seq++) {
+        info.timestamp = seq;
+        length = snprintf(message, sizeof(message), "Entry %u", seq);
+        if (unilog_flash_write(&flog, &info, message, (size_t)length) != UNILOG_OK) {
+            break;
+        }
+    }
+    assert(flog.head % (SECTOR_SIZE / PAGE_SIZE) == 0 && flog.errors > 0);
+
+    /* The full page stays buffered, and further entries are refused */
+    uint32_t fill = flog.fill;
+    uint32_t head = flog.head;
+    for (int i = 0; i < 3; i++) {
+        assert(unilog_flash_write(&flog, &info, message, (size_t)length) ==
+               UNILOG_ERR_INVALID);
+        assert(flog.fill == fill && flog.head == head);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_ERR_INVALID);
+
+    /* Once the erase succeeds, the page and the refused entry are written */
+    g_erase_fails = false;
+    assert(unilog_flash_write(&flog, &info, message, (size_t)length) == UNILOG_OK);
+    for (seq++; seq < 100; seq++) {
+        write_entry(&flog, seq);
+    }
+    assert(unilog_flash_flush(&flog) == UNILOG_OK);
+    assert(read_all(&flog, &first, NULL) == 100);
+    assert(first == 0);
+    assert(sim.violations == 0);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_erase_failure passed\n");
+}
+
+static void test_flash_invalid(void) {
+    unilog_flash_sim_t sim;
+    unilog_flash_log_t flog;
+    unilog_flash_reader_t reader;
+
+    open_sim(&sim, true);
+    assert(unilog_flash_mount(NULL, &sim.dev, page_buf, 1) == UNILOG_ERR_INVALID);
+    assert(unilog_flash_mount(&flog, &sim.dev, NULL, 1) == UNILOG_ERR_INVALID);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 0) == UNILOG_ERR_INVALID);
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, SECTORS) == UNILOG_ERR_INVALID);
+
+    unilog_flash_dev_t dev = sim.dev;
+    dev.sector_size = PAGE_SIZE + 4;
+    assert(unilog_flash_mount(&flog, &dev, page_buf, 1) == UNILOG_ERR_INVALID);
+    dev = sim.dev;
+    dev.sector_count = 1;
+    assert(unilog_flash_mount(&flog, &dev, page_buf, 1) == UNILOG_ERR_INVALID);
+
+    assert(unilog_flash_mount(&flog, &sim.dev, page_buf, 1) == UNILOG_OK);
+    assert(unilog_flash_write(&flog, NULL, "x", 1) == UNILOG_ERR_INVALID);
+    assert(unilog_flash_reader_init(&reader, &flog, page_buf) == UNILOG_ERR_INVALID);
+
+    unilog_flash_sim_close(&sim);
+    remove(PATH);
+    printf("✓ test_flash_invalid passed\n");
+}
+
+int main(void) {
+    printf("Running flash tests...\n\n");
+
+    test_flash_roundtrip();
+    test_flash_remount();
+    test_flash_wrap();
+    test_flash_torn_page();
+    test_flash_erase_ahead();
+    test_flash_erase_failure();
+    test_flash_invalid();
+
+    printf("\nAll flash tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * @file test_intern.c
+ * @brief String interning tests for unilog
+ */
+
+#include <unilog/unilog_intern.h>
+#include <unilog/unilog_segment.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_THREADS 4
+#define MESSAGES_PER_THREAD 2000
+#define NUM_NAMES 8
+
+#define LIT(s) { s, sizeof(s) - 1, false }
+#define INTERN(s) { s, sizeof(s) - 1, true }
+
+/* Read the next entry and expand it, skipping definition records */
+static int read_expanded(unilog_t *log, unilog_intern_map_t *map, unilog_entry_info_t *info,
+                         char *out, size_t out_size) {
+    char raw[256];
+    for (;;) {
+        int len = unilog_read_entry(log, info, raw, sizeof(raw));
+        if (len < 0) {
+            return len;
+        }
+        int result = unilog_intern_process(map, info, raw, (size_t)len, out, out_size);
+        if (result != UNILOG_ERR_EMPTY) {
+            return result;
+        }
+    }
+}
+
+static void test_intern_basic(void) {
+    uint8_t buffer[1024];
+    unilog_t log;
+    unilog_intern_slot_t slots[16];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[16];
+    char arena[256];
+    unilog_intern_map_t map;
+    unilog_entry_info_t info;
+    char raw[256], out[256];
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 16) == UNILOG_OK);
+    assert(unilog_intern_map_init(&map, entries, 16, arena, sizeof(arena)) == UNILOG_OK);
+
+    const unilog_part_t parts[] = { LIT("Connected to "), INTERN("db-primary.internal") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 1, parts, 2) == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 2, parts, 2) == UNILOG_OK);
+
+    /* The first use writes a definition record */
+    int len = unilog_read_entry(&log, &info, raw, sizeof(raw));
+    assert(info.flags == UNILOG_FLAG_DEFINITION);
+    assert(info.level == UNILOG_LEVEL_INFO);
+    assert(len == 4 + (int)strlen("db-primary.internal"));
+    assert(unilog_intern_process(&map, &info, raw, (size_t)len, out, sizeof(out)) ==
+           UNILOG_ERR_EMPTY);
+
+    /* Both entries only carry a reference */
+    for (uint32_t ts = 1; ts <= 2; ts++) {
+        len = unilog_read_entry(&log, &info, raw, sizeof(raw));
+        assert(info.flags == UNILOG_FLAG_INTERNED);
+        assert(info.timestamp == ts);
+        assert(len == (int)strlen("Connected to ") + UNILOG_INTERN_REF_SIZE);
+        len = unilog_intern_process(&map, &info, raw, (size_t)len, out, sizeof(out));
+        assert(len == (int)strlen("Connected to db-primary.internal"));
+        assert(strcmp(out, "Connected to db-primary.internal") == 0);
+    }
+    assert(unilog_is_empty(&log));
+
+    /* A reader that missed the definition shows the ID */
+    unilog_intern_map_reset(&map);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_WARN, 3, parts, 2) == UNILOG_OK);
+    assert(read_expanded(&log, &map, &info, out, sizeof(out)) > 0);
+    assert(strncmp(out, "Connected to #", 14) == 0);
+
+    /* Filtered entries do not define anything */
+    unilog_set_level(&log, UNILOG_LEVEL_ERROR);
+    const unilog_part_t other[] = { INTERN("never defined") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 4, other, 1) == UNILOG_OK);
+    assert(unilog_is_empty(&log));
+
+    printf("✓ test_intern_basic passed\n");
+}
+
+static void test_intern_literal(void) {
+    uint8_t buffer[1024];
+    unilog_t log;
+    unilog_intern_slot_t slots[2];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[2];
+    char arena[128];
+    unilog_intern_map_t map;
+    unilog_entry_info_t info;
+    char out[256];
+    uint32_t id;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 2) == UNILOG_OK);
+    assert(unilog_intern_map_init(&map, entries, 2, arena, sizeof(arena)) == UNILOG_OK);
+
+    /* Escape bytes in literal text survive */
+    const unilog_part_t escaped[] = { LIT("a\x1a" "b"), INTERN("name") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 1, escaped, 2) == UNILOG_OK);
+    assert(read_expanded(&log, &map, &info, out, sizeof(out)) == 7);
+    assert(memcmp(out, "a\x1a" "bname", 7) == 0);
+
+    /* Without references, messages are stored as they are */
+    const unilog_part_t plain[] = { LIT("plain "), LIT("text") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 2, plain, 2) == UNILOG_OK);
+    assert(read_expanded(&log, &map, &info, out, sizeof(out)) == 10);
+    assert(info.flags == 0);
+    assert(strcmp(out, "plain text") == 0);
+
+    /* A full table falls back to literal text */
+    assert(unilog_intern_id(&table, UNILOG_LEVEL_INFO, 3, "second", 6, &id) == UNILOG_OK);
+    const unilog_part_t third[] = { INTERN("third") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, 4, third, 1) == UNILOG_OK);
+    assert(read_expanded(&log, &map, &info, out, sizeof(out)) == 5);
+    assert(info.flags == 0);
+    assert(strcmp(out, "third") == 0);
+    assert(unilog_intern_id(&table, UNILOG_LEVEL_INFO, 5, "third", 5, &id) == UNILOG_ERR_FULL);
+
+    /* Existing strings keep their ID */
+    uint32_t again;
+    assert(unilog_intern_id(&table, UNILOG_LEVEL_INFO, 6, "second", 6, &again) == UNILOG_OK);
+    assert(again == id);
+
+    /* Invalid parameters */
+    char big[UNILOG_INTERN_MAX_LENGTH + 1];
+    memset(big, 'x', sizeof(big));
+    assert(unilog_intern_id(&table, UNILOG_LEVEL_INFO, 0, big, sizeof(big), &id) ==
+           UNILOG_ERR_INVALID);
+    assert(unilog_intern_init(&table, &log, slots, 3) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_intern_literal passed\n");
+}
+
+static void test_intern_segment(void) {
+    uint8_t buffer[1024];
+    unilog_t log;
+    unilog_intern_slot_t slots[4];
+    unilog_intern_t table;
+    unilog_intern_entry_t entries[4];
+    char arena[128];
+    unilog_intern_map_t map;
+    unilog_entry_info_t info;
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    char raw[256], out[256];
+    int len;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 4) == UNILOG_OK);
+    assert(unilog_intern_map_init(&map, entries, 4, arena, sizeof(arena)) == UNILOG_OK);
+
+    const unilog_part_t parts[] = { INTERN("worker"), LIT(" started") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_DEBUG, 1, parts, 2) == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_ERROR, 2, parts, 2) == UNILOG_OK);
+
+    /* Archive the ring, entry flags are kept */
+    FILE *file = tmpfile();
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    while ((len = unilog_read_entry(&log, &info, raw, sizeof(raw))) >= 0) {
+        assert(unilog_segment_write(&writer, &info, raw, (size_t)len) == UNILOG_OK);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+
+    /* Compaction drops the debug entry, but keeps the definition it made */
+    FILE *compacted = tmpfile();
+    FILE *inputs[] = { file };
+    unilog_retention_t policy;
+    unilog_compactor_t compactor;
+    policy.now = 10;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = i >= UNILOG_LEVEL_ERROR ? UNILOG_RETAIN_FOREVER : 0;
+    }
+    assert(unilog_segment_writer_init(&writer, compacted, index, 4) == UNILOG_OK);
+    assert(unilog_compactor_init(&compactor, inputs, 1, &writer, &policy) == UNILOG_OK);
+    unilog_result_t res;
+    while ((res = unilog_compactor_step(&compactor, 16)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(compactor.kept == 2);
+    assert(compactor.dropped == 1);
+
+    assert(unilog_segment_reader_init(&reader, compacted) == UNILOG_OK);
+    len = unilog_segment_read(&reader, &info, raw, sizeof(raw));
+    assert(info.flags == UNILOG_FLAG_DEFINITION);
+    assert(unilog_intern_process(&map, &info, raw, (size_t)len, out, sizeof(out)) ==
+           UNILOG_ERR_EMPTY);
+    len = unilog_segment_read(&reader, &info, raw, sizeof(raw));
+    assert(info.level == UNILOG_LEVEL_ERROR);
+    assert(info.flags == UNILOG_FLAG_INTERNED);
+    assert(unilog_intern_process(&map, &info, raw, (size_t)len, out, sizeof(out)) > 0);
+    assert(strcmp(out, "worker started") == 0);
+    assert(unilog_segment_read(&reader, &info, raw, sizeof(raw)) == UNILOG_ERR_EMPTY);
+
+    fclose(file);
+    fclose(compacted);
+    printf("✓ test_intern_segment passed\n");
+}
+
+/* Write entries of one process interning name, at timestamps first and first + 2 */
+static FILE *archive_process(const char *name, uint32_t first) {
+    uint8_t buffer[512];
+    unilog_t log;
+    unilog_intern_slot_t slots[1];
+    unilog_intern_t table;
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_entry_info_t info;
+    char raw[256];
+    int len;
+
+    unilog_init(&log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&table, &log, slots, 1) == UNILOG_OK);
+    const unilog_part_t parts[] = { { name, strlen(name), true }, LIT(" ready") };
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, first, parts, 2) == UNILOG_OK);
+    assert(unilog_intern_write(&table, UNILOG_LEVEL_INFO, first + 2, parts, 1) == UNILOG_OK);
+
+    FILE *file = tmpfile();
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    while ((len = unilog_read_entry(&log, &info, raw, sizeof(raw))) >= 0) {
+        assert(unilog_segment_write(&writer, &info, raw, (size_t)len) == UNILOG_OK);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+    return file;
+}
+
+static void test_intern_merge(void) {
+    /* Both processes use ID 1, for different strings */
+    FILE *inputs[2] = { archive_process("alpha", 1), archive_process("bravo", 2) };
+    static const char *const expected[] = { "alpha ready", "bravo ready", "alpha", "bravo" };
+    unilog_intern_entry_t entries[2][4];
+    char arenas[2][64];
+    unilog_intern_map_t maps[2];
+    unilog_merge_source_t sources[2];
+    uint32_t heap[2];
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_merger_t merger;
+    unilog_entry_info_t info;
+    unilog_result_t res;
+    char raw[256];
+    for (int i = 0; i < 2; i++) {
+        assert(unilog_intern_map_init(&maps[i], entries[i], 4, arenas[i], sizeof(arenas[i])) ==
+               UNILOG_OK);
+    }
+
+    /* Without maps, interned inputs are refused */
+    FILE *output = tmpfile();
+    assert(unilog_segment_writer_init(&writer, output, index, 4) == UNILOG_OK);
+    assert(unilog_merger_init(&merger, inputs, NULL, NULL, 2, sources, heap, NULL, &writer) ==
+           UNILOG_OK);
+    assert(unilog_merger_step(&merger, 16) == UNILOG_ERR_INVALID);
+    fclose(output);
+
+    /* With maps, references are expanded with the strings of their own input */
+    output = tmpfile();
+    assert(unilog_segment_writer_init(&writer, output, index, 4) == UNILOG_OK);
+    assert(unilog_merger_init(&merger, inputs, NULL, NULL, 2, sources, heap, maps, &writer) ==
+           UNILOG_OK);
+    while ((res = unilog_merger_step(&merger, 16)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(merger.merged == 4);
+    assert(unilog_segment_reader_init(&reader, output) == UNILOG_OK);
+    for (int i = 0; i < 4; i++) {
+        int len = unilog_segment_read(&reader, &info, raw, sizeof(raw));
+        assert(len == (int)strlen(expected[i]) && strcmp(raw, expected[i]) == 0);
+        assert(info.flags == 0);
+        assert(info.timestamp == (uint32_t)i + 1);
+    }
+    assert(unilog_segment_read(&reader, &info, raw, sizeof(raw)) == UNILOG_ERR_EMPTY);
+    fclose(output);
+
+    /* A range after the definitions still resolves them */
+    uint32_t begin[2];
+    for (int i = 0; i < 2; i++) {
+        assert(unilog_segment_reader_init(&reader, inputs[i]) == UNILOG_OK);
+        assert(unilog_segment_find(&reader, 3) == UNILOG_OK);
+        begin[i] = reader.offset;
+        assert(begin[i] > 0);
+    }
+    output = tmpfile();
+    assert(unilog_segment_writer_init(&writer, output, index, 4) == UNILOG_OK);
+    assert(unilog_merger_init(&merger, inputs, begin, NULL, 2, sources, heap, maps, &writer) ==
+           UNILOG_OK);
+    while ((res = unilog_merger_step(&merger, 16)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(unilog_segment_reader_init(&reader, output) == UNILOG_OK);
+    for (int i = 2; i < 4; i++) {
+        assert(unilog_segment_read(&reader, &info, raw, sizeof(raw)) >= 0);
+        assert(strcmp(raw, expected[i]) == 0);
+    }
+    assert(unilog_segment_read(&reader, &info, raw, sizeof(raw)) == UNILOG_ERR_EMPTY);
+
+    fclose(output);
+    fclose(inputs[0]);
+    fclose(inputs[1]);
+    printf("✓ test_intern_merge passed\n");
+}
+
+static const char *g_names[NUM_NAMES] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"
+};
+static unilog_t g_log;
+static unilog_intern_t g_table;
+static _Atomic(int) g_producers_done;
+
+static void *producer_thread(void *arg) {
+    int tid = (int)(size_t)arg;
+
+    for (int i = 0; i < MESSAGES_PER_THREAD; i++) {
+        const char *name = g_names[(tid + i) % NUM_NAMES];
+        unilog_part_t parts[] = { LIT("Peer "), { name, strlen(name), true } };
+        while (unilog_intern_write(&g_table, UNILOG_LEVEL_INFO, (uint32_t)((tid + i) % NUM_NAMES),
+                                   parts, 2) == UNILOG_ERR_FULL) {
+            sched_yield();
+        }
+    }
+    atomic_fetch_add(&g_producers_done, 1);
+    return NULL;
+}
+
+static void test_intern_concurrent(void) {
+    static uint8_t buffer[4096];
+    unilog_intern_slot_t slots[16];
+    unilog_intern_entry_t entries[16];
+    char arena[256];
+    unilog_intern_map_t map;
+    pthread_t threads[NUM_THREADS];
+    unilog_entry_info_t info;
+    char raw[256], out[256];
+    int definitions = 0, count = 0;
+
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_intern_init(&g_table, &g_log, slots, 16) == UNILOG_OK);
+    assert(unilog_intern_map_init(&map, entries, 16, arena, sizeof(arena)) == UNILOG_OK);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_create(&threads[i], NULL, producer_thread, (void *)(size_t)i);
+    }
+
+    /* Every reference resolves, since definitions come first */
+    for (;;) {
+        bool done = atomic_load(&g_producers_done) == NUM_THREADS;
+        int len = unilog_read_entry(&g_log, &info, raw, sizeof(raw));
+        if (len < 0) {
+            if (done) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        len = unilog_intern_process(&map, &info, raw, (size_t)len, out, sizeof(out));
+        if (len == UNILOG_ERR_EMPTY) {
+            definitions++;
+            continue;
+        }
+        char expected[32];
+        snprintf(expected, sizeof(expected), "Peer %s", g_names[info.timestamp]);
+        assert(strcmp(out, expected) == 0);
+        count++;
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(count == NUM_THREADS * MESSAGES_PER_THREAD);
+    assert(definitions == NUM_NAMES);
+
+    printf("✓ test_intern_concurrent passed\n");
+}
+
+int main(void) {
+    printf("Running interning tests...\n\n");
+
+    test_intern_basic();
+    test_intern_literal();
+    test_intern_segment();
+    test_intern_merge();
+    test_intern_concurrent();
+
+    printf("\n✓ All interning tests passed!\n");
+    return 0;
+}
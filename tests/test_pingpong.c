@@ -0,0 +1,208 @@
+/**
+ * @file test_pingpong.c
+ * @brief Double-buffer mode tests for unilog
+ */
+
+#include <unilog/unilog_pingpong.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_THREADS 4
+#define MESSAGES_PER_THREAD 1000
+
+static void test_pingpong_basic(void) {
+    static uint32_t buffer[64];
+    unilog_pingpong_t pp;
+    unilog_block_t block;
+    unilog_entry_info_t info;
+    const char *message;
+    uint32_t offset = 0;
+
+    assert(unilog_pingpong_init(&pp, buffer, sizeof(buffer)) == UNILOG_OK);
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_ERR_EMPTY);
+
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 1, "First block") == UNILOG_OK);
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_WARN, 2, "Second") == UNILOG_OK);
+    assert(unilog_pingpong_used(&pp) > 0);
+
+    /* The filled half is handed off as one block */
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_OK);
+    assert(block.data == (const uint8_t *)buffer);
+    assert(unilog_pingpong_used(&pp) == 0);
+
+    int len = unilog_block_next(&block, &offset, &info, &message);
+    assert(len == (int)strlen("First block"));
+    assert(memcmp(message, "First block", len) == 0);
+    assert(info.level == UNILOG_LEVEL_INFO);
+    assert(info.timestamp == 1);
+    assert(unilog_block_next(&block, &offset, &info, &message) == (int)strlen("Second"));
+    assert(info.timestamp == 2);
+    assert(unilog_block_next(&block, &offset, &info, &message) == UNILOG_ERR_EMPTY);
+    assert(offset == block.size);
+
+    /* Producers continue in the other half meanwhile */
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 3, "Other half") == UNILOG_OK);
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_ERR_BUSY);
+    assert(unilog_pingpong_release(&pp) == UNILOG_OK);
+    assert(unilog_pingpong_release(&pp) == UNILOG_ERR_INVALID);
+
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_OK);
+    assert(block.data == (const uint8_t *)buffer + sizeof(buffer) / 2);
+    offset = 0;
+    assert(unilog_block_next(&block, &offset, &info, &message) == (int)strlen("Other half"));
+    assert(info.timestamp == 3);
+    assert(unilog_pingpong_release(&pp) == UNILOG_OK);
+
+    printf("✓ test_pingpong_basic passed\n");
+}
+
+static void test_pingpong_full(void) {
+    static uint32_t buffer[32];
+    unilog_pingpong_t pp;
+    unilog_block_t block;
+    int written = 0;
+
+    assert(unilog_pingpong_init(&pp, buffer, sizeof(buffer)) == UNILOG_OK);
+    while (unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 0, "Fill") == UNILOG_OK) {
+        written++;
+    }
+    assert(written > 0);
+    assert(unilog_pingpong_used(&pp) <= sizeof(buffer) / 2);
+
+    /* Entries larger than a half are rejected */
+    char big[sizeof(buffer)];
+    memset(big, 'x', sizeof(big));
+    assert(unilog_pingpong_write_raw(&pp, UNILOG_LEVEL_INFO, 0, big, sizeof(big))
+           == UNILOG_ERR_INVALID);
+
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_OK);
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 0, "Fill") == UNILOG_OK);
+    assert(unilog_pingpong_release(&pp) == UNILOG_OK);
+
+    /* Invalid parameters */
+    assert(unilog_pingpong_init(&pp, buffer, 12) == UNILOG_ERR_INVALID);
+    assert(unilog_pingpong_init(NULL, buffer, sizeof(buffer)) == UNILOG_ERR_INVALID);
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_NONE, 0, "Reserved") == UNILOG_ERR_INVALID);
+
+    printf("✓ test_pingpong_full passed\n");
+}
+
+static void test_pingpong_in_flight(void) {
+    static uint32_t buffer[64];
+    unilog_pingpong_t pp;
+    unilog_block_t block;
+
+    assert(unilog_pingpong_init(&pp, buffer, sizeof(buffer)) == UNILOG_OK);
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 0, "Committed") == UNILOG_OK);
+
+    /* Simulate a producer that reserved space but was interrupted */
+    atomic_fetch_add(&pp.writers[0], 1);
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_ERR_BUSY);
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_ERR_BUSY);
+
+    /* New entries go to the other half while the swap waits */
+    assert(unilog_pingpong_write(&pp, UNILOG_LEVEL_INFO, 0, "New half") == UNILOG_OK);
+    assert(atomic_load(&pp.fill[1]) > 0);
+
+    atomic_fetch_sub(&pp.writers[0], 1);
+    assert(unilog_pingpong_swap(&pp, &block) == UNILOG_OK);
+    assert(block.data == (const uint8_t *)buffer);
+    assert(unilog_pingpong_release(&pp) == UNILOG_OK);
+
+    printf("✓ test_pingpong_in_flight passed\n");
+}
+
+static unilog_pingpong_t g_pp;
+static _Atomic(int) g_write_count;
+
+static void *producer_thread(void *arg) {
+    int tid = (int)(size_t)arg;
+    char msg[32];
+
+    for (int i = 0; i < MESSAGES_PER_THREAD; i++) {
+        snprintf(msg, sizeof(msg), "Thread %d message %d", tid, i);
+        while (unilog_pingpong_write(&g_pp, UNILOG_LEVEL_INFO, tid, msg) == UNILOG_ERR_FULL) {
+            sched_yield();  /* Wait for the consumer to swap */
+        }
+        atomic_fetch_add(&g_write_count, 1);
+    }
+    return NULL;
+}
+
+/* Check all entries of a block, returning their number */
+static int consume_block(const unilog_block_t *block, int *next) {
+    unilog_entry_info_t info;
+    const char *message;
+    uint32_t offset = 0;
+    int count = 0;
+    int len;
+
+    while ((len = unilog_block_next(block, &offset, &info, &message)) >= 0) {
+        char expected[32];
+        int tid = (int)info.timestamp;
+        assert(tid >= 0 && tid < NUM_THREADS);
+        snprintf(expected, sizeof(expected), "Thread %d message %d", tid, next[tid]++);
+        assert(len == (int)strlen(expected));
+        assert(memcmp(message, expected, len) == 0);
+        count++;
+    }
+    assert(len == UNILOG_ERR_EMPTY);
+    return count;
+}
+
+static void test_pingpong_threads(void) {
+    static uint32_t buffer[256];
+    pthread_t threads[NUM_THREADS];
+    unilog_block_t block;
+    int next[NUM_THREADS] = { 0 };
+    int read_count = 0;
+    int blocks = 0;
+
+    assert(unilog_pingpong_init(&g_pp, buffer, sizeof(buffer)) == UNILOG_OK);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_create(&threads[i], NULL, producer_thread, (void *)(size_t)i);
+    }
+
+    /* Consume until all producers are done and the buffer is drained */
+    for (;;) {
+        bool done = atomic_load(&g_write_count) == NUM_THREADS * MESSAGES_PER_THREAD;
+        unilog_result_t res = unilog_pingpong_swap(&g_pp, &block);
+        if (res == UNILOG_OK) {
+            read_count += consume_block(&block, next);
+            assert(unilog_pingpong_release(&g_pp) == UNILOG_OK);
+            blocks++;
+        } else if (res == UNILOG_ERR_EMPTY && done) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Every message arrives exactly once, in per-thread order */
+    assert(read_count == NUM_THREADS * MESSAGES_PER_THREAD);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        assert(next[i] == MESSAGES_PER_THREAD);
+    }
+    assert(blocks > 1);
+
+    printf("✓ test_pingpong_threads passed (%d blocks)\n", blocks);
+}
+
+int main(void) {
+    printf("Running ping-pong tests...\n\n");
+
+    test_pingpong_basic();
+    test_pingpong_full();
+    test_pingpong_in_flight();
+    test_pingpong_threads();
+
+    printf("\n✓ All ping-pong tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_redact.c
+ * @brief Redaction tests for unilog
+ */
+
+#include <unilog/unilog_redact.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+static unilog_redactor_t g_redactor;
+
+/* Redact a copy of text and compare with the expected result */
+static void check(const char *text, const char *expected, uint32_t items) {
+    char buffer[256];
+    size_t length = strlen(text);
+    memcpy(buffer, text, length + 1);
+    uint32_t count = unilog_redact(&g_redactor, buffer, length);
+    if (strcmp(buffer, expected) != 0 || count != items) {
+        printf("  \"%s\" -> \"%s\" (%u)\n", text, buffer, count);
+    }
+    assert(strcmp(buffer, expected) == 0);
+    assert(count == items);
+}
+
+static void test_redact_email(void) {
+    assert(unilog_redactor_init(&g_redactor, UNILOG_REDACT_EMAIL) == UNILOG_OK);
+
+    check("Login by jane.doe+test@example.co.uk failed",
+          "Login by *************************** failed", 1);
+    check("a@b.c,x@y.z", "*****,*****", 2);
+    check("Mail to <ops@corp.example.com>.", "Mail to <********************>.", 1);
+
+    /* Not addresses */
+    check("@mention and user@localhost", "@mention and user@localhost", 0);
+    check("trailing@", "trailing@", 0);
+    check("x@.com", "x@.com", 0);
+
+    printf("✓ test_redact_email passed\n");
+}
+
+static void test_redact_card(void) {
+    assert(unilog_redactor_init(&g_redactor, UNILOG_REDACT_CARD) == UNILOG_OK);
+
+    check("card 4111111111111111 ok", "card **************** ok", 1);
+    check("card=4111 1111 1111 1111", "card=**** **** **** ****", 1);
+    check("5500-0000-0000-0004.", "****-****-****-****.", 1);
+    check("378282246310005", "***************", 1);
+
+    /* Failing Luhn, wrong lengths, or part of a word */
+    check("id 4111111111111112", "id 4111111111111112", 0);
+    check("ts 123456789012", "ts 123456789012", 0);
+    check("41111111111111111111111", "41111111111111111111111", 0);
+    check("x4111111111111111", "x4111111111111111", 0);
+    check("4111111111111111x", "4111111111111111x", 0);
+
+    printf("✓ test_redact_card passed\n");
+}
+
+static void test_redact_secrets(void) {
+    assert(unilog_redactor_init(&g_redactor, UNILOG_REDACT_SECRETS) == UNILOG_OK);
+
+    check("user=bob password=hunter2 retry=1", "user=bob password=******* retry=1", 1);
+    check("Authorization: Bearer eyJhbGciOi.x", "Authorization: Bearer ************", 1);
+    check("?TOKEN=abc&next=1", "?TOKEN=***&next=1", 1);
+    check("password= empty", "password= empty", 0);
+
+    /* Custom keywords */
+    assert(unilog_redactor_add_keyword(&g_redactor, "session=") == UNILOG_OK);
+    check("session=42;path=/", "session=**;path=/", 1);
+    assert(unilog_redactor_add_keyword(&g_redactor, "s") == UNILOG_ERR_INVALID);
+    while (g_redactor.keyword_count < UNILOG_REDACT_MAX_KEYWORDS) {
+        assert(unilog_redactor_add_keyword(&g_redactor, "key=") == UNILOG_OK);
+    }
+    assert(unilog_redactor_add_keyword(&g_redactor, "key=") == UNILOG_ERR_FULL);
+    assert(unilog_redactor_init(&g_redactor, 0x80) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_redact_secrets passed\n");
+}
+
+static void test_redact_offsets(void) {
+    char text[96];
+    char expected[96];
+    const char *items[] = { "bob@example.org", "4111111111111111", "token=abcdef" };
+    const char *masked[] = { "***************", "****************", "token=******" };
+
+    /* Every item at every offset, across the 16-byte blocks of the prefilter */
+    assert(unilog_redactor_init(&g_redactor, UNILOG_REDACT_ALL) == UNILOG_OK);
+    for (size_t item = 0; item < 3; item++) {
+        size_t item_length = strlen(items[item]);
+        for (size_t offset = 0; offset + item_length < 64; offset++) {
+            size_t total = offset + item_length + (offset % 7);
+            memset(text, 'z', total);
+            memset(text, ' ', offset);
+            memcpy(text + offset, items[item], item_length);
+            if (offset + item_length < total) {
+                text[offset + item_length] = ' ';
+            }
+            text[total] = '\0';
+            memcpy(expected, text, total + 1);
+            memcpy(expected + offset, masked[item], item_length);
+            check(text, expected, 1);
+        }
+    }
+
+    printf("✓ test_redact_offsets passed\n");
+}
+
+static void test_redact_throughput(void) {
+    static char text[1 << 20];
+    const char *line = "[1234] INFO: request 42 from 10.0.0.7 served in 3.5 ms, status 200\n";
+    size_t line_length = strlen(line);
+    size_t length = 0;
+    while (length + line_length <= sizeof(text)) {
+        memcpy(text + length, line, line_length);
+        length += line_length;
+    }
+
+    assert(unilog_redactor_init(&g_redactor, UNILOG_REDACT_ALL) == UNILOG_OK);
+    clock_t start = clock();
+    uint32_t count = 0;
+    for (int round = 0; round < 20; round++) {
+        count += unilog_redact(&g_redactor, text, length);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    assert(count == 0);
+
+    printf("✓ test_redact_throughput passed (%.0f MB/s)\n",
+           seconds > 0 ? 20.0 * (double)length / seconds / 1e6 : 0.0);
+}
+
+int main(void) {
+    printf("Running redaction tests...\n\n");
+
+    test_redact_email();
+    test_redact_card();
+    test_redact_secrets();
+    test_redact_offsets();
+    test_redact_throughput();
+
+    printf("\n✓ All redaction tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file test_resize.c
+ * @brief Online resize tests for unilog
+ */
+
+#include <unilog/unilog.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static void test_resize_order(void) {
+    static uint8_t small[256];
+    static uint8_t large[1024];
+    unilog_t log;
+    unilog_entry_info_t info;
+    char read_buf[512];
+    char expected[32];
+    void *old = NULL;
+
+    assert(unilog_init(&log, small, sizeof(small)) == UNILOG_OK);
+    for (uint32_t i = 0; i < 4; i++) {
+        snprintf(expected, sizeof(expected), "Before %u", i);
+        assert(unilog_write(&log, UNILOG_LEVEL_INFO, i, expected) == UNILOG_OK);
+    }
+    uint32_t before = unilog_available(&log);
+
+    /* Nothing to take back yet */
+    assert(unilog_resize_finish(&log, &old) == UNILOG_ERR_INVALID);
+    assert(unilog_resize(&log, large, 1000) == UNILOG_ERR_INVALID);
+    assert(unilog_resize(NULL, large, sizeof(large)) == UNILOG_ERR_INVALID);
+
+    assert(unilog_resize(&log, large, sizeof(large)) == UNILOG_OK);
+    assert(unilog_resize(&log, small, sizeof(small)) == UNILOG_ERR_BUSY);
+    assert(unilog_available(&log) == before);
+
+    /* New entries go to the new ring, entries too large for the old one fit */
+    char big[300];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 4, big) == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 5, "After") == UNILOG_OK);
+    assert(unilog_available(&log) > before);
+
+    /* The old ring is read first, in order */
+    for (uint32_t i = 0; i < 4; i++) {
+        assert(unilog_resize_finish(&log, &old) == UNILOG_ERR_BUSY);
+        snprintf(expected, sizeof(expected), "Before %u", i);
+        assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) ==
+               (int)strlen(expected));
+        assert(info.timestamp == i);
+        assert(strcmp(read_buf, expected) == 0);
+    }
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) == (int)strlen(big));
+    assert(info.timestamp == 4);
+    assert(unilog_resize_finish(&log, &old) == UNILOG_OK);
+    assert(old == small);
+    assert(unilog_resize_finish(&log, &old) == UNILOG_ERR_INVALID);
+
+    /* Shrink back: the remaining entry moves over, large ones are rejected */
+    assert(unilog_resize(&log, small, sizeof(small)) == UNILOG_OK);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 6, big) == UNILOG_ERR_INVALID);
+    assert(unilog_write(&log, UNILOG_LEVEL_INFO, 7, "Small again") == UNILOG_OK);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 5);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 7);
+    assert(unilog_is_empty(&log));
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+    assert(unilog_resize_finish(&log, &old) == UNILOG_OK);
+    assert(old == large);
+
+    /* An empty log switches on the next read */
+    assert(unilog_resize(&log, large, sizeof(large)) == UNILOG_OK);
+    assert(unilog_resize_finish(&log, &old) == UNILOG_ERR_BUSY);
+    assert(unilog_read_entry(&log, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+    assert(unilog_resize_finish(&log, &old) == UNILOG_OK);
+    assert(old == small);
+
+    printf("✓ test_resize_order passed\n");
+}
+
+#define PRODUCERS 4
+#define PER_PRODUCER 20000
+
+typedef struct {
+    unilog_t *log;
+    uint32_t id;
+} producer_t;
+
+static void *producer_main(void *arg) {
+    producer_t *producer = (producer_t *)arg;
+    char message[64];
+
+    for (uint32_t i = 0; i < PER_PRODUCER; i++) {
+        snprintf(message, sizeof(message), "%u %u", producer->id, i);
+        unilog_result_t result;
+        while ((result = unilog_write(producer->log, UNILOG_LEVEL_INFO, i, message)) ==
+               UNILOG_ERR_FULL) {
+            sched_yield();
+        }
+        assert(result == UNILOG_OK);
+    }
+    return NULL;
+}
+
+static void test_resize_concurrent(void) {
+    static uint8_t buffers[2][16384];
+    static const uint32_t capacities[] = { 512, 16384, 2048, 8192, 1024, 16384 };
+    unilog_t log;
+    unilog_entry_info_t info;
+    char read_buf[64];
+    uint32_t next[PRODUCERS] = { 0 };
+    uint32_t read = 0;
+
+    assert(unilog_init(&log, buffers[0], 256) == UNILOG_OK);
+    producer_t producers[PRODUCERS];
+    pthread_t threads[PRODUCERS];
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        producers[p].log = &log;
+        producers[p].id = p;
+        assert(pthread_create(&threads[p], NULL, producer_main, &producers[p]) == 0);
+    }
+
+    /* Resize repeatedly while reading: no entry is lost or reordered */
+    uint32_t resizes = 0;
+    uint32_t next_resize = 1000;
+    bool pending = false;
+    while (read < PRODUCERS * PER_PRODUCER) {
+        int len = unilog_read_entry(&log, &info, read_buf, sizeof(read_buf));
+        if (len >= 0) {
+            uint32_t id, seq;
+            assert(sscanf(read_buf, "%u %u", &id, &seq) == 2);
+            assert(id < PRODUCERS && seq == next[id] && info.timestamp == seq);
+            next[id]++;
+            read++;
+        } else {
+            assert(len == UNILOG_ERR_EMPTY || len == UNILOG_ERR_BUSY);
+            sched_yield();
+        }
+
+        void *old;
+        if (pending && unilog_resize_finish(&log, &old) == UNILOG_OK) {
+            pending = false;
+        }
+        if (!pending && read >= next_resize &&
+            resizes < sizeof(capacities) / sizeof(capacities[0])) {
+            /* Any buffer the log does not hold */
+            uint32_t b = 0;
+            while (buffers[b] == log.buffer.buffer || buffers[b] == log.spare.buffer) {
+                b++;
+            }
+            assert(unilog_resize(&log, buffers[b], capacities[resizes]) == UNILOG_OK);
+            resizes++;
+            next_resize += 4096;
+            pending = true;
+        }
+    }
+
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    assert(resizes == sizeof(capacities) / sizeof(capacities[0]));
+    assert(unilog_is_empty(&log));
+
+    printf("✓ test_resize_concurrent passed (%u resizes)\n", resizes);
+}
+
+int main(void) {
+    printf("Running resize tests...\n\n");
+
+    test_resize_order();
+    test_resize_concurrent();
+
+    printf("\nAll resize tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,468 @@
+/**
+ * @file test_segment.c
+ * @brief Segment file and compaction tests for unilog
+ */
+
+#include <unilog/unilog_segment.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static void write_entry(unilog_segment_writer_t *writer, unilog_level_t level,
+                        uint32_t timestamp, const char *message) {
+    unilog_entry_info_t info = { level, timestamp, 0, UNILOG_CPU_UNKNOWN, 0 };
+    assert(unilog_segment_write(writer, &info, message, strlen(message)) == UNILOG_OK);
+}
+
+static void test_segment_roundtrip(void) {
+    FILE *file = tmpfile();
+    unilog_segment_index_t index[16];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    char read_buf[256];
+
+    assert(unilog_segment_writer_init(&writer, file, index, 16) == UNILOG_OK);
+    for (int i = 0; i < 10; i++) {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "Segment message %d", i);
+        write_entry(&writer, UNILOG_LEVEL_INFO, 100 + i, msg);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    assert(reader.header.entry_count == 10);
+    assert(reader.header.ts_min == 100);
+    assert(reader.header.ts_max == 109);
+
+    for (int i = 0; i < 10; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "Segment message %d", i);
+        int len = unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf));
+        assert(len == (int)strlen(expected));
+        assert(info.level == UNILOG_LEVEL_INFO);
+        assert(info.timestamp == (uint32_t)(100 + i));
+        assert(strcmp(read_buf, expected) == 0);
+    }
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+
+    fclose(file);
+    printf("✓ test_segment_roundtrip passed\n");
+}
+
+static void test_segment_index(void) {
+    FILE *file = tmpfile();
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    char read_buf[256];
+
+    /* Index fills up and gets sparser as entries are added */
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    for (int i = 0; i < 100; i++) {
+        write_entry(&writer, UNILOG_LEVEL_DEBUG, i * 10, "Indexed entry");
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+    assert(writer.header.index_count <= 4);
+    assert(writer.header.index_stride == 32);
+
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+
+    /* Seek lands at most index_stride entries before the target */
+    assert(unilog_segment_seek(&reader, 700) == UNILOG_OK);
+    int skipped = 0;
+    do {
+        assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) > 0);
+        skipped++;
+    } while (info.timestamp < 700);
+    assert(info.timestamp == 700);
+    assert(skipped <= 32);
+
+    /* Seeking before the first entry starts at the beginning */
+    assert(unilog_segment_seek(&reader, 0) == UNILOG_OK);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 0);
+
+    fclose(file);
+    printf("✓ test_segment_index passed\n");
+}
+
+static void test_segment_invalid(void) {
+    FILE *file = tmpfile();
+    unilog_segment_reader_t reader;
+
+    fputs("This is not a segment file at all, just text", file);
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_ERR_INVALID);
+    assert(unilog_segment_reader_init(NULL, file) == UNILOG_ERR_INVALID);
+
+    fclose(file);
+    printf("✓ test_segment_invalid passed\n");
+}
+
+#if UNILOG_ENTRY_CRC
+static void test_segment_corrupt(void) {
+    FILE *file = tmpfile();
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    char read_buf[256];
+
+    assert(unilog_segment_writer_init(&writer, file, NULL, 0) == UNILOG_OK);
+    write_entry(&writer, UNILOG_LEVEL_INFO, 1, "First");
+    write_entry(&writer, UNILOG_LEVEL_INFO, 2, "Damaged on disk");
+    write_entry(&writer, UNILOG_LEVEL_INFO, 3, "Third");
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+
+    /* Flip a bit in the second message */
+    long second = (long)sizeof(unilog_segment_header_t) +
+                  (long)((sizeof(unilog_entry_header_t) + 5 + 3) & ~3u);
+    assert(fseek(file, second + (long)sizeof(unilog_entry_header_t), SEEK_SET) == 0);
+    assert(fputc('d', file) != EOF);
+
+    /* The damaged entry is skipped and counted */
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 1);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 3);
+    assert(strcmp(read_buf, "Third") == 0);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+    assert(reader.corrupt == 1);
+
+    fclose(file);
+    printf("✓ test_segment_corrupt passed\n");
+}
+#endif
+
+static void test_retention(void) {
+    unilog_retention_t policy;
+    policy.now = 1000;
+    policy.skew = 1000;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+    policy.max_age[UNILOG_LEVEL_DEBUG] = 10;
+    policy.max_age[UNILOG_LEVEL_INFO] = 100;
+
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_ERROR, 0));
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_INFO, 900));
+    assert(!unilog_retention_keep(&policy, UNILOG_LEVEL_INFO, 899));
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, 995));
+    assert(!unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, 500));
+
+    /* Entries newer than now are kept within the skew, older beyond it */
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, 2000));
+    assert(!unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, 2001));
+
+    /* Ages beyond 2^31 units: 30 days of milliseconds */
+    policy.now = 3000000000u;
+    policy.skew = 0;
+    policy.max_age[UNILOG_LEVEL_INFO] = 2592000000u;
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_INFO, 500000000u));
+    assert(!unilog_retention_keep(&policy, UNILOG_LEVEL_INFO, 400000000u));
+
+    /* Timestamps that wrapped around since are aged across the wrap */
+    policy.now = 1000;
+    policy.max_age[UNILOG_LEVEL_DEBUG] = 2000;
+    assert(unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, UINT32_MAX - 500));
+    assert(!unilog_retention_keep(&policy, UNILOG_LEVEL_DEBUG, UINT32_MAX - 1500));
+
+    printf("✓ test_retention passed\n");
+}
+
+static void test_compaction(void) {
+    FILE *inputs[2] = { tmpfile(), tmpfile() };
+    FILE *output = tmpfile();
+    unilog_segment_index_t index[16];
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_compactor_t compactor;
+    unilog_entry_info_t info;
+    char read_buf[256];
+
+    /* Two small segments with a mix of levels */
+    for (int s = 0; s < 2; s++) {
+        assert(unilog_segment_writer_init(&writer, inputs[s], NULL, 0) == UNILOG_OK);
+        for (int i = 0; i < 20; i++) {
+            uint32_t ts = s * 20 + i;
+            write_entry(&writer, UNILOG_LEVEL_DEBUG, ts, "Debug details that expire");
+            write_entry(&writer, UNILOG_LEVEL_ERROR, ts, "Error kept forever");
+        }
+        assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+    }
+
+    /* Keep DEBUG for 5 time units only */
+    unilog_retention_t policy;
+    policy.now = 39;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+    policy.max_age[UNILOG_LEVEL_DEBUG] = 5;
+
+    assert(unilog_segment_writer_init(&writer, output, index, 16) == UNILOG_OK);
+    assert(unilog_compactor_init(&compactor, inputs, 2, &writer, &policy) == UNILOG_OK);
+
+    /* Compaction proceeds in bounded steps */
+    int steps = 0;
+    unilog_result_t res;
+    while ((res = unilog_compactor_step(&compactor, 7)) == UNILOG_ERR_BUSY) {
+        steps++;
+    }
+    assert(res == UNILOG_OK);
+    assert(steps >= 80 / 7);
+    assert(compactor.kept == 40 + 6);
+    assert(compactor.dropped == 40 - 6);
+    assert(unilog_compactor_step(&compactor, 7) == UNILOG_OK);
+
+    /* Output is a single indexed segment with the retained entries */
+    assert(unilog_segment_reader_init(&reader, output) == UNILOG_OK);
+    assert(reader.header.entry_count == 46);
+    assert(reader.header.index_count > 0);
+
+    int debug_count = 0, error_count = 0;
+    int len;
+    while ((len = unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf))) >= 0) {
+        if (info.level == UNILOG_LEVEL_DEBUG) {
+            assert(info.timestamp >= 34);
+            assert(strcmp(read_buf, "Debug details that expire") == 0);
+            debug_count++;
+        } else {
+            assert(info.level == UNILOG_LEVEL_ERROR);
+            assert(strcmp(read_buf, "Error kept forever") == 0);
+            error_count++;
+        }
+    }
+    assert(len == UNILOG_ERR_EMPTY);
+    assert(debug_count == 6);
+    assert(error_count == 40);
+
+    fclose(inputs[0]);
+    fclose(inputs[1]);
+    fclose(output);
+    printf("✓ test_compaction passed\n");
+}
+
+/* A hex dump line pattern, compressible like real diagnostic dumps */
+static void fill_dump(char *dump, size_t length, uint32_t seed) {
+    for (size_t i = 0; i < length; i++) {
+        dump[i] = i % 48 == 47 ? '\n' : "0123456789abcdef "[(i * 7 + seed) % 17];
+    }
+}
+
+static void test_compaction_compressed(void) {
+    FILE *input = tmpfile();
+    FILE *output = tmpfile();
+    unilog_segment_writer_t writer;
+    unilog_segment_reader_t reader;
+    unilog_compactor_t compactor;
+    unilog_entry_info_t info = { UNILOG_LEVEL_INFO, 0, 0, UNILOG_CPU_UNKNOWN, 0 };
+    static char dump[UNILOG_SEGMENT_COMPRESS_SIZE + 1024];
+    static char read_buf[UNILOG_SEGMENT_COMPRESS_SIZE + 1024];
+    const size_t sizes[] = { 100, 2048, 8000, UNILOG_SEGMENT_COMPRESS_SIZE + 1000 };
+
+    /* Small messages, dumps, and one too large to compress */
+    assert(unilog_segment_writer_init(&writer, input, NULL, 0) == UNILOG_OK);
+    for (uint32_t i = 0; i < 4; i++) {
+        fill_dump(dump, sizes[i], i);
+        info.timestamp = i;
+        assert(unilog_segment_write(&writer, &info, dump, sizes[i]) == UNILOG_OK);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+
+    unilog_retention_t policy;
+    policy.now = 0;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+    assert(unilog_segment_writer_init(&writer, output, NULL, 0) == UNILOG_OK);
+    assert(unilog_compactor_init(&compactor, &input, 1, &writer, &policy) == UNILOG_OK);
+    unilog_compactor_set_compression(&compactor, 512);
+    unilog_result_t res;
+    while ((res = unilog_compactor_step(&compactor, 1)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(compactor.kept == 4 && compactor.compressed == 2);
+
+    /* The dumps shrink, and read back as written */
+    assert(unilog_segment_reader_init(&reader, input) == UNILOG_OK);
+    uint32_t plain_size = reader.header.data_size;
+    assert(unilog_segment_reader_init(&reader, output) == UNILOG_OK);
+    assert(reader.header.data_size < plain_size - 5000);
+    for (uint32_t i = 0; i < 4; i++) {
+        int len = unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf));
+        fill_dump(dump, sizes[i], i);
+        assert(len == (int)sizes[i]);
+        assert(info.timestamp == i && info.flags == 0);
+        assert(memcmp(read_buf, dump, sizes[i]) == 0);
+    }
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) == UNILOG_ERR_EMPTY);
+
+    /* Compressed entries are copied as they are by a later compaction */
+    FILE *again = tmpfile();
+    assert(unilog_segment_writer_init(&writer, again, NULL, 0) == UNILOG_OK);
+    assert(unilog_compactor_init(&compactor, &output, 1, &writer, &policy) == UNILOG_OK);
+    unilog_compactor_set_compression(&compactor, 512);
+    while ((res = unilog_compactor_step(&compactor, 16)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK && compactor.kept == 4 && compactor.compressed == 0);
+    assert(unilog_segment_reader_init(&reader, again) == UNILOG_OK);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) == 100);
+    assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) == 2048);
+
+    fclose(input);
+    fclose(output);
+    fclose(again);
+    printf("✓ test_compaction_compressed passed\n");
+}
+
+/* Write a segment with entries at start, start + step, ... tagged with the input number */
+static FILE *make_input(int input, uint32_t start, uint32_t step, int count) {
+    FILE *file = tmpfile();
+    unilog_segment_index_t index[4];
+    unilog_segment_writer_t writer;
+
+    assert(unilog_segment_writer_init(&writer, file, index, 4) == UNILOG_OK);
+    for (int i = 0; i < count; i++) {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "input %d entry %d", input, i);
+        write_entry(&writer, UNILOG_LEVEL_INFO, start + step * (uint32_t)i, msg);
+    }
+    assert(unilog_segment_writer_finish(&writer) == UNILOG_OK);
+    return file;
+}
+
+/* Check that a segment is ordered by timestamp, then input, then entry */
+static int check_merged(FILE *file) {
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    char read_buf[64];
+    uint32_t last_ts = 0;
+    int last_input = -1, count = 0;
+    int last_entry[3] = { -1, -1, -1 };
+
+    assert(unilog_segment_reader_init(&reader, file) == UNILOG_OK);
+    while (unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) >= 0) {
+        int input, entry;
+        assert(sscanf(read_buf, "input %d entry %d", &input, &entry) == 2);
+        assert(info.timestamp > last_ts || (info.timestamp == last_ts && input > last_input) ||
+               count == 0);
+        assert(entry == last_entry[input] + 1);
+        last_entry[input] = entry;
+        last_ts = info.timestamp;
+        last_input = input;
+        count++;
+    }
+    return count;
+}
+
+static void test_merge(void) {
+    FILE *inputs[3] = {
+        make_input(0, 0, 3, 40),    /* 0, 3, 6, ... */
+        make_input(1, 0, 2, 60),    /* 0, 2, 4, ... ties with input 0 */
+        make_input(2, 50, 1, 20),   /* 50 .. 69 */
+    };
+    unilog_merge_source_t sources[3];
+    uint32_t heap[3];
+    unilog_segment_index_t index[8];
+    unilog_segment_writer_t writer;
+    unilog_merger_t merger;
+    unilog_result_t res;
+
+    /* Full merge */
+    FILE *output = tmpfile();
+    assert(unilog_segment_writer_init(&writer, output, index, 8) == UNILOG_OK);
+    assert(unilog_merger_init(&merger, inputs, NULL, NULL, 3, sources, heap, NULL, &writer) == UNILOG_OK);
+    while ((res = unilog_merger_step(&merger, 7)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(merger.merged == 120);
+    assert(check_merged(output) == 120);
+
+    /* The index tells how entries are spread over time */
+    unilog_segment_reader_t reader;
+    unilog_segment_index_t entry;
+    assert(unilog_segment_reader_init(&reader, inputs[1]) == UNILOG_OK);
+    assert(reader.header.index_count > 1);
+    assert(unilog_segment_index_entry(&reader, 1, &entry) == UNILOG_OK);
+    assert(entry.timestamp == 2 * reader.header.index_stride);
+    assert(unilog_segment_index_entry(&reader, reader.header.index_count, &entry) ==
+           UNILOG_ERR_INVALID);
+    unilog_segment_index_t run[16];
+    uint32_t run_count = reader.header.index_count;
+    assert(run_count <= 16);
+    assert(unilog_segment_read_index(&reader, 0, run, run_count) == UNILOG_OK);
+    assert(run[0].timestamp == 0 && run[1].timestamp == entry.timestamp);
+    assert(unilog_segment_read_index(&reader, 1, run, run_count) == UNILOG_ERR_INVALID);
+
+    /* Partitioned merge: cut every input at timestamp 61, merge both halves */
+    uint32_t cut[3], zero[3] = { 0, 0, 0 };
+    const uint32_t first_after[3] = { 63, 62, 61 };
+    for (int i = 0; i < 3; i++) {
+        unilog_entry_info_t info;
+        char read_buf[64];
+        assert(unilog_segment_reader_init(&reader, inputs[i]) == UNILOG_OK);
+        assert(unilog_segment_find(&reader, 61) == UNILOG_OK);
+        cut[i] = reader.offset;
+        assert(unilog_segment_read(&reader, &info, read_buf, sizeof(read_buf)) >= 0);
+        assert(info.timestamp == first_after[i]);
+    }
+
+    FILE *halves[2] = { tmpfile(), tmpfile() };
+    uint32_t merged = 0;
+    for (int h = 0; h < 2; h++) {
+        assert(unilog_segment_writer_init(&writer, halves[h], index, 8) == UNILOG_OK);
+        assert(unilog_merger_init(&merger, inputs, h == 0 ? zero : cut, h == 0 ? cut : NULL, 3,
+                                  sources, heap, NULL, &writer) == UNILOG_OK);
+        while ((res = unilog_merger_step(&merger, 100)) == UNILOG_ERR_BUSY) {
+        }
+        assert(res == UNILOG_OK);
+        merged += merger.merged;
+    }
+    assert(merged == 120);
+
+    /* Concatenated halves are the same timeline */
+    unilog_retention_t policy;
+    unilog_compactor_t compactor;
+    policy.now = 0;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+    FILE *joined = tmpfile();
+    assert(unilog_segment_writer_init(&writer, joined, index, 8) == UNILOG_OK);
+    assert(unilog_compactor_init(&compactor, halves, 2, &writer, &policy) == UNILOG_OK);
+    while ((res = unilog_compactor_step(&compactor, 100)) == UNILOG_ERR_BUSY) {
+    }
+    assert(res == UNILOG_OK);
+    assert(check_merged(joined) == 120);
+
+    for (int i = 0; i < 3; i++) {
+        fclose(inputs[i]);
+    }
+    fclose(output);
+    fclose(halves[0]);
+    fclose(halves[1]);
+    fclose(joined);
+    printf("✓ test_merge passed\n");
+}
+
+int main(void) {
+    printf("Running segment tests...\n\n");
+
+    test_segment_roundtrip();
+    test_segment_index();
+    test_segment_invalid();
+#if UNILOG_ENTRY_CRC
+    test_segment_corrupt();
+#endif
+    test_retention();
+    test_compaction();
+    test_compaction_compressed();
+    test_merge();
+
+    printf("\n✓ All segment tests passed!\n");
+    return 0;
+}
@@ -3,6 +3,8 @@
  * @brief Signal safety tests for unilog
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <unilog/unilog.h>
 #include <stdio.h>
 #include <pthread.h>
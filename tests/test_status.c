@@ -0,0 +1,149 @@
+/**
+ * @file test_status.c
+ * @brief Status board tests for unilog
+ */
+
+#include <unilog/unilog_status.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_KEYS 4
+#define UPDATES 200000
+
+static void test_status_basic(void) {
+    unilog_status_slot_t slots[NUM_KEYS];
+    unilog_status_t board;
+    unilog_status_value_t value;
+
+    assert(unilog_status_init(&board, slots, NUM_KEYS) == UNILOG_OK);
+    assert(unilog_status_get(&board, 0, &value) == UNILOG_ERR_EMPTY);
+
+    assert(unilog_status_set(&board, 0, 10, "link down", 9) == UNILOG_OK);
+    assert(unilog_status_set(&board, 0, 20, "link up", 7) == UNILOG_OK);
+    assert(unilog_status_format(&board, 1, 30, "queue depth %d", 37) == UNILOG_OK);
+
+    /* Only the latest value is kept */
+    assert(unilog_status_get(&board, 0, &value) == UNILOG_OK);
+    assert(strcmp(value.value, "link up") == 0);
+    assert(value.timestamp == 20);
+    assert(value.version == 2);
+
+    assert(unilog_status_get(&board, 1, &value) == UNILOG_OK);
+    assert(strcmp(value.value, "queue depth 37") == 0);
+    assert(value.version == 1);
+
+    /* Formatted values are truncated, raw values must fit */
+    char big[UNILOG_STATUS_VALUE_SIZE + 1];
+    memset(big, 'x', sizeof(big));
+    assert(unilog_status_set(&board, 2, 0, big, sizeof(big)) == UNILOG_ERR_INVALID);
+    assert(unilog_status_format(&board, 2, 0, "%.*s", (int)sizeof(big), big) == UNILOG_OK);
+    assert(unilog_status_get(&board, 2, &value) == UNILOG_OK);
+    assert(value.length == UNILOG_STATUS_VALUE_SIZE);
+
+    /* Invalid keys */
+    assert(unilog_status_set(&board, NUM_KEYS, 0, "x", 1) == UNILOG_ERR_INVALID);
+    assert(unilog_status_get(&board, NUM_KEYS, &value) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_status_basic passed\n");
+}
+
+static void test_status_snapshot(void) {
+    unilog_status_slot_t slots[NUM_KEYS];
+    unilog_status_t board;
+    unilog_status_value_t before[NUM_KEYS], after[NUM_KEYS];
+
+    assert(unilog_status_init(&board, slots, NUM_KEYS) == UNILOG_OK);
+    assert(unilog_status_set(&board, 0, 1, "a", 1) == UNILOG_OK);
+    assert(unilog_status_set(&board, 3, 1, "b", 1) == UNILOG_OK);
+    assert(unilog_status_snapshot(&board, before, NUM_KEYS) == 2);
+    assert(before[1].version == 0);
+
+    /* Versions tell which keys changed between snapshots */
+    assert(unilog_status_set(&board, 3, 2, "c", 1) == UNILOG_OK);
+    assert(unilog_status_snapshot(&board, after, NUM_KEYS) == 2);
+    assert(after[0].version == before[0].version);
+    assert(after[3].version != before[3].version);
+    assert(strcmp(after[3].value, "c") == 0);
+
+    assert(unilog_status_snapshot(&board, after, NUM_KEYS - 1) == UNILOG_ERR_INVALID);
+
+    printf("✓ test_status_snapshot passed\n");
+}
+
+static void test_status_interrupted(void) {
+    unilog_status_slot_t slots[1];
+    unilog_status_t board;
+    unilog_status_value_t value;
+
+    assert(unilog_status_init(&board, slots, 1) == UNILOG_OK);
+    assert(unilog_status_set(&board, 0, 1, "old", 3) == UNILOG_OK);
+
+    /* Simulate an update interrupted halfway */
+    atomic_fetch_add(&slots[0].seq, 1);
+    assert(unilog_status_set(&board, 0, 2, "new", 3) == UNILOG_ERR_BUSY);
+    assert(unilog_status_get(&board, 0, &value) == UNILOG_ERR_BUSY);
+
+    atomic_fetch_add(&slots[0].seq, 1);
+    assert(unilog_status_get(&board, 0, &value) == UNILOG_OK);
+    assert(strcmp(value.value, "old") == 0);
+
+    printf("✓ test_status_interrupted passed\n");
+}
+
+static unilog_status_t g_board;
+static _Atomic(int) g_done;
+
+static void *writer_thread(void *arg) {
+    (void)arg;
+    char value[UNILOG_STATUS_VALUE_SIZE];
+
+    /* Every value consists of one repeated digit, with the timestamp matching it */
+    for (uint32_t i = 0; i < UPDATES; i++) {
+        memset(value, '0' + (char)(i % 10), sizeof(value));
+        assert(unilog_status_set(&g_board, 0, i % 10, value, 1 + i % sizeof(value)) == UNILOG_OK);
+    }
+    atomic_store(&g_done, 1);
+    return NULL;
+}
+
+static void test_status_concurrent(void) {
+    unilog_status_slot_t slots[1];
+    unilog_status_value_t value;
+    pthread_t writer;
+    int consistent = 0;
+
+    assert(unilog_status_init(&g_board, slots, 1) == UNILOG_OK);
+    pthread_create(&writer, NULL, writer_thread, NULL);
+
+    /* Snapshots never mix two updates */
+    while (!atomic_load(&g_done)) {
+        if (unilog_status_get(&g_board, 0, &value) != UNILOG_OK) {
+            continue;
+        }
+        assert(value.length >= 1 && value.length <= UNILOG_STATUS_VALUE_SIZE);
+        for (uint32_t i = 0; i < value.length; i++) {
+            assert(value.value[i] == '0' + (char)value.timestamp);
+        }
+        consistent++;
+    }
+    pthread_join(writer, NULL);
+
+    assert(unilog_status_get(&g_board, 0, &value) == UNILOG_OK);
+    assert(value.version == UPDATES);
+
+    printf("✓ test_status_concurrent passed (%d snapshots)\n", consistent);
+}
+
+int main(void) {
+    printf("Running status board tests...\n\n");
+
+    test_status_basic();
+    test_status_snapshot();
+    test_status_interrupted();
+    test_status_concurrent();
+
+    printf("\n✓ All status board tests passed!\n");
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <unilog/unilog.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <assert.h>
 
@@ -244,6 +245,178 @@ static void test_level_change_concurrent(void) {
     printf("✓ test_level_change_concurrent passed\n");
 }
 
+static void *other_thread_debug(void *arg) {
+    (void)arg;
+    
+    /* Overrides of other threads do not apply here */
+    assert(unilog_get_thread_level() == UNILOG_LEVEL_NONE);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_DEBUG, 2, "Other thread debug") == UNILOG_OK);
+    return NULL;
+}
+
+static void test_thread_level(void) {
+    uint8_t buffer[1024];
+    char read_buf[64];
+    unilog_level_t level;
+    uint32_t timestamp;
+    
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    unilog_set_level(&g_log, UNILOG_LEVEL_WARN);
+    
+    /* Enable DEBUG for this thread only, e.g. while handling one request */
+    unilog_level_t previous = unilog_set_thread_level(UNILOG_LEVEL_DEBUG);
+    assert(previous == UNILOG_LEVEL_NONE);
+    assert(unilog_get_thread_level() == UNILOG_LEVEL_DEBUG);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_DEBUG, 1, "Request debug") == UNILOG_OK);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_TRACE, 1, "Still filtered") == UNILOG_OK);
+    
+    pthread_t other;
+    pthread_create(&other, NULL, other_thread_debug, NULL);
+    pthread_join(other, NULL);
+    
+    /* Only this thread's DEBUG entry was recorded */
+    assert(unilog_read(&g_log, &level, &timestamp, read_buf, sizeof(read_buf)) > 0);
+    assert(level == UNILOG_LEVEL_DEBUG);
+    assert(strcmp(read_buf, "Request debug") == 0);
+    assert(unilog_is_empty(&g_log));
+    
+    /* The override cannot raise the threshold above the log's own */
+    unilog_set_thread_level(UNILOG_LEVEL_FATAL);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_WARN, 3, "Warning") == UNILOG_OK);
+    assert(!unilog_is_empty(&g_log));
+    assert(unilog_read(&g_log, &level, &timestamp, read_buf, sizeof(read_buf)) > 0);
+    
+    unilog_set_thread_level(previous);
+    assert(unilog_get_thread_level() == UNILOG_LEVEL_NONE);
+    unilog_set_thread_level(UNILOG_LEVEL_TRACE);
+    unilog_clear_thread_level();
+    assert(unilog_write(&g_log, UNILOG_LEVEL_DEBUG, 4, "Filtered again") == UNILOG_OK);
+    assert(unilog_is_empty(&g_log));
+    
+    printf("✓ test_thread_level passed\n");
+}
+
+typedef struct {
+    int count;
+    long long timestamp_sum;
+    uint32_t last_timestamp;
+} helped_sink_t;
+
+static void helped_sink(void *ctx, const unilog_entry_info_t *info, const char *message,
+                        size_t length) {
+    helped_sink_t *sink = (helped_sink_t *)ctx;
+    (void)message;
+    (void)length;
+    
+    /* Only one producer drains at a time */
+    sink->count++;
+    sink->timestamp_sum += info->timestamp;
+    sink->last_timestamp = info->timestamp;
+}
+
+static void test_helping_single(void) {
+    uint8_t buffer[256];
+    char helper_buf[64];
+    helped_sink_t sink = { 0 };
+    unilog_helper_t helper = {
+        .sink = helped_sink,
+        .ctx = &sink,
+        .buffer = helper_buf,
+        .buffer_size = sizeof(helper_buf),
+        .max_batch = 4,
+    };
+    
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_set_helper(&g_log, NULL) == UNILOG_OK);
+    helper.max_batch = 0;
+    assert(unilog_set_helper(&g_log, &helper) == UNILOG_ERR_INVALID);
+    helper.max_batch = 4;
+    
+    /* Fill the log */
+    uint32_t written = 0;
+    while (unilog_write(&g_log, UNILOG_LEVEL_INFO, written, "Helping test message") ==
+           UNILOG_OK) {
+        written++;
+    }
+    
+    /* Without opting in, a full log still drops */
+    assert(unilog_set_helper(&g_log, &helper) == UNILOG_OK);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_INFO, written, "Helping test message") ==
+           UNILOG_ERR_FULL);
+    
+    /* Opted in, the producer drains one batch in order and retries */
+    assert(unilog_set_thread_helping(true) == false);
+    assert(unilog_write(&g_log, UNILOG_LEVEL_INFO, written, "Helping test message") ==
+           UNILOG_OK);
+    assert(sink.count == 4);
+    assert(sink.last_timestamp == 3);
+    assert(atomic_load(&helper.helped) == 4);
+    
+    /* The consumer continues where the producer stopped */
+    char read_buf[64];
+    unilog_entry_info_t info;
+    assert(unilog_read_entry(&g_log, &info, read_buf, sizeof(read_buf)) > 0);
+    assert(info.timestamp == 4);
+    
+    assert(unilog_set_thread_helping(false) == true);
+    printf("✓ test_helping_single passed\n");
+}
+
+#define HELPING_THREADS 4
+#define HELPING_MESSAGES 2000
+
+static void *helping_producer(void *arg) {
+    int tid = (int)(size_t)arg;
+    
+    unilog_set_thread_helping(true);
+    for (int i = 0; i < HELPING_MESSAGES; i++) {
+        while (unilog_format(&g_log, UNILOG_LEVEL_INFO, (uint32_t)(tid * HELPING_MESSAGES + i),
+                             "Thread %d message %d", tid, i) == UNILOG_ERR_FULL) {
+            /* Only when the consumer or another producer holds the token */
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_helping_concurrent(void) {
+    static uint8_t buffer[512];
+    char helper_buf[64];
+    helped_sink_t sink = { 0 };
+    unilog_helper_t helper = {
+        .sink = helped_sink,
+        .ctx = &sink,
+        .buffer = helper_buf,
+        .buffer_size = sizeof(helper_buf),
+        .max_batch = 8,
+    };
+    pthread_t threads[HELPING_THREADS];
+    pthread_t consumer;
+    
+    unilog_init(&g_log, buffer, sizeof(buffer));
+    assert(unilog_set_helper(&g_log, &helper) == UNILOG_OK);
+    atomic_store(&g_running, 1);
+    atomic_store(&g_read_count, 0);
+    pthread_create(&consumer, NULL, consumer_thread, NULL);
+    for (int i = 0; i < HELPING_THREADS; i++) {
+        pthread_create(&threads[i], NULL, helping_producer, (void *)(size_t)i);
+    }
+    for (int i = 0; i < HELPING_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    atomic_store(&g_running, 0);
+    pthread_join(consumer, NULL);
+    
+    /* Every entry went to exactly one of the consumer and the sink */
+    int total = HELPING_THREADS * HELPING_MESSAGES;
+    assert(atomic_load(&g_read_count) + sink.count == total);
+    assert((int)atomic_load(&helper.helped) == sink.count);
+    assert(unilog_is_empty(&g_log));
+    
+    printf("✓ test_helping_concurrent passed (consumer: %d, helped: %d)\n",
+           atomic_load(&g_read_count), sink.count);
+}
+
 int main(void) {
     printf("Running thread safety tests...\n\n");
     
@@ -251,6 +424,9 @@ int main(void) {
     test_concurrent_read_write();
     test_mixed_operations();
     test_level_change_concurrent();
+    test_thread_level();
+    test_helping_single();
+    test_helping_concurrent();
     
     printf("\n✓ All thread safety tests passed!\n");
     return 0;
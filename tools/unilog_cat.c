@@ -0,0 +1,206 @@
+/**
+ * @file unilog_cat.c
+ * @brief Decode segment files and ring dumps from any target
+ *
+ * Usage: unilog_cat [-r] [-o OUTPUT] FILE...
+ *
+ * Prints the entries of each FILE, which may be a segment or a ring
+ * dump (unilog_dump_header_t followed by the buffer). Interned strings
+ * are expanded, with definitions tracked per file. With -o, entries are
+ * converted into a native segment instead of being printed, keeping
+ * definitions and references as they are. With -r, emails, card numbers
+ * and secrets are masked; in -o output, interned entries are then
+ * written expanded, as plain entries, so that interned strings are
+ * masked too, and definition records are left out.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <unilog/unilog_decode.h>
+#include <unilog/unilog_intern.h>
+#include <unilog/unilog_redact.h>
+#include <unilog/unilog_segment.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Largest message printed in full */
+#define MESSAGE_BUFFER_SIZE 65536
+
+/* Maximum number of time index entries in the output segment */
+#define INDEX_CAPACITY 4096
+
+/* Interned strings tracked per input file */
+#define INTERN_CAPACITY 65536
+#define INTERN_ARENA_SIZE (INTERN_CAPACITY * 16)
+
+static unilog_intern_map_t intern_map;
+
+/* Redaction rules, NULL without -r */
+static const unilog_redactor_t *redactor;
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-r] [-o OUTPUT] FILE...\n", argv0);
+}
+
+/* Print or archive one entry */
+static int handle_entry(void *ctx, const unilog_entry_info_t *info,
+                        const char *message, size_t length) {
+    static char expanded[MESSAGE_BUFFER_SIZE];
+    unilog_segment_writer_t *writer = (unilog_segment_writer_t *)ctx;
+    if (writer && !redactor) {
+        return unilog_segment_write(writer, info, message, length) == UNILOG_OK ? 0 : 1;
+    }
+
+    /* Interned strings are only seen, and masked, once expanded */
+    int expanded_length = unilog_intern_process(&intern_map, info, message, length,
+                                                expanded, sizeof(expanded));
+    if (expanded_length < 0) {
+        /* Definition records are not printed, nor archived once expanded */
+        return 0;
+    }
+    message = expanded;
+    length = (size_t)expanded_length;
+    if (redactor) {
+        unilog_redact(redactor, expanded, length);
+    }
+
+    if (writer) {
+        unilog_entry_info_t plain = *info;
+        plain.flags &= ~(uint32_t)UNILOG_FLAG_INTERNED;
+        return unilog_segment_write(writer, &plain, message, length) == UNILOG_OK ? 0 : 1;
+    }
+
+    if (info->thread_id != 0) {
+        printf("[%u] %s (tid %u, cpu %d): %.*s\n", info->timestamp,
+               unilog_level_name(info->level), info->thread_id, (int)info->cpu_id,
+               (int)length, message);
+    } else {
+        printf("[%u] %s: %.*s\n", info->timestamp, unilog_level_name(info->level),
+               (int)length, message);
+    }
+    return 0;
+}
+
+static int cat_segment(const char *name, FILE *file, unilog_segment_writer_t *writer) {
+    static char message[MESSAGE_BUFFER_SIZE];
+    unilog_segment_reader_t reader;
+    unilog_entry_info_t info;
+    int len;
+
+    if (unilog_segment_reader_init(&reader, file) != UNILOG_OK) {
+        return -1;
+    }
+    while ((len = unilog_segment_read(&reader, &info, message, sizeof(message))) >= 0) {
+        if (handle_entry(writer, &info, message, (size_t)len) != 0) {
+            return -1;
+        }
+    }
+    if (reader.corrupt > 0) {
+        fprintf(stderr, "%s: skipped %u corrupt regions\n", name, reader.corrupt);
+    }
+    return len == UNILOG_ERR_EMPTY ? 0 : -1;
+}
+
+static int cat_dump(const char *name, FILE *file, unilog_segment_writer_t *writer) {
+    static char scratch[MESSAGE_BUFFER_SIZE];
+    unilog_decode_stats_t stats;
+    long size;
+
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 ||
+        fseek(file, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    void *dump = malloc((size_t)size);
+    if (!dump || fread(dump, 1, (size_t)size, file) != (size_t)size) {
+        free(dump);
+        return -1;
+    }
+
+    int count = unilog_decode_dump(dump, (size_t)size, scratch, sizeof(scratch),
+                                   handle_entry, writer, &stats);
+    free(dump);
+    if (count >= 0 && stats.corrupt > 0) {
+        fprintf(stderr, "%s: skipped %u corrupt regions (%u bytes)\n", name,
+                stats.corrupt, stats.corrupt_bytes);
+    }
+    return count < 0 ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    static unilog_redactor_t rules;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ro:")) != -1) {
+        switch (opt) {
+            case 'r':
+                unilog_redactor_init(&rules, UNILOG_REDACT_ALL);
+                redactor = &rules;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static unilog_intern_entry_t intern_entries[INTERN_CAPACITY];
+    static char intern_arena[INTERN_ARENA_SIZE];
+    unilog_intern_map_init(&intern_map, intern_entries, INTERN_CAPACITY,
+                           intern_arena, sizeof(intern_arena));
+
+    static unilog_segment_index_t index[INDEX_CAPACITY];
+    unilog_segment_writer_t writer;
+    FILE *out = NULL;
+    if (output) {
+        out = fopen(output, "wb");
+        if (!out || unilog_segment_writer_init(&writer, out, index, INDEX_CAPACITY) != UNILOG_OK) {
+            perror(output);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    for (int i = optind; i < argc; i++) {
+        FILE *file = fopen(argv[i], "rb");
+        char magic[4];
+        if (!file) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+
+        int result = -1;
+        unilog_intern_map_reset(&intern_map);
+        if (fread(magic, sizeof(magic), 1, file) == 1) {
+            if (memcmp(magic, UNILOG_SEGMENT_MAGIC, sizeof(magic)) == 0) {
+                result = cat_segment(argv[i], file, out ? &writer : NULL);
+            } else if (memcmp(magic, UNILOG_DUMP_MAGIC, sizeof(magic)) == 0) {
+                result = cat_dump(argv[i], file, out ? &writer : NULL);
+            }
+        }
+        if (result != 0) {
+            fprintf(stderr, "%s: invalid or unsupported file\n", argv[i]);
+            status = 1;
+        }
+        fclose(file);
+    }
+
+    if (out) {
+        if (unilog_segment_writer_finish(&writer) != UNILOG_OK) {
+            fprintf(stderr, "%s: failed to finish segment\n", output);
+            status = 1;
+        }
+        fclose(out);
+    }
+    return status;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file unilog_compact.c
+ * @brief Compact archived segments according to a retention policy
+ *
+ * Usage: unilog_compact [-n NOW] [-k SKEW] [-r LEVEL=AGE|forever]... [-z BYTES]
+ *                       -o OUTPUT INPUT...
+ *
+ * Merges the input segments (oldest first) into OUTPUT, dropping entries
+ * older than the retention configured for their level, and rebuilds the
+ * time index. Ages count from NOW, by default the newest timestamp in the
+ * inputs; entries up to SKEW ahead of NOW are kept. With -z, retained
+ * messages of at least BYTES are LZ compressed. Runs at idle I/O
+ * priority where supported, in small steps, so it can be left running
+ * next to a live sink.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <unilog/unilog_segment.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/* Entries processed per compaction step */
+#define STEP_ENTRIES 1024
+
+/* Maximum number of input segments */
+#define MAX_INPUTS 256
+
+/* Maximum number of time index entries in the output segment */
+#define INDEX_CAPACITY 4096
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n NOW] [-k SKEW] [-r LEVEL=AGE|forever]... [-z BYTES]\n"
+            "          -o OUTPUT INPUT...\n",
+            argv0);
+}
+
+/* Lower our I/O priority so compaction yields to the sink */
+static void set_idle_io_priority(void) {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    const int ioprio_who_process = 1;
+    const int ioprio_class_idle = 3;
+    syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << 13);
+#endif
+}
+
+/* Parse a LEVEL=AGE retention rule into the policy */
+static int parse_rule(unilog_retention_t *policy, const char *rule) {
+    const char *eq = strchr(rule, '=');
+    if (!eq) {
+        return -1;
+    }
+    unilog_level_t level = unilog_level_from_name(rule, eq - rule);
+    if (level == UNILOG_LEVEL_NONE) {
+        return -1;
+    }
+    if (strcmp(eq + 1, "forever") == 0) {
+        policy->max_age[level] = UNILOG_RETAIN_FOREVER;
+    } else {
+        policy->max_age[level] = (uint32_t)strtoul(eq + 1, NULL, 0);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    unilog_retention_t policy;
+    const char *output = NULL;
+    bool have_now = false;
+    uint32_t compress_threshold = 0;
+    int opt;
+
+    policy.now = 0;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+
+    while ((opt = getopt(argc, argv, "n:k:r:z:o:")) != -1) {
+        switch (opt) {
+            case 'n':
+                policy.now = (uint32_t)strtoul(optarg, NULL, 0);
+                have_now = true;
+                break;
+            case 'k':
+                policy.skew = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                if (parse_rule(&policy, optarg) != 0) {
+                    fprintf(stderr, "Invalid retention rule: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'z':
+                compress_threshold = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    size_t input_count = (size_t)(argc - optind);
+    if (!output || input_count == 0 || input_count > MAX_INPUTS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    set_idle_io_priority();
+
+    static FILE *inputs[MAX_INPUTS];
+    for (size_t i = 0; i < input_count; i++) {
+        inputs[i] = fopen(argv[optind + i], "rb");
+        if (!inputs[i]) {
+            perror(argv[optind + i]);
+            return 1;
+        }
+    }
+
+    /* Without -n, age entries relative to the newest one */
+    if (!have_now) {
+        for (size_t i = 0; i < input_count; i++) {
+            unilog_segment_reader_t reader;
+            if (unilog_segment_reader_init(&reader, inputs[i]) != UNILOG_OK) {
+                fprintf(stderr, "Invalid segment: %s\n", argv[optind + i]);
+                return 1;
+            }
+            if (reader.header.entry_count > 0 && reader.header.ts_max > policy.now) {
+                policy.now = reader.header.ts_max;
+            }
+        }
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+
+    static unilog_segment_index_t index[INDEX_CAPACITY];
+    unilog_segment_writer_t writer;
+    unilog_compactor_t compactor;
+    if (unilog_segment_writer_init(&writer, out, index, INDEX_CAPACITY) != UNILOG_OK ||
+        unilog_compactor_init(&compactor, inputs, input_count, &writer, &policy) != UNILOG_OK) {
+        fprintf(stderr, "Failed to start compaction\n");
+        return 1;
+    }
+    unilog_compactor_set_compression(&compactor, compress_threshold);
+
+    unilog_result_t result;
+    while ((result = unilog_compactor_step(&compactor, STEP_ENTRIES)) == UNILOG_ERR_BUSY) {
+        /* Keep going - the idle I/O class already throttles us */
+    }
+
+    if (result != UNILOG_OK) {
+        fprintf(stderr, "Compaction failed in %s\n", argv[optind + compactor.current]);
+        return 1;
+    }
+
+    printf("kept %u entries (%u compressed), dropped %u entries\n", compactor.kept,
+           compactor.compressed, compactor.dropped);
+
+    fclose(out);
+    for (size_t i = 0; i < input_count; i++) {
+        fclose(inputs[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,477 @@
+/**
+ * @file unilog_ingest.c
+ * @brief Convert text logs into indexed segments
+ *
+ * Usage: unilog_ingest [-j JOBS] -o OUTPUT INPUT...
+ *
+ * Reads text logs in the line format printed by unilog_cat,
+ *
+ *   [TIMESTAMP] LEVEL: message
+ *   [TIMESTAMP] LEVEL (tid THREAD, cpu CPU): message
+ *
+ * and writes their entries, in input order, into one indexed segment.
+ * Each input is mapped into memory and split into JOBS chunks at line
+ * boundaries, which are scanned for newlines with SSE2 or NEON and
+ * parsed in parallel. Lines in other formats are counted and skipped.
+ *
+ * Messages are then encoded in order. Words containing digits are taken
+ * as variable and the text between them as the message template; each
+ * template part long enough to save space is interned once it has been
+ * seen twice, so repeated messages shrink to references plus their
+ * variable parts. The result reads back with unilog_cat and
+ * unilog_query like any other segment.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <unilog/unilog_intern.h>
+#include <unilog/unilog_segment.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define INGEST_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define INGEST_NEON 1
+#endif
+
+/* Maximum number of chunks parsed in parallel */
+#define MAX_JOBS 64
+
+/* Maximum number of time index entries in the output segment */
+#define INDEX_CAPACITY 4096
+
+/* Interned template parts */
+#define INTERN_CAPACITY 65536
+
+/* Template parts remembered as seen once */
+#define SEEN_BITS 20
+
+/* Every part holds at least one byte, so this many always suffice */
+#define MAX_PARTS UNILOG_INTERN_MESSAGE_SIZE
+
+/* Ring the encoded entries pass through on their way to the segment */
+#define RING_SIZE 4096
+
+typedef struct {
+    unilog_entry_info_t info;
+    uint32_t offset;        /* Message offset in the input */
+    uint32_t length;        /* Message length */
+} record_t;
+
+typedef struct {
+    const char *begin;      /* First byte of the chunk */
+    const char *end;        /* Byte after the chunk */
+    const char *base;       /* Start of the input, for offsets */
+    record_t *records;      /* Parsed lines */
+    size_t count;           /* Number of parsed lines */
+    size_t capacity;        /* Size of records */
+    size_t unparsed;        /* Lines in other formats */
+    int status;             /* 0 on success */
+} chunk_t;
+
+typedef struct {
+    unilog_t log;
+    unilog_intern_t table;
+    unilog_segment_writer_t writer;
+    uint64_t *seen;         /* Hashes of template parts seen once */
+    uint64_t in_bytes;      /* Message bytes read */
+    uint64_t entries;       /* Entries written */
+} encoder_t;
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-j JOBS] -o OUTPUT INPUT...\n", argv0);
+}
+
+/* Position of the first newline in [p, end), or end */
+static const char *find_newline(const char *p, const char *end) {
+#if defined(INGEST_SSE2)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+        if (mask) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+    }
+#elif defined(INGEST_NEON)
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)p), newline);
+        /* One nibble per byte */
+        uint64_t mask = vget_lane_u64(
+                vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        if (mask) {
+            return p + (__builtin_ctzll(mask) >> 2);
+        }
+    }
+#endif
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+static bool parse_u32(const char **p, const char *end, uint32_t *value) {
+    const char *s = *p;
+    uint64_t v = 0;
+    while (s < end && *s >= '0' && *s <= '9' && v <= UINT32_MAX) {
+        v = v * 10 + (uint64_t)(*s++ - '0');
+    }
+    if (s == *p || v > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t)v;
+    *p = s;
+    return true;
+}
+
+static bool expect(const char **p, const char *end, const char *text) {
+    size_t n = strlen(text);
+    if ((size_t)(end - *p) < n || memcmp(*p, text, n) != 0) {
+        return false;
+    }
+    *p += n;
+    return true;
+}
+
+/* Parse one line without its newline */
+static bool parse_line(const char *p, const char *end, record_t *record, const char *base) {
+    unilog_entry_info_t *info = &record->info;
+    info->thread_id = 0;
+    info->cpu_id = UNILOG_CPU_UNKNOWN;
+    info->flags = 0;
+
+    if (end > p && end[-1] == '\r') {
+        end--;
+    }
+    if (!expect(&p, end, "[") || !parse_u32(&p, end, &info->timestamp) ||
+        !expect(&p, end, "] ")) {
+        return false;
+    }
+
+    const char *name = p;
+    while (p < end && *p != ':' && *p != ' ') {
+        p++;
+    }
+    info->level = unilog_level_from_name(name, (size_t)(p - name));
+    if (info->level == UNILOG_LEVEL_NONE) {
+        return false;
+    }
+
+    if (expect(&p, end, " (tid ")) {
+        uint32_t cpu;
+        if (!parse_u32(&p, end, &info->thread_id) || !expect(&p, end, ", cpu ")) {
+            return false;
+        }
+        if (expect(&p, end, "-1")) {
+            cpu = UNILOG_CPU_UNKNOWN;
+        } else if (!parse_u32(&p, end, &cpu)) {
+            return false;
+        }
+        info->cpu_id = cpu;
+        if (!expect(&p, end, ")")) {
+            return false;
+        }
+    }
+    if (!expect(&p, end, ": ") && !expect(&p, end, ":")) {
+        return false;
+    }
+
+    record->offset = (uint32_t)(p - base);
+    record->length = (uint32_t)(end - p);
+    return true;
+}
+
+static void *parse_chunk(void *arg) {
+    chunk_t *chunk = (chunk_t *)arg;
+    const char *p = chunk->begin;
+
+    while (p < chunk->end) {
+        const char *line_end = find_newline(p, chunk->end);
+        if (chunk->count == chunk->capacity) {
+            size_t capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+            record_t *records = realloc(chunk->records, capacity * sizeof(*records));
+            if (!records) {
+                chunk->status = 1;
+                return NULL;
+            }
+            chunk->records = records;
+            chunk->capacity = capacity;
+        }
+        if (parse_line(p, line_end, &chunk->records[chunk->count], chunk->base)) {
+            chunk->count++;
+        } else if (line_end > p) {
+            chunk->unparsed++;
+        }
+        p = line_end + 1;
+    }
+    return NULL;
+}
+
+static uint64_t hash_part(const char *text, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 1099511628211ull;
+    }
+    return hash | 1;
+}
+
+/* True if the part was seen before; remembers it otherwise */
+static bool seen_before(encoder_t *encoder, const char *text, size_t length) {
+    uint64_t hash = hash_part(text, length);
+    uint32_t mask = (1u << SEEN_BITS) - 1;
+    for (uint32_t i = 0, slot = (uint32_t)hash & mask; i < 16; i++, slot = (slot + 1) & mask) {
+        if (encoder->seen[slot] == hash) {
+            return true;
+        }
+        if (encoder->seen[slot] == 0) {
+            encoder->seen[slot] = hash;
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool is_variable(const char *word, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (word[i] >= '0' && word[i] <= '9') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Add a template part, interning it if that saves space */
+static size_t add_template(encoder_t *encoder, unilog_part_t *parts, size_t count,
+                           const char *text, size_t length) {
+    while (length > 0) {
+        size_t n = length < UNILOG_INTERN_MAX_LENGTH ? length : UNILOG_INTERN_MAX_LENGTH;
+        bool intern = n > UNILOG_INTERN_REF_SIZE && seen_before(encoder, text, n);
+        parts[count++] = (unilog_part_t){ text, n, intern };
+        text += n;
+        length -= n;
+    }
+    return count;
+}
+
+/* Split a message into variable words and template parts between them */
+static size_t split_message(encoder_t *encoder, const char *m, size_t length,
+                            unilog_part_t *parts) {
+    size_t count = 0;
+    size_t template_start = 0;
+    size_t i = 0;
+
+    while (i < length) {
+        size_t word = i;
+        while (i < length && m[i] != ' ') {
+            i++;
+        }
+        if (is_variable(m + word, i - word)) {
+            count = add_template(encoder, parts, count, m + template_start, word - template_start);
+            parts[count++] = (unilog_part_t){ m + word, i - word, false };
+            template_start = i;
+        }
+        while (i < length && m[i] == ' ') {
+            i++;
+        }
+    }
+    return add_template(encoder, parts, count, m + template_start, length - template_start);
+}
+
+static size_t encoded_size(const char *m, size_t length) {
+    size_t size = length;
+    for (size_t i = 0; i < length; i++) {
+        if ((uint8_t)m[i] == UNILOG_INTERN_ESCAPE) {
+            size += UNILOG_INTERN_REF_SIZE - 1;
+        }
+    }
+    return size;
+}
+
+static int encode_record(encoder_t *encoder, const record_t *record, const char *base) {
+    const char *m = base + record->offset;
+    size_t length = record->length;
+
+    encoder->in_bytes += length;
+    encoder->entries++;
+
+    /* Longer messages do not fit interned entries and are kept as they are */
+    if (encoded_size(m, length) > UNILOG_INTERN_MESSAGE_SIZE) {
+        return unilog_segment_write(&encoder->writer, &record->info, m, length) == UNILOG_OK
+                   ? 0 : 1;
+    }
+
+    unilog_part_t parts[MAX_PARTS];
+    size_t count = split_message(encoder, m, length, parts);
+    if (unilog_intern_write(&encoder->table, record->info.level, record->info.timestamp,
+                            parts, count) != UNILOG_OK) {
+        return 1;
+    }
+
+    /* Move the entry and any definitions it made into the segment */
+    unilog_entry_info_t info;
+    char message[UNILOG_INTERN_MESSAGE_SIZE + 1];
+    int n;
+    while ((n = unilog_read_entry(&encoder->log, &info, message, sizeof(message))) >= 0) {
+        if (!(info.flags & UNILOG_FLAG_DEFINITION)) {
+            info.thread_id = record->info.thread_id;
+            info.cpu_id = record->info.cpu_id;
+        }
+        if (unilog_segment_write(&encoder->writer, &info, message, (size_t)n) != UNILOG_OK) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int ingest(encoder_t *encoder, const char *name, long jobs, size_t *unparsed) {
+    int fd = open(name, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(name);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    if ((uint64_t)st.st_size > UINT32_MAX) {
+        fprintf(stderr, "%s: inputs are limited to 4 GiB\n", name);
+        close(fd);
+        return 1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(name);
+        return 1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    /* Cut into chunks of about equal size, each ending after a newline */
+    static chunk_t chunks[MAX_JOBS];
+    pthread_t threads[MAX_JOBS];
+    const char *end = data + size;
+    const char *p = data;
+    long count = 0;
+    for (long j = 0; j < jobs && p < end; j++) {
+        const char *cut = j == jobs - 1 ? end : data + size / (size_t)jobs * (size_t)(j + 1);
+        if (cut < p) {
+            cut = p;
+        }
+        cut = cut < end ? find_newline(cut, end) : end;
+        cut = cut < end ? cut + 1 : end;
+        memset(&chunks[count], 0, sizeof(chunks[count]));
+        chunks[count].begin = p;
+        chunks[count].end = cut;
+        chunks[count].base = data;
+        p = cut;
+        count++;
+    }
+
+    int status = 0;
+    long started = 0;
+    for (; started < count; started++) {
+        if (pthread_create(&threads[started], NULL, parse_chunk, &chunks[started]) != 0) {
+            perror("pthread_create");
+            status = 1;
+            break;
+        }
+    }
+    for (long j = 0; j < started; j++) {
+        pthread_join(threads[j], NULL);
+        status |= chunks[j].status;
+    }
+
+    /* Encode in input order, which interning and the index rely on */
+    for (long j = 0; j < started; j++) {
+        for (size_t i = 0; i < chunks[j].count && status == 0; i++) {
+            status = encode_record(encoder, &chunks[j].records[i], data);
+        }
+        *unparsed += chunks[j].unparsed;
+        free(chunks[j].records);
+    }
+    if (status != 0) {
+        fprintf(stderr, "%s: failed to convert\n", name);
+    }
+
+    munmap((void *)data, size);
+    return status;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+        switch (opt) {
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (!output || optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    } else if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+
+    static encoder_t encoder;
+    static uint8_t ring[RING_SIZE];
+    static unilog_intern_slot_t slots[INTERN_CAPACITY];
+    static unilog_segment_index_t index[INDEX_CAPACITY];
+    encoder.seen = calloc((size_t)1 << SEEN_BITS, sizeof(uint64_t));
+    FILE *out = fopen(output, "wb");
+    if (!out || !encoder.seen ||
+        unilog_init(&encoder.log, ring, sizeof(ring)) != UNILOG_OK ||
+        unilog_intern_init(&encoder.table, &encoder.log, slots, INTERN_CAPACITY) != UNILOG_OK ||
+        unilog_segment_writer_init(&encoder.writer, out, index, INDEX_CAPACITY) != UNILOG_OK) {
+        perror(output);
+        return 1;
+    }
+
+    int status = 0;
+    size_t unparsed = 0;
+    for (int i = optind; i < argc && status == 0; i++) {
+        status = ingest(&encoder, argv[i], jobs, &unparsed);
+    }
+    if (unilog_segment_writer_finish(&encoder.writer) != UNILOG_OK) {
+        fprintf(stderr, "%s: failed to finish segment\n", output);
+        status = 1;
+    }
+
+    long out_bytes = fseek(out, 0, SEEK_END) == 0 ? ftell(out) : -1;
+    fclose(out);
+    free(encoder.seen);
+    if (status == 0) {
+        printf("ingested %llu entries (%llu message bytes) into %ld bytes, %zu lines skipped\n",
+               (unsigned long long)encoder.entries, (unsigned long long)encoder.in_bytes,
+               out_bytes, unparsed);
+    }
+    return status;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file unilog_merge.c
+ * @brief Merge segments from many processes and hosts into one timeline
+ *
+ * Usage: unilog_merge [-j JOBS] -o OUTPUT INPUT...
+ *
+ * Performs a k-way merge of the input segments by timestamp (ties keep
+ * the order of the inputs on the command line) into one indexed
+ * segment. The time indexes of the inputs are used to split the time
+ * range into JOBS partitions holding about the same number of entries,
+ * which are merged in parallel and then concatenated. Interned strings
+ * are expanded, since their IDs are only unique within one process.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <unilog/unilog_segment.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Entries merged per step */
+#define STEP_ENTRIES 1024
+
+/* Maximum number of input segments */
+#define MAX_INPUTS 256
+
+/* Maximum number of partitions merged in parallel */
+#define MAX_JOBS 64
+
+/* Maximum number of time index entries per output segment */
+#define INDEX_CAPACITY 4096
+
+/* Do not split inputs with fewer entries per partition than this */
+#define MIN_PARTITION_ENTRIES 4096
+
+/* Interned strings tracked per input and partition */
+#define INTERN_CAPACITY 16384
+#define INTERN_ARENA_SIZE (INTERN_CAPACITY * 16)
+
+/* Index entries read, and byte-swapped, at once */
+#define INDEX_BLOCK 256
+
+typedef struct {
+    uint32_t timestamp;     /* Timestamp of an index entry */
+    uint32_t weight;        /* Entries it stands for */
+} sample_t;
+
+typedef struct {
+    char **names;           /* Input file names */
+    uint32_t count;         /* Number of inputs */
+    uint32_t *begin;        /* First data offset per input */
+    uint32_t *end;          /* End data offset per input */
+    FILE *output;           /* Temporary segment for this partition */
+    uint32_t merged;        /* Entries merged */
+    int status;             /* 0 on success */
+} partition_t;
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-j JOBS] -o OUTPUT INPUT...\n", argv0);
+}
+
+static int compare_samples(const void *a, const void *b) {
+    uint32_t ta = ((const sample_t *)a)->timestamp;
+    uint32_t tb = ((const sample_t *)b)->timestamp;
+    return ta < tb ? -1 : ta > tb;
+}
+
+/*
+ * Choose up to jobs - 1 timestamps that split the inputs into ranges of
+ * about equal entry counts, from the index entries of all inputs.
+ */
+static uint32_t choose_boundaries(unilog_segment_reader_t *readers, uint32_t count,
+                                  uint32_t jobs, uint32_t *boundaries) {
+    uint64_t total = 0;
+    size_t sample_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += readers[i].header.entry_count;
+        sample_count += readers[i].header.index_count;
+    }
+    if (jobs > total / MIN_PARTITION_ENTRIES) {
+        jobs = (uint32_t)(total / MIN_PARTITION_ENTRIES);
+    }
+    if (jobs < 2 || sample_count == 0) {
+        return 0;
+    }
+
+    sample_t *samples = malloc(sample_count * sizeof(*samples));
+    if (!samples) {
+        return 0;
+    }
+    size_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        unilog_segment_index_t block[INDEX_BLOCK];
+        uint32_t index_count = readers[i].header.index_count;
+        for (uint32_t k = 0; k < index_count; k += INDEX_BLOCK) {
+            uint32_t run = index_count - k < INDEX_BLOCK ? index_count - k : INDEX_BLOCK;
+            if (unilog_segment_read_index(&readers[i], k, block, run) != UNILOG_OK) {
+                continue;
+            }
+            for (uint32_t j = 0; j < run; j++) {
+                samples[n].timestamp = block[j].timestamp;
+                samples[n].weight = readers[i].header.index_stride;
+                n++;
+            }
+        }
+    }
+    qsort(samples, n, sizeof(*samples), compare_samples);
+
+    /* Weighted quantiles; equal timestamps cannot be split */
+    uint32_t chosen = 0;
+    uint64_t seen = 0;
+    for (size_t k = 0; k < n && chosen < jobs - 1; k++) {
+        seen += samples[k].weight;
+        if (seen >= total * (chosen + 1) / jobs && k + 1 < n &&
+            samples[k + 1].timestamp > samples[k].timestamp) {
+            boundaries[chosen++] = samples[k + 1].timestamp;
+        }
+    }
+
+    free(samples);
+    return chosen;
+}
+
+static void *merge_partition(void *arg) {
+    partition_t *part = (partition_t *)arg;
+    static _Thread_local unilog_segment_index_t index[INDEX_CAPACITY];
+    FILE *inputs[MAX_INPUTS];
+    unilog_merge_source_t *sources = malloc(part->count * sizeof(*sources));
+    uint32_t *heap = malloc(part->count * sizeof(*heap));
+    unilog_intern_map_t *maps = calloc(part->count, sizeof(*maps));
+    uint32_t opened = 0;
+    uint32_t mapped = 0;
+
+    part->status = 1;
+    part->output = tmpfile();
+    if (!sources || !heap || !maps || !part->output) {
+        goto out;
+    }
+    for (; mapped < part->count; mapped++) {
+        unilog_intern_entry_t *entries = malloc(INTERN_CAPACITY * sizeof(*entries));
+        char *arena = malloc(INTERN_ARENA_SIZE);
+        if (!entries || !arena) {
+            free(entries);
+            free(arena);
+            goto out;
+        }
+        unilog_intern_map_init(&maps[mapped], entries, INTERN_CAPACITY, arena, INTERN_ARENA_SIZE);
+    }
+
+    /* Each partition reads through its own file handles */
+    for (; opened < part->count; opened++) {
+        inputs[opened] = fopen(part->names[opened], "rb");
+        if (!inputs[opened]) {
+            goto out;
+        }
+    }
+
+    unilog_segment_writer_t writer;
+    unilog_merger_t merger;
+    if (unilog_segment_writer_init(&writer, part->output, index, INDEX_CAPACITY) != UNILOG_OK ||
+        unilog_merger_init(&merger, inputs, part->begin, part->end, part->count, sources, heap,
+                           maps, &writer) != UNILOG_OK) {
+        goto out;
+    }
+
+    unilog_result_t result;
+    while ((result = unilog_merger_step(&merger, STEP_ENTRIES)) == UNILOG_ERR_BUSY) {
+    }
+    part->merged = merger.merged;
+    part->status = result == UNILOG_OK ? 0 : 1;
+
+out:
+    while (opened > 0) {
+        fclose(inputs[--opened]);
+    }
+    while (mapped > 0) {
+        mapped--;
+        free(maps[mapped].entries);
+        free(maps[mapped].arena);
+    }
+    free(maps);
+    free(sources);
+    free(heap);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+        switch (opt) {
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    uint32_t input_count = (uint32_t)(argc - optind);
+    if (!output || input_count == 0 || input_count > MAX_INPUTS) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    } else if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+
+    static FILE *inputs[MAX_INPUTS];
+    static unilog_segment_reader_t readers[MAX_INPUTS];
+    for (uint32_t i = 0; i < input_count; i++) {
+        inputs[i] = fopen(argv[optind + i], "rb");
+        if (!inputs[i]) {
+            perror(argv[optind + i]);
+            return 1;
+        }
+        if (unilog_segment_reader_init(&readers[i], inputs[i]) != UNILOG_OK) {
+            fprintf(stderr, "%s: invalid or unsupported file\n", argv[optind + i]);
+            return 1;
+        }
+    }
+
+    /* Cut every input at the partition boundaries. Offsets never go
+       backwards, so each entry belongs to exactly one partition even if
+       an input is not perfectly ordered. */
+    uint32_t boundaries[MAX_JOBS];
+    uint32_t partition_count = choose_boundaries(readers, input_count, (uint32_t)jobs,
+                                                 boundaries) + 1;
+    static uint32_t cuts[MAX_JOBS + 1][MAX_INPUTS];
+    for (uint32_t i = 0; i < input_count; i++) {
+        cuts[0][i] = 0;
+        cuts[partition_count][i] = readers[i].header.data_size;
+        for (uint32_t p = 1; p < partition_count; p++) {
+            if (unilog_segment_find(&readers[i], boundaries[p - 1]) != UNILOG_OK) {
+                fprintf(stderr, "%s: failed to read\n", argv[optind + i]);
+                return 1;
+            }
+            uint32_t offset = readers[i].offset;
+            cuts[p][i] = offset > cuts[p - 1][i] ? offset : cuts[p - 1][i];
+        }
+        fclose(inputs[i]);
+    }
+
+    static partition_t partitions[MAX_JOBS];
+    pthread_t threads[MAX_JOBS];
+    for (uint32_t p = 0; p < partition_count; p++) {
+        partitions[p].names = argv + optind;
+        partitions[p].count = input_count;
+        partitions[p].begin = cuts[p];
+        partitions[p].end = cuts[p + 1];
+        if (pthread_create(&threads[p], NULL, merge_partition, &partitions[p]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    int status = 0;
+    static FILE *merged[MAX_JOBS];
+    for (uint32_t p = 0; p < partition_count; p++) {
+        pthread_join(threads[p], NULL);
+        merged[p] = partitions[p].output;
+        if (partitions[p].status != 0) {
+            fprintf(stderr, "Merge of partition %u failed\n", p);
+            status = 1;
+        }
+    }
+    if (status != 0) {
+        return status;
+    }
+
+    /* Partitions cover consecutive time ranges, so concatenating them
+       (a compaction that keeps everything) yields the merged timeline */
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+    static unilog_segment_index_t index[INDEX_CAPACITY];
+    unilog_segment_writer_t writer;
+    unilog_compactor_t compactor;
+    unilog_retention_t policy;
+    policy.now = 0;
+    policy.skew = 0;
+    for (int i = 0; i < UNILOG_LEVEL_NONE; i++) {
+        policy.max_age[i] = UNILOG_RETAIN_FOREVER;
+    }
+    if (unilog_segment_writer_init(&writer, out, index, INDEX_CAPACITY) != UNILOG_OK ||
+        unilog_compactor_init(&compactor, merged, partition_count, &writer, &policy) != UNILOG_OK) {
+        fprintf(stderr, "Failed to write %s\n", output);
+        return 1;
+    }
+    unilog_result_t result;
+    while ((result = unilog_compactor_step(&compactor, STEP_ENTRIES)) == UNILOG_ERR_BUSY) {
+    }
+    if (result != UNILOG_OK) {
+        fprintf(stderr, "Failed to write %s\n", output);
+        return 1;
+    }
+
+    printf("merged %u entries from %u inputs in %u partitions\n", compactor.kept, input_count,
+           partition_count);
+
+    fclose(out);
+    for (uint32_t p = 0; p < partition_count; p++) {
+        fclose(merged[p]);
+    }
+    return 0;
+}
@@ -0,0 +1,395 @@
+/**
+ * @file unilog_query.c
+ * @brief Aggregate archived segments without formatting them
+ *
+ * Usage: unilog_query [-j JOBS] [-b BEGIN] [-e END] [-l LEVEL] [-w WIDTH] [-n TOP]
+ *                     MODE SEGMENT...
+ *
+ * MODE is one of:
+ *   histogram  entry counts per level in buckets of WIDTH timestamp units
+ *   levels     entry counts per level
+ *   formats    the TOP most frequent format strings (first interned string)
+ *   threads    the TOP busiest producer threads
+ *
+ * Only entries with timestamps in [BEGIN, END) and, except for
+ * histograms, at LEVEL or above are counted; histograms round the range
+ * up to whole buckets. Segments are decoded into
+ * columns and aggregated by JOBS threads in parallel, each taking the
+ * next segment when done with one; segments outside the time range are
+ * skipped using their headers. Format names are resolved from the
+ * definitions in the segments, which are assumed to come from one
+ * producer stream; in formats mode, segments before the range are
+ * still read for their definitions.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <unilog/unilog_aggregate.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Entries decoded per batch */
+#define BATCH_ENTRIES 4096
+
+/* Maximum number of threads */
+#define MAX_JOBS 64
+
+/* Group table slots per thread */
+#define GROUP_CAPACITY 65536
+
+/* Largest number of histogram buckets */
+#define MAX_BUCKETS (1u << 20)
+
+/* Interned strings tracked per thread */
+#define INTERN_CAPACITY 65536
+#define INTERN_ARENA_SIZE (INTERN_CAPACITY * 16)
+
+typedef enum { MODE_HISTOGRAM, MODE_LEVELS, MODE_FORMATS, MODE_THREADS } query_mode_t;
+
+typedef struct {
+    query_mode_t mode;
+    char **names;                   /* Segment file names */
+    uint32_t count;                 /* Number of segments */
+    uint32_t begin;                 /* First timestamp included */
+    uint32_t end;                   /* First timestamp excluded */
+    _Atomic(uint32_t) next;         /* Next segment to aggregate */
+} query_t;
+
+typedef struct {
+    query_t *query;
+    unilog_histogram_t histogram;
+    unilog_agg_count_t groups;
+    unilog_intern_map_t map;
+    uint64_t entries;               /* Entries decoded */
+    uint32_t skipped;               /* Segments outside the time range */
+    int status;                     /* 0 on success */
+} worker_t;
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-j JOBS] [-b BEGIN] [-e END] [-l LEVEL] [-w WIDTH] [-n TOP] "
+            "histogram|levels|formats|threads SEGMENT...\n", argv0);
+}
+
+/* Take the definitions of a segment into the map of a worker, counting nothing */
+static int load_definitions(worker_t *worker, unilog_segment_reader_t *reader) {
+    char message[UNILOG_INTERN_MAX_LENGTH + 8];
+    char expanded[1];
+    unilog_entry_info_t info;
+    int length;
+
+    while ((length = unilog_segment_read(reader, &info, message, sizeof(message))) >= 0) {
+        if (info.flags & UNILOG_FLAG_DEFINITION) {
+            unilog_intern_process(&worker->map, &info, message, (size_t)length, expanded,
+                                  sizeof(expanded));
+        }
+    }
+    return length == UNILOG_ERR_EMPTY ? 0 : 1;
+}
+
+static int aggregate_segment(worker_t *worker, const char *name, unilog_columns_t *columns) {
+    query_t *query = worker->query;
+    FILE *file = fopen(name, "rb");
+    if (!file) {
+        perror(name);
+        return 1;
+    }
+
+    unilog_segment_reader_t reader;
+    int status = 0;
+    if (unilog_segment_reader_init(&reader, file) != UNILOG_OK) {
+        fprintf(stderr, "%s: invalid or unsupported file\n", name);
+        status = 1;
+    } else if (reader.header.entry_count > 0 && reader.header.ts_min >= query->end) {
+        worker->skipped++;
+    } else if (reader.header.entry_count > 0 && reader.header.ts_max < query->begin) {
+        /* Definitions are written once per process, often long before the
+           range; formats in it are named after them */
+        if (query->mode == MODE_FORMATS && load_definitions(worker, &reader) != 0) {
+            fprintf(stderr, "%s: failed to read\n", name);
+            status = 1;
+        }
+        worker->skipped++;
+    } else {
+        /* Definitions before the range are needed to name formats */
+        if (query->mode != MODE_FORMATS && query->begin > reader.header.ts_min &&
+            unilog_segment_seek(&reader, query->begin) != UNILOG_OK) {
+            status = 1;
+        }
+        int n = 0;
+        while (status == 0 && (n = unilog_segment_read_columns(&reader, columns,
+                                                               &worker->map)) > 0) {
+            if (query->mode == MODE_HISTOGRAM) {
+                unilog_histogram_add(&worker->histogram, columns);
+            } else {
+                unilog_agg_add(&worker->groups, columns);
+            }
+            worker->entries += (uint32_t)n;
+        }
+        if (n < 0) {
+            fprintf(stderr, "%s: failed to read\n", name);
+            status = 1;
+        }
+    }
+
+    fclose(file);
+    return status;
+}
+
+static void *aggregate_main(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    query_t *query = worker->query;
+    unilog_columns_t columns;
+
+    columns.capacity = BATCH_ENTRIES;
+    columns.timestamp = malloc(BATCH_ENTRIES * sizeof(uint32_t));
+    columns.level = malloc(BATCH_ENTRIES * sizeof(uint8_t));
+    columns.format = malloc(BATCH_ENTRIES * sizeof(uint32_t));
+    columns.thread = malloc(BATCH_ENTRIES * sizeof(uint32_t));
+    if (!columns.timestamp || !columns.level || !columns.format || !columns.thread) {
+        worker->status = 1;
+    }
+
+    uint32_t i;
+    while (worker->status == 0 && (i = atomic_fetch_add(&query->next, 1)) < query->count) {
+        worker->status = aggregate_segment(worker, query->names[i], &columns);
+    }
+
+    free(columns.timestamp);
+    free(columns.level);
+    free(columns.format);
+    free(columns.thread);
+    return NULL;
+}
+
+static int init_worker(worker_t *worker, query_t *query, const unilog_agg_filter_t *filter,
+                       uint32_t width, uint32_t buckets) {
+    memset(worker, 0, sizeof(*worker));
+    worker->query = query;
+
+    unilog_group_by_t by = query->mode == MODE_FORMATS ? UNILOG_GROUP_FORMAT
+                         : query->mode == MODE_THREADS ? UNILOG_GROUP_THREAD
+                                                       : UNILOG_GROUP_LEVEL;
+    uint64_t *counts = calloc((size_t)buckets * UNILOG_LEVEL_NONE, sizeof(uint64_t));
+    unilog_agg_group_t *groups = malloc(GROUP_CAPACITY * sizeof(*groups));
+    unilog_intern_entry_t *entries = malloc(INTERN_CAPACITY * sizeof(*entries));
+    char *arena = malloc(INTERN_ARENA_SIZE);
+    if (!counts || !groups || !entries || !arena ||
+        unilog_histogram_init(&worker->histogram, query->begin, width, buckets,
+                              counts) != UNILOG_OK ||
+        unilog_agg_init(&worker->groups, by, filter, groups, GROUP_CAPACITY) != UNILOG_OK ||
+        unilog_intern_map_init(&worker->map, entries, INTERN_CAPACITY, arena,
+                               INTERN_ARENA_SIZE) != UNILOG_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+static void print_histogram(const unilog_histogram_t *histogram) {
+    printf("%-10s", "begin");
+    for (int l = 0; l < UNILOG_LEVEL_NONE; l++) {
+        printf(" %10s", unilog_level_name((unilog_level_t)l));
+    }
+    printf("\n");
+
+    for (uint32_t b = 0; b < histogram->buckets; b++) {
+        const uint64_t *counts = histogram->counts + (size_t)b * UNILOG_LEVEL_NONE;
+        printf("%-10u", histogram->begin + b * histogram->width);
+        for (int l = 0; l < UNILOG_LEVEL_NONE; l++) {
+            printf(" %10llu", (unsigned long long)counts[l]);
+        }
+        printf("\n");
+    }
+}
+
+static void print_groups(query_mode_t mode, const unilog_agg_count_t *groups, uint32_t top_count,
+                         const worker_t *workers, uint32_t jobs) {
+    unilog_agg_group_t *top = malloc(top_count * sizeof(*top));
+    if (!top) {
+        return;
+    }
+
+    uint32_t n = unilog_agg_top(groups, top, top_count);
+    for (uint32_t i = 0; i < n; i++) {
+        printf("%12llu  ", (unsigned long long)top[i].count);
+        if (mode == MODE_LEVELS) {
+            printf("%s\n", unilog_level_name((unilog_level_t)top[i].key));
+        } else if (mode == MODE_THREADS) {
+            printf("tid %u\n", top[i].key);
+        } else if (top[i].key == UNILOG_FORMAT_NONE) {
+            printf("(not interned)\n");
+        } else {
+            const char *text = NULL;
+            uint32_t length = 0;
+            for (uint32_t w = 0; w < jobs && !text; w++) {
+                text = unilog_intern_lookup(&workers[w].map, top[i].key, &length);
+            }
+            if (text) {
+                printf("%.*s\n", (int)length, text);
+            } else {
+                printf("#%u\n", top[i].key);
+            }
+        }
+    }
+    if (groups->dropped > 0) {
+        fprintf(stderr, "%llu entries not counted: too many groups\n",
+                (unsigned long long)groups->dropped);
+    }
+    free(top);
+}
+
+int main(int argc, char **argv) {
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    unilog_agg_filter_t filter = { 0, UINT32_MAX, UNILOG_LEVEL_TRACE };
+    bool has_begin = false, has_end = false;
+    uint32_t width = 0;
+    uint32_t top_count = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:b:e:l:w:n:")) != -1) {
+        switch (opt) {
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+                break;
+            case 'b':
+                filter.begin = (uint32_t)strtoul(optarg, NULL, 0);
+                has_begin = true;
+                break;
+            case 'e':
+                filter.end = (uint32_t)strtoul(optarg, NULL, 0);
+                has_end = true;
+                break;
+            case 'l':
+                filter.min_level = unilog_level_from_name(optarg, strlen(optarg));
+                if (filter.min_level == UNILOG_LEVEL_NONE) {
+                    fprintf(stderr, "Unknown level %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                width = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                top_count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind < 2 || top_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static query_t query;
+    const char *mode = argv[optind];
+    if (strcmp(mode, "histogram") == 0) {
+        query.mode = MODE_HISTOGRAM;
+    } else if (strcmp(mode, "levels") == 0) {
+        query.mode = MODE_LEVELS;
+    } else if (strcmp(mode, "formats") == 0) {
+        query.mode = MODE_FORMATS;
+    } else if (strcmp(mode, "threads") == 0) {
+        query.mode = MODE_THREADS;
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+    query.names = argv + optind + 1;
+    query.count = (uint32_t)(argc - optind - 1);
+    if (jobs < 1) {
+        jobs = 1;
+    } else if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+    if ((uint32_t)jobs > query.count) {
+        jobs = query.count;
+    }
+
+    /* Without explicit bounds, histograms cover the range of all segments */
+    if (query.mode == MODE_HISTOGRAM && (!has_begin || !has_end)) {
+        uint32_t ts_min = UINT32_MAX, ts_max = 0;
+        for (uint32_t i = 0; i < query.count; i++) {
+            FILE *file = fopen(query.names[i], "rb");
+            unilog_segment_reader_t reader;
+            if (!file || unilog_segment_reader_init(&reader, file) != UNILOG_OK) {
+                fprintf(stderr, "%s: invalid or unsupported file\n", query.names[i]);
+                return 1;
+            }
+            if (reader.header.entry_count > 0) {
+                ts_min = reader.header.ts_min < ts_min ? reader.header.ts_min : ts_min;
+                ts_max = reader.header.ts_max > ts_max ? reader.header.ts_max : ts_max;
+            }
+            fclose(file);
+        }
+        if (!has_begin) {
+            filter.begin = ts_min <= ts_max ? ts_min : 0;
+        }
+        if (!has_end) {
+            filter.end = ts_max < UINT32_MAX ? ts_max + 1 : UINT32_MAX;
+        }
+    }
+    query.begin = filter.begin;
+    query.end = filter.end;
+
+    uint32_t buckets = 1;
+    if (query.mode == MODE_HISTOGRAM) {
+        uint32_t span = query.end > query.begin ? query.end - query.begin : 0;
+        if (width == 0 || span == 0 || span / width >= MAX_BUCKETS) {
+            fprintf(stderr, "Histograms need -w WIDTH, giving at most %u buckets\n", MAX_BUCKETS);
+            return 1;
+        }
+        buckets = span / width + (span % width != 0);
+        if ((uint64_t)buckets * width > UINT32_MAX) {
+            buckets--;
+        }
+    } else {
+        width = 1;
+    }
+
+    static worker_t workers[MAX_JOBS];
+    pthread_t threads[MAX_JOBS];
+    for (long w = 0; w < jobs; w++) {
+        if (init_worker(&workers[w], &query, &filter, width, buckets) != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+    for (long w = 0; w < jobs; w++) {
+        if (pthread_create(&threads[w], NULL, aggregate_main, &workers[w]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    int status = 0;
+    uint64_t entries = 0;
+    uint32_t skipped = 0;
+    for (long w = 0; w < jobs; w++) {
+        pthread_join(threads[w], NULL);
+        status |= workers[w].status;
+        entries += workers[w].entries;
+        skipped += workers[w].skipped;
+        if (w > 0) {
+            unilog_histogram_merge(&workers[0].histogram, &workers[w].histogram);
+            unilog_agg_merge(&workers[0].groups, &workers[w].groups);
+        }
+    }
+    if (status != 0) {
+        return status;
+    }
+
+    if (query.mode == MODE_HISTOGRAM) {
+        print_histogram(&workers[0].histogram);
+    } else {
+        print_groups(query.mode, &workers[0].groups, top_count, workers, (uint32_t)jobs);
+    }
+    fprintf(stderr, "decoded %llu entries from %u segments (%u skipped) with %ld jobs\n",
+            (unsigned long long)entries, query.count, skipped, jobs);
+    return 0;
+}